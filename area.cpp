@@ -39,6 +39,69 @@ Area::Area(std::string localAuthorityCode) {
     this->localAuthorityCode = std::move(localAuthorityCode);
 }
 
+/*
+  Copy or move an Area. As with a Measure, the copy is not held by any Areas
+  until it is stored in one (see Areas::setArea()), and assigning to an Area
+  counts as a change to it.
+
+  @param other
+    The Area to copy or move
+*/
+Area::Area(const Area &other)
+    : names(other.names), localAuthorityCode(other.localAuthorityCode),
+      measures(other.measures) {}
+
+Area::Area(Area &&other) noexcept
+    : names(std::move(other.names)),
+      localAuthorityCode(std::move(other.localAuthorityCode)),
+      measures(std::move(other.measures)) {
+    other.changed();
+    attach(nullptr);
+}
+
+Area &Area::operator=(const Area &other) {
+    this->names = other.names;
+    this->localAuthorityCode = other.localAuthorityCode;
+    this->measures = other.measures;
+    attach(this->changes);
+    changed();
+    return *this;
+}
+
+Area &Area::operator=(Area &&other) noexcept {
+    this->names = std::move(other.names);
+    this->localAuthorityCode = std::move(other.localAuthorityCode);
+    this->measures = std::move(other.measures);
+    other.changed();
+    attach(this->changes);
+    changed();
+    return *this;
+}
+
+/*
+  Count a change to the Area towards the Areas holding it, so indexes the
+  Areas built over it are rebuilt (see Areas::buildIndexes()).
+*/
+void Area::changed() {
+    if (this->changes != nullptr) {
+        (*this->changes)++;
+    }
+}
+
+/*
+  Count every later change to the Area, or to one of its Measures, towards
+  the given counter of the Areas now holding it (or towards none, if null).
+
+  @param changes
+    The change counter of the Areas
+*/
+void Area::attach(uint64_t *changes) {
+    this->changes = changes;
+    for (auto &measure : this->measures) {
+        measure.second.changes = changes;
+    }
+}
+
 /*
   TODO: Area::getLocalAuthorityCode()
 
@@ -118,6 +181,7 @@ std::string Area::getName(const std::string& lang) {
 void Area::setName(std::string lang, const std::string& name) {
     std::transform(lang.begin(), lang.end(), lang.begin(), ::tolower);
     if (lang.size() == 3 && lang.find_first_of("0123456789") == std::string::npos) {
+        changed();
         if (this->names.find(lang) == this->names.end()) {
             this -> names.insert(std::pair<std::string, std::string>(lang, name));
         } else {
@@ -199,7 +263,9 @@ void Area::setMeasure(std::string codename, Measure measure) {
     std::transform(codename.begin(), codename.end(), codename.begin(), ::tolower);
     if (this->measures.find(codename) == this->measures.end()) {
         //doesn't exist
-        this->measures.insert(std::pair<std::string, Measure>(codename, measure));
+        changed();
+        auto inserted = this->measures.insert(std::pair<std::string, Measure>(codename, measure));
+        inserted.first->second.changes = this->changes;
     } else {
         //does exist
         //update all values inside existing measure
@@ -235,11 +301,109 @@ void Area::setMeasure(std::string codename, Measure measure) {
     area.setMeasure(code, measure);
     auto size = area.size();
 */
-unsigned int Area::size() {
+size_t Area::size() const {
     return measures.size();
 }
 
 
+/*
+  Area::fillGaps(mode)
+
+  Fill in the missing years of every Measure in the Area.
+
+  @param mode
+    How to fill the gaps (see GapFillMode)
+
+  @example
+    Area area("W06000023");
+    ...
+    area.fillGaps(GapFillLinear);
+*/
+void Area::fillGaps(GapFillMode mode) {
+    // each Measure counts its own change
+    for (auto &measure : this->measures) {
+        measure.second.fillGaps(mode);
+    }
+}
+
+/*
+  Area::hasJSON()
+
+  Check whether the Area has anything to write as JSON, i.e. at least one
+  name or at least one Measure with a value. Areas::toJSON() leaves out
+  Areas that do not.
+
+  @return
+    true if toJSON() would write any names or measures
+*/
+bool Area::hasJSON() const {
+    if (!this->names.empty()) {
+        return true;
+    }
+    for (const auto &measure : this->measures) {
+        if (!measure.second.getValues().empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  Area::toJSON(out)
+
+  Write the Area to an OutputBuffer as a JSON object, formatted as:
+    { "measures": { "<codename1>": { "<year1>": <value1>, … }, … },
+      "names": { "<languageCode1>": "<languageName1>", … } }
+
+  Measures without any values are left out, as is either key if it would be
+  empty.
+
+  @param out
+    The OutputBuffer to write to
+
+  @example
+    Area area("W06000023");
+    area.setName("eng", "Powys");
+
+    OutputBuffer out(std::cout);
+    area.toJSON(out);
+*/
+void Area::toJSON(OutputBuffer &out) const {
+    out.append('{');
+
+    bool first = true;
+    for (const auto &measure : this->measures) {
+        if (measure.second.getValues().empty()) {
+            continue;
+        }
+        out.append(first ? "\"measures\":{" : ",", first ? 12 : 1);
+        first = false;
+        out.appendJSONString(measure.first);
+        out.append(':');
+        measure.second.toJSON(out);
+    }
+    if (!first) {
+        out.append('}');
+    }
+
+    if (!this->names.empty()) {
+        out.append(first ? "\"names\":{" : ",\"names\":{", first ? 9 : 10);
+        bool firstName = true;
+        for (const auto &name : this->names) {
+            if (!firstName) {
+                out.append(',');
+            }
+            firstName = false;
+            out.appendJSONString(name.first);
+            out.append(':');
+            out.appendJSONString(name.second);
+        }
+        out.append('}');
+    }
+
+    out.append('}');
+}
+
 /*
   TODO: operator<<(os, area)
 
@@ -272,32 +436,55 @@ unsigned int Area::size() {
     std::cout << area << std::endl;
 */
 
-std::ostream &operator<<(std::ostream &os, Area &area) {
-    std::string namesOut;
-    switch(area.getNames().size()) {
+std::ostream &operator<<(std::ostream &os, const Area &area) {
+    OutputBuffer out(os);
+    area.toTable(out);
+    return os;
+}
+
+/*
+  Area::toTable(out)
+
+  Write the Area to an OutputBuffer in the format described for operator<<
+  above: its names and authority code on one line, followed by each Measure
+  (see Measure::toTable()).
+
+  @param out
+    The OutputBuffer to write to
+
+  @example
+    Area area("W06000023");
+    area.setName("eng", "Powys");
+
+    OutputBuffer out(std::cout);
+    area.toTable(out);
+*/
+void Area::toTable(OutputBuffer &out) const {
+    switch (this->names.size()) {
         case 0:
-            namesOut = "Unnamed";
+            out.append("Unnamed", 7);
             break;
         case 1:
-            namesOut = area.getNames().begin()->second;
-            break;
-        case 2:
-            namesOut = area.getName("eng") + " / " + area.getName("cym");
+            out.append(this->names.begin()->second);
             break;
         default:
+            out.append(this->names.at("eng"));
+            out.append(" / ", 3);
+            out.append(this->names.at("cym"));
             break;
     }
-    os << namesOut << " (" << area.getLocalAuthorityCode() << ")" << std::endl;
+    out.append(" (", 2);
+    out.append(this->localAuthorityCode);
+    out.append(")\n", 2);
 
-    if (area.getMeasures().empty()) {
-        return os << "<no measures>" << std::endl;
+    if (this->measures.empty()) {
+        out.append("<no measures>\n\n", 15);
+        return;
     }
 
-    for (auto measure : area.getMeasures()) {
-        os << measure.second << std::endl;
+    for (const auto &measure : this->measures) {
+        measure.second.toTable(out);
     }
-
-    return os << std::endl;
 }
 
 
@@ -339,6 +526,11 @@ bool operator==(const Area& lhs, const Area& rhs) {
  */
 
 std::map<std::string, Measure> & Area::getMeasures()  {
+    changed(); // the caller may change them
+    return this->measures;
+}
+
+const std::map<std::string, Measure> & Area::getMeasures() const {
     return this->measures;
 }
 
@@ -350,14 +542,55 @@ std::map<std::string, Measure> & Area::getMeasures()  {
  */
 
 std::map<std::string, std::string> & Area::getNames() {
+    changed(); // the caller may change them
+    return this->names;
+}
+
+const std::map<std::string, std::string> & Area::getNames() const {
     return this->names;
 }
 
+/*
+  Area::toDelimited(out, delimiter, stats)
 
+  Write every Measure of the Area to an OutputBuffer as delimited (CSV or
+  TSV) rows, each starting with the authority code and the English and Welsh
+  names of the Area (empty if it does not have them). See
+  Measure::toDelimited().
 
+  @param out
+    The OutputBuffer to write to
 
+  @param delimiter
+    The character that separates fields
 
+  @param stats
+    Whether to include the average and difference columns
 
+  @example
+    Area area("W06000023");
+    area.setName("eng", "Powys");
 
+    OutputBuffer out(std::cout);
+    area.toDelimited(out, ',', false);
+*/
+void Area::toDelimited(OutputBuffer &out, char delimiter, bool stats) const {
+    if (this->measures.empty()) {
+        return;
+    }
 
+    OutputBuffer prefix;
+    prefix.appendDelimitedField(this->localAuthorityCode, delimiter);
+    for (const char *lang : {"eng", "cym"}) {
+        prefix.append(delimiter);
+        auto name = this->names.find(lang);
+        if (name != this->names.end()) {
+            prefix.appendDelimitedField(name->second, delimiter);
+        }
+    }
+    prefix.append(delimiter);
 
+    for (const auto &measure : this->measures) {
+        measure.second.toDelimited(out, prefix.str(), delimiter, stats);
+    }
+}
@@ -16,6 +16,7 @@
   functions and member variables you need to declare in this class.
  */
 
+#include <cstdint>
 #include <string>
 #include <map>
 #include <ostream>
@@ -37,22 +38,39 @@ class Area {
 
 public:
   explicit Area(std::string localAuthorityCode);
+  Area(const Area &other);
+  Area(Area &&other) noexcept;
+  Area &operator=(const Area &other);
+  Area &operator=(Area &&other) noexcept;
   std::string getLocalAuthorityCode();
   std::string getName(const std::string& lang);
   void setName(std::string lang, const std::string& name);
   Measure& getMeasure(const std::string& key);
   void setMeasure(std::string codename, Measure measure);
-  unsigned int size();
+  size_t size() const;
+  void fillGaps(GapFillMode mode);
+  bool hasJSON() const;
+  void toJSON(OutputBuffer &out) const;
+  void toTable(OutputBuffer &out) const;
+  void toDelimited(OutputBuffer &out, char delimiter, bool stats) const;
   std::map<std::string, std::string>& getNames();
+  const std::map<std::string, std::string>& getNames() const;
   std::map<std::string, Measure>& getMeasures();
+  const std::map<std::string, Measure>& getMeasures() const;
   friend bool operator==(const Area& lhs, const Area& rhs);
-  friend std::ostream &operator<<(std::ostream &os, Area &area);
+  friend std::ostream &operator<<(std::ostream &os, const Area &area);
 
 private:
     std::map<std::string, std::string> names;
     std::string localAuthorityCode;
     std::map<std::string, Measure> measures;
 
+    // The change counter of the Areas holding this Area, if any
+    uint64_t *changes = nullptr;
+    void changed();
+    void attach(uint64_t *changes);
+
+    friend class Areas;
 };
 
 #endif // AREA_H_
\ No newline at end of file
@@ -18,23 +18,204 @@
   must implement has a TODO block comment. 
 */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 #include <string>
 #include <tuple>
 #include <sstream>
 #include <queue>
+#include <vector>
 
 #include "lib_json.hpp"
 
 #include "datasets.h"
 #include "areas.h"
+#include "compiledfilter.h"
+#include "renderpool.h"
 
 /*
   An alias for the imported JSON parsing library.
 */
 using json = nlohmann::json;
 
+namespace {
+
+/*
+  The fields of a StatsWales row that are imported, in the order they are
+  held in a WelshStatsRow.
+*/
+enum WelshStatsField {
+  ROW_AUTH_CODE,
+  ROW_NAME_ENG,
+  ROW_NAME_CYM,
+  ROW_YEAR,
+  ROW_MEASURE_CODE,
+  ROW_MEASURE_NAME,
+  ROW_VALUE,
+  ROW_FIELDS
+};
+
+/*
+  One row of a StatsWales dataset, as read by WelshStatsReader. The strings
+  are kept from row to row, so once they have grown to fit the longest value
+  reading another row allocates nothing.
+*/
+struct WelshStatsRow {
+  std::string text[ROW_FIELDS];
+  double number[ROW_FIELDS];
+  bool numeric[ROW_FIELDS];
+  unsigned int seen;
+
+  bool has(WelshStatsField field) const {
+    return (seen & (1u << field)) != 0;
+  }
+};
+
+/*
+  A SAX handler for the StatsWales JSON files. Rather than parsing the whole
+  document into a json object, it copies the fields that are imported from
+  each row of the top-level "value" array into a WelshStatsRow, and passes
+  the row to a function at the end of each one. Everything else is skipped.
+*/
+template <typename RowHandler>
+class WelshStatsReader : public nlohmann::json_sax<json> {
+public:
+  WelshStatsReader(const BethYw::SourceColumnMapping &cols, RowHandler &handler)
+      : handler(handler) {
+    const BethYw::SourceColumn keys[ROW_FIELDS] = {
+        BethYw::AUTH_CODE, BethYw::AUTH_NAME_ENG, BethYw::AUTH_NAME_CYM, BethYw::YEAR,
+        BethYw::MEASURE_CODE, BethYw::MEASURE_NAME, BethYw::VALUE};
+    for (int field = 0; field < ROW_FIELDS; field++) {
+      const auto column = cols.find(keys[field]);
+      columns[field] = column != cols.end() ? column->second : std::string();
+    }
+  }
+
+  bool null() override { return true; }
+  bool boolean(bool) override { return true; }
+  bool number_integer(number_integer_t value) override { return number((double) value); }
+  bool number_unsigned(number_unsigned_t value) override { return number((double) value); }
+  bool number_float(number_float_t value, const string_t &) override { return number(value); }
+  bool binary(binary_t &) override { return true; }
+
+  bool string(string_t &value) override {
+    if (inRow()) {
+      for (int field = 0; field < ROW_FIELDS; field++) {
+        if (fields & (1u << field)) {
+          row.text[field] = value;
+          row.numeric[field] = false;
+        }
+      }
+      row.seen |= fields;
+    }
+    return true;
+  }
+
+  bool key(string_t &name) override {
+    if (depth == 1) {
+      valueKey = name == "value";
+    } else if (inValue && depth == 3) {
+      //one column can give more than one field (e.g. the measure's codename
+      //and label)
+      fields = 0;
+      for (int field = 0; field < ROW_FIELDS; field++) {
+        if (!columns[field].empty() && columns[field] == name) {
+          fields |= 1u << field;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    depth++;
+    if (inValue && depth == 3) {
+      row.seen = 0;
+    }
+    fields = 0;
+    return true;
+  }
+
+  bool end_object() override {
+    if (inValue && depth == 3) {
+      handler(row);
+    }
+    depth--;
+    fields = 0;
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    depth++;
+    if (depth == 2 && valueKey) {
+      inValue = true;
+    }
+    fields = 0;
+    return true;
+  }
+
+  bool end_array() override {
+    if (inValue && depth == 2) {
+      inValue = false;
+    }
+    depth--;
+    valueKey = false;
+    fields = 0;
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &error) override {
+    throw std::runtime_error(std::string("Malformed file: ") + error.what());
+  }
+
+private:
+  bool inRow() const {
+    return inValue && depth == 3 && fields != 0;
+  }
+
+  bool number(double value) {
+    if (inRow()) {
+      for (int field = 0; field < ROW_FIELDS; field++) {
+        if (fields & (1u << field)) {
+          row.number[field] = value;
+          row.numeric[field] = true;
+        }
+      }
+      row.seen |= fields;
+    }
+    return true;
+  }
+
+  RowHandler &handler;
+  std::string columns[ROW_FIELDS];
+  WelshStatsRow row;
+  int depth = 0;
+  unsigned int fields = 0;
+  bool valueKey = false;
+  bool inValue = false;
+};
+
+/*
+  Parse a value from a CSV field or a JSON string. An empty field is a value
+  that is missing and gives false.
+*/
+bool parseValue(const char *begin, const char *end, double &value) {
+  if (begin == end) {
+    return false;
+  }
+  char *stop;
+  value = std::strtod(begin, &stop);
+  if (stop == begin) {
+    throw std::runtime_error("Malformed file: invalid value " + std::string(begin, end));
+  }
+  return true;
+}
+
+} // namespace
+
 /*
   TODO: Areas::Areas()
 
@@ -45,6 +226,35 @@ using json = nlohmann::json;
 */
 Areas::Areas() = default;
 
+/*
+  Copy an Areas object. The copied areas count their changes towards the
+  copy, not the original, and the indexes are built afresh when asked for.
+
+  @param other
+    The Areas to copy
+*/
+Areas::Areas(const Areas &other)
+    : areasContainer(other.areasContainer), indexes(other.indexes),
+      quantileTracking(other.quantileTracking) {
+    changed();
+    for (auto &area : this->areasContainer) {
+        area.second.attach(this->changes.get());
+    }
+}
+
+Areas &Areas::operator=(const Areas &other) {
+    if (this != &other) {
+        this->areasContainer = other.areasContainer;
+        this->indexes = other.indexes;
+        this->quantileTracking = other.quantileTracking;
+        changed();
+        for (auto &area : this->areasContainer) {
+            area.second.attach(this->changes.get());
+        }
+    }
+    return *this;
+}
+
 /*
   TODO: Areas::setArea(localAuthorityCode, area)
 
@@ -71,9 +281,11 @@ Areas::Areas() = default;
     data.setArea(localAuthorityCode, area);
 */
 void Areas::setArea(const std::string& localAuthorityCode, Area area) {
+    changed();
     if (this->areasContainer.find(localAuthorityCode) == this->areasContainer.end()) {
         //doesn't exist
-        this->areasContainer.insert(std::pair<std::string, Area>(localAuthorityCode, area));
+        auto inserted = this->areasContainer.insert(std::pair<std::string, Area>(localAuthorityCode, area));
+        inserted.first->second.attach(this->changes.get());
     } else {
         //exists
         //update names
@@ -139,10 +351,53 @@ Area& Areas::getArea(const std::string& localAuthorityCode) {
     
     auto size = areas.size(); // returns 1
 */
-unsigned int Areas::size() {
+size_t Areas::size() const {
     return this->areasContainer.size();
 }
 
+/*
+  Areas::valueCount()
+
+  Count the values held across every Measure of every Area.
+
+  @return
+    The number of values
+
+  @example
+    Areas data = Areas();
+    ...
+    auto values = data.valueCount(); // e.g. 1584 for popden
+*/
+size_t Areas::valueCount() const {
+    size_t values = 0;
+    for (const auto &area : this->areasContainer) {
+        for (const auto &measure : area.second.getMeasures()) {
+            values += measure.second.size();
+        }
+    }
+    return values;
+}
+
+/*
+  Areas::fillGaps(mode)
+
+  Fill in the missing years of every Measure in every Area, so each series
+  covers a contiguous range of years.
+
+  @param mode
+    How to fill the gaps (see GapFillMode)
+
+  @example
+    Areas data = Areas();
+    ...
+    data.fillGaps(GapFillLinear);
+*/
+void Areas::fillGaps(GapFillMode mode) {
+    for (auto &area : this->areasContainer) {
+        area.second.fillGaps(mode);
+    }
+}
+
 /*
   TODO: Areas::populateFromAuthorityCodeCSV(is, cols, areasFilter)
 
@@ -198,6 +453,13 @@ void Areas::populateFromAuthorityCodeCSV(
     std::istream &is,
     const BethYw::SourceColumnMapping &cols,
     const StringFilterSet * const areasFilter) {
+    populateFromAuthorityCodeCSV(is, cols, CompiledFilter(areasFilter, nullptr, nullptr));
+}
+
+void Areas::populateFromAuthorityCodeCSV(
+    std::istream &is,
+    const BethYw::SourceColumnMapping &cols,
+    const CompiledFilter &filter) {
 
     if(is.good()) {
 
@@ -238,11 +500,9 @@ void Areas::populateFromAuthorityCodeCSV(
             std::getline(ss, name_cym, ',');
 
             //check if line is valid
-            if (!areasFilter
-            || areasFilter->empty()
-            || areasFilter->find(auth_code) != areasFilter->end()
-            || areasFilter->find(name_eng) != areasFilter->end()
-            || areasFilter->find(name_cym) != areasFilter->end()) {
+            if (filter.acceptsArea(auth_code)
+            || filter.acceptsArea(name_eng)
+            || filter.acceptsArea(name_cym)) {
 
                 //create area
                 Area area(auth_code);
@@ -366,78 +626,89 @@ void Areas::populateFromWelshStatsJSON(std::istream& is, const BethYw::SourceCol
                                        const StringFilterSet *const areasFilter,
                                        const StringFilterSet *const measuresFilter,
                                        const YearFilterTuple *const yearsFilter) {
-    json j;
-    is >> j;
-
-    for (auto &el : j["value"].items()) {
-        auto &data = el.value();
-
-        //get what we need for area
-        std::string name_eng = std::string();
-        std::string name_cym = std::string();
-        std::string auth_code = data[cols.at(BethYw::AUTH_CODE)];
-        if (cols.find(BethYw::AUTH_NAME_ENG) != cols.end()) {
-            name_eng = data[cols.at(BethYw::AUTH_NAME_ENG)];
-        }
-        if (cols.find(BethYw::AUTH_NAME_CYM) != cols.end()) {
-            name_cym = data[cols.at(BethYw::AUTH_NAME_CYM)];
-        }
-
-        //check if null or empty or is in filter
-        if (!areasFilter
-            || areasFilter->empty()
-            || areasFilter->find(auth_code) != areasFilter->end()
-            || areasFilter->find(name_eng) != areasFilter->end()
-            || areasFilter->find(name_cym) != areasFilter->end()) {
-            //create area object
-            Area area(auth_code);
-            if (!name_eng.empty()) {
-                area.setName("eng", name_eng);
-            }
-            if (!name_cym.empty()) {
-                area.setName("cym", name_cym);
-            }
+    populateFromWelshStatsJSON(is, cols, CompiledFilter(areasFilter, measuresFilter, yearsFilter));
+}
 
-            //get year
-            unsigned int year = stoi(std::string(data[cols.at(BethYw::YEAR)]));
-            //check if year is in range or range is empty
-            if ((std::get<1>(*yearsFilter) >= year && year >= std::get<0>(*yearsFilter))
-            || (std::get<0>(*yearsFilter) == 0 && std::get<1>(*yearsFilter) == 0)) {
-
-                //get the values needed for measures
-                std::string codename;
-                std::string label;
-                //deals with differing measure enums
-                if (cols.find(BethYw::MEASURE_NAME) != cols.end()) {
-                    codename = data[cols.at(BethYw::MEASURE_CODE)];
-                    label = data[cols.at(BethYw::MEASURE_NAME)];
-                } else {
-                    codename = cols.at(BethYw::SINGLE_MEASURE_CODE);
-                    label = cols.at(BethYw::SINGLE_MEASURE_NAME);
-                }
+void Areas::populateFromWelshStatsJSON(std::istream& is, const BethYw::SourceColumnMapping &cols,
+                                       const CompiledFilter &filter) {
+    CompiledFilter::MeasureIds measures(filter);
+    const bool singleMeasure = cols.find(BethYw::MEASURE_NAME) == cols.end();
+    const size_t single = singleMeasure
+                          ? measures.find(cols.at(BethYw::SINGLE_MEASURE_CODE),
+                                          cols.at(BethYw::SINGLE_MEASURE_NAME))
+                          : 0;
+
+    auto importRow = [&](const WelshStatsRow &row) {
+        if (!row.has(ROW_AUTH_CODE) || row.numeric[ROW_AUTH_CODE]
+            || !row.has(ROW_YEAR)
+            || !row.has(ROW_VALUE)
+            || (!singleMeasure && (!row.has(ROW_MEASURE_CODE) || !row.has(ROW_MEASURE_NAME)))) {
+            throw std::runtime_error("Malformed file: a row is missing a column");
+        }
 
-                //gets code name as lower case
-                std::transform(codename.begin(), codename.end(), codename.begin(), ::tolower);
+        //check the area against the filter (by code or by either name) first,
+        //straight from the bytes read
+        const std::string &auth_code = row.text[ROW_AUTH_CODE];
+        const bool hasEng = row.has(ROW_NAME_ENG) && !row.numeric[ROW_NAME_ENG];
+        const bool hasCym = row.has(ROW_NAME_CYM) && !row.numeric[ROW_NAME_CYM];
+        if (!filter.acceptsArea(auth_code)
+            && !(hasEng && filter.acceptsArea(row.text[ROW_NAME_ENG]))
+            && !(hasCym && filter.acceptsArea(row.text[ROW_NAME_CYM]))) {
+            return;
+        }
 
-                //gets the value whether it's saved as string or double
-                double value = (data[cols.at(BethYw::VALUE)].type() == json::value_t::number_float) ?
-                        (double) data[cols.at(BethYw::VALUE)] : std::stod(std::string(data[cols.at(BethYw::VALUE)]));
+        //get year
+        unsigned int year;
+        if (row.numeric[ROW_YEAR]) {
+            year = (unsigned int) row.number[ROW_YEAR];
+        } else {
+            char *stop;
+            year = (unsigned int) std::strtoul(row.text[ROW_YEAR].c_str(), &stop, 10);
+            if (stop == row.text[ROW_YEAR].c_str()) {
+                throw std::runtime_error("Malformed file: invalid year " + row.text[ROW_YEAR]);
+            }
+        }
+        if (!filter.acceptsYear(year)) {
+            return;
+        }
 
-                //check if null or empty or in filter
-                if (!measuresFilter
-                    || measuresFilter->empty()
-                    || measuresFilter->find(codename) != measuresFilter->end()
-                    || measuresFilter->find(label) != measuresFilter->end()) {
+        //deals with differing measure enums
+        const size_t id = singleMeasure
+                          ? single
+                          : measures.find(row.text[ROW_MEASURE_CODE], row.text[ROW_MEASURE_NAME]);
+        if (!measures.accepted(id)) {
+            return;
+        }
 
-                    //finally create measure with measure attributes, add to area object and add to container
-                    Measure measure(codename, label);
-                    measure.setValue(year, value);
-                    area.setMeasure(codename, measure);
-                    setArea(auth_code, area);
-                }
+        //gets the value whether it's saved as a number or a string
+        double value;
+        if (row.numeric[ROW_VALUE]) {
+            value = row.number[ROW_VALUE];
+        } else {
+            const std::string &text = row.text[ROW_VALUE];
+            if (!parseValue(text.c_str(), text.c_str() + text.size(), value)) {
+                return;
             }
         }
-    }
+
+        //finally create measure with measure attributes, add to area object and add to container
+        const std::string &codename = measures.codename(id);
+        const std::string &label = measures.label(id);
+        Area area(auth_code);
+        if (hasEng && !row.text[ROW_NAME_ENG].empty()) {
+            area.setName("eng", row.text[ROW_NAME_ENG]);
+        }
+        if (hasCym && !row.text[ROW_NAME_CYM].empty()) {
+            area.setName("cym", row.text[ROW_NAME_CYM]);
+        }
+        Measure measure(codename, label);
+        measure.setValue(year, value);
+        area.setMeasure(codename, measure);
+        setArea(auth_code, area);
+    };
+
+    WelshStatsReader<decltype(importRow)> reader(cols, importRow);
+    json::sax_parse(is, &reader);
 }
 
 /*
@@ -509,73 +780,119 @@ void Areas::populateFromAuthorityByYearCSV(std::istream& is,
                                            const BethYw::SourceColumnMapping& cols,
                                            const StringFilterSet * const areasFilter,
                                            const YearFilterTuple * const yearsFilter) {
-    //primary key is year
-    //vector contains many <auth code, value> pairs
-    std::map<unsigned int, std::vector<std::pair<std::string, double>>> data_table;
-    if(is.good()) {
-        //read top line
-        std::string line;
-        std::string token;
+    populateFromAuthorityByYearCSV(is, cols, CompiledFilter(areasFilter, nullptr, yearsFilter));
+}
 
-        std::getline(is, line);
-        std::stringstream ss(line);
+void Areas::populateFromAuthorityByYearCSV(std::istream& is,
+                                           const BethYw::SourceColumnMapping& cols,
+                                           const CompiledFilter &filter) {
+    if (!is.good()) {
+        return;
+    }
 
-        //insert column headers as keys
-        while (std::getline(ss, token, ',')) {
-            //ignore auth code column header
-            if (token != cols.at(BethYw::AUTH_CODE)) {
-                    //insert keys and blank vectors
-                    data_table.insert(std::pair<unsigned int, std::vector<std::pair<std::string, double>>>(stoi(token), std::vector<std::pair<std::string, double>>{}));
-                }
-            }
+    //read top line, with the years as the column headers
+    std::string line;
+    std::string token;
+    std::getline(is, line);
+    std::stringstream ss(line);
+
+    std::vector<unsigned int> columnYears;
+    while (std::getline(ss, token, ',')) {
+        //ignore auth code column header
+        if (token != cols.at(BethYw::AUTH_CODE)) {
+            columnYears.push_back((unsigned int) stoi(token));
+        }
+    }
 
+    //check for the right number of column headers (minus the auth code)
+    std::vector<unsigned int> distinctYears = columnYears;
+    std::sort(distinctYears.begin(), distinctYears.end());
+    distinctYears.erase(std::unique(distinctYears.begin(), distinctYears.end()), distinctYears.end());
+    if (distinctYears.size() != 11) {
+        throw std::out_of_range("Malformed file: There is an incorrect number of columns");
+    }
 
-        //check for the right number of column headers (minus the auth code)
-        if (data_table.size() != 11) {
-            throw std::out_of_range("Malformed file: There is an incorrect number of columns");
+    //the columns of the years that pass the filter, the only ones parsed
+    std::vector<size_t> kept;
+    for (size_t column = 0; column < columnYears.size(); column++) {
+        if (filter.acceptsYear(columnYears[column])) {
+            kept.push_back(column);
         }
+    }
 
-        //read data
-        while(std::getline(is, line)) {
-            ss.clear();
-            ss = std::stringstream(line);
+    //the kept values of each row that passes the areas filter, with whether
+    //each was given at all
+    std::vector<std::string> codes;
+    std::vector<double> values;
+    std::vector<bool> present;
+
+    while (std::getline(is, line)) {
+        const char *field = line.c_str();
+        const char *end = field + line.size();
+        if (end > field && end[-1] == '\r') {
+            end--;
+        }
+        if (field == end) {
+            continue;
+        }
 
-            //extract auth code
-            std::string auth_code;
-            std::getline(ss, auth_code, ',');
+        //check the auth code against the filter before anything is copied
+        const char *comma = (const char *) std::memchr(field, ',', (size_t) (end - field));
+        if (!comma) {
+            comma = end;
+        }
+        if (!filter.acceptsArea(field, (size_t) (comma - field))) {
+            continue;
+        }
+        codes.emplace_back(field, comma);
 
-            //go through a line
-            for (auto& elem : data_table) {
-                //extract each value
-                std::string value;
-                std::getline(ss, value, ',');
-                //push back a pair with extracted auth code
-                elem.second.push_back(std::pair<std::string, double>(auth_code, stod(value)));
+        field = comma;
+        size_t next = 0;
+        for (size_t column = 0; column < columnYears.size() && next < kept.size(); column++) {
+            if (field == end) {
+                throw std::runtime_error("Malformed file: missing values for " + codes.back());
+            }
+            field++;
+            const char *fieldEnd = (const char *) std::memchr(field, ',', (size_t) (end - field));
+            if (!fieldEnd) {
+                fieldEnd = end;
             }
+            if (kept[next] == column) {
+                double value = 0;
+                present.push_back(parseValue(field, fieldEnd, value));
+                values.push_back(value);
+                next++;
+            }
+            field = fieldEnd;
         }
     }
 
-    //deal with filters
-    for (const auto& elem : data_table) {
-        //if key (year) matches yearfilter range or yearfilter is <0,0>
-        if (((elem.first >= std::get<0>(*yearsFilter) && elem.first <= std::get<1>(*yearsFilter))
-                || ((std::get<0>(*yearsFilter) == 0 && std::get<1>(*yearsFilter) == 0)))) {
-            //for each item in vector
-            for (auto item : elem.second) {
+    //add the values a year at a time, in order of year
+    std::vector<size_t> order(kept.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return columnYears[kept[a]] < columnYears[kept[b]];
+    });
+
+    const std::string &codename = cols.at(BethYw::SINGLE_MEASURE_CODE);
+    const std::string &label = cols.at(BethYw::SINGLE_MEASURE_NAME);
+    for (size_t i : order) {
+        const unsigned int year = columnYears[kept[i]];
+        for (size_t row = 0; row < codes.size(); row++) {
+            const size_t index = row * kept.size() + i;
+            if (!present[index]) {
+                continue;
+            }
 
-                //if pair pos 0 (authcode) is in areasFilter or null
-                if (!areasFilter
-                || areasFilter->empty()
-                || areasFilter->find(std::get<0>(item)) != areasFilter->end()) {
-                    //make new area
-                    Area area(std::get<0>(item));
-                    Measure measure(cols.at(BethYw::SINGLE_MEASURE_CODE), cols.at(BethYw::SINGLE_MEASURE_NAME));
-                    measure.setValue(elem.first, std::get<1>(item));
-                    area.setMeasure(cols.at(BethYw::SINGLE_MEASURE_CODE), measure);
+            //make new area
+            Area area(codes[row]);
+            Measure measure(codename, label);
+            measure.setValue(year, values[index]);
+            area.setMeasure(codename, measure);
 
-                    setArea(std::get<0>(item), area);
-                }
-            }
+            setArea(codes[row], area);
         }
     }
 }
@@ -735,24 +1052,432 @@ void Areas::populate(
     const BethYw::SourceColumnMapping &cols,
     const StringFilterSet * const areasFilter,
     const StringFilterSet * const measuresFilter,
-    const YearFilterTuple * const yearsFilter)
-     {
-         if (type == BethYw::AuthorityCodeCSV) {
-             populateFromAuthorityCodeCSV(is, cols, areasFilter);
-         } else if (type == BethYw::WelshStatsJSON) {
-             populateFromWelshStatsJSON(is, cols, areasFilter, measuresFilter, yearsFilter);
-         } else if (type == BethYw::AuthorityByYearCSV) {
-             //deal with measure filter here because it isn't passed in
-             if (!measuresFilter
-             || measuresFilter->empty()
-             || measuresFilter->find(cols.at(BethYw::SINGLE_MEASURE_NAME)) != measuresFilter->end()
-             || measuresFilter->find(cols.at(BethYw::SINGLE_MEASURE_CODE)) != measuresFilter->end()) {
-                 populateFromAuthorityByYearCSV(is, cols, areasFilter, yearsFilter);
-             }
-
-         } else {
-             throw std::runtime_error("Areas::populate: Unexpected data type");
-         }
+    const YearFilterTuple * const yearsFilter) {
+    populate(is, type, cols, CompiledFilter(areasFilter, measuresFilter, yearsFilter));
+}
+
+/*
+  Areas::populate(is, type, cols, filter)
+
+  As above, with the filters already compiled, so that importing several
+  datasets with the same filters only compiles them once.
+
+  @param is
+    The input stream from InputSource
+
+  @param type
+    A value from the BethYw::SourceDataType enum which states the underlying
+    data file structure
+
+  @param cols
+    A map of the enum BethyYw::SourceColumnMapping (see datasets.h) to strings
+    that give the column header in the CSV file
+
+  @param filter
+    The areas, measures and years filters, compiled
+
+  @throws
+    std::runtime_error if a parsing error occurs (e.g. due to a malformed file)
+    std::out_of_range if there are not enough columns in cols
+
+  @example
+    CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+    areas.populate(is, DataType::WelshStatsJSON, cols, filter);
+*/
+void Areas::populate(
+    std::istream &is,
+    const BethYw::SourceDataType &type,
+    const BethYw::SourceColumnMapping &cols,
+    const CompiledFilter &filter) {
+    if (type == BethYw::AuthorityCodeCSV) {
+        populateFromAuthorityCodeCSV(is, cols, filter);
+    } else if (type == BethYw::WelshStatsJSON) {
+        populateFromWelshStatsJSON(is, cols, filter);
+    } else if (type == BethYw::AuthorityByYearCSV) {
+        //deal with measure filter here because it isn't passed in, with
+        //the codename in lowercase as it is stored (and as the filter is)
+        std::string codename = cols.at(BethYw::SINGLE_MEASURE_CODE);
+        std::transform(codename.begin(), codename.end(), codename.begin(), ::tolower);
+        if (filter.acceptsMeasure(codename, cols.at(BethYw::SINGLE_MEASURE_NAME))) {
+            populateFromAuthorityByYearCSV(is, cols, filter);
+        }
+    } else {
+        throw std::runtime_error("Areas::populate: Unexpected data type");
+    }
+}
+
+/*
+  Areas::mergeFiltered(source, areasFilter, measuresFilter, yearsFilter)
+
+  Add the data from another Areas object (e.g. a dataset imported earlier
+  without any filters) as if it were being imported by populate() with the
+  given filters: an Area is included if the filter is empty or contains its
+  authority code or either of its names, a Measure if the filter is empty or
+  contains its codename or label, and a value if its year is in range (or
+  the range is <0,0>). An Area is only added if it has at least one value
+  that is kept, or if it has no measures at all (e.g. the areas imported
+  from areas.csv, which only have names).
+
+  @param source
+    The Areas to merge in
+
+  @param areasFilter
+    An umodifiable pointer to set of umodifiable strings for areas to import,
+    or an empty set if all areas should be imported
+
+  @param measuresFilter
+    An umodifiable pointer to set of umodifiable strings for measures to import,
+    or an empty set if all measures should be imported
+
+  @param yearsFilter
+    An umodifiable pointer to an umodifiable tuple of two unsigned integers,
+    where if both values are 0, then all years should be imported
+
+  @example
+    Areas unfiltered = Areas();
+    ...
+    Areas data = Areas();
+    data.mergeFiltered(unfiltered, &areasFilter, &measuresFilter, &yearsFilter);
+*/
+void Areas::mergeFiltered(const Areas &source,
+                          const StringFilterSet * const areasFilter,
+                          const StringFilterSet * const measuresFilter,
+                          const YearFilterTuple * const yearsFilter) {
+    const bool allYears = !yearsFilter
+                          || (std::get<0>(*yearsFilter) == 0 && std::get<1>(*yearsFilter) == 0);
+    const bool allMeasures = !measuresFilter || measuresFilter->empty();
+
+    auto areaIncluded = [&](const std::string &code, const Area &area) {
+        if (!areasFilter || areasFilter->empty()
+            || areasFilter->find(code) != areasFilter->end()) {
+            return true;
+        }
+        for (const auto &name : area.getNames()) {
+            if (areasFilter->find(name.second) != areasFilter->end()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto measureIncluded = [&](const std::string &codename, const std::string &label) {
+        return allMeasures
+               || measuresFilter->find(codename) != measuresFilter->end()
+               || measuresFilter->find(label) != measuresFilter->end();
+    };
+
+    if (source.hasIndexes() && (!allMeasures || !allYears)) {
+        // Look the values up in the source's indexes instead of walking every
+        // area, then merge them in the same order as the walk below would
+        std::vector<AreaYearValue> selected;
+        if (!allMeasures) {
+            std::vector<const AreaSeries *> series;
+            for (const auto &entry : source.getMeasureIndex()) {
+                const bool byCodename = measuresFilter->find(entry.first) != measuresFilter->end();
+                for (const auto &item : entry.second) {
+                    if (byCodename || measureIncluded(entry.first, item.measure->getLabel())) {
+                        series.push_back(&item);
+                    }
+                }
+            }
+            std::sort(series.begin(), series.end(), [](const AreaSeries *a, const AreaSeries *b) {
+                const int order = a->code->compare(*b->code);
+                return order != 0 ? order < 0
+                                  : a->measure->getCodename() < b->measure->getCodename();
+            });
+
+            for (const AreaSeries *item : series) {
+                if (!areaIncluded(*item->code, *item->area)) {
+                    continue;
+                }
+                const auto &values = item->measure->getValues();
+                auto value = allYears ? values.begin() : values.lower_bound(std::get<0>(*yearsFilter));
+                for (; value != values.end()
+                       && (allYears || value->first <= std::get<1>(*yearsFilter)); value++) {
+                    selected.push_back({item->code, item->area, item->measure,
+                                        value->first, value->second});
+                }
+            }
+        } else {
+            const auto &years = source.getYearIndex();
+            for (auto year = years.lower_bound(std::get<0>(*yearsFilter));
+                 year != years.end() && year->first <= std::get<1>(*yearsFilter);
+                 year++) {
+                for (const auto &item : year->second) {
+                    if (areaIncluded(*item.code, *item.area)) {
+                        selected.push_back(item);
+                    }
+                }
+            }
+            std::sort(selected.begin(), selected.end(),
+                      [](const AreaYearValue &a, const AreaYearValue &b) {
+                const int order = a.code->compare(*b.code);
+                if (order != 0) {
+                    return order < 0;
+                }
+                const int measureOrder = a.measure->getCodename().compare(b.measure->getCodename());
+                return measureOrder != 0 ? measureOrder < 0 : a.year < b.year;
+            });
+        }
+
+        mergeSelected(selected);
+        for (const auto &item : source.indexes.withoutMeasures) {
+            if (areaIncluded(*item.code, *item.area)) {
+                Area area(*item.code);
+                for (const auto &name : item.area->getNames()) {
+                    area.setName(name.first, name.second);
+                }
+                setArea(*item.code, std::move(area));
+            }
+        }
+        return;
+    }
+
+    for (const auto &entry : source.areasContainer) {
+        const Area &sourceArea = entry.second;
+        if (!areaIncluded(entry.first, sourceArea)) {
+            continue;
+        }
+
+        Area area(entry.first);
+        for (const auto &name : sourceArea.getNames()) {
+            area.setName(name.first, name.second);
+        }
+
+        bool kept = false;
+        for (const auto &measure : sourceArea.getMeasures()) {
+            const std::string &codename = measure.first;
+            const std::string &label = measure.second.getLabel();
+            if (!measureIncluded(codename, label)) {
+                continue;
+            }
+
+            Measure filtered(codename, label);
+            for (const auto &value : measure.second.getValues()) {
+                if (allYears || (value.first >= std::get<0>(*yearsFilter)
+                                 && value.first <= std::get<1>(*yearsFilter))) {
+                    filtered.setValue(value.first, value.second);
+                }
+            }
+
+            if (filtered.size() != 0) {
+                area.setMeasure(codename, std::move(filtered));
+                kept = true;
+            }
+        }
+
+        if (kept || sourceArea.getMeasures().empty()) {
+            setArea(entry.first, std::move(area));
+        }
+    }
+}
+
+/*
+  Add the values picked out of another Areas object's indexes by
+  mergeFiltered(), which are in order of authority code, codename and year.
+  An Area is added if at least one of its values is recorded.
+*/
+void Areas::mergeSelected(const std::vector<AreaYearValue> &selected) {
+    size_t i = 0;
+    while (i < selected.size()) {
+        const Area *sourceArea = selected[i].area;
+        const std::string &code = *selected[i].code;
+        Area area(code);
+        for (const auto &name : sourceArea->getNames()) {
+            area.setName(name.first, name.second);
+        }
+
+        bool kept = false;
+        while (i < selected.size() && selected[i].area == sourceArea) {
+            const Measure *measure = selected[i].measure;
+            const std::string &codename = measure->getCodename();
+            const std::string &label = measure->getLabel();
+
+            Measure filtered(codename, label);
+            for (; i < selected.size() && selected[i].measure == measure; i++) {
+                filtered.setValue(selected[i].year, selected[i].value);
+            }
+
+            if (filtered.size() != 0) {
+                area.setMeasure(codename, std::move(filtered));
+                kept = true;
+            }
+        }
+
+        if (kept) {
+            setArea(code, std::move(area));
+        }
+    }
+}
+
+/*
+  Build the secondary indexes and zone maps now, rather than when they are
+  first asked for, e.g. for data that is imported once and then queried many times (see
+  ResidentData). They are dropped again if the areas change.
+
+  @example
+    Areas data = Areas();
+    ...
+    data.buildIndexes();
+    for (const auto &entry : data.getYearIndex().at(2015)) {
+      ...
+    }
+*/
+void Areas::buildIndexes() const {
+    std::lock_guard<std::mutex> lock(indexes.mutex);
+    dropStaleIndexes();
+    if (indexes.byMeasure) {
+        return;
+    }
+
+    auto widen = [](ValueRange &range, double value, bool first) {
+        if (first || value < range.min) {
+            range.min = value;
+        }
+        if (first || value > range.max) {
+            range.max = value;
+        }
+    };
+
+    std::unique_ptr<MeasureIndex> byMeasure(new MeasureIndex());
+    std::unique_ptr<YearIndex> byYear(new YearIndex());
+    std::unique_ptr<ZoneMap> zones(new ZoneMap());
+    std::vector<AreaSeries> withoutMeasures;
+    for (const auto &entry : areasContainer) {
+        const Area &area = entry.second;
+        if (area.getMeasures().empty()) {
+            withoutMeasures.push_back({&entry.first, &area, nullptr, {0, 0}});
+        }
+        for (const auto &measure : area.getMeasures()) {
+            const auto &values = measure.second.getValues();
+            AreaSeries series = {&entry.first, &area, &measure.second, {0, 0}};
+            if (!values.empty()) {
+                const bool firstSeries = zones->find(measure.first) == zones->end();
+                MeasureZones &zone = (*zones)[measure.first];
+                for (const auto &value : values) {
+                    widen(series.range, value.second, &value == &*values.begin());
+                    const bool firstInYear = zone.byYear.find(value.first) == zone.byYear.end();
+                    widen(zone.byYear[value.first], value.second, firstInYear);
+                }
+                widen(zone.all, series.range.min, firstSeries);
+                widen(zone.all, series.range.max, false);
+            }
+            (*byMeasure)[measure.first].push_back(series);
+            for (const auto &value : values) {
+                (*byYear)[value.first].push_back({&entry.first, &area, &measure.second,
+                                                  value.first, value.second});
+            }
+        }
+    }
+
+    indexes.byYear = std::move(byYear);
+    indexes.zones = std::move(zones);
+    indexes.withoutMeasures = std::move(withoutMeasures);
+    indexes.byMeasure = std::move(byMeasure);
+}
+
+/*
+  Check whether the secondary indexes have been built (and not dropped
+  since).
+
+  @return
+    true if getMeasureIndex() and getYearIndex() can be called without
+    building anything
+*/
+bool Areas::hasIndexes() const {
+    std::lock_guard<std::mutex> lock(indexes.mutex);
+    dropStaleIndexes();
+    return indexes.byMeasure != nullptr;
+}
+
+/*
+  Retrieve the index from each measure's codename to every area with the
+  measure, building the indexes if they have not been built.
+
+  @return
+    The measure index, which is valid until the areas change
+
+  @example
+    Areas data = Areas();
+    ...
+    for (const auto &entry : data.getMeasureIndex().at("pop")) {
+      std::cout << *entry.code << ": " << entry.measure->size() << std::endl;
+    }
+*/
+const MeasureIndex &Areas::getMeasureIndex() const {
+    buildIndexes();
+    return *indexes.byMeasure;
+}
+
+/*
+  Retrieve the index from each year to every area and measure with a value
+  for the year, building the indexes if they have not been built.
+
+  @return
+    The year index, which is valid until the areas change
+*/
+const YearIndex &Areas::getYearIndex() const {
+    buildIndexes();
+    return *indexes.byYear;
+}
+
+/*
+  Retrieve the zone maps: the range of each measure's values, across every
+  area, in all and for each year (the range of each area's own series is in
+  the measure index), building the indexes if they have not been built.
+
+  @return
+    The zone maps, which are valid until the areas change
+
+  @example
+    Areas data = Areas();
+    ...
+    const ValueRange &range = data.getZoneMap().at("pop").byYear.at(2019);
+    if (range.max <= 100000) {
+      // no area had a population above 100000 in 2019
+    }
+*/
+const ZoneMap &Areas::getZoneMap() const {
+    buildIndexes();
+    return *indexes.zones;
+}
+
+/*
+  Count a change to the areas, so the secondary indexes, zone maps and
+  quantile sketches are rebuilt when next asked for. Each Area and Measure
+  held counts its own changes (see Area::attach()), so a change made
+  through a reference from getArea() is counted too.
+*/
+void Areas::changed() {
+    if (!this->changes) {
+        this->changes.reset(new uint64_t(0));
+    }
+    (*this->changes)++;
+}
+
+/*
+  Retrieve the number of changes made to the areas so far.
+
+  @return
+    The change count
+*/
+uint64_t Areas::changeCount() const {
+    return this->changes ? *this->changes : 0;
+}
+
+/*
+  Drop the secondary indexes, zone maps and quantile sketches if the areas
+  have changed since they were built. The indexes mutex must be held.
+*/
+void Areas::dropStaleIndexes() const {
+    const uint64_t count = changeCount();
+    if (indexes.builtAt != count) {
+        indexes.byMeasure.reset();
+        indexes.byYear.reset();
+        indexes.zones.reset();
+        indexes.withoutMeasures.clear();
+        indexes.sketches.reset();
+        indexes.builtAt = count;
+    }
 }
 
 /*
@@ -829,31 +1554,185 @@ void Areas::populate(
     std::cout << data.toJSON();
 */
 std::string Areas::toJSON() const {
-  json j;
-
-  //for every area
-  for (auto area : getAreasContainer()) {
-      //for every measure in the area
-      for (auto measure : area.second.getMeasures()) {
-          // for every value in the measure
-          for (auto value : measure.second.getValues()) {
-              //[area code][measures][codename][year] = [value]
-              j[area.first]["measures"][measure.first][std::to_string(value.first)] = value.second;
-          }
-      }
-      //for every name in the area
-      for (auto name : area.second.getNames()) {
-          //[area code][names][lang] = [name]
-          j[area.first]["names"][name.first] = name.second;
-      }
-  }
+    std::ostringstream os;
+    toJSON(os);
+    return os.str();
+}
+
+/*
+  Areas::toJSON(os, threads)
+
+  Write the same JSON as Areas::toJSON() directly to an output stream, in a
+  single pass over the Areas and without building a JSON document or string
+  first. Areas without any names or values are left out.
+
+  With more than one thread, the Areas are rendered on a pool of worker
+  threads (see renderInOrder()) and written out in authority code order, so
+  the output is the same whatever the number of threads.
+
+  @param os
+    The output stream to write to
+
+  @param threads
+    The number of threads to render with
+
+  @example
+    Areas data = Areas();
+    ...
+    data.toJSON(std::cout);
+*/
+void Areas::toJSON(std::ostream &os, unsigned int threads) const {
+    std::vector<const AreasContainer::value_type *> areas;
+    areas.reserve(this->areasContainer.size());
+    for (const auto &area : this->areasContainer) {
+        if (area.second.hasJSON()) {
+            areas.push_back(&area);
+        }
+    }
+
+    OutputBuffer out(os);
+    out.append('{');
+    renderInOrder(out, areas.size(), threads, [&areas](OutputBuffer &buffer, size_t i) {
+        if (i != 0) {
+            buffer.append(',');
+        }
+        buffer.appendJSONString(areas[i]->first);
+        buffer.append(':');
+        areas[i]->second.toJSON(buffer);
+    });
+    out.append('}');
+}
+
+/*
+  Areas::toNDJSON(os, threads)
+
+  Write the Areas as newline-delimited JSON: one line per Area, each a
+  complete JSON object with the authority code as its only key, e.g.
+    {"W06000001":{"measures":{...},"names":{...}}}
+  Merging every line gives the same object as Areas::toJSON(). Each line is
+  flushed as soon as it is written (a batch of lines at a time with more
+  than one thread), so whatever reads the output can process each Area as
+  it arrives, and never needs the whole output in memory.
+
+  @param os
+    The output stream to write to
+
+  @param threads
+    The number of threads to render with
 
-  return j.dump() == "null" ? "{}" : j.dump();
+  @example
+    Areas data = Areas();
+    ...
+    data.toNDJSON(std::cout);
+*/
+void Areas::toNDJSON(std::ostream &os, unsigned int threads) const {
+    std::vector<const AreasContainer::value_type *> areas;
+    areas.reserve(this->areasContainer.size());
+    for (const auto &area : this->areasContainer) {
+        if (area.second.hasJSON()) {
+            areas.push_back(&area);
+        }
+    }
+
+    OutputBuffer out(os);
+    auto render = [&areas](OutputBuffer &buffer, size_t i) {
+        buffer.append('{');
+        buffer.appendJSONString(areas[i]->first);
+        buffer.append(':');
+        areas[i]->second.toJSON(buffer);
+        buffer.append("}\n", 2);
+    };
+    renderInOrder(out, areas.size(), threads, render, true);
 }
 
+/*
+  Areas::toTable(os, threads)
+
+  Write every Area as a table (see operator<< below) to an output stream.
+
+  With more than one thread, the Areas are rendered on a pool of worker
+  threads (see renderInOrder()) and written out in authority code order, so
+  the output is the same whatever the number of threads.
+
+  @param os
+    The output stream to write to
 
+  @param threads
+    The number of threads to render with
 
+  @example
+    Areas data = Areas();
+    ...
+    data.toTable(std::cout, 4);
+*/
+void Areas::toTable(std::ostream &os, unsigned int threads) const {
+    std::vector<const Area *> areas;
+    areas.reserve(this->areasContainer.size());
+    for (const auto &area : this->areasContainer) {
+        areas.push_back(&area.second);
+    }
 
+    OutputBuffer out(os);
+    renderInOrder(out, areas.size(), threads, [&areas](OutputBuffer &buffer, size_t i) {
+        areas[i]->toTable(buffer);
+    });
+}
+
+/*
+  Areas::toDelimited(os, delimiter, stats, threads)
+
+  Write every value as a delimited (e.g. CSV or TSV) row to an output
+  stream, one row per area, measure and year, after a header row:
+    auth_code,name_eng,name_cym,measure_code,measure_label,year,value
+  followed by average,diff,diff_pct if stats is true. Rows are ordered by
+  authority code, then measure codename, then year, and are rendered on a
+  pool of threads just like Areas::toTable().
+
+  @param os
+    The output stream to write to
+
+  @param delimiter
+    The character that separates fields, e.g. ',' for CSV or '\t' for TSV
+
+  @param stats
+    Whether to include the average and difference of each measure
+
+  @param threads
+    The number of threads to render with
+
+  @example
+    Areas data = Areas();
+    ...
+    data.toDelimited(std::cout, ',', true);
+*/
+void Areas::toDelimited(std::ostream &os,
+                        char delimiter,
+                        bool stats,
+                        unsigned int threads) const {
+    static const char *const COLUMNS[] = {
+        "auth_code", "name_eng", "name_cym", "measure_code", "measure_label",
+        "year", "value", "average", "diff", "diff_pct"};
+    const size_t columns = stats ? 10 : 7;
+
+    std::vector<const Area *> areas;
+    areas.reserve(this->areasContainer.size());
+    for (const auto &area : this->areasContainer) {
+        areas.push_back(&area.second);
+    }
+
+    OutputBuffer out(os);
+    for (size_t i = 0; i < columns; i++) {
+        if (i != 0) {
+            out.append(delimiter);
+        }
+        out.append(COLUMNS[i]);
+    }
+    out.append('\n');
+
+    renderInOrder(out, areas.size(), threads, [&areas, delimiter, stats](OutputBuffer &buffer, size_t i) {
+        areas[i]->toDelimited(buffer, delimiter, stats);
+    });
+}
 
 /*
   TODO: operator<<(os, areas)
@@ -962,10 +1841,8 @@ std::string Areas::toJSON() const {
     std::cout << areas << std::end;
 */
 
-std::ostream &operator<<(std::ostream &os, Areas &areas) {
-    for (auto area : areas.getAreasContainer()) {
-        os << area.second << std::endl;
-    }
+std::ostream &operator<<(std::ostream &os, const Areas &areas) {
+    areas.toTable(os);
     return os;
 }
 
@@ -979,4 +1856,106 @@ std::ostream &operator<<(std::ostream &os, Areas &areas) {
 
 const AreasContainer &Areas::getAreasContainer() const {
     return areasContainer;
-}
\ No newline at end of file
+}
+
+/*
+  Areas::setQuantileTracking(enabled)
+
+  Turn on (or off) a quantile sketch per measure, so percentiles across all
+  areas and years can be read from getQuantileSketches().
+
+  The values are all held here anyway, so each sketch is made large enough
+  never to compact them, and its percentiles are exact. The sketches are
+  built from the values the Areas holds, once per area, measure and year,
+  the first time they are asked for after the areas change, so a value one
+  dataset replaces in another is only counted once. Where the values are
+  not all held, the sketches are instead fed one area at a time with
+  addToQuantileSketches().
+
+  @param enabled
+    Whether to maintain the sketches
+
+  @example
+    Areas data = Areas();
+    data.setQuantileTracking(true);
+    ...
+    auto median = data.getQuantileSketches().at("pop").getQuantile(0.5);
+*/
+void Areas::setQuantileTracking(bool enabled) {
+    this->quantileTracking = enabled;
+    changed();
+}
+
+/*
+  Retrieve the quantile sketches of the values held, keyed by measure
+  codename, building them if the areas have changed since they were last
+  built. This is empty unless setQuantileTracking() was enabled first.
+
+  @return
+    The exact QuantileSketch of each measure by codename, which is valid
+    until the areas change
+*/
+const QuantileSketches &Areas::getQuantileSketches() const {
+    std::lock_guard<std::mutex> lock(indexes.mutex);
+    dropStaleIndexes();
+    if (indexes.sketches) {
+        return *indexes.sketches;
+    }
+
+    std::unique_ptr<QuantileSketches> sketches(new QuantileSketches());
+    if (quantileTracking) {
+        // Size each sketch to hold all of its measure's values
+        std::map<std::string, size_t> counts;
+        for (const auto &area : areasContainer) {
+            for (const auto &measure : area.second.getMeasures()) {
+                counts[measure.first] += measure.second.size();
+            }
+        }
+        for (const auto &area : areasContainer) {
+            for (const auto &measure : area.second.getMeasures()) {
+                if (sketches->find(measure.first) == sketches->end()) {
+                    const size_t count = counts[measure.first];
+                    sketches->emplace(measure.first,
+                                      QuantileSketch(measure.first,
+                                                     measure.second.getLabel(),
+                                                     (unsigned int) count + 1));
+                }
+            }
+        }
+        addToQuantileSketches(*sketches);
+    }
+    indexes.sketches = std::move(sketches);
+    return *indexes.sketches;
+}
+
+/*
+  Add every value held to the quantile sketch of its measure, starting a
+  sketch (with the default k) for a measure that has none yet. --stream and
+  --memory-limit call this with each area as it is merged, once its values
+  are final, so each value is counted once and the values need not be kept.
+
+  @param sketches
+    The sketches to add to, keyed by codename
+
+  @example
+    QuantileSketches sketches;
+    spilled.forEachArea([&sketches](Areas &area) {
+      area.addToQuantileSketches(sketches);
+    });
+*/
+void Areas::addToQuantileSketches(QuantileSketches &sketches) const {
+    for (const auto &area : areasContainer) {
+        for (const auto &measure : area.second.getMeasures()) {
+            // The codenames are stored in lowercase already
+            auto sketch = sketches.find(measure.first);
+            if (sketch == sketches.end()) {
+                sketch = sketches.emplace(measure.first,
+                                          QuantileSketch(measure.first,
+                                                         measure.second.getLabel())).first;
+            }
+            for (const auto &value : measure.second.getValues()) {
+                sketch->second.update(value.second);
+            }
+        }
+    }
+}
@@ -26,13 +26,19 @@
   functions and member variables you need to declare in this class.
  */
 
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <unordered_set>
+#include <vector>
 
 #include "datasets.h"
 #include "area.h"
+#include "quantiles.h"
 
 /*
   An alias for filters based on strings such as categorisations e.g. area,
@@ -53,6 +59,62 @@ using YearFilterTuple = std::tuple<unsigned int, unsigned int>;
 */
 using AreasContainer = std::map<std::string, Area>;
 
+class CompiledFilter;
+
+/*
+  The smallest and largest of a set of values, i.e. an entry in a zone map.
+*/
+struct ValueRange {
+  double min;
+  double max;
+};
+
+/*
+  An entry in the measure index of an Areas object: an area, its series of
+  values for the measure, and the range of the values in the series.
+*/
+struct AreaSeries {
+  const std::string *code;
+  const Area *area;
+  const Measure *measure;
+  ValueRange range;
+};
+
+/*
+  An entry in the year index of an Areas object: an area, a measure, and
+  the measure's value for the year.
+*/
+struct AreaYearValue {
+  const std::string *code;
+  const Area *area;
+  const Measure *measure;
+  unsigned int year;
+  double value;
+};
+
+/*
+  Aliases for the secondary indexes of an Areas object, from a measure's
+  codename and from a year to every area with a value for it, in order of
+  authority code (and then of codename).
+*/
+using MeasureIndex = std::map<std::string, std::vector<AreaSeries>>;
+using YearIndex = std::map<unsigned int, std::vector<AreaYearValue>>;
+
+/*
+  The zone map of a measure in an Areas object: the range of its values
+  across every area, in all and in each year, so that a comparison can rule
+  a whole measure (or year) in or out without looking at its values.
+*/
+struct MeasureZones {
+  ValueRange all;
+  std::map<unsigned int, ValueRange> byYear;
+};
+
+/*
+  An alias for the zone maps of an Areas object, by measure codename.
+*/
+using ZoneMap = std::map<std::string, MeasureZones>;
+
 /*
   Areas is a class that stores all the data categorised by area. The 
   underlying Standard Library container is customisable using the alias above.
@@ -70,24 +132,40 @@ using AreasContainer = std::map<std::string, Area>;
 class Areas {
 public:
   Areas();
+  Areas(const Areas &other);
+  Areas(Areas &&other) = default;
+  Areas &operator=(const Areas &other);
+  Areas &operator=(Areas &&other) = default;
   void setArea(const std::string& localAuthorityCode, Area area);
   Area& getArea(const std::string& localAuthorityCode);
   const AreasContainer &getAreasContainer() const;
 
-    unsigned int size();
+    size_t size() const;
+  size_t valueCount() const;
+  void fillGaps(GapFillMode mode);
   void populateFromWelshStatsJSON(std::istream& is, const BethYw::SourceColumnMapping& cols,const StringFilterSet * const areasFilter, const StringFilterSet * const measuresFilter, const YearFilterTuple * const yearsFilter);
+  void populateFromWelshStatsJSON(std::istream& is, const BethYw::SourceColumnMapping& cols, const CompiledFilter &filter);
 
     void populateFromAuthorityByYearCSV(
             std::istream &is,
             const BethYw::SourceColumnMapping &cols,
             const StringFilterSet *const areasFilter,
             const YearFilterTuple *const yearsFilter);
+    void populateFromAuthorityByYearCSV(
+            std::istream &is,
+            const BethYw::SourceColumnMapping &cols,
+            const CompiledFilter &filter);
 
     void populateFromAuthorityCodeCSV(
       std::istream& is,
       const BethYw::SourceColumnMapping& cols,
       const StringFilterSet * const areas = nullptr)
       noexcept(false);
+    void populateFromAuthorityCodeCSV(
+      std::istream& is,
+      const BethYw::SourceColumnMapping& cols,
+      const CompiledFilter &filter)
+      noexcept(false);
 
   void populate(
       std::istream& is,
@@ -103,14 +181,85 @@ public:
       const YearFilterTuple * const yearsFilter = nullptr)
       noexcept(false);
 
-  friend std::ostream &operator<<(std::ostream &os, Areas &areas);
+  void populate(
+      std::istream& is,
+      const BethYw::SourceDataType& type,
+      const BethYw::SourceColumnMapping& cols,
+      const CompiledFilter &filter)
+      noexcept(false);
+
+  void mergeFiltered(
+      const Areas &source,
+      const StringFilterSet * const areasFilter = nullptr,
+      const StringFilterSet * const measuresFilter = nullptr,
+      const YearFilterTuple * const yearsFilter = nullptr);
+
+  friend std::ostream &operator<<(std::ostream &os, const Areas &areas);
 
     std::string toJSON() const;
+  void toJSON(std::ostream &os, unsigned int threads = 1) const;
+  void toNDJSON(std::ostream &os, unsigned int threads = 1) const;
+  void toTable(std::ostream &os, unsigned int threads = 1) const;
+  void toDelimited(std::ostream &os, char delimiter, bool stats, unsigned int threads = 1) const;
+
+  void buildIndexes() const;
+  bool hasIndexes() const;
+  const MeasureIndex &getMeasureIndex() const;
+  const YearIndex &getYearIndex() const;
+  const ZoneMap &getZoneMap() const;
+
+  void setQuantileTracking(bool enabled);
+  const QuantileSketches &getQuantileSketches() const;
+  void addToQuantileSketches(QuantileSketches &sketches) const;
 
 private:
-    AreasContainer areasContainer;
+    /*
+      The secondary indexes and zone maps, built by buildIndexes() or when
+      they are first asked for, and the quantile sketches, built when they
+      are first asked for, all rebuilt if the change counter has moved on
+      since builtAt. They point into the areas, so copying an Areas object
+      does not copy them.
+      Building them is guarded by a mutex, as the servers read the same
+      Areas on several threads.
+    */
+    struct Indexes {
+      Indexes() = default;
+      Indexes(const Indexes &) {}
+      Indexes &operator=(const Indexes &) {
+          builtAt = 0;
+          byMeasure.reset();
+          byYear.reset();
+          zones.reset();
+          withoutMeasures.clear();
+          sketches.reset();
+          return *this;
+      }
+
+      std::mutex mutex;
+      uint64_t builtAt = 0;
+      std::unique_ptr<MeasureIndex> byMeasure;
+      std::unique_ptr<YearIndex> byYear;
+      std::unique_ptr<ZoneMap> zones;
+      std::vector<AreaSeries> withoutMeasures;
+      std::unique_ptr<QuantileSketches> sketches;
+    };
 
+    /*
+      The number of changes made to the areas, counted by each Area and
+      Measure held (through a mutable reference or not) as well as here.
+      It lives on the heap so the areas can point to it even when the Areas
+      object is moved.
+    */
+    std::unique_ptr<uint64_t> changes;
+
+    AreasContainer areasContainer;
+    mutable Indexes indexes;
+    bool quantileTracking = false;
 
+    void changed();
+    uint64_t changeCount() const;
+    void dropStaleIndexes() const;
+    void mergeSelected(const std::vector<AreaYearValue> &selected);
 };
 
 #endif // AREAS_H
\ No newline at end of file
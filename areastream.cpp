@@ -0,0 +1,410 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the AreaStream and
+  AreaStreamWriter classes.
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "lib_json.hpp"
+
+#include "areastream.h"
+
+/*
+  Open a file to read it one group of rows at a time.
+
+  @param path
+    The path of the file
+
+  @param source
+    The dataset (or areas.csv) the file holds, which must outlive the stream
+
+  @throws
+    std::runtime_error if the file cannot be opened, or is not laid out as
+    its parser expects
+
+  @example
+    AreaStream stream(dir + source.FILE, source);
+    while (!stream.done()) {
+      Areas area = Areas();
+      stream.next(area, filter);
+    }
+*/
+AreaStream::AreaStream(const std::string &path, const BethYw::InputFileSource &source)
+    : source(source),
+      input(path),
+      is(input.open()),
+      json(source.PARSER == BethYw::WelshStatsJSON) {
+    if (json) {
+        findJSONRows();
+    } else if (!std::getline(is, header)) {
+        throw std::runtime_error("Malformed file: " + path + " is empty");
+    }
+    header += '\n';
+    readRow();
+}
+
+/*
+  Check that a file's rows are sorted by authority code, i.e. that the code
+  of each row is the same as or comes after the code of the row before.
+
+  @param path
+    The path of the file
+
+  @param source
+    The dataset (or areas.csv) the file holds
+
+  @return
+    true if the rows are sorted, or false if they are not, or the file cannot
+    be read as expected (so it is left to the normal import to report)
+
+  @example
+    if (AreaStream::sorted(dir + source.FILE, source)) {
+      // it can be merged
+    }
+*/
+bool AreaStream::sorted(const std::string &path, const BethYw::InputFileSource &source) {
+    try {
+        AreaStream stream(path, source);
+        std::string previous;
+        while (!stream.done()) {
+            if (stream.code() < previous) {
+                return false;
+            }
+            previous = stream.code();
+            stream.readRow();
+        }
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+/*
+  Check whether every group has been read.
+
+  @return
+    true if there are no more rows
+*/
+bool AreaStream::done() const {
+    return finished;
+}
+
+/*
+  Retrieve the authority code of the next group.
+
+  @return
+    The authority code, as written in the file
+*/
+const std::string &AreaStream::code() const {
+    return rowCode;
+}
+
+/*
+  Import the next group of rows (those with the authority code given by
+  code()) into an Areas object, by the same rules as populate().
+
+  @param areas
+    The Areas object to add the rows to
+
+  @param filter
+    The filters to import the rows with
+
+  @throws
+    std::runtime_error if a row is malformed
+*/
+void AreaStream::next(Areas &areas, const CompiledFilter &filter) {
+    import(areas, filter, 0);
+}
+
+/*
+  Import the next rows, in the order they come and whatever their authority
+  codes, into an Areas object, by the same rules as populate(). Rows are
+  read until their text adds up to a number of bytes (or the file ends), so
+  the import takes about the same amount of memory each time.
+
+  @param areas
+    The Areas object to add the rows to
+
+  @param filter
+    The filters to import the rows with
+
+  @param bytes
+    The number of bytes of rows to read, at least one row's
+
+  @throws
+    std::runtime_error if a row is malformed
+*/
+void AreaStream::nextRows(Areas &areas, const CompiledFilter &filter, size_t bytes) {
+    import(areas, filter, std::max(bytes, (size_t) 1));
+}
+
+/*
+  Import the next group (bytes is 0) or the next rows (up to bytes) into an
+  Areas object.
+*/
+void AreaStream::import(Areas &areas, const CompiledFilter &filter, size_t bytes) {
+    const std::string groupCode = rowCode;
+    group = header;
+    bool firstRow = true;
+    do {
+        if (json && !firstRow) {
+            group += ',';
+        }
+        group += row;
+        if (!json) {
+            group += '\n';
+        }
+        firstRow = false;
+    } while (readRow() && (bytes == 0 ? rowCode == groupCode : group.size() < bytes));
+    if (json) {
+        group += "]}";
+    }
+
+    std::istringstream document(group);
+    auto cols = source.COLS;
+    areas.populate(document, source.PARSER, cols, filter);
+}
+
+/*
+  Read the next row and its authority code, returning false (and marking the
+  stream as done) if there are no more.
+*/
+bool AreaStream::readRow() {
+    if (json) {
+        if (!readJSONRow()) {
+            finished = true;
+            return false;
+        }
+        nlohmann::json object;
+        try {
+            object = nlohmann::json::parse(row);
+        } catch (const nlohmann::json::exception &error) {
+            throw std::runtime_error(std::string("Malformed file: ") + error.what());
+        }
+        const auto code = object.find(source.COLS.at(BethYw::AUTH_CODE));
+        if (code == object.end() || !code->is_string()) {
+            throw std::runtime_error("Malformed file: a row is missing a column");
+        }
+        rowCode = code->get<std::string>();
+        return true;
+    }
+
+    while (std::getline(is, row)) {
+        size_t end = row.size();
+        if (end > 0 && row[end - 1] == '\r') {
+            end--;
+        }
+        if (end == 0) {
+            continue;
+        }
+        rowCode = row.substr(0, std::min(row.find(','), end));
+        return true;
+    }
+    finished = true;
+    return false;
+}
+
+/*
+  Read up to the start of the rows of a StatsWales file, the array under the
+  top-level "value" key, keeping the opening of a document that the rows of
+  a group can be added to.
+*/
+void AreaStream::findJSONRows() {
+    int depth = 0;
+    bool valueKey = false;
+    std::string text;
+    int c;
+    while ((c = readJSONChar()) != EOF) {
+        if (c == '[' && valueKey && depth == 1) {
+            header = "{\"value\":[";
+            return;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '"') {
+            readJSONString(text);
+            if (depth == 1 && text == "\"value\"") {
+                // Only a key if a colon follows
+                const int following = readJSONChar();
+                valueKey = following == ':';
+                depth -= following == '}';
+                continue;
+            }
+        }
+        valueKey = false;
+    }
+    throw std::runtime_error("Malformed file: no value array");
+}
+
+/*
+  Read the next row (an object) of the "value" array, as text, or return
+  false at the end of the array.
+*/
+bool AreaStream::readJSONRow() {
+    int c = readJSONChar();
+    if (c == ',') {
+        c = readJSONChar();
+    }
+    if (c == ']') {
+        return false;
+    }
+    if (c != '{') {
+        throw std::runtime_error("Malformed file: expected a row");
+    }
+
+    row = "{";
+    int depth = 1;
+    std::string text;
+    while (depth > 0) {
+        c = readJSONChar();
+        if (c == EOF) {
+            throw std::runtime_error("Malformed file: unterminated row");
+        } else if (c == '"') {
+            readJSONString(text);
+            row += text;
+            continue;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        }
+        row += (char) c;
+    }
+    return true;
+}
+
+/*
+  Read the rest of a JSON string whose opening quote has just been read,
+  giving the string as written, quotes and escapes included.
+*/
+void AreaStream::readJSONString(std::string &text) {
+    text = "\"";
+    int c;
+    while ((c = is.get()) != EOF) {
+        text += (char) c;
+        if (c == '\\') {
+            if ((c = is.get()) == EOF) {
+                break;
+            }
+            text += (char) c;
+        } else if (c == '"') {
+            return;
+        }
+    }
+    throw std::runtime_error("Malformed file: unterminated string");
+}
+
+/*
+  Read the next character of a JSON file that is not whitespace.
+*/
+int AreaStream::readJSONChar() {
+    int c;
+    do {
+        c = is.get();
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    return c;
+}
+
+/*
+  Construct a writer for areas, writing the start of the output (e.g. the
+  header row of a CSV file) straight away.
+
+  @param os
+    The output stream to write to
+
+  @param format
+    The format to write, one that supports() accepts
+
+  @param stats
+    Whether to include the average and difference of each measure (csv and
+    tsv only)
+
+  @example
+    AreaStreamWriter writer(std::cout, BethYw::FormatNDJSON, false);
+    writer.write(area);
+    writer.finish();
+*/
+AreaStreamWriter::AreaStreamWriter(std::ostream &os, BethYw::OutputFormat format, bool stats)
+    : os(os), out(os), format(format), stats(stats) {
+    if (format == BethYw::FormatCSV || format == BethYw::FormatTSV) {
+        // The header row, which is all there is for no areas
+        Areas().toDelimited(os, format == BethYw::FormatCSV ? ',' : '\t', stats);
+    } else if (format == BethYw::FormatJSON) {
+        out.append('{');
+    }
+}
+
+/*
+  Check whether a format can be written an area at a time.
+
+  @param format
+    The output format
+
+  @return
+    true for table, json, ndjson, csv and tsv
+*/
+bool AreaStreamWriter::supports(BethYw::OutputFormat format) {
+    return format != BethYw::FormatColumnar;
+}
+
+/*
+  Write the areas in an Areas object (usually just one) after those written
+  before, which must all have come before them in authority code order.
+
+  @param areas
+    The areas to write
+*/
+void AreaStreamWriter::write(const Areas &areas) {
+    for (const auto &area : areas.getAreasContainer()) {
+        if (format == BethYw::FormatTable) {
+            area.second.toTable(out);
+        } else if (format == BethYw::FormatCSV || format == BethYw::FormatTSV) {
+            area.second.toDelimited(out, format == BethYw::FormatCSV ? ',' : '\t', stats);
+        } else if (area.second.hasJSON()) {
+            if (format == BethYw::FormatNDJSON) {
+                out.append('{');
+            } else if (!first) {
+                out.append(',');
+            }
+            out.appendJSONString(area.first);
+            out.append(':');
+            area.second.toJSON(out);
+            first = false;
+            if (format == BethYw::FormatNDJSON) {
+                out.append("}\n", 2);
+                out.flush();
+                os.flush();
+            }
+        }
+    }
+}
+
+/*
+  Write the end of the output, as writeData() would.
+*/
+void AreaStreamWriter::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    if (format == BethYw::FormatJSON) {
+        out.append('}');
+        out.flush();
+        os << std::endl;
+    } else if (format == BethYw::FormatTable) {
+        out.flush();
+        os << std::endl;
+    } else {
+        out.flush();
+        os.flush();
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef AREASTREAM_H_
+#define AREASTREAM_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declarations of the AreaStream and AreaStreamWriter
+  classes, which --stream uses to merge datasets that are sorted by
+  authority code one area at a time, instead of importing them whole.
+ */
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "datasets.h"
+#include "areas.h"
+#include "bethyw.h"
+#include "compiledfilter.h"
+#include "input.h"
+#include "outputbuffer.h"
+
+/*
+  An AreaStream reads areas.csv or a dataset file from start to end, one
+  group of rows at a time, where a group is the consecutive rows for one
+  authority code. A group is imported with the same populate function (and
+  so by the same rules) as the whole file would be, so importing every group
+  of a file gives the same data as importing the file.
+
+  nextRows() instead imports the rows in the order they come, a number of
+  bytes at a time whatever their codes, for --memory-limit.
+
+  For a k-way merge on authority code the groups have to come in order, and
+  each code only once, which sorted() checks by reading the whole file first
+  (without importing anything) so that the caller can choose another way to
+  import it before anything has been written.
+*/
+class AreaStream {
+public:
+  AreaStream(const std::string &path, const BethYw::InputFileSource &source);
+
+  static bool sorted(const std::string &path, const BethYw::InputFileSource &source);
+
+  bool done() const;
+  const std::string &code() const;
+  void next(Areas &areas, const CompiledFilter &filter);
+  void nextRows(Areas &areas, const CompiledFilter &filter, size_t bytes);
+
+private:
+  void import(Areas &areas, const CompiledFilter &filter, size_t bytes);
+  bool readRow();
+  bool readJSONRow();
+  void findJSONRows();
+  void readJSONString(std::string &text);
+  int readJSONChar();
+
+  const BethYw::InputFileSource &source;
+  InputFile input;
+  std::istream &is;
+  bool json;
+
+  // The first part of a group's document (the CSV header line, or the
+  // start of the StatsWales "value" array) and the current row
+  std::string header;
+  std::string row;
+  std::string rowCode;
+  bool finished = false;
+
+  // The rows being imported
+  std::string group;
+};
+
+/*
+  An AreaStreamWriter writes areas one at a time, in authority code order,
+  in one of the formats that can be written that way (table, json, ndjson,
+  csv and tsv), giving exactly what Areas::toTable(), toJSON(), toNDJSON()
+  and toDelimited() would for the same areas all at once.
+*/
+class AreaStreamWriter {
+public:
+  AreaStreamWriter(std::ostream &os, BethYw::OutputFormat format, bool stats);
+
+  static bool supports(BethYw::OutputFormat format);
+
+  void write(const Areas &areas);
+  void finish();
+
+private:
+  std::ostream &os;
+  OutputBuffer out;
+  BethYw::OutputFormat format;
+  bool stats;
+  bool first = true;
+  bool finished = false;
+};
+
+#endif // AREASTREAM_H_
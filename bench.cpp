@@ -0,0 +1,413 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  A benchmark suite for the hot paths of Beth Yw?: each populate function,
+  merging areas with Areas::setArea(), the stats functions, and JSON and
+  table output, each on its own (micro) and together as a whole import and
+  export (macro). The inputs are synthetic, built in memory in the shapes of
+  areas.csv, the StatsWales JSON files and the complete-*.csv files by the
+  DatasetGenerator that bethyw-datagen uses, with as many areas, measures
+  and years as asked for. Each benchmark is run a number of times and
+  reported as rows/s and bytes/s, with their standard deviation, as a table
+  or as JSON to keep and compare over time.
+
+  Build with ./build.sh bench, then e.g.:
+
+    bin/bethyw-bench --areas 2000 --years 40 --repetitions 10 --json > before.json
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lib_cxxopts.hpp"
+#include "lib_json.hpp"
+
+#include "datasets.h"
+#include "areas.h"
+#include "datasetgenerator.h"
+
+namespace {
+
+/*
+  The synthetic inputs the benchmarks read, as the text of each file.
+*/
+struct BenchInputs {
+  std::string areasCSV;
+  std::string statsJSON;
+  std::string byYearCSV;
+  size_t areas = 0;
+  size_t jsonRows = 0;
+};
+
+/*
+  The size of the synthetic inputs.
+*/
+struct BenchConfig {
+  unsigned int areas;
+  unsigned int measures;
+  unsigned int years;
+  double missing;
+  GeneratedOrder order;
+  unsigned long long seed;
+  unsigned int repetitions;
+};
+
+/*
+  What one run of a benchmark processed.
+*/
+struct BenchWork {
+  size_t rows;
+  size_t bytes;
+};
+
+/*
+  The mean and standard deviation of a set of samples.
+*/
+struct BenchSpread {
+  double mean;
+  double stddev;
+};
+
+/*
+  Generate areas.csv (AuthorityCodeCSV), a StatsWales JSON file with every
+  measure (WelshStatsJSON, in the shape of POPDEN) and a complete-*.csv file
+  with one measure (AuthorityByYearCSV, in the shape of COMPLETE_POP) with a
+  DatasetGenerator, as bethyw-datagen would write them.
+*/
+BenchInputs buildInputs(const BenchConfig &config) {
+    GeneratorSettings settings;
+    settings.areas = config.areas;
+    settings.measures = config.measures;
+    settings.years = config.years;
+    settings.missing = config.missing;
+    settings.order = config.order;
+    settings.seed = config.seed;
+    const DatasetGenerator generator(settings);
+
+    // The parser only reads complete-*.csv files with eleven years
+    GeneratorSettings csvSettings = settings;
+    csvSettings.years = 11;
+    const DatasetGenerator csvGenerator(csvSettings);
+
+    BenchInputs inputs;
+    inputs.areas = config.areas;
+    std::ostringstream areas, json, csv;
+    generator.write(areas, BethYw::InputFiles::AREAS);
+    inputs.jsonRows = generator.write(json, BethYw::InputFiles::POPDEN);
+    csvGenerator.write(csv, BethYw::InputFiles::COMPLETE_POP);
+    inputs.areasCSV = areas.str();
+    inputs.statsJSON = json.str();
+    inputs.byYearCSV = csv.str();
+    return inputs;
+}
+
+void populate(Areas &areas, const std::string &text, const BethYw::InputFileSource &source) {
+    StringFilterSet noFilter;
+    YearFilterTuple allYears(0, 0);
+    std::istringstream is(text);
+    auto cols = source.COLS;
+    areas.populate(is, source.PARSER, cols, &noFilter, &noFilter, &allYears);
+}
+
+/*
+  Import every synthetic input into one Areas object, as a run with
+  -d popden,complete-pop would.
+*/
+void populateAll(Areas &areas, const BenchInputs &inputs) {
+    populate(areas, inputs.areasCSV, BethYw::InputFiles::AREAS);
+    populate(areas, inputs.statsJSON, BethYw::InputFiles::POPDEN);
+    populate(areas, inputs.byYearCSV, BethYw::InputFiles::COMPLETE_POP);
+}
+
+BenchSpread spread(const std::vector<double> &samples) {
+    BenchSpread result = {0, 0};
+    if (samples.empty()) {
+        return result;
+    }
+    for (double sample : samples) {
+        result.mean += sample;
+    }
+    result.mean /= (double) samples.size();
+    if (samples.size() > 1) {
+        double squares = 0;
+        for (double sample : samples) {
+            squares += (sample - result.mean) * (sample - result.mean);
+        }
+        result.stddev = std::sqrt(squares / (double) (samples.size() - 1));
+    }
+    return result;
+}
+
+nlohmann::json spreadJSON(const BenchSpread &spread) {
+    return {{"mean", spread.mean}, {"stddev", spread.stddev}};
+}
+
+/*
+  Run a benchmark once to warm up and then the given number of times,
+  timing only the body (not the setup, which builds whatever the body
+  works on afresh each time), and return its results as JSON.
+*/
+nlohmann::json runBenchmark(const std::string &name,
+                            const std::string &kind,
+                            unsigned int repetitions,
+                            const std::function<void()> &setup,
+                            const std::function<BenchWork()> &body) {
+    std::vector<double> seconds, rowsPerSecond, bytesPerSecond;
+    BenchWork work = {0, 0};
+    for (unsigned int i = 0; i <= repetitions; i++) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        work = body();
+        const double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        if (i == 0) {
+            continue;
+        }
+        seconds.push_back(elapsed);
+        rowsPerSecond.push_back((double) work.rows / elapsed);
+        bytesPerSecond.push_back((double) work.bytes / elapsed);
+    }
+
+    nlohmann::json result = {
+        {"name", name},
+        {"kind", kind},
+        {"rows", work.rows},
+        {"bytes", work.bytes},
+        {"repetitions", repetitions},
+        {"seconds", spreadJSON(spread(seconds))},
+        {"rows_per_second", spreadJSON(spread(rowsPerSecond))},
+    };
+    result["seconds"]["min"] = *std::min_element(seconds.begin(), seconds.end());
+    result["seconds"]["max"] = *std::max_element(seconds.begin(), seconds.end());
+    if (work.bytes != 0) {
+        result["bytes_per_second"] = spreadJSON(spread(bytesPerSecond));
+    } else {
+        result["bytes_per_second"] = nullptr;
+    }
+    return result;
+}
+
+/*
+  Print the results as a table, one benchmark per line, with each rate
+  followed by its standard deviation as a percentage of it.
+*/
+void printTable(std::ostream &os, const nlohmann::json &results) {
+    auto relative = [](const nlohmann::json &spread) {
+        const double mean = spread["mean"].get<double>();
+        return mean == 0 ? 0.0 : 100 * spread["stddev"].get<double>() / mean;
+    };
+
+    os << std::left << std::setw(30) << "Benchmark" << std::right
+       << std::setw(12) << "Rows" << std::setw(16) << "Rows/s" << std::setw(8) << "±%"
+       << std::setw(14) << "MB/s" << std::setw(8) << "±%"
+       << std::setw(12) << "Mean ms" << '\n';
+    os << std::fixed;
+    for (const auto &result : results["benchmarks"]) {
+        os << std::left << std::setw(30) << result["name"].get<std::string>() << std::right
+           << std::setw(12) << result["rows"].get<size_t>()
+           << std::setprecision(0) << std::setw(16) << result["rows_per_second"]["mean"].get<double>()
+           << std::setprecision(1) << std::setw(8) << relative(result["rows_per_second"]);
+        if (result["bytes_per_second"].is_null()) {
+            os << std::setw(14) << "-" << std::setw(8) << "-";
+        } else {
+            os << std::setprecision(2) << std::setw(14)
+               << result["bytes_per_second"]["mean"].get<double>() / (1024 * 1024)
+               << std::setprecision(1) << std::setw(8) << relative(result["bytes_per_second"]);
+        }
+        os << std::setprecision(3) << std::setw(12)
+           << 1000 * result["seconds"]["mean"].get<double>() << '\n';
+    }
+    os << std::flush;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cxxopts::Options cxxopts("bethyw-bench",
+                             "Benchmark the import, merging, stats and output of Beth Yw? "
+                             "on synthetic data.\n");
+    cxxopts.add_options()(
+        "areas",
+        "The number of areas in the synthetic data",
+        cxxopts::value<unsigned int>()->default_value("500"))(
+
+        "measures",
+        "The number of measures in the synthetic StatsWales JSON file",
+        cxxopts::value<unsigned int>()->default_value("5"))(
+
+        "years",
+        "The number of years of each measure in the synthetic StatsWales "
+        "JSON file (the complete-*.csv file always has eleven, as its parser "
+        "expects)",
+        cxxopts::value<unsigned int>()->default_value("30"))(
+
+        "r,repetitions",
+        "The number of times to run each benchmark (after one to warm up)",
+        cxxopts::value<unsigned int>()->default_value("5"))(
+
+        "missing",
+        "The share of values, from 0 to 1, that are missing",
+        cxxopts::value<double>()->default_value("0"))(
+
+        "order",
+        "The order of the rows: sorted, interleaved or shuffled (see "
+        "bethyw-datagen)",
+        cxxopts::value<std::string>()->default_value("sorted"))(
+
+        "seed",
+        "The seed for the synthetic values",
+        cxxopts::value<unsigned long long>()->default_value("1"))(
+
+        "b,benchmark",
+        "Only run the benchmarks whose names contain this (may be given "
+        "several times)",
+        cxxopts::value<std::vector<std::string>>())(
+
+        "j,json",
+        "Print the results as JSON instead of a table")(
+
+        "h,help",
+        "Print usage.");
+
+    try {
+        auto args = cxxopts.parse(argc, argv);
+        if (args.count("help")) {
+            std::cerr << cxxopts.help() << std::endl;
+            return 0;
+        }
+
+        const BenchConfig config = {
+            args["areas"].as<unsigned int>(),
+            args["measures"].as<unsigned int>(),
+            args["years"].as<unsigned int>(),
+            args["missing"].as<double>(),
+            DatasetGenerator::parseOrder(args["order"].as<std::string>()),
+            args["seed"].as<unsigned long long>(),
+            args["repetitions"].as<unsigned int>()};
+        if (config.areas == 0 || config.measures == 0 || config.years == 0
+            || config.repetitions == 0) {
+            throw std::invalid_argument(
+                "The areas, measures, years and repetitions must be positive");
+        }
+        std::vector<std::string> only;
+        if (args.count("benchmark")) {
+            only = args["benchmark"].as<std::vector<std::string>>();
+        }
+
+        const BenchInputs inputs = buildInputs(config);
+        Areas imported = Areas();
+        populateAll(imported, inputs);
+        const size_t values = imported.valueCount();
+
+        nlohmann::json results = {
+            {"config", {{"areas", config.areas},
+                        {"measures", config.measures},
+                        {"years", config.years},
+                        {"missing", config.missing},
+                        {"order", args["order"].as<std::string>()},
+                        {"repetitions", config.repetitions},
+                        {"seed", config.seed}}},
+            {"benchmarks", nlohmann::json::array()},
+        };
+        auto run = [&](const std::string &name,
+                       const std::string &kind,
+                       const std::function<void()> &setup,
+                       const std::function<BenchWork()> &body) {
+            const bool selected = only.empty() || std::any_of(
+                only.begin(), only.end(),
+                [&name](const std::string &part) { return name.find(part) != std::string::npos; });
+            if (selected) {
+                results["benchmarks"].push_back(
+                    runBenchmark(name, kind, config.repetitions, setup, body));
+            }
+        };
+
+        Areas target = Areas();
+        auto fresh = [&target]() { target = Areas(); };
+        auto none = []() {};
+
+        run("populate/AuthorityCodeCSV", "micro", fresh, [&]() {
+            populate(target, inputs.areasCSV, BethYw::InputFiles::AREAS);
+            return BenchWork{inputs.areas, inputs.areasCSV.size()};
+        });
+        run("populate/WelshStatsJSON", "micro", fresh, [&]() {
+            populate(target, inputs.statsJSON, BethYw::InputFiles::POPDEN);
+            return BenchWork{inputs.jsonRows, inputs.statsJSON.size()};
+        });
+        run("populate/AuthorityByYearCSV", "micro", fresh, [&]() {
+            populate(target, inputs.byYearCSV, BethYw::InputFiles::COMPLETE_POP);
+            return BenchWork{inputs.areas, inputs.byYearCSV.size()};
+        });
+
+        // Merge every area into areas that already have the same measures,
+        // as importing a second file for the same areas does
+        run("setArea/merge", "micro", [&]() { target = imported; }, [&]() {
+            for (const auto &area : imported.getAreasContainer()) {
+                target.setArea(area.first, area.second);
+            }
+            return BenchWork{values, 0};
+        });
+
+        run("stats/average+difference", "micro", none, [&]() {
+            double sum = 0;
+            for (const auto &area : imported.getAreasContainer()) {
+                for (const auto &measure : area.second.getMeasures()) {
+                    sum += measure.second.getAverage() + measure.second.getDifference()
+                           + measure.second.getDifferenceAsPercentage();
+                }
+            }
+            // Keep the compiler from dropping the loop
+            volatile double result = sum;
+            (void) result;
+            return BenchWork{values, 0};
+        });
+
+        run("output/toJSON", "micro", none, [&]() {
+            std::ostringstream os;
+            imported.toJSON(os);
+            return BenchWork{values, os.str().size()};
+        });
+        run("output/toTable", "micro", none, [&]() {
+            std::ostringstream os;
+            imported.toTable(os);
+            return BenchWork{values, os.str().size()};
+        });
+
+        const size_t inputBytes = inputs.areasCSV.size() + inputs.statsJSON.size()
+                                  + inputs.byYearCSV.size();
+        run("pipeline/import+json", "macro", fresh, [&]() {
+            populateAll(target, inputs);
+            std::ostringstream os;
+            target.toJSON(os);
+            return BenchWork{inputs.areas + inputs.jsonRows + inputs.areas, inputBytes};
+        });
+        run("pipeline/import+table", "macro", fresh, [&]() {
+            populateAll(target, inputs);
+            std::ostringstream os;
+            target.toTable(os);
+            return BenchWork{inputs.areas + inputs.jsonRows + inputs.areas, inputBytes};
+        });
+
+        if (args.count("json")) {
+            std::cout << results.dump(2) << std::endl;
+        } else {
+            printTable(std::cout, results);
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -22,22 +22,56 @@
   additional functions not specified.
 */
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <tuple>
 #include <unordered_set>
 #include <vector>
 
 #include "lib_cxxopts.hpp"
+#include "lib_json.hpp"
 
 #include "datasets.h"
 #include "bethyw.h"
+#include "areastream.h"
+#include "columnar.h"
+#include "compiledfilter.h"
+#include "correlation.h"
+#include "datasetwatcher.h"
+#include "httpserver.h"
 #include "input.h"
+#include "nameindex.h"
+#include "queryserver.h"
+#include "renderpool.h"
+#include "resident.h"
+#include "resultcache.h"
+#include "snapshotcache.h"
+#include "snapshotholder.h"
+#include "spilledareas.h"
+#include "stageprofiler.h"
 
 /*
   Run Beth Yw?, parsing the command line arguments, importing the data,
   and outputting the requested data to the standard output/error.
 
+  With --serve, the data is imported once and kept in memory to answer
+  queries over a Unix domain socket until the process is interrupted. With
+  --client, the arguments are sent to such a server, and its reply is
+  written out instead of importing anything.
+
+  With --profile-stages, the time, bytes, rows and allocations of each stage
+  of importing and writing the data are reported to the standard error once
+  the output is written (see runQuery()).
+
   Hint: cxxopts.parse() throws exceptions you'll need to catch. Read the cxxopts
   documentation for more information.
 
@@ -51,6 +85,12 @@
     Exit code
 */
 int BethYw::run(int argc, char *argv[]) {
+  // Parsing rearranges argv, so keep the arguments as given for a server
+  const std::vector<std::string> arguments(argv + 1, argv + argc);
+
+  // The first stage of --profile-stages starts before the arguments are parsed
+  const StageProfiler::Sample started = StageProfiler::now();
+
   try {
       auto cxxopts = BethYw::cxxoptsSetup();
       auto args = cxxopts.parse(argc, argv);
@@ -61,6 +101,84 @@ int BethYw::run(int argc, char *argv[]) {
           return 0;
       }
 
+      if (args.count("serve")) {
+          return BethYw::serve(args);
+      }
+
+      if (args.count("batch")) {
+          return BethYw::runBatch(args);
+      }
+
+      if (args.count("http")) {
+          return BethYw::serveHttp(args);
+      }
+
+      if (args.count("client")) {
+          return BethYw::queryServer(args, arguments);
+      }
+
+      if (args.count("profile-stages")) {
+          const OutputFormat report = BethYw::parseProfileStagesArg(args);
+          StageProfiler profiler(started);
+          const int code = BethYw::runQuery(args, std::cout, std::cerr, nullptr, &profiler);
+          if (report == FormatJSON) {
+              profiler.toJSON(std::cerr);
+          } else {
+              profiler.toTable(std::cerr);
+          }
+          return code;
+      }
+
+      return BethYw::runQuery(args, std::cout, std::cerr);
+  } catch (std::invalid_argument& iaError) {
+      std::cerr << iaError.what() << std::endl;
+      return 1;
+  } catch (std::runtime_error& rtError) {
+      std::cerr << "Error importing dataset:" << std::endl;
+      std::cerr << rtError.what() << std::endl;
+      return 2;
+  }
+}
+
+/*
+  BethYw::runQuery(args, out, err, resident, profiler)
+
+  Import the data selected by the parsed arguments, either from the files or
+  from data already held in memory, and write it out in the requested
+  format.
+
+  @param args
+    Parsed program arguments
+
+  @param out
+    The stream to write the output to (unless --output is given)
+
+  @param err
+    The stream to write error messages to
+
+  @param resident
+    The data held in memory by a server, or nullptr to import the files. A
+    server's data was imported from its own directory, so --dir,
+    --snapshot-cache and --result-cache are ignored, --output is left to the
+    client, and all the datasets the server holds are queried if --datasets
+    is not given.
+
+  @param profiler
+    A StageProfiler to record each stage of the run in (--profile-stages),
+    or nullptr. Each stage ends as the next begins: the arguments, the
+    result cache, loadAreas, resolving the areas, screening --where, then
+    each dataset's open and parse (and merge, from a snapshot), filling gaps
+    (fill) and the rendering of the output, with the bytes and rows of each.
+
+  @return
+    Exit code
+*/
+int BethYw::runQuery(cxxopts::ParseResult& args,
+                     std::ostream &out,
+                     std::ostream &err,
+                     const ResidentData *resident,
+                     StageProfiler *profiler) {
+  try {
       // Parse data directory argument
       std::string dir = args["dir"].as<std::string>() + DIR_SEP;
 
@@ -68,6 +186,11 @@ int BethYw::run(int argc, char *argv[]) {
       std::vector<BethYw::InputFileSource> datasetsToImport;
       if (args.count("datasets")) {
           datasetsToImport = BethYw::parseDatasetsArg(args);
+      } else if (resident) {
+          // All the datasets the server holds
+          for (const auto & i : resident->getDatasets()) {
+              datasetsToImport.push_back(i);
+          }
       } else {
           for (const auto & i : BethYw::InputFiles::DATASETS) {
               datasetsToImport.push_back(i);
@@ -95,37 +218,335 @@ int BethYw::run(int argc, char *argv[]) {
           yearsFilter = std::pair<unsigned int, unsigned int>(0,0);
       }
 
+      std::vector<ValuePredicate> predicates;
+      if (args.count("where")) {
+          predicates = BethYw::parseWhereArg(args);
+      }
 
-      Areas data = Areas();
+      const uint64_t memoryLimit = BethYw::parseMemoryLimitArg(args);
+
+      // Check the output arguments before importing anything
+      BethYw::checkOutputArgs(args);
+      const bool percentiles = args.count("percentiles") > 0;
+
+      // Write to a file instead of the standard output if one is given
+      std::ofstream outputFile;
+      if (args.count("output") && !resident) {
+          const std::string path = args["output"].as<std::string>();
+          outputFile.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+          if (!outputFile.is_open()) {
+              throw std::invalid_argument("Could not open output file: " + path);
+          }
+      }
+      std::ostream &target = outputFile.is_open() ? outputFile : out;
+      if (profiler) {
+          profiler->stage("args");
+      }
+
+      // Copy the output of an identical earlier run if there is one, or
+      // record this run's output for next time
+      std::unique_ptr<ResultCache> resultCache;
+      std::unique_ptr<ResultRecording> recording;
+      if (args.count("result-cache") && !resident) {
+          resultCache.reset(new ResultCache(args["result-cache"].as<std::string>(),
+                                            BethYw::parseResultCacheSizeArg(args)));
+          const std::string key = BethYw::resultCacheKey(args,
+                                                         dir,
+                                                         datasetsToImport,
+                                                         areasFilter,
+                                                         measuresFilter,
+                                                         yearsFilter);
+          if (!key.empty()) {
+              const bool replayed = resultCache->replay(key, target);
+              if (profiler) {
+                  profiler->stage("result cache");
+              }
+              if (replayed) {
+                  return 0;
+              }
+              recording = resultCache->record(key, target);
+          }
+      }
 
-      loadAreas(data,  dir, areasFilter);
+      // Count the bytes written while profiling
+      std::ostream &written = recording ? recording->stream() : target;
+      CountingStreambuf counter(written.rdbuf());
+      std::ostream counted(&counter);
+      std::ostream &os = profiler ? counted : written;
+
+      Areas data = Areas();
 
-      BethYw::loadDatasets(data,
-                           dir,
-                           datasetsToImport,
-                           areasFilter,
-                           measuresFilter,
-                           yearsFilter);
+      // The sketches are built from the imported values once every dataset
+      // is merged, so that each value is counted once
+      if (percentiles) {
+          data.setQuantileTracking(true);
+      }
 
-      if (args.count("json")) {
-          // The output as JSON
-          std::cout << data.toJSON() << std::endl;
+      bool streamed = false;
+      if (resident) {
+          resident->query(data, datasetsToImport, areasFilter, measuresFilter, yearsFilter,
+                          predicates);
+          if (profiler) {
+              profiler->stage("query", 0, data.valueCount());
+          }
       } else {
-          // The output as tables
-          std::cout << data << std::endl;
+          std::unique_ptr<SnapshotCache> cache;
+          if (args.count("snapshot-cache")) {
+              cache.reset(new SnapshotCache(args["snapshot-cache"].as<std::string>()));
+          }
+
+          Areas allAreas = Areas();
+          if (!areasFilter.empty() || !predicates.empty()) {
+              std::unordered_set<std::string> noFilter;
+              loadAreas(allAreas, dir, noFilter);
+              if (profiler) {
+                  profiler->stage("loadAreas", StageProfiler::fileSize(dir + "areas.csv"),
+                                  allAreas.size());
+              }
+          }
+          if (!areasFilter.empty()) {
+              // Resolve prefixes and near-miss names to authority codes
+              // with the names in areas.csv before anything else is parsed
+              NameIndex(allAreas).resolve(areasFilter);
+              if (profiler) {
+                  profiler->stage("resolve areas", 0, areasFilter.size());
+              }
+          }
+
+          bool anyPassed = true;
+          if (!predicates.empty()) {
+              // Import only the compared measures, in every year, to find
+              // the areas that pass, then import those areas as usual
+              Areas screening = Areas();
+              std::unordered_set<std::string> compared;
+              for (const auto &predicate : predicates) {
+                  compared.insert(predicate.getMeasure());
+              }
+              std::tuple<unsigned int, unsigned int> everyYear(0, 0);
+              BethYw::loadDatasets(screening,
+                                   dir,
+                                   datasetsToImport,
+                                   areasFilter,
+                                   compared,
+                                   everyYear,
+                                   cache.get());
+
+              const std::set<std::string> passed =
+                  ValuePredicate::screen(predicates, {&screening}, areasFilter);
+              areasFilter = std::unordered_set<std::string>(passed.begin(), passed.end());
+              anyPassed = !passed.empty();
+              if (profiler) {
+                  profiler->stage("where", 0, screening.valueCount());
+              }
+          }
+
+          // Merge sorted datasets an area at a time, if asked to and the
+          // output can be written (or the percentiles sketched) that way
+          const bool writable = !args.count("correlate")
+                                && (percentiles
+                                    || AreaStreamWriter::supports(BethYw::parseFormatArg(args)));
+          QuantileSketches sketches;
+          QuantileSketches *sketching = percentiles ? &sketches : nullptr;
+          if (anyPassed && args.count("stream") && writable) {
+              streamed = BethYw::streamDatasets(args,
+                                                dir,
+                                                datasetsToImport,
+                                                areasFilter,
+                                                measuresFilter,
+                                                yearsFilter,
+                                                os,
+                                                sketching);
+              if (profiler) {
+                  // Finding a file is not sorted takes a pass over it too
+                  profiler->stage(streamed ? "stream" : "stream check", counter.count());
+              }
+          }
+
+          // Otherwise keep within the memory limit by spilling to disk
+          if (anyPassed && !streamed && memoryLimit != 0 && writable) {
+              BethYw::spillDatasets(args,
+                                    dir,
+                                    datasetsToImport,
+                                    areasFilter,
+                                    measuresFilter,
+                                    yearsFilter,
+                                    memoryLimit,
+                                    os,
+                                    sketching);
+              streamed = true;
+              if (profiler) {
+                  profiler->stage("memory-limit", counter.count());
+              }
+          }
+
+          if (streamed && percentiles) {
+              const uint64_t before = counter.count();
+              BethYw::printPercentiles(os, sketches, BethYw::parsePercentilesArg(args),
+                                       BethYw::parseFormatArg(args) == BethYw::FormatJSON);
+              if (profiler) {
+                  profiler->stage("render", counter.count() - before, sketches.size());
+              }
+          }
+
+          if (anyPassed && !streamed) {
+              if (areasFilter.empty()) {
+                  loadAreas(data,  dir, areasFilter);
+                  if (profiler) {
+                      profiler->stage("loadAreas", StageProfiler::fileSize(dir + "areas.csv"), data.size());
+                  }
+              } else {
+                  data.mergeFiltered(allAreas, &areasFilter, nullptr, nullptr);
+                  if (profiler) {
+                      profiler->stage("filter areas", 0, data.size());
+                  }
+              }
+
+              BethYw::loadDatasets(data,
+                                   dir,
+                                   datasetsToImport,
+                                   areasFilter,
+                                   measuresFilter,
+                                   yearsFilter,
+                                   cache.get(),
+                                   profiler);
+          }
+      }
+
+      if (!streamed) {
+          // Percentiles are of the imported values only
+          if (!percentiles) {
+              data.fillGaps(BethYw::parseFillArg(args));
+          }
+          const size_t values = profiler ? data.valueCount() : 0;
+          if (profiler) {
+              profiler->stage("fill", 0, values);
+          }
+
+          BethYw::writeData(args, data, os);
+          if (profiler) {
+              profiler->stage("render", counter.count(), values);
+          }
+      }
+
+      // The counting stream does not pass on a failure to write
+      if (profiler && !counted) {
+          written.setstate(std::ios::badbit);
+      }
+
+      if (recording) {
+          resultCache->commit(*recording);
+      }
+
+      if (outputFile.is_open() && !outputFile) {
+          throw std::runtime_error("Could not write output file: "
+                                   + args["output"].as<std::string>());
       }
       return 0;
     } catch (std::invalid_argument& iaError) {
-      std::cerr << iaError.what() << std::endl;
+      err << iaError.what() << std::endl;
       return 1;
   } catch (std::runtime_error& rtError) {
-      std::cerr << "Error importing dataset:" << std::endl;
-      std::cerr << rtError.what() << std::endl;
+      err << "Error importing dataset:" << std::endl;
+      err << rtError.what() << std::endl;
       return 2;
   }
 
 }
 
+/*
+  BethYw::checkOutputArgs(args)
+
+  Check the arguments that control the output (percentiles, correlate,
+  format, fill and threads) before any data is imported.
+
+  @param args
+    Parsed program arguments
+
+  @throws
+    std::invalid_argument if any of them is invalid, with the message for
+    that argument (e.g. percentiles with a csv, tsv, ndjson or columnar
+    format gives: Invalid input for format argument)
+*/
+void BethYw::checkOutputArgs(cxxopts::ParseResult& args) {
+    std::vector<double> percentiles;
+    if (args.count("percentiles")) {
+        percentiles = BethYw::parsePercentilesArg(args);
+    }
+
+    const BethYw::OutputFormat format = BethYw::parseFormatArg(args);
+    const bool delimited = format == BethYw::FormatCSV || format == BethYw::FormatTSV;
+    if ((delimited || format == BethYw::FormatNDJSON || format == BethYw::FormatColumnar)
+        && (!percentiles.empty() || args.count("correlate"))) {
+        throw std::invalid_argument("Invalid input for format argument");
+    }
+
+    BethYw::parseFillArg(args);
+    BethYw::parseThreadsArg(args);
+}
+
+/*
+  BethYw::writeData(args, data, os)
+
+  Write imported data out as the output arguments ask: the percentiles, the
+  correlation matrix, or the data itself in the chosen format.
+
+  @param args
+    Parsed program arguments, already checked with checkOutputArgs()
+
+  @param data
+    The imported data (with quantile tracking enabled for percentiles)
+
+  @param os
+    The stream to write to
+
+  @throws
+    std::invalid_argument if the correlate target matches nothing
+*/
+void BethYw::writeData(cxxopts::ParseResult& args, const Areas &data, std::ostream &os) {
+    std::vector<double> percentiles;
+    if (args.count("percentiles")) {
+        percentiles = BethYw::parsePercentilesArg(args);
+    }
+    const BethYw::OutputFormat format = BethYw::parseFormatArg(args);
+    const bool delimited = format == BethYw::FormatCSV || format == BethYw::FormatTSV;
+    const unsigned int threads = BethYw::parseThreadsArg(args);
+
+    if (!percentiles.empty()) {
+        BethYw::printPercentiles(os, data.getQuantileSketches(), percentiles,
+                                 format == BethYw::FormatJSON);
+    } else if (args.count("correlate")) {
+        // The correlation between measures instead of the data itself
+        auto matrix = BethYw::correlate(data, args["correlate"].as<std::string>());
+        if (format == BethYw::FormatJSON) {
+            os << matrix.toJSON() << std::endl;
+        } else {
+            os << matrix << std::endl;
+        }
+    } else if (format == BethYw::FormatJSON) {
+        // The output as JSON, written straight to the stream
+        data.toJSON(os, threads);
+        os << std::endl;
+    } else if (format == BethYw::FormatNDJSON) {
+        // One JSON object per area per line, flushed as it goes
+        data.toNDJSON(os, threads);
+    } else if (delimited) {
+        // One row per area, measure and year, every row ending in a newline
+        data.toDelimited(os,
+                         format == BethYw::FormatCSV ? ',' : '\t',
+                         args.count("stats") > 0,
+                         threads);
+        os.flush();
+    } else if (format == BethYw::FormatColumnar) {
+        // A binary file, see columnar.h
+        writeColumnar(os, data);
+        os.flush();
+    } else {
+        // The output as tables
+        data.toTable(os, threads);
+        os << std::endl;
+    }
+}
+
 /*
   This function sets up and returns a valid cxxopts object. You do not need to
   modify this function.
@@ -156,7 +577,9 @@ cxxopts::Options BethYw::cxxoptsSetup() {
 
       "a,areas",
       "The areas(s) to import and analyse as a comma-separated list of "
-      "authority codes (omit or set to 'all' to import and analyse all areas)",
+      "authority codes or names, in English or Welsh (end one with * to match "
+      "every area starting with it; case, accents and small typing mistakes "
+      "are forgiven) (omit or set to 'all' to import and analyse all areas)",
       cxxopts::value<std::vector<std::string>>())(
 
       "m,measures",
@@ -170,7 +593,118 @@ cxxopts::Options BethYw::cxxoptsSetup() {
       cxxopts::value<std::string>()->default_value("0"))(
 
       "j,json",
-      "Print the output as JSON instead of tables.")(
+      "Print the output as JSON instead of tables (short for --format json).")(
+
+      "format",
+      "The output format: table, json, ndjson, csv, tsv or columnar "
+      "(ndjson has one line per area; csv and tsv have one row per area, "
+      "measure and year; columnar is a binary file, best written with "
+      "--output)",
+      cxxopts::value<std::string>()->default_value("table"))(
+
+      "o,output",
+      "Write the output to a file instead of the standard output",
+      cxxopts::value<std::string>())(
+
+      "stats",
+      "Include the average, difference and percentage difference of each "
+      "measure as extra columns in csv or tsv output")(
+
+      "fill",
+      "Fill in missing years between the first and last year of each measure "
+      "(none, linear or step)",
+      cxxopts::value<std::string>()->default_value("none"))(
+
+      "w,where",
+      "Only import the areas with a value that passes a comparison, e.g. "
+      "'pop>100000 in 2019' (<, <=, =, !=, >= or >; without 'in YYYY' a "
+      "value in any year may pass), found in the dataset(s) being imported; "
+      "give several, comma-separated or repeated, to require all of them",
+      cxxopts::value<std::vector<std::string>>())(
+
+      "stream",
+      "Merge the datasets an area at a time, writing each area as soon as "
+      "it is complete instead of importing everything first, if every file "
+      "is sorted by authority code (otherwise they are imported as usual); "
+      "with --percentiles each area is added to the sketches instead; not "
+      "used with --correlate or columnar output")(
+
+      "p,percentiles",
+      "Print percentiles (0-100) of each measure across all areas and years "
+      "instead of the data, as a comma-separated list (approximate with "
+      "--stream or --memory-limit, which do not hold the values)",
+      cxxopts::value<std::vector<std::string>>())(
+
+      "c,correlate",
+      "Print the correlation between every pair of measures instead of the "
+      "data, either across all areas for a year (YYYY) or across all years "
+      "for an area (authority code)",
+      cxxopts::value<std::string>())(
+
+      "snapshot-cache",
+      "Keep a snapshot of each parsed dataset in this directory, and load "
+      "datasets from their snapshots while their files are unchanged",
+      cxxopts::value<std::string>())(
+
+      "result-cache",
+      "Keep the output of each run in this directory, and reuse it for "
+      "identical runs while the datasets are unchanged",
+      cxxopts::value<std::string>())(
+
+      "memory-limit",
+      "Import within about this much memory, in megabytes, by spilling "
+      "sorted runs of values to temporary files and merging them as the "
+      "output is written, or with --percentiles adding them to sketches as "
+      "they are merged; not used with --correlate or columnar output",
+      cxxopts::value<std::string>())(
+
+      "profile-stages",
+      "Report the wall and CPU time, bytes, rows and allocations of each "
+      "stage of the run to the standard error, as a table, or as JSON with "
+      "--profile-stages=json",
+      cxxopts::value<std::string>()->implicit_value("table"))(
+
+      "result-cache-size",
+      "The most the result cache may hold, in megabytes, before the least "
+      "recently used results are removed",
+      cxxopts::value<std::string>()->default_value("256"))(
+
+      "batch",
+      "Run every query in this file, one command line per line, each with "
+      "its own --output file, importing the datasets they need only once",
+      cxxopts::value<std::string>())(
+
+      "serve",
+      "Import the datasets once and answer queries from --client on this "
+      "Unix domain socket until interrupted",
+      cxxopts::value<std::string>())(
+
+      "client",
+      "Send the query to the server listening on this Unix domain socket "
+      "instead of importing the datasets",
+      cxxopts::value<std::string>())(
+
+      "http",
+      "Import the datasets once and answer HTTP requests such as "
+      "GET /areas/W06000011?measures=pop&years=2010-2019 on this port of "
+      "127.0.0.1 until interrupted",
+      cxxopts::value<std::string>())(
+
+      "reload",
+      "With --serve or --http, check every this many seconds whether the "
+      "dataset files have changed, and if so import them again without "
+      "pausing queries (0 to never check)",
+      cxxopts::value<std::string>()->default_value("0"))(
+
+      "watch",
+      "With --serve or --http, watch the data directory (with inotify, on "
+      "Linux) and import each dataset file again as soon as it changes")(
+
+      "threads",
+      "The number of threads to format the output with "
+      "(0 to use one per processor core), or with --serve or --http, the number "
+      "of queries or requests to answer at once",
+      cxxopts::value<std::string>()->default_value("0"))(
 
       "h,help",
       "Print usage.");
@@ -419,114 +953,1640 @@ std::tuple<unsigned int, unsigned int> BethYw::parseYearsArg(
 
 
 /*
-  TODO: BethYw::loadAreas(areas, dir, areasFilter)
+  BethYw::parsePercentilesArg(args)
 
-  Load the areas.csv file from the directory `dir`. Parse the file and
-  create the appropriate Area objects inside the Areas object passed to
-  the function in the `areas` argument.
+  Parse the percentiles command line argument, a comma-separated list of
+  numbers between 0 and 100 inclusive (e.g. 50,90,99.9).
 
-  areas.csv is guaranteed to be formatted as:
-    Local authority code,Name (eng),Name (cym)
+  @param args
+    Parsed program arguments
 
-  Hint: To implement this function. First you will need create an InputFile 
-  object with the filename of the areas file, open it, and then pass reference 
-  to the stream to the Areas::populate() function.
+  @return
+    A std::vector of the requested percentiles, in the order given
 
-  Hint 2: you can retrieve the specific filename for a dataset, e.g. for the 
-  areas.csv file, from the InputFileSource's FILE member variable
+  @throws
+    std::invalid_argument if any value is not a number between 0 and 100 with
+    the message: Invalid input for percentiles argument
+*/
+std::vector<double> BethYw::parsePercentilesArg(cxxopts::ParseResult& args) {
+    std::vector<double> percentiles;
+
+    auto temp = args["percentiles"].as<std::vector<std::string>>();
+    for (auto & percentile : temp) {
+        size_t pos = 0;
+        double value = -1;
+        try {
+            value = std::stod(percentile, &pos);
+        } catch (std::exception &) {
+            pos = 0;
+        }
+        if (percentile.empty() || pos != percentile.length() || !(value >= 0 && value <= 100)) {
+            throw std::invalid_argument("Invalid input for percentiles argument");
+        }
+        percentiles.push_back(value);
+    }
 
-  @param areas
-    An Areas instance that should be modified (i.e. the populate() function
-    in the instance should be called)
+    return percentiles;
+}
 
-  @param dir
-    Directory where the areas.csv file is
+/*
+  BethYw::parseFillArg(args)
 
-  @param areasFilter
-    An unordered set of areas to filter, or empty to import all areas
+  Parse the fill command line argument, which selects how missing years are
+  filled in after importing: none (the default), linear or step. The value is
+  case insensitive.
 
-  @return
-    void
+  @param args
+    Parsed program arguments
 
-  @example
-    Areas areas();
+  @return
+    The GapFillMode to apply
 
-    BethYw::loadAreas(areas, "data", BethYw::parseAreasArg(args));
+  @throws
+    std::invalid_argument if the argument is not one of the modes, with the
+    message: Invalid input for fill argument
 */
+GapFillMode BethYw::parseFillArg(cxxopts::ParseResult& args) {
+    auto mode = args["fill"].as<std::string>();
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if (mode == "none") {
+        return GapFillNone;
+    } else if (mode == "linear") {
+        return GapFillLinear;
+    } else if (mode == "step") {
+        return GapFillStep;
+    }
 
-void BethYw::loadAreas(Areas &areas, std::string &dir, std::unordered_set<std::string> &areasFilter) {
-    InputFile input(dir + "areas.csv");
-    auto &is = input.open();
-    auto cols = BethYw::InputFiles::AREAS.COLS;
-    areas.populate(is, BethYw::SourceDataType::AuthorityCodeCSV, cols, &areasFilter, NULL, NULL);
+    throw std::invalid_argument("Invalid input for fill argument");
 }
 
+/*
+  BethYw::parseWhereArg(args)
+
+  Parse the where command line argument, a list of value predicates such as
+  pop>100000 in 2019 (see ValuePredicate::parse()), every one of which an
+  area must pass to be imported.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The predicates, in the order given
+
+  @throws
+    std::invalid_argument if any of them is not a predicate, with the
+    message: Invalid input for where argument: <predicate>
+*/
+std::vector<ValuePredicate> BethYw::parseWhereArg(cxxopts::ParseResult& args) {
+    std::vector<ValuePredicate> predicates;
+    for (const auto &text : args["where"].as<std::vector<std::string>>()) {
+        predicates.push_back(ValuePredicate::parse(text));
+    }
+    return predicates;
+}
 
 /*
-  TODO: BethYw::loadDatasets(areas,
-                             dir,
-                             datasetsToImport,
-                             areasFilter,
-                             measuresFilter,
-                             yearsFilter)
+  BethYw::parseFormatArg(args)
 
-  Import datasets from `datasetsToImport` as files in `dir` into areas, and
-  filtering them with the `areasFilter`, `measuresFilter`, and `yearsFilter`.
+  Parse the format command line argument: table (the default), json,
+  ndjson, csv, tsv or columnar, case insensitive. The json argument is short for
+  --format json, and cannot be combined with a different format.
 
-  The actual filtering will be done by the Areas::populate() function, thus 
-  you need to merely pass pointers on to these flters.
+  @param args
+    Parsed program arguments
 
-  This function should promise not to throw an exception. If there is an
-  error/exception thrown in any function called by thus function, catch it and
-  output 'Error importing dataset:', followed by a new line and then the output
-  of the what() function on the exception.
+  @return
+    The OutputFormat to write
 
-  @param areas
-    An Areas instance that should be modified (i.e. datasets loaded into it)
+  @throws
+    std::invalid_argument if the argument is not one of the formats, or
+    conflicts with the json argument, with the message:
+    Invalid input for format argument
+*/
+BethYw::OutputFormat BethYw::parseFormatArg(cxxopts::ParseResult& args) {
+    auto format = args["format"].as<std::string>();
+    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+
+    OutputFormat parsed;
+    if (format == "table") {
+        parsed = FormatTable;
+    } else if (format == "json") {
+        parsed = FormatJSON;
+    } else if (format == "ndjson") {
+        parsed = FormatNDJSON;
+    } else if (format == "csv") {
+        parsed = FormatCSV;
+    } else if (format == "tsv") {
+        parsed = FormatTSV;
+    } else if (format == "columnar") {
+        parsed = FormatColumnar;
+    } else {
+        throw std::invalid_argument("Invalid input for format argument");
+    }
 
-  @param dir
-    The directory where the datasets are
+    if (args.count("json")) {
+        if (args.count("format") && parsed != FormatJSON) {
+            throw std::invalid_argument("Invalid input for format argument");
+        }
+        parsed = FormatJSON;
+    }
 
-  @param datasetsToImport
-    A vector of InputFileSource objects
+    return parsed;
+}
 
-  @param areasFilter
-    An unordered set of areas (as authority codes encoded in std::strings)
-    to filter, or empty to import all areas
+/*
+  BethYw::parseThreadsArg(args)
 
-  @param measuresFilter
-    An unordered set of measures (as measure codes encoded in std::strings)
-    to filter, or empty to import all measures
+  Parse the threads command line argument, the number of threads to format
+  the output with. 0 (the default) uses one thread per processor core.
 
-  @param yearsFilter
-    An two-pair tuple of unsigned ints corresponding to the range of years 
-    to import, which should both be 0 to import all years.
+  @param args
+    Parsed program arguments
 
   @return
-    void
-
-  @example
-    Areas areas();
+    The number of threads to use, at least 1
 
-    BethYw::loadDatasets(
-      areas,
-      "data",
-      BethYw::parseDatasetsArgument(args),
-      BethYw::parseAreasArg(args),
-      BethYw::parseMeasuresArg(args),
-      BethYw::parseYearsArg(args));
+  @throws
+    std::invalid_argument if the argument is not a whole number from 0 to
+    1024, with the message: Invalid input for threads argument
 */
+unsigned int BethYw::parseThreadsArg(cxxopts::ParseResult& args) {
+    const unsigned int MAX_THREADS = 1024;
+
+    auto threads = args["threads"].as<std::string>();
+    if (threads.empty() || threads.size() > 4
+        || !std::all_of(threads.begin(), threads.end(), ::isdigit)
+        || std::stoul(threads) > MAX_THREADS) {
+        throw std::invalid_argument("Invalid input for threads argument");
+    }
 
-void BethYw::loadDatasets(Areas &areas, std::string &dir, const std::vector<InputFileSource>& datasetsToImport,
-                          std::unordered_set<std::string> &areasFilter, std::unordered_set<std::string> &measuresFilter,
-                          std::tuple<unsigned int, unsigned int> &yearsFilter) {
+    return renderThreads((unsigned int) std::stoul(threads));
+}
 
-    for (const InputFileSource &source : datasetsToImport) {
-        InputFile input(dir + source.FILE);
-        auto &is = input.open();
-        auto cols = source.COLS;
-        areas.populate(is, source.PARSER, cols, &areasFilter, &measuresFilter, &yearsFilter);
+/*
+  BethYw::parseResultCacheSizeArg(args)
+
+  Parse the result-cache-size command line argument, the size limit of the
+  result cache in megabytes.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The size limit in bytes
+
+  @throws
+    std::invalid_argument if the argument is not a whole number from 1 to
+    1048576 (1 TB), with the message:
+    Invalid input for result-cache-size argument
+*/
+uint64_t BethYw::parseResultCacheSizeArg(cxxopts::ParseResult& args) {
+    const uint64_t MAX_MEGABYTES = 1024 * 1024;
+
+    auto size = args["result-cache-size"].as<std::string>();
+    if (size.empty() || size.size() > 7
+        || !std::all_of(size.begin(), size.end(), ::isdigit)
+        || std::stoull(size) == 0 || std::stoull(size) > MAX_MEGABYTES) {
+        throw std::invalid_argument("Invalid input for result-cache-size argument");
     }
+
+    return std::stoull(size) * 1024 * 1024;
 }
 
+/*
+  BethYw::parseMemoryLimitArg(args)
+
+  Parse the memory-limit command line argument, the memory in megabytes to
+  import the datasets within (see spillDatasets()).
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The memory limit in bytes, or 0 if the argument was not given
+
+  @throws
+    std::invalid_argument if the argument is not a whole number from 1 to
+    1048576 (1 TB), with the message:
+    Invalid input for memory-limit argument
+*/
+uint64_t BethYw::parseMemoryLimitArg(cxxopts::ParseResult& args) {
+    const uint64_t MAX_MEGABYTES = 1024 * 1024;
 
+    if (!args.count("memory-limit")) {
+        return 0;
+    }
+    auto limit = args["memory-limit"].as<std::string>();
+    if (limit.empty() || limit.size() > 7
+        || !std::all_of(limit.begin(), limit.end(), ::isdigit)
+        || std::stoull(limit) == 0 || std::stoull(limit) > MAX_MEGABYTES) {
+        throw std::invalid_argument("Invalid input for memory-limit argument");
+    }
+
+    return std::stoull(limit) * 1024 * 1024;
+}
+
+/*
+  BethYw::parseProfileStagesArg(args)
+
+  Parse the profile-stages command line argument, the format of the report
+  of the stages of the run: table (the default, if no value is given) or
+  json.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    FormatTable or FormatJSON
+
+  @throws
+    std::invalid_argument if the argument is neither, with the message:
+    Invalid input for profile-stages argument
+*/
+BethYw::OutputFormat BethYw::parseProfileStagesArg(cxxopts::ParseResult& args) {
+    auto format = args["profile-stages"].as<std::string>();
+    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+    if (format == "table") {
+        return FormatTable;
+    } else if (format == "json") {
+        return FormatJSON;
+    }
+    throw std::invalid_argument("Invalid input for profile-stages argument");
+}
+
+/*
+  BethYw::resultCacheKey(args, dir, datasetsToImport, areasFilter,
+                         measuresFilter, yearsFilter)
+
+  Describe everything the output of a run depends on, for the result cache:
+  the fingerprint (size, modification time and inode) of areas.csv and each
+  dataset file in the order they are imported, the filters (sorted, so the
+  order they were given in does not matter) and the options that change
+  what is written. The description is a JSON object, so that any filter
+  value is encoded unambiguously.
+
+  @param args
+    Parsed program arguments
+
+  @param dir
+    The directory where the datasets are
+
+  @param datasetsToImport
+    The datasets the run imports
+
+  @param areasFilter
+    The parsed areas filter
+
+  @param measuresFilter
+    The parsed measures filter
+
+  @param yearsFilter
+    The parsed years filter
+
+  @return
+    The key, or an empty string if a file cannot be read (so the run goes
+    ahead without the cache and reports the file as usual)
+*/
+std::string BethYw::resultCacheKey(cxxopts::ParseResult& args,
+                                   const std::string &dir,
+                                   const std::vector<InputFileSource>& datasetsToImport,
+                                   const std::unordered_set<std::string> &areasFilter,
+                                   const std::unordered_set<std::string> &measuresFilter,
+                                   const std::tuple<unsigned int, unsigned int> &yearsFilter) {
+    nlohmann::json key;
+    key["version"] = 2;
+
+    try {
+        key["areas.csv"] = ResultCache::fingerprint(dir + "areas.csv");
+        for (const auto &source : datasetsToImport) {
+            key["datasets"].push_back({source.CODE, source.FILE,
+                                       ResultCache::fingerprint(dir + source.FILE)});
+        }
+    } catch (const std::runtime_error &) {
+        return "";
+    }
+
+    key["areas"] = std::set<std::string>(areasFilter.begin(), areasFilter.end());
+    key["measures"] = std::set<std::string>(measuresFilter.begin(), measuresFilter.end());
+    key["years"] = {std::get<0>(yearsFilter), std::get<1>(yearsFilter)};
+
+    key["format"] = parseFormatArg(args);
+    key["stats"] = args.count("stats") > 0;
+    key["fill"] = parseFillArg(args);
+    if (args.count("where")) {
+        for (const auto &predicate : parseWhereArg(args)) {
+            key["where"].push_back(predicate.toString());
+        }
+    }
+    if (args.count("percentiles")) {
+        key["percentiles"] = parsePercentilesArg(args);
+        // The percentiles are approximate if the values are not all held
+        key["sketched"] = args.count("stream") > 0 || parseMemoryLimitArg(args) != 0;
+    }
+    if (args.count("correlate")) {
+        key["correlate"] = args["correlate"].as<std::string>();
+    }
+
+    return key.dump();
+}
+
+/*
+  BethYw::loadResident(args)
+
+  Import the areas and the datasets selected by the datasets argument (all
+  of them if it is omitted) from the data directory, without any filters, to
+  keep in memory for a server.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The data, which is never modified afterwards
+
+  @throws
+    std::runtime_error if the datasets cannot be imported
+*/
+std::unique_ptr<ResidentData> BethYw::loadResident(cxxopts::ParseResult& args) {
+    std::vector<BethYw::InputFileSource> datasetsToImport;
+    if (args.count("datasets")) {
+        datasetsToImport = BethYw::parseDatasetsArg(args);
+    } else {
+        for (const auto & i : BethYw::InputFiles::DATASETS) {
+            datasetsToImport.push_back(i);
+        }
+    }
+
+    std::unique_ptr<SnapshotCache> cache;
+    if (args.count("snapshot-cache")) {
+        cache.reset(new SnapshotCache(args["snapshot-cache"].as<std::string>()));
+    }
+
+    return std::unique_ptr<ResidentData>(new ResidentData(args["dir"].as<std::string>() + DIR_SEP,
+                                                          datasetsToImport,
+                                                          cache.get()));
+}
+
+/*
+  BethYw::parseReloadArg(args)
+
+  Parse the reload argument, how often a server checks whether the dataset
+  files have changed.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The interval, or 0 to never check
+
+  @throws
+    std::invalid_argument if the argument is not a whole number of seconds
+    from 0 to 86400, with the message: Invalid input for reload argument
+*/
+std::chrono::seconds BethYw::parseReloadArg(cxxopts::ParseResult& args) {
+    auto seconds = args["reload"].as<std::string>();
+    if (seconds.empty() || seconds.size() > 5
+        || !std::all_of(seconds.begin(), seconds.end(), ::isdigit)
+        || std::stoul(seconds) > 86400) {
+        throw std::invalid_argument("Invalid input for reload argument");
+    }
+    return std::chrono::seconds(std::stoul(seconds));
+}
+
+/*
+  BethYw::startReloader(args, holder, interval)
+
+  Start a BackgroundReloader that imports the server's data again, and
+  publishes it to the holder, whenever the files change. Queries in progress
+  carry on with the data they started with.
+
+  @param args
+    Parsed program arguments, as given to loadResident()
+
+  @param holder
+    The SnapshotHolder the server reads its data from
+
+  @param interval
+    How often to check the files, or 0 to never check
+
+  @return
+    The reloader, which stops when destroyed, or nullptr if the interval is 0
+*/
+std::unique_ptr<BackgroundReloader> BethYw::startReloader(cxxopts::ParseResult& args,
+                                                          SnapshotHolder &holder,
+                                                          std::chrono::seconds interval) {
+    if (interval.count() == 0) {
+        return nullptr;
+    }
+
+    const auto current = holder.read();
+    const std::string dir = current->getDir();
+    const std::vector<BethYw::InputFileSource> datasets = current->getDatasets();
+
+    return std::unique_ptr<BackgroundReloader>(new BackgroundReloader(
+        holder,
+        [&args]() {
+            auto resident = BethYw::loadResident(args);
+            std::cerr << "Reloaded " << resident->datasetCount() << " datasets" << std::endl;
+            return resident;
+        },
+        [dir, datasets]() { return ResidentData::stamp(dir, datasets); },
+        current->getStamp(),
+        interval));
+}
+
+/*
+  BethYw::startWatcher(args, holder)
+
+  Start a DatasetWatcher on the data directory that, whenever areas.csv or
+  one of the server's dataset files is written or replaced, re-imports just
+  those files and publishes the result to the holder, sharing the datasets
+  that did not change (see ResidentData::reloaded()).
+
+  @param args
+    Parsed program arguments, as given to loadResident()
+
+  @param holder
+    The SnapshotHolder the server reads its data from
+
+  @return
+    The watcher, which stops when destroyed, or nullptr if the watch
+    argument was not given
+
+  @throws
+    std::runtime_error if the directory cannot be watched (or inotify is not
+    available)
+*/
+std::unique_ptr<DatasetWatcher> BethYw::startWatcher(cxxopts::ParseResult& args,
+                                                     SnapshotHolder &holder) {
+    if (!args.count("watch")) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<DatasetWatcher>(new DatasetWatcher(
+        args["dir"].as<std::string>(),
+        [&args, &holder](const std::set<std::string> &files) {
+            std::unique_ptr<SnapshotCache> cache;
+            if (args.count("snapshot-cache")) {
+                cache.reset(new SnapshotCache(args["snapshot-cache"].as<std::string>()));
+            }
+
+            std::unique_ptr<ResidentData> next;
+            try {
+                // Let go of the current data before publishing, as
+                // publish() waits for every reader
+                const auto current = holder.read();
+                std::set<std::string> held = {"areas.csv"};
+                for (const auto &source : current->getDatasets()) {
+                    held.insert(source.FILE);
+                }
+                std::set<std::string> changed;
+                for (const auto &file : files) {
+                    if (held.count(file)) {
+                        changed.insert(file);
+                    }
+                }
+                if (changed.empty()) {
+                    return;
+                }
+                next = current->reloaded(changed, cache.get());
+
+                std::cerr << "Reloaded";
+                for (const auto &file : changed) {
+                    std::cerr << " " << file;
+                }
+                std::cerr << std::endl;
+            } catch (const std::exception &e) {
+                std::cerr << "Could not reload the datasets, keeping the previous data:"
+                          << std::endl << e.what() << std::endl;
+                return;
+            }
+            holder.publish(std::move(next));
+        }));
+}
+
+/*
+  BethYw::parseArguments(arguments)
+
+  Parse a command line that did not come from main(), e.g. one sent to a
+  server or read from a batch file.
+
+  @param arguments
+    The command line arguments, without the program name
+
+  @return
+    The parsed arguments
+
+  @throws
+    cxxopts::OptionException if the arguments cannot be parsed
+
+  @example
+    auto args = BethYw::parseArguments({"-d", "popden", "-j"});
+*/
+cxxopts::ParseResult BethYw::parseArguments(std::vector<std::string> arguments) {
+    // cxxopts needs a mutable argv, starting with the program name
+    arguments.insert(arguments.begin(), "bethyw");
+    std::vector<char *> argv;
+    for (auto &argument : arguments) {
+        argv.push_back(&argument[0]);
+    }
+    int argc = (int) argv.size();
+    char **argvPointer = argv.data();
+
+    auto options = BethYw::cxxoptsSetup();
+    return options.parse(argc, argvPointer);
+}
+
+/*
+  BethYw::runArguments(arguments, out, err, resident, profiler)
+
+  Parse a command line with parseArguments() and run it with runQuery(),
+  e.g. against the data in memory of a server.
+
+  @param arguments
+    The command line arguments, without the program name
+
+  @param out
+    The stream to write the output to
+
+  @param err
+    The stream to write error messages to
+
+  @param resident
+    The data held in memory, or nullptr to import the files
+
+  @param profiler
+    A StageProfiler to record each stage of the run in, or nullptr
+
+  @return
+    Exit code
+
+  @throws
+    cxxopts::OptionException if the arguments cannot be parsed
+
+  @example
+    std::ostringstream out, err;
+    int code = BethYw::runArguments({"-d", "popden", "-a", "W06000011", "-j"}, out, err);
+*/
+int BethYw::runArguments(const std::vector<std::string> &arguments,
+                         std::ostream &out,
+                         std::ostream &err,
+                         const ResidentData *resident,
+                         StageProfiler *profiler) {
+    auto args = BethYw::parseArguments(arguments);
+    return BethYw::runQuery(args, out, err, resident, profiler);
+}
+
+/*
+  BethYw::serve(args)
+
+  Import the areas and datasets from the data directory, without any
+  filters, and answer queries from clients on the Unix domain socket given
+  by the serve argument until the process receives SIGINT or SIGTERM. Each
+  query is the command line of a client, which is parsed and run by
+  runQuery() against the data in memory, so the areas, measures, years and
+  format arguments mean exactly what they do without a server. The threads
+  argument sets how many queries are answered at once.
+
+  @param args
+    Parsed program arguments, whose datasets argument selects the datasets
+    to keep in memory (all of them if omitted)
+
+  @return
+    Exit code
+
+  @throws
+    std::runtime_error if the datasets cannot be imported or the socket
+    cannot be listened on
+
+  @example
+    bethyw --serve /tmp/bethyw.sock &
+    bethyw --client /tmp/bethyw.sock -d popden -a W06000011 -j
+*/
+int BethYw::serve(cxxopts::ParseResult& args) {
+    const unsigned int workers = BethYw::parseThreadsArg(args);
+    const std::chrono::seconds reloadInterval = BethYw::parseReloadArg(args);
+    SnapshotHolder holder(BethYw::loadResident(args));
+    const auto reloader = BethYw::startReloader(args, holder, reloadInterval);
+    const auto watcher = BethYw::startWatcher(args, holder);
+
+    const std::string path = args["serve"].as<std::string>();
+    QueryServer server(path, workers);
+    std::cerr << "Serving " << holder.read()->datasetCount() << " datasets on " << path
+              << std::endl;
+
+    server.serve([&holder](const std::vector<std::string> &arguments,
+                           std::ostream &out,
+                           std::ostream &err) {
+        const auto snapshot = holder.read();
+        return BethYw::runArguments(arguments, out, err, &*snapshot);
+    });
+
+    return 0;
+}
+
+/*
+  BethYw::serveHttp(args)
+
+  Import the areas and datasets from the data directory, without any
+  filters, and answer HTTP requests (see answerHttp()) on the loopback port
+  given by the http argument until the process receives SIGINT or SIGTERM.
+  The threads argument sets how many requests are answered at once.
+
+  @param args
+    Parsed program arguments, whose datasets argument selects the datasets
+    to keep in memory (all of them if omitted)
+
+  @return
+    Exit code
+
+  @throws
+    std::invalid_argument if the port is not a number from 0 to 65535, with
+    the message: Invalid input for http argument
+    std::runtime_error if the datasets cannot be imported or the port cannot
+    be listened on
+
+  @example
+    bethyw --http 8080 &
+    curl 'http://127.0.0.1:8080/areas/W06000011?measures=pop&years=2010-2019'
+*/
+int BethYw::serveHttp(cxxopts::ParseResult& args) {
+    const auto port = args["http"].as<std::string>();
+    if (port.empty() || port.size() > 5
+        || !std::all_of(port.begin(), port.end(), ::isdigit)
+        || std::stoul(port) > 65535) {
+        throw std::invalid_argument("Invalid input for http argument");
+    }
+    const unsigned int workers = BethYw::parseThreadsArg(args);
+    const std::chrono::seconds reloadInterval = BethYw::parseReloadArg(args);
+
+    SnapshotHolder holder(BethYw::loadResident(args));
+    const auto reloader = BethYw::startReloader(args, holder, reloadInterval);
+    const auto watcher = BethYw::startWatcher(args, holder);
+
+    HttpServer server((uint16_t) std::stoul(port), workers);
+    std::cerr << "Serving " << holder.read()->datasetCount() << " datasets on http://127.0.0.1:"
+              << server.getPort() << "/areas" << std::endl;
+
+    server.serve([&holder](const HttpRequest &request) {
+        const auto snapshot = holder.read();
+        return BethYw::answerHttp(*snapshot, request);
+    });
+
+    return 0;
+}
+
+/*
+  BethYw::answerHttp(resident, request)
+
+  Answer an HTTP request for data held in memory. The requests are:
+
+    GET /areas
+    GET /areas/<areas>
+
+  where <areas> is a comma-separated list of authority codes or names, as for
+  the areas argument. These query parameters are accepted, each meaning what
+  the argument of the same name does:
+
+    datasets, measures, years, format (json, the default, ndjson, csv, tsv or
+    table), stats (no value) and fill
+
+  e.g. GET /areas/W06000011?measures=pop&years=2010-2019&format=csv
+
+  The request is turned into a command line and run by runQuery() with one
+  output thread (the server answers several requests at once instead).
+
+  @param resident
+    The data held in memory
+
+  @param request
+    The request
+
+  @return
+    The response: 200 with the output, 400 with the error message if the
+    parameters are invalid, 404 for any other path, or 500 if the query
+    failed
+*/
+HttpResponse BethYw::answerHttp(const ResidentData &resident, const HttpRequest &request) {
+    const std::string prefix = "/areas";
+    const std::string &path = request.path;
+    if (path.compare(0, prefix.size(), prefix) != 0
+        || (path.size() > prefix.size() && path[prefix.size()] != '/')) {
+        return {404, "text/plain; charset=utf-8", "Not found: " + path + "\n"};
+    }
+
+    std::vector<std::string> arguments = {"--threads", "1", "--format", "json"};
+    if (path.size() > prefix.size() + 1) {
+        arguments.push_back("--areas");
+        arguments.push_back(path.substr(prefix.size() + 1));
+    }
+
+    std::string contentType = "application/json";
+    for (const auto &parameter : request.query) {
+        const std::string &name = parameter.first;
+        const std::string &value = parameter.second;
+        if (name == "format") {
+            // In any case, as --format is
+            std::string format = value;
+            std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+            arguments[3] = format;
+            contentType = format == "ndjson" ? "application/x-ndjson"
+                        : format == "csv" ? "text/csv; charset=utf-8"
+                        : format == "tsv" ? "text/tab-separated-values; charset=utf-8"
+                        : format == "table" ? "text/plain; charset=utf-8"
+                        : format == "json" ? "application/json"
+                        : "";
+            if (contentType.empty()) {
+                return {400, "text/plain; charset=utf-8", "Invalid input for format argument\n"};
+            }
+        } else if (name == "stats") {
+            arguments.push_back("--stats");
+        } else if (name == "datasets" || name == "measures" || name == "years" || name == "fill"
+                   || name == "where") {
+            arguments.push_back("--" + name);
+            arguments.push_back(value);
+        } else {
+            return {400, "text/plain; charset=utf-8", "Unknown parameter: " + name + "\n"};
+        }
+    }
+
+    std::ostringstream out, err;
+    int code;
+    try {
+        code = BethYw::runArguments(arguments, out, err, &resident);
+    } catch (const std::exception &e) {
+        return {400, "text/plain; charset=utf-8", std::string(e.what()) + "\n"};
+    }
+
+    if (code == 0) {
+        return {200, contentType, out.str()};
+    }
+    return {code == 1 ? 400 : 500, "text/plain; charset=utf-8", err.str()};
+}
+
+/*
+  BethYw::queryServer(args, arguments)
+
+  Send the command line to the server listening on the socket given by the
+  client argument, and write its reply to the standard output (or the file
+  given by the output argument), or its error message to the standard error.
+
+  @param args
+    Parsed program arguments
+
+  @param arguments
+    The program arguments as they were given
+
+  @return
+    The exit code from the server
+
+  @throws
+    std::invalid_argument if the output file cannot be opened
+    std::runtime_error if the server cannot be reached
+*/
+int BethYw::queryServer(cxxopts::ParseResult& args, const std::vector<std::string> &arguments) {
+    std::ofstream outputFile;
+    if (args.count("output")) {
+        const std::string path = args["output"].as<std::string>();
+        outputFile.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outputFile.is_open()) {
+            throw std::invalid_argument("Could not open output file: " + path);
+        }
+    }
+    std::ostream &out = outputFile.is_open() ? outputFile : std::cout;
+
+    const int code = QueryServer::query(args["client"].as<std::string>(), arguments, out, std::cerr);
+
+    if (outputFile.is_open() && !outputFile) {
+        throw std::runtime_error("Could not write output file: "
+                                 + args["output"].as<std::string>());
+    }
+    return code;
+}
+
+/*
+  BethYw::splitCommandLine(line)
+
+  Split a line of a batch file into arguments as a shell would: at spaces
+  and tabs, except inside single or double quotes, with a backslash escaping
+  the next character (outside single quotes).
+
+  @param line
+    The line to split
+
+  @return
+    The arguments
+
+  @throws
+    std::invalid_argument if a quote is not closed or the line ends with a
+    backslash
+
+  @example
+    auto arguments = BethYw::splitCommandLine("-a 'Vale of Glamorgan' -j");
+    // {"-a", "Vale of Glamorgan", "-j"}
+*/
+std::vector<std::string> BethYw::splitCommandLine(const std::string &line) {
+    std::vector<std::string> arguments;
+    std::string argument;
+    bool inArgument = false;
+    char quote = '\0';
+
+    for (size_t i = 0; i < line.size(); i++) {
+        const char c = line[i];
+        if (quote == '\'') {
+            if (c == '\'') {
+                quote = '\0';
+            } else {
+                argument += c;
+            }
+        } else if (c == '\\') {
+            if (i + 1 == line.size()) {
+                throw std::invalid_argument("Unfinished escape");
+            }
+            argument += line[++i];
+            inArgument = true;
+        } else if (quote == '"') {
+            if (c == '"') {
+                quote = '\0';
+            } else {
+                argument += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            inArgument = true;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            if (inArgument) {
+                arguments.push_back(argument);
+                argument.clear();
+                inArgument = false;
+            }
+        } else {
+            argument += c;
+            inArgument = true;
+        }
+    }
+
+    if (quote != '\0') {
+        throw std::invalid_argument("Unclosed quote");
+    }
+    if (inArgument) {
+        arguments.push_back(argument);
+    }
+    return arguments;
+}
+
+/*
+  BethYw::runBatch(args)
+
+  Run every query in the batch file given by the batch argument, importing
+  the datasets they need between them only once.
+
+  Each line of the file is a command line, as it would be given to bethyw
+  (the program name at the start is optional), which must include an output
+  file (-o). Blank lines and lines starting with # are skipped. The datasets
+  all the queries need are imported, without filters, into a ResidentData
+  object. The queries are then grouped by their datasets, and each group's
+  data is built with a single pass over each of the resident datasets (see
+  ResidentData::query()): the union of the group's areas, measures and years
+  is merged out once, and each query's data out of that. Queries that select
+  exactly the same data (the same areas, measures, years, value predicates,
+  gap filling, and whether they want percentiles) share their data, which is
+  written out for each of them in whatever format each asks for. The dir and
+  snapshot-cache arguments of the batch run apply to all the queries.
+
+  A query that is invalid, or fails, is reported on the standard error with
+  its line number, and the others still run. If a group's data cannot be
+  built, the failure is reported against every query in the group.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    0 if every query succeeded, otherwise the highest exit code of those that
+    failed
+
+  @throws
+    std::invalid_argument if the batch file cannot be opened
+    std::runtime_error if the datasets cannot be imported
+
+  @example
+    bethyw --batch nightly.txt
+*/
+int BethYw::runBatch(cxxopts::ParseResult& args) {
+    const std::string batchPath = args["batch"].as<std::string>();
+    std::ifstream batch(batchPath);
+    if (!batch.is_open()) {
+        throw std::invalid_argument("Could not open batch file: " + batchPath);
+    }
+
+    struct Query {
+      size_t line;
+      std::unique_ptr<cxxopts::ParseResult> args;
+      std::vector<BethYw::InputFileSource> datasets;
+      ResidentData::Selection selection;
+    };
+    std::vector<Query> queries;
+    std::vector<BethYw::InputFileSource> allDatasets;
+    int result = 0;
+
+    // Parse and check every query before importing anything
+    std::string text;
+    for (size_t line = 1; std::getline(batch, text); line++) {
+        try {
+            std::vector<std::string> arguments = BethYw::splitCommandLine(text);
+            if (arguments.empty() || arguments[0][0] == '#') {
+                continue;
+            }
+            const std::string &program = arguments[0];
+            if (program == "bethyw"
+                || (program.size() > 7 && program.compare(program.size() - 7, 7, "/bethyw") == 0)) {
+                arguments.erase(arguments.begin());
+            }
+
+            Query query;
+            query.line = line;
+            query.args.reset(new cxxopts::ParseResult(BethYw::parseArguments(arguments)));
+            cxxopts::ParseResult &queryArgs = *query.args;
+
+            if (!queryArgs.count("output")) {
+                throw std::invalid_argument("No output file (-o) given");
+            }
+            if (queryArgs.count("batch") || queryArgs.count("serve")
+                || queryArgs.count("client") || queryArgs.count("http")) {
+                throw std::invalid_argument("Only queries can be run in a batch");
+            }
+            BethYw::checkOutputArgs(queryArgs);
+
+            if (queryArgs.count("datasets")) {
+                query.datasets = BethYw::parseDatasetsArg(queryArgs);
+            } else {
+                for (const auto & i : BethYw::InputFiles::DATASETS) {
+                    query.datasets.push_back(i);
+                }
+            }
+            ResidentData::Selection &selection = query.selection;
+            if (queryArgs.count("areas")) {
+                selection.areasFilter = BethYw::parseAreasArg(queryArgs);
+            }
+            if (queryArgs.count("measures")) {
+                selection.measuresFilter = BethYw::parseMeasuresArg(queryArgs);
+            }
+            selection.yearsFilter = queryArgs.count("years") ? BethYw::parseYearsArg(queryArgs)
+                                                             : std::make_tuple(0u, 0u);
+            if (queryArgs.count("where")) {
+                selection.predicates = BethYw::parseWhereArg(queryArgs);
+            }
+
+            for (const auto &source : query.datasets) {
+                if (std::none_of(allDatasets.begin(), allDatasets.end(),
+                                 [&source](const InputFileSource &added) {
+                                     return added.CODE == source.CODE;
+                                 })) {
+                    allDatasets.push_back(source);
+                }
+            }
+            queries.push_back(std::move(query));
+        } catch (const std::exception &e) {
+            std::cerr << batchPath << ":" << line << ": " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+
+    if (queries.empty()) {
+        return result;
+    }
+
+    std::unique_ptr<SnapshotCache> cache;
+    if (args.count("snapshot-cache")) {
+        cache.reset(new SnapshotCache(args["snapshot-cache"].as<std::string>()));
+    }
+    const ResidentData resident(args["dir"].as<std::string>() + DIR_SEP, allDatasets, cache.get());
+
+    // Group the queries by their datasets, and the queries of each group by
+    // the data they select, in the order of the first query of each
+    struct Group {
+      std::vector<std::vector<const Query *>> selections;
+      std::map<std::string, size_t> selectionByKey;
+    };
+    std::vector<Group> groups;
+    std::map<std::string, size_t> groupByDatasets;
+    for (const auto &query : queries) {
+        nlohmann::json datasets = nlohmann::json::array();
+        for (const auto &source : query.datasets) {
+            datasets.push_back(source.CODE);
+        }
+
+        const ResidentData::Selection &selection = query.selection;
+        nlohmann::json key;
+        key["areas"] = std::set<std::string>(selection.areasFilter.begin(),
+                                             selection.areasFilter.end());
+        key["measures"] = std::set<std::string>(selection.measuresFilter.begin(),
+                                                selection.measuresFilter.end());
+        key["years"] = {std::get<0>(selection.yearsFilter), std::get<1>(selection.yearsFilter)};
+        key["fill"] = BethYw::parseFillArg(*query.args);
+        for (const auto &predicate : selection.predicates) {
+            key["where"].push_back(predicate.toString());
+        }
+        key["percentiles"] = query.args->count("percentiles") > 0;
+
+        const auto group = groupByDatasets.emplace(datasets.dump(), groups.size());
+        if (group.second) {
+            groups.emplace_back();
+        }
+        Group &queriesOfGroup = groups[group.first->second];
+        const auto inserted = queriesOfGroup.selectionByKey.emplace(
+            key.dump(), queriesOfGroup.selections.size());
+        if (inserted.second) {
+            queriesOfGroup.selections.emplace_back();
+        }
+        queriesOfGroup.selections[inserted.first->second].push_back(&query);
+    }
+
+    for (const auto &group : groups) {
+        const auto fail = [&](const std::exception &e) {
+            for (const auto &selection : group.selections) {
+                for (const Query *query : selection) {
+                    std::cerr << batchPath << ":" << query->line << ": " << e.what() << std::endl;
+                }
+            }
+        };
+
+        // The data of every selection is built from a single pass over each
+        // of the group's datasets. A failure building it fails every query
+        // in the group, but not the other groups
+        std::vector<Areas> data(group.selections.size());
+        try {
+            std::vector<Areas *> filled;
+            std::vector<ResidentData::Selection> selections;
+            for (size_t i = 0; i < group.selections.size(); i++) {
+                const Query &first = *group.selections[i].front();
+                data[i].setQuantileTracking(first.args->count("percentiles") > 0);
+                filled.push_back(&data[i]);
+                selections.push_back(first.selection);
+            }
+            resident.query(filled, group.selections.front().front()->datasets, selections);
+            for (size_t i = 0; i < group.selections.size(); i++) {
+                const Query &first = *group.selections[i].front();
+                if (!first.args->count("percentiles")) {
+                    data[i].fillGaps(BethYw::parseFillArg(*first.args));
+                }
+            }
+        } catch (const std::invalid_argument &e) {
+            fail(e);
+            result = std::max(result, 1);
+            continue;
+        } catch (const std::runtime_error &e) {
+            fail(e);
+            result = 2;
+            continue;
+        }
+
+        for (size_t i = 0; i < group.selections.size(); i++) {
+            for (const Query *query : group.selections[i]) {
+                const std::string path = (*query->args)["output"].as<std::string>();
+                try {
+                    std::ofstream outputFile(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                    if (!outputFile.is_open()) {
+                        throw std::invalid_argument("Could not open output file: " + path);
+                    }
+                    BethYw::writeData(*query->args, data[i], outputFile);
+                    outputFile.close();
+                    if (!outputFile) {
+                        throw std::runtime_error("Could not write output file: " + path);
+                    }
+                } catch (const std::invalid_argument &e) {
+                    std::cerr << batchPath << ":" << query->line << ": " << e.what() << std::endl;
+                    result = std::max(result, 1);
+                } catch (const std::runtime_error &e) {
+                    std::cerr << batchPath << ":" << query->line << ": " << e.what() << std::endl;
+                    result = 2;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*
+  TODO: BethYw::loadAreas(areas, dir, areasFilter)
+
+  Load the areas.csv file from the directory `dir`. Parse the file and
+  create the appropriate Area objects inside the Areas object passed to
+  the function in the `areas` argument.
+
+  areas.csv is guaranteed to be formatted as:
+    Local authority code,Name (eng),Name (cym)
+
+  Hint: To implement this function. First you will need create an InputFile 
+  object with the filename of the areas file, open it, and then pass reference 
+  to the stream to the Areas::populate() function.
+
+  Hint 2: you can retrieve the specific filename for a dataset, e.g. for the 
+  areas.csv file, from the InputFileSource's FILE member variable
+
+  @param areas
+    An Areas instance that should be modified (i.e. the populate() function
+    in the instance should be called)
+
+  @param dir
+    Directory where the areas.csv file is
+
+  @param areasFilter
+    An unordered set of areas to filter, or empty to import all areas
+
+  @return
+    void
+
+  @example
+    Areas areas();
+
+    BethYw::loadAreas(areas, "data", BethYw::parseAreasArg(args));
+*/
+
+void BethYw::loadAreas(Areas &areas, std::string &dir, std::unordered_set<std::string> &areasFilter) {
+    InputFile input(dir + "areas.csv");
+    auto &is = input.open();
+    auto cols = BethYw::InputFiles::AREAS.COLS;
+    areas.populate(is, BethYw::SourceDataType::AuthorityCodeCSV, cols, &areasFilter, NULL, NULL);
+}
+
+
+/*
+  TODO: BethYw::loadDatasets(areas,
+                             dir,
+                             datasetsToImport,
+                             areasFilter,
+                             measuresFilter,
+                             yearsFilter)
+
+  Import datasets from `datasetsToImport` as files in `dir` into areas, and
+  filtering them with the `areasFilter`, `measuresFilter`, and `yearsFilter`.
+
+  The actual filtering will be done by the Areas::populate() function, thus 
+  you need to merely pass pointers on to these flters.
+
+  This function should promise not to throw an exception. If there is an
+  error/exception thrown in any function called by thus function, catch it and
+  output 'Error importing dataset:', followed by a new line and then the output
+  of the what() function on the exception.
+
+  @param areas
+    An Areas instance that should be modified (i.e. datasets loaded into it)
+
+  @param dir
+    The directory where the datasets are
+
+  @param datasetsToImport
+    A vector of InputFileSource objects
+
+  @param areasFilter
+    An unordered set of areas (as authority codes encoded in std::strings)
+    to filter, or empty to import all areas
+
+  @param measuresFilter
+    An unordered set of measures (as measure codes encoded in std::strings)
+    to filter, or empty to import all measures
+
+  @param yearsFilter
+    An two-pair tuple of unsigned ints corresponding to the range of years 
+    to import, which should both be 0 to import all years.
+
+  @param cache
+    A SnapshotCache to load each dataset from (unfiltered, and filtered with
+    Areas::mergeFiltered()) if its file has not changed since it was last
+    parsed, and to store newly parsed datasets in, or nullptr to always
+    parse the files
+
+  @param profiler
+    A StageProfiler to record the stages of each dataset in, or nullptr.
+    A file is parsed straight into areas, as without a profiler, so its
+    parse stage includes merging the values in and its rows are the values
+    it added. From a snapshot, the parse stage is loading the snapshot and
+    there is a separate merge stage for Areas::mergeFiltered().
+
+  @return
+    void
+
+  @example
+    Areas areas();
+
+    BethYw::loadDatasets(
+      areas,
+      "data",
+      BethYw::parseDatasetsArgument(args),
+      BethYw::parseAreasArg(args),
+      BethYw::parseMeasuresArg(args),
+      BethYw::parseYearsArg(args));
+*/
+
+void BethYw::loadDatasets(Areas &areas, std::string &dir, const std::vector<InputFileSource>& datasetsToImport,
+                          std::unordered_set<std::string> &areasFilter, std::unordered_set<std::string> &measuresFilter,
+                          std::tuple<unsigned int, unsigned int> &yearsFilter,
+                          SnapshotCache *cache,
+                          StageProfiler *profiler) {
+
+    // The areas have been loaded by now, so compile the filters once for all
+    // the datasets
+    const CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+
+    for (const InputFileSource &source : datasetsToImport) {
+        const std::string path = dir + source.FILE;
+
+        std::string snapshotPath;
+        if (cache && source.PARSER != AuthorityCodeCSV) {
+            try {
+                snapshotPath = cache->snapshotPath(source, path);
+            } catch (const std::runtime_error &) {
+                // Leave it to InputFile to report the file
+            }
+        }
+
+        if (snapshotPath.empty()) {
+            const size_t before = profiler ? areas.valueCount() : 0;
+            InputFile input(path);
+            auto &is = input.open();
+            auto cols = source.COLS;
+            if (profiler) {
+                profiler->stage(source.CODE + ": open");
+            }
+            areas.populate(is, source.PARSER, cols, filter);
+            if (profiler) {
+                profiler->stage(source.CODE + ": parse", StageProfiler::fileSize(path),
+                                areas.valueCount() - before);
+            }
+            continue;
+        }
+
+        // The snapshot is read if there is one, or else the file
+        uint64_t bytes = 0;
+        if (profiler) {
+            profiler->stage(source.CODE + ": open");
+            bytes = StageProfiler::fileSize(snapshotPath);
+            if (bytes == 0) {
+                bytes = StageProfiler::fileSize(path);
+            }
+        }
+        Areas snapshot = Areas();
+        if (!cache->load(snapshotPath, snapshot)) {
+            StringFilterSet noFilter;
+            YearFilterTuple allYears(0, 0);
+            InputFile input(path);
+            auto &is = input.open();
+            auto cols = source.COLS;
+            snapshot.populate(is, source.PARSER, cols, &noFilter, &noFilter, &allYears);
+            cache->store(snapshotPath, source, snapshot);
+        }
+        if (profiler) {
+            profiler->stage(source.CODE + ": parse", bytes, snapshot.valueCount());
+        }
+        const size_t before = profiler ? areas.valueCount() : 0;
+        areas.mergeFiltered(snapshot, &areasFilter, &measuresFilter, &yearsFilter);
+        if (profiler) {
+            profiler->stage(source.CODE + ": merge", 0, areas.valueCount() - before);
+        }
+    }
+}
+
+/*
+  BethYw::streamDatasets(args,
+                         dir,
+                         datasetsToImport,
+                         areasFilter,
+                         measuresFilter,
+                         yearsFilter,
+                         os)
+
+  Import areas.csv and the datasets with a k-way merge on authority code and
+  write the output as it goes (for --stream), instead of importing them into
+  one Areas object and writing that. Each file is read with an AreaStream, a
+  group of rows for one authority code at a time, and once every file has
+  moved past a code, the area's groups are imported into an Areas object of
+  their own, its gaps filled (--fill), and written with an AreaStreamWriter.
+  So only about one area is held at a time, rather than all of them, and the
+  output is the same as a normal run's. For --percentiles, each area's values
+  are instead added to quantile sketches once they are final, and nothing is
+  written.
+
+  This only works if every file is sorted by authority code, which is
+  checked first, before anything is written.
+
+  @param args
+    Parsed program arguments, for --format, --stats and --fill
+
+  @param dir
+    The data directory, ending in DIR_SEP
+
+  @param datasetsToImport
+    The datasets to import
+
+  @param areasFilter
+    The areas to import (resolved to codes or exact names), or an empty set
+
+  @param measuresFilter
+    The measures to import, or an empty set
+
+  @param yearsFilter
+    The range of years to import, or <0,0>
+
+  @param os
+    The output stream to write to
+
+  @param sketches
+    The quantile sketches to add each area's values to, instead of writing
+    the areas, or nullptr to write them
+
+  @return
+    true if the data was written (or sketched), or false (without anything
+    written) if a file is not sorted by authority code, so must be imported
+    as usual
+
+  @throws
+    std::runtime_error if a file cannot be opened or a row is malformed, in
+    which case the output written so far stops where it is
+
+  @example
+    if (!BethYw::streamDatasets(args, dir, datasets, areas, measures, years, std::cout)) {
+      // import as usual
+    }
+*/
+bool BethYw::streamDatasets(cxxopts::ParseResult& args,
+                            std::string &dir,
+                            const std::vector<InputFileSource>& datasetsToImport,
+                            std::unordered_set<std::string> &areasFilter,
+                            std::unordered_set<std::string> &measuresFilter,
+                            std::tuple<unsigned int, unsigned int> &yearsFilter,
+                            std::ostream &os,
+                            QuantileSketches *sketches) {
+    std::vector<const InputFileSource *> sources = {&InputFiles::AREAS};
+    for (const InputFileSource &source : datasetsToImport) {
+        sources.push_back(&source);
+    }
+    for (const InputFileSource *source : sources) {
+        if (!AreaStream::sorted(dir + source->FILE, *source)) {
+            return false;
+        }
+    }
+
+    const CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+    std::vector<std::unique_ptr<AreaStream>> streams;
+    for (const InputFileSource *source : sources) {
+        streams.emplace_back(new AreaStream(dir + source->FILE, *source));
+    }
+
+    // Nothing is written when sketching, not even the start of the output
+    const GapFillMode fill = parseFillArg(args);
+    std::unique_ptr<AreaStreamWriter> writer;
+    if (!sketches) {
+        writer.reset(new AreaStreamWriter(os, parseFormatArg(args), args.count("stats") > 0));
+    }
+    while (true) {
+        // The lowest code any file has yet to give
+        const std::string *lowest = nullptr;
+        for (const auto &stream : streams) {
+            if (!stream->done() && (!lowest || stream->code() < *lowest)) {
+                lowest = &stream->code();
+            }
+        }
+        if (!lowest) {
+            break;
+        }
+
+        // Every file's rows for it, in the order a normal run imports them
+        const std::string code = *lowest;
+        Areas area = Areas();
+        for (const auto &stream : streams) {
+            if (!stream->done() && stream->code() == code) {
+                stream->next(area, filter);
+            }
+        }
+        if (sketches) {
+            area.addToQuantileSketches(*sketches);
+        } else {
+            area.fillGaps(fill);
+            writer->write(area);
+        }
+    }
+    if (writer) {
+        writer->finish();
+    }
+    return true;
+}
+
+/*
+  BethYw::spillDatasets(args,
+                        dir,
+                        datasetsToImport,
+                        areasFilter,
+                        measuresFilter,
+                        yearsFilter,
+                        memoryLimit,
+                        os)
+
+  Import areas.csv and the datasets within a memory limit (for
+  --memory-limit) and write the output, for files too big to import whole
+  that are not sorted by authority code (which --stream needs). Each file is
+  read with an AreaStream a few rows at a time, and the values imported from
+  them are added to a SpilledAreas, which spills sorted runs of them to
+  temporary files whenever they fill half the limit. The runs are then
+  merged to rebuild one area at a time, in authority code order, which has
+  its gaps filled (--fill) and is written with an AreaStreamWriter. The
+  output is the same as a normal run's. For --percentiles, each rebuilt
+  area's values are instead added to quantile sketches, so neither they nor
+  the sketches grow with the data, and nothing is written.
+
+  @param args
+    Parsed program arguments, for --format, --stats and --fill
+
+  @param dir
+    The data directory, ending in DIR_SEP
+
+  @param datasetsToImport
+    The datasets to import
+
+  @param areasFilter
+    The areas to import (resolved to codes or exact names), or an empty set
+
+  @param measuresFilter
+    The measures to import, or an empty set
+
+  @param yearsFilter
+    The range of years to import, or <0,0>
+
+  @param memoryLimit
+    The memory limit in bytes, from parseMemoryLimitArg()
+
+  @param os
+    The output stream to write to
+
+  @param sketches
+    The quantile sketches to add each area's values to, instead of writing
+    the areas, or nullptr to write them
+
+  @throws
+    std::runtime_error if a file cannot be opened, a row is malformed, or a
+    temporary file cannot be written
+
+  @example
+    BethYw::spillDatasets(args, dir, datasets, areas, measures, years,
+                          256 * 1024 * 1024, std::cout);
+*/
+void BethYw::spillDatasets(cxxopts::ParseResult& args,
+                           std::string &dir,
+                           const std::vector<InputFileSource>& datasetsToImport,
+                           std::unordered_set<std::string> &areasFilter,
+                           std::unordered_set<std::string> &measuresFilter,
+                           std::tuple<unsigned int, unsigned int> &yearsFilter,
+                           uint64_t memoryLimit,
+                           std::ostream &os,
+                           QuantileSketches *sketches) {
+    // Read enough rows at a time for parsing to be efficient, but few
+    // enough that the imported chunk is small next to the limit
+    const size_t MIN_CHUNK = 64 * 1024;
+    const size_t MAX_CHUNK = 4 * 1024 * 1024;
+    const size_t chunkBytes = (size_t) std::min<uint64_t>(
+        std::max<uint64_t>(memoryLimit / 32, MIN_CHUNK), MAX_CHUNK);
+
+    std::vector<const InputFileSource *> sources = {&InputFiles::AREAS};
+    for (const InputFileSource &source : datasetsToImport) {
+        sources.push_back(&source);
+    }
+
+    const CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+    SpilledAreas spilled(memoryLimit);
+    for (const InputFileSource *source : sources) {
+        AreaStream stream(dir + source->FILE, *source);
+        while (!stream.done()) {
+            Areas chunk = Areas();
+            stream.nextRows(chunk, filter, chunkBytes);
+            spilled.add(chunk);
+        }
+    }
+
+    // Nothing is written when sketching, not even the start of the output
+    const GapFillMode fill = parseFillArg(args);
+    std::unique_ptr<AreaStreamWriter> writer;
+    if (!sketches) {
+        writer.reset(new AreaStreamWriter(os, parseFormatArg(args), args.count("stats") > 0));
+    }
+    spilled.forEachArea([&writer, fill, sketches](Areas &area) {
+        if (sketches) {
+            area.addToQuantileSketches(*sketches);
+        } else {
+            area.fillGaps(fill);
+            writer->write(area);
+        }
+    });
+    if (writer) {
+        writer->finish();
+    }
+}
+
+/*
+  BethYw::correlate(areas, target)
+
+  Compute the correlation matrix requested by the correlate argument. If the
+  target is a four digit year, the measures are compared across all the
+  imported areas for that year, otherwise the target is treated as a local
+  authority code and the measures are compared across all years for that area.
+
+  @param areas
+    An Areas instance with the datasets already loaded
+
+  @param target
+    The value of the correlate argument
+
+  @return
+    The computed CorrelationMatrix
+
+  @throws
+    std::invalid_argument if the target is not a year and no area matches it
+
+  @example
+    auto matrix = BethYw::correlate(areas, "2015");
+    std::cout << matrix << std::endl;
+*/
+CorrelationMatrix BethYw::correlate(const Areas &areas, const std::string &target) {
+    if (target.length() == 4 && target.find_first_not_of("0123456789") == std::string::npos) {
+        return CorrelationMatrix::acrossAreas(areas, stoi(target));
+    }
+    return CorrelationMatrix::acrossYears(areas, target);
+}
+
+/*
+  BethYw::printPercentiles(os, sketches, percentiles, json)
+
+  Print the requested percentiles of every measure from the quantile sketches
+  of the imported values (see Areas::setQuantileTracking() and
+  Areas::addToQuantileSketches()).
+
+  As a table, each measure is printed like a Measure, with one column per
+  percentile followed by the number of values seen:
+
+    Population (pop)
+             p50          p90    Count
+    69772.000000 132865.000000    638
+
+  As JSON:
+    { "<codename>": { "label": "<label>", "count": <count>,
+                      "percentiles": { "<percentile>": <value>, … } }, … }
+
+  @param os
+    The output stream to write to
+
+  @param sketches
+    The quantile sketch of each measure, by codename
+
+  @param percentiles
+    The percentiles to print, between 0 and 100
+
+  @param json
+    Whether to print JSON instead of tables
+*/
+void BethYw::printPercentiles(std::ostream &os,
+                              const QuantileSketches &sketches,
+                              const std::vector<double> &percentiles,
+                              bool json) {
+    if (json) {
+        nlohmann::json j = nlohmann::json::object();
+        for (const auto &entry : sketches) {
+            const QuantileSketch &sketch = entry.second;
+            auto &out = j[entry.first];
+            out["label"] = sketch.getLabel();
+            out["count"] = sketch.count();
+            out["percentiles"] = nlohmann::json::object();
+            for (double percentile : percentiles) {
+                std::ostringstream key;
+                key << percentile;
+                out["percentiles"][key.str()] = sketch.getQuantile(percentile / 100);
+            }
+        }
+        os << j.dump() << std::endl;
+        return;
+    }
+
+    for (const auto &entry : sketches) {
+        const QuantileSketch &sketch = entry.second;
+        os << sketch.getLabel() << " (" << entry.first << ")" << std::endl;
+
+        std::vector<std::string> headings;
+        std::vector<std::string> cells;
+        for (double percentile : percentiles) {
+            std::ostringstream heading, cell;
+            heading << 'p' << percentile;
+            cell << std::fixed << std::setprecision(6) << sketch.getQuantile(percentile / 100);
+            headings.push_back(heading.str());
+            cells.push_back(cell.str());
+        }
+        headings.emplace_back("Count");
+        cells.push_back(std::to_string(sketch.count()));
+
+        std::ostringstream headingRow, cellRow;
+        for (size_t i = 0; i < headings.size(); i++) {
+            const int width = (int) std::max(headings[i].size(), cells[i].size());
+            headingRow << std::setw(width) << headings[i] << ' ';
+            cellRow << std::setw(width) << cells[i] << ' ';
+        }
+        os << headingRow.str() << std::endl << cellRow.str() << std::endl << std::endl;
+    }
+}
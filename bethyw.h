@@ -15,7 +15,12 @@
   functions you need to declare in this file.
  */
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 #include <vector>
 
@@ -23,6 +28,16 @@
 
 #include "datasets.h"
 #include "areas.h"
+#include "correlation.h"
+#include "httpserver.h"
+#include "predicate.h"
+#include "snapshotcache.h"
+
+class BackgroundReloader;
+class DatasetWatcher;
+class ResidentData;
+class SnapshotHolder;
+class StageProfiler;
 
 const char DIR_SEP =
 #ifdef _WIN32
@@ -38,11 +53,82 @@ namespace BethYw {
 */
 const std::string STUDENT_NUMBER = "956213";
 
+/*
+  The formats the imported data can be written in:
+    FormatTable — aligned tables, one per measure (the default)
+    FormatJSON  — a JSON object of areas
+    FormatCSV   — comma-separated rows, one per area, measure and year
+    FormatTSV   — tab-separated rows, one per area, measure and year
+    FormatNDJSON — one JSON object per line, one line per area
+    FormatColumnar — a binary columnar file (see columnar.h)
+*/
+enum OutputFormat {
+  FormatTable,
+  FormatJSON,
+  FormatNDJSON,
+  FormatCSV,
+  FormatTSV,
+  FormatColumnar
+};
+
 /*
   Run Beth Yw?, parsing the command line arguments and acting upon them.
 */
 int run(int argc, char *argv[]);
 
+/*
+  Import the data and write it out for one set of parsed arguments, from
+  the files or from data held in memory by a server.
+*/
+int runQuery(cxxopts::ParseResult& args,
+             std::ostream &out,
+             std::ostream &err,
+             const ResidentData *resident = nullptr,
+             StageProfiler *profiler = nullptr);
+
+/*
+  Parse and run a command line given as strings, e.g. one sent to a server,
+  read from a batch file or built for an HTTP request.
+*/
+cxxopts::ParseResult parseArguments(std::vector<std::string> arguments);
+int runArguments(const std::vector<std::string> &arguments,
+                 std::ostream &out,
+                 std::ostream &err,
+                 const ResidentData *resident = nullptr,
+                 StageProfiler *profiler = nullptr);
+
+/*
+  Check the output arguments, and write imported data out as they ask.
+*/
+void checkOutputArgs(cxxopts::ParseResult& args);
+void writeData(cxxopts::ParseResult& args, const Areas &data, std::ostream &os);
+
+/*
+  Keep the data in memory and answer queries over a Unix domain socket
+  (--serve), or send a query to such a server (--client).
+*/
+std::unique_ptr<ResidentData> loadResident(cxxopts::ParseResult& args);
+std::chrono::seconds parseReloadArg(cxxopts::ParseResult& args);
+std::unique_ptr<BackgroundReloader> startReloader(cxxopts::ParseResult& args,
+                                                  SnapshotHolder &holder,
+                                                  std::chrono::seconds interval);
+std::unique_ptr<DatasetWatcher> startWatcher(cxxopts::ParseResult& args, SnapshotHolder &holder);
+int serve(cxxopts::ParseResult& args);
+int queryServer(cxxopts::ParseResult& args, const std::vector<std::string> &arguments);
+
+/*
+  Run a file of queries, importing the datasets they need only once
+  (--batch).
+*/
+std::vector<std::string> splitCommandLine(const std::string &line);
+int runBatch(cxxopts::ParseResult& args);
+
+/*
+  Answer HTTP requests for data held in memory (--http).
+*/
+int serveHttp(cxxopts::ParseResult& args);
+HttpResponse answerHttp(const ResidentData &resident, const HttpRequest &request);
+
 /*
   Create a cxxopts instance.
 */
@@ -62,13 +148,51 @@ std::vector<BethYw::InputFileSource> parseDatasetsArg(
 std::unordered_set<std::string> parseAreasArg(cxxopts::ParseResult& args);
 std::unordered_set<std::string> parseMeasuresArg(cxxopts::ParseResult& args);
 std::tuple<unsigned int, unsigned int> parseYearsArg(cxxopts::ParseResult& args);
+std::vector<double> parsePercentilesArg(cxxopts::ParseResult& args);
+GapFillMode parseFillArg(cxxopts::ParseResult& args);
+std::vector<ValuePredicate> parseWhereArg(cxxopts::ParseResult& args);
+OutputFormat parseFormatArg(cxxopts::ParseResult& args);
+unsigned int parseThreadsArg(cxxopts::ParseResult& args);
+uint64_t parseResultCacheSizeArg(cxxopts::ParseResult& args);
+uint64_t parseMemoryLimitArg(cxxopts::ParseResult& args);
+OutputFormat parseProfileStagesArg(cxxopts::ParseResult& args);
+std::string resultCacheKey(cxxopts::ParseResult& args,
+                           const std::string &dir,
+                           const std::vector<InputFileSource>& datasetsToImport,
+                           const std::unordered_set<std::string> &areasFilter,
+                           const std::unordered_set<std::string> &measuresFilter,
+                           const std::tuple<unsigned int, unsigned int> &yearsFilter);
 void loadAreas(Areas &areas, std::string &dir, std::unordered_set<std::string> &areasFilter);
 void loadDatasets(Areas &areas,
                   std::string &dir,
                   const std::vector<InputFileSource>& datasetsToImport,
                   std::unordered_set<std::string> &areasFilter,
                   std::unordered_set<std::string> &measuresFilter,
-                  std::tuple<unsigned int, unsigned int> &yearsFilter);
+                  std::tuple<unsigned int, unsigned int> &yearsFilter,
+                  SnapshotCache *cache = nullptr,
+                  StageProfiler *profiler = nullptr);
+bool streamDatasets(cxxopts::ParseResult& args,
+                    std::string &dir,
+                    const std::vector<InputFileSource>& datasetsToImport,
+                    std::unordered_set<std::string> &areasFilter,
+                    std::unordered_set<std::string> &measuresFilter,
+                    std::tuple<unsigned int, unsigned int> &yearsFilter,
+                    std::ostream &os,
+                    QuantileSketches *sketches = nullptr);
+void spillDatasets(cxxopts::ParseResult& args,
+                   std::string &dir,
+                   const std::vector<InputFileSource>& datasetsToImport,
+                   std::unordered_set<std::string> &areasFilter,
+                   std::unordered_set<std::string> &measuresFilter,
+                   std::tuple<unsigned int, unsigned int> &yearsFilter,
+                   uint64_t memoryLimit,
+                   std::ostream &os,
+                   QuantileSketches *sketches = nullptr);
+CorrelationMatrix correlate(const Areas &areas, const std::string &target);
+void printPercentiles(std::ostream &os,
+                      const QuantileSketches &sketches,
+                      const std::vector<double> &percentiles,
+                      bool json);
 
 } // namespace BethYw
 
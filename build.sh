@@ -2,7 +2,7 @@
 
 BIN_DIR="bin"
 TESTS_DIR="tests"
-SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp"
+SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp areastream.cpp measure.cpp nameindex.cpp correlation.cpp quantiles.cpp outputbuffer.cpp predicate.cpp renderpool.cpp columnar.cpp compiledfilter.cpp snapshotcache.cpp resultcache.cpp resident.cpp queryserver.cpp httpserver.cpp snapshotholder.cpp datasetwatcher.cpp spilledareas.cpp datasetgenerator.cpp stageprofiler.cpp"
 MAIN_FILE="main.cpp"
 EXECUTABLE="./${BIN_DIR}/bethyw"
 
@@ -10,10 +10,21 @@ set -x
 cd "${0%/*}"
 
 if [ $# -gt 1 ]; then
-  echo "Unknown arguments!" "Only one argument accepted, and must begin with test"
+  echo "Unknown arguments!" "Only one argument accepted, and must begin with test, or be loadgen, bench or datagen"
   exit
 elif [ $# -eq 1 ]; then
-  if [[ $1 == test* ]]; then
+  if [[ $1 == loadgen ]]; then
+    SOURCE_FILES=""
+    MAIN_FILE="loadgen.cpp"
+    EXECUTABLE="./${BIN_DIR}/bethyw-loadgen"
+  elif [[ $1 == bench ]]; then
+    MAIN_FILE="bench.cpp"
+    EXECUTABLE="./${BIN_DIR}/bethyw-bench"
+  elif [[ $1 == datagen ]]; then
+    SOURCE_FILES="datasetgenerator.cpp"
+    MAIN_FILE="datagen.cpp"
+    EXECUTABLE="./${BIN_DIR}/bethyw-datagen"
+  elif [[ $1 == test* ]]; then
     SOURCE_FILES="${SOURCE_FILES} ./${TESTS_DIR}/$1.cpp"
     MAIN_FILE="./${BIN_DIR}/catch.o"
     EXECUTABLE="./${BIN_DIR}/bethyw-test"
@@ -27,4 +38,4 @@ fi
 
 mkdir -p ${BIN_DIR}
 rm ${EXECUTABLE} 2> /dev/null
-g++ --std=c++14 -pedantic -Wall ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE}
\ No newline at end of file
+g++ --std=c++14 -pedantic -Wall -pthread ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE}
\ No newline at end of file
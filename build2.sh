@@ -2,7 +2,7 @@
 
 BIN_DIR="bin"
 TESTS_DIR="tests"
-SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp"
+SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp areastream.cpp measure.cpp nameindex.cpp correlation.cpp quantiles.cpp outputbuffer.cpp predicate.cpp renderpool.cpp columnar.cpp compiledfilter.cpp snapshotcache.cpp resultcache.cpp resident.cpp queryserver.cpp httpserver.cpp snapshotholder.cpp datasetwatcher.cpp spilledareas.cpp datasetgenerator.cpp stageprofiler.cpp"
 MAIN_FILE="main.cpp"
 EXECUTABLE="./${BIN_DIR}/bethyw"
 
@@ -24,4 +24,4 @@ fi
 
 mkdir -p ${BIN_DIR}
 rm ${EXECUTABLE} 2> /dev/null
-g++ --std=c++14 -pedantic -Wall ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE}
\ No newline at end of file
+g++ --std=c++14 -pedantic -Wall -pthread ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE}
\ No newline at end of file
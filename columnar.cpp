@@ -0,0 +1,531 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of writeColumnar() and the
+  ColumnarReader class. See columnar.h for the layout of the file.
+
+  Numbers are written in the byte order of the machine that writes them. The
+  byte order marker in the header lets a reader on a machine with a
+  different byte order reject the file rather than misread it.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "columnar.h"
+#include "outputbuffer.h"
+
+namespace {
+
+const char MAGIC[8] = {'B', 'E', 'T', 'H', 'Y', 'W', 'C', '1'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const size_t HEADER_SIZE = 24;
+const size_t ENTRY_SIZE = 40;
+const size_t NAME_SIZE = 16;
+
+const char *const COLUMN_NAMES[COLUMNAR_COLUMNS] = {
+    "area_code", "area_name_eng", "area_name_cym", "measure_code",
+    "measure_label", "area", "measure", "year", "value"};
+
+const uint32_t COLUMN_TYPES[COLUMNAR_COLUMNS] = {
+    ColumnStrings, ColumnStrings, ColumnStrings, ColumnStrings,
+    ColumnStrings, ColumnU32, ColumnU32, ColumnU32, ColumnF64};
+
+uint64_t alignTo8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+template<typename T>
+void writeRaw(OutputBuffer &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+T readRaw(const char *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/*
+  The size in bytes of a column of strings.
+*/
+uint64_t stringsSize(const std::vector<const std::string *> &strings) {
+    uint64_t size = sizeof(uint32_t) * (strings.size() + 1);
+    for (const auto *text : strings) {
+        size += text->size();
+    }
+    return size;
+}
+
+/*
+  Write a column of strings: the offsets of each string, then the characters.
+*/
+void writeStrings(OutputBuffer &out, const std::vector<const std::string *> &strings) {
+    uint32_t offset = 0;
+    writeRaw(out, offset);
+    for (const auto *text : strings) {
+        offset += (uint32_t) text->size();
+        writeRaw(out, offset);
+    }
+    for (const auto *text : strings) {
+        out.append(*text);
+    }
+}
+
+} // namespace
+
+/*
+  Write an Areas object to a stream as a columnar file. Every Area is
+  included (even without any measures, so its names are kept), along with
+  one row for every value of every Measure, ordered by authority code,
+  measure codename and year.
+
+  @param os
+    The output stream to write to, opened in binary mode
+
+  @param areas
+    The Areas to write
+
+  @throws
+    std::runtime_error if there are too many strings or rows for the format
+
+  @example
+    Areas data = Areas();
+    ...
+    std::ofstream file("data.bin", std::ios::binary);
+    writeColumnar(file, data);
+*/
+void writeColumnar(std::ostream &os, const Areas &areas) {
+    static const std::string EMPTY;
+
+    //the dictionaries, and the number of rows
+    std::vector<const std::string *> strings[COLUMNAR_COLUMNS];
+    std::map<std::pair<std::string, std::string>, uint32_t> measureIndexes;
+    uint64_t rowCount = 0;
+
+    for (const auto &area : areas.getAreasContainer()) {
+        const auto &names = area.second.getNames();
+        auto eng = names.find("eng");
+        auto cym = names.find("cym");
+        strings[ColumnAreaCode].push_back(&area.first);
+        strings[ColumnAreaNameEng].push_back(eng == names.end() ? &EMPTY : &eng->second);
+        strings[ColumnAreaNameCym].push_back(cym == names.end() ? &EMPTY : &cym->second);
+
+        for (const auto &measure : area.second.getMeasures()) {
+            const Measure &m = measure.second;
+            auto key = std::make_pair(measure.first, m.getLabel());
+            if (measureIndexes.emplace(key, (uint32_t) measureIndexes.size()).second) {
+                strings[ColumnMeasureCode].push_back(&measure.first);
+                strings[ColumnMeasureLabel].push_back(&m.getLabel());
+            }
+            rowCount += m.getValues().size();
+        }
+    }
+
+    if (rowCount > UINT32_MAX || measureIndexes.size() > UINT32_MAX
+        || strings[ColumnAreaCode].size() > UINT32_MAX) {
+        throw std::runtime_error("Too much data for a columnar file");
+    }
+
+    //the size and position of every column
+    uint64_t sizes[COLUMNAR_COLUMNS];
+    uint64_t counts[COLUMNAR_COLUMNS];
+    for (int column = 0; column < COLUMNAR_COLUMNS; column++) {
+        if (COLUMN_TYPES[column] == ColumnStrings) {
+            sizes[column] = stringsSize(strings[column]);
+            if (sizes[column] > UINT32_MAX) {
+                throw std::runtime_error("Too much data for a columnar file");
+            }
+            counts[column] = strings[column].size();
+        } else {
+            const uint64_t width = COLUMN_TYPES[column] == ColumnF64 ? sizeof(double) : sizeof(uint32_t);
+            sizes[column] = rowCount * width;
+            counts[column] = rowCount;
+        }
+    }
+
+    uint64_t offsets[COLUMNAR_COLUMNS];
+    uint64_t offset = alignTo8(HEADER_SIZE + ENTRY_SIZE * COLUMNAR_COLUMNS);
+    for (int column = 0; column < COLUMNAR_COLUMNS; column++) {
+        offsets[column] = offset;
+        offset = alignTo8(offset + sizes[column]);
+    }
+
+    //the header and directory
+    OutputBuffer out(os);
+    out.append(MAGIC, sizeof(MAGIC));
+    writeRaw(out, BYTE_ORDER_MARK);
+    writeRaw(out, (uint32_t) COLUMNAR_COLUMNS);
+    writeRaw(out, rowCount);
+    for (int column = 0; column < COLUMNAR_COLUMNS; column++) {
+        char name[NAME_SIZE] = {0};
+        std::strncpy(name, COLUMN_NAMES[column], NAME_SIZE - 1);
+        out.append(name, NAME_SIZE);
+        writeRaw(out, COLUMN_TYPES[column]);
+        writeRaw(out, (uint32_t) counts[column]);
+        writeRaw(out, offsets[column]);
+        writeRaw(out, sizes[column]);
+    }
+
+    //the columns, each padded to a multiple of 8 bytes
+    uint64_t position = HEADER_SIZE + ENTRY_SIZE * COLUMNAR_COLUMNS;
+    auto pad = [&out, &position](uint64_t to) {
+        static const char ZEROS[8] = {0};
+        out.append(ZEROS, (size_t) (to - position));
+        position = to;
+    };
+
+    for (int column = 0; column < COLUMNAR_COLUMNS; column++) {
+        pad(offsets[column]);
+
+        if (COLUMN_TYPES[column] == ColumnStrings) {
+            writeStrings(out, strings[column]);
+        } else {
+            //the row columns are written area by area, as they were counted
+            uint32_t areaIndex = 0;
+            for (const auto &area : areas.getAreasContainer()) {
+                for (const auto &measure : area.second.getMeasures()) {
+                    const uint32_t measureIndex = measureIndexes.at(
+                        std::make_pair(measure.first, measure.second.getLabel()));
+                    for (const auto &value : measure.second.getValues()) {
+                        switch (column) {
+                            case ColumnArea:    writeRaw(out, areaIndex); break;
+                            case ColumnMeasure: writeRaw(out, measureIndex); break;
+                            case ColumnYear:    writeRaw(out, (uint32_t) value.first); break;
+                            default:            writeRaw(out, value.second); break;
+                        }
+                    }
+                }
+                areaIndex++;
+            }
+        }
+        position += sizes[column];
+    }
+    pad(alignTo8(position));
+}
+
+/*
+  Open a columnar file and check its header and directory.
+
+  @param path
+    The path of the file
+
+  @throws
+    std::runtime_error if the file cannot be opened, or is not a valid
+    columnar file
+
+  @example
+    ColumnarReader reader("data.bin");
+    for (uint64_t row = 0; row < reader.rows(); row++) {
+      double value = reader.values()[row];
+    }
+*/
+ColumnarReader::ColumnarReader(const std::string &path)
+    : path(path), data(nullptr), length(0), mapped(false), rowCount(0) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open columnar file: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not open columnar file: " + path);
+    }
+    length = (size_t) info.st_size;
+    if (length > 0) {
+        void *address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            data = static_cast<const char *>(address);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (!mapped) {
+        //no mmap (or it failed), so read the file into 8-byte aligned memory
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open columnar file: " + path);
+        }
+        length = (size_t) file.tellg();
+        copy.resize((length + 7) / 8);
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(copy.data()), (std::streamsize) length);
+        if (!file) {
+            throw std::runtime_error("Could not read columnar file: " + path);
+        }
+        data = reinterpret_cast<const char *>(copy.data());
+    }
+
+    try {
+        parse();
+    } catch (...) {
+#ifndef _WIN32
+        if (mapped) {
+            ::munmap(const_cast<char *>(data), length);
+        }
+#endif
+        throw;
+    }
+}
+
+/*
+  Unmap the file.
+*/
+ColumnarReader::~ColumnarReader() {
+#ifndef _WIN32
+    if (mapped) {
+        ::munmap(const_cast<char *>(data), length);
+    }
+#endif
+}
+
+/*
+  Check the header and directory, and find each column.
+
+  @throws
+    std::runtime_error if the file is not a valid columnar file
+*/
+void ColumnarReader::parse() {
+    const std::runtime_error invalid("Invalid columnar file: " + path);
+
+    if (length < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        throw invalid;
+    }
+    if (readRaw<uint32_t>(data + 8) != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Columnar file has a different byte order: " + path);
+    }
+    const uint32_t columnCount = readRaw<uint32_t>(data + 12);
+    rowCount = readRaw<uint64_t>(data + 16);
+    if (columnCount != COLUMNAR_COLUMNS
+        || length < HEADER_SIZE + ENTRY_SIZE * (uint64_t) columnCount) {
+        throw invalid;
+    }
+
+    for (int column = 0; column < COLUMNAR_COLUMNS; column++) {
+        const char *entry = data + HEADER_SIZE + ENTRY_SIZE * column;
+        if (std::strncmp(entry, COLUMN_NAMES[column], NAME_SIZE) != 0) {
+            throw invalid;
+        }
+
+        Column &c = columns[column];
+        c.type = readRaw<uint32_t>(entry + NAME_SIZE);
+        c.count = readRaw<uint32_t>(entry + NAME_SIZE + 4);
+        const uint64_t offset = readRaw<uint64_t>(entry + NAME_SIZE + 8);
+        c.size = readRaw<uint64_t>(entry + NAME_SIZE + 16);
+        if (c.type != COLUMN_TYPES[column] || offset % 8 != 0
+            || offset > length || c.size > length - offset) {
+            throw invalid;
+        }
+        c.data = data + offset;
+
+        if (c.type == ColumnStrings) {
+            //the offsets must fit, start at 0, never decrease and end in bounds
+            const uint64_t offsetsSize = sizeof(uint32_t) * ((uint64_t) c.count + 1);
+            if (c.size < offsetsSize || readRaw<uint32_t>(c.data) != 0) {
+                throw invalid;
+            }
+            const uint64_t characters = c.size - offsetsSize;
+            uint32_t previous = 0;
+            for (uint32_t i = 1; i <= c.count; i++) {
+                const uint32_t next = readRaw<uint32_t>(c.data + sizeof(uint32_t) * i);
+                if (next < previous || next > characters) {
+                    throw invalid;
+                }
+                previous = next;
+            }
+        } else {
+            const uint64_t width = c.type == ColumnF64 ? sizeof(double) : sizeof(uint32_t);
+            if (c.count != rowCount || c.size != rowCount * width) {
+                throw invalid;
+            }
+        }
+    }
+
+    if (columns[ColumnAreaNameEng].count != columns[ColumnAreaCode].count
+        || columns[ColumnAreaNameCym].count != columns[ColumnAreaCode].count
+        || columns[ColumnMeasureLabel].count != columns[ColumnMeasureCode].count) {
+        throw invalid;
+    }
+}
+
+/*
+  Retrieve the number of rows (values) in the file.
+
+  @return
+    The number of rows
+*/
+uint64_t ColumnarReader::rows() const {
+    return rowCount;
+}
+
+/*
+  Retrieve the number of areas in the area dictionary.
+
+  @return
+    The number of areas
+*/
+uint32_t ColumnarReader::areaCount() const {
+    return columns[ColumnAreaCode].count;
+}
+
+/*
+  Retrieve the number of measures in the measure dictionary.
+
+  @return
+    The number of measures
+*/
+uint32_t ColumnarReader::measureCount() const {
+    return columns[ColumnMeasureCode].count;
+}
+
+/*
+  Retrieve a string from one of the dictionary columns.
+
+  @param column
+    One of the string columns, e.g. ColumnAreaCode
+
+  @param index
+    The index of the string in the column
+
+  @return
+    A copy of the string
+
+  @throws
+    std::out_of_range if the column does not hold strings or the index is
+    out of range
+*/
+std::string ColumnarReader::getString(ColumnarColumn column, uint32_t index) const {
+    if ((int) column < 0 || column >= COLUMNAR_COLUMNS
+        || columns[column].type != ColumnStrings || index >= columns[column].count) {
+        throw std::out_of_range("No such string in columnar file");
+    }
+
+    const Column &c = columns[column];
+    const char *characters = c.data + sizeof(uint32_t) * ((size_t) c.count + 1);
+    const uint32_t start = readRaw<uint32_t>(c.data + sizeof(uint32_t) * index);
+    const uint32_t end = readRaw<uint32_t>(c.data + sizeof(uint32_t) * (index + 1));
+    return std::string(characters + start, end - start);
+}
+
+/*
+  Retrieve the area column: the index in the area dictionary of each row.
+
+  @return
+    Pointer to rows() values
+*/
+const uint32_t *ColumnarReader::areas() const {
+    return reinterpret_cast<const uint32_t *>(columns[ColumnArea].data);
+}
+
+/*
+  Retrieve the measure column: the index in the measure dictionary of each
+  row.
+
+  @return
+    Pointer to rows() values
+*/
+const uint32_t *ColumnarReader::measures() const {
+    return reinterpret_cast<const uint32_t *>(columns[ColumnMeasure].data);
+}
+
+/*
+  Retrieve the year column.
+
+  @return
+    Pointer to rows() values
+*/
+const uint32_t *ColumnarReader::years() const {
+    return reinterpret_cast<const uint32_t *>(columns[ColumnYear].data);
+}
+
+/*
+  Retrieve the value column.
+
+  @return
+    Pointer to rows() values
+*/
+const double *ColumnarReader::values() const {
+    return reinterpret_cast<const double *>(columns[ColumnValue].data);
+}
+
+/*
+  Add everything in the file to an Areas object, as if it had been imported
+  from the original datasets.
+
+  @param areas
+    The Areas object to add to
+
+  @throws
+    std::runtime_error if a row refers to an area or measure that is not in
+    the dictionaries
+
+  @example
+    Areas data = Areas();
+    ColumnarReader("data.bin").toAreas(data);
+*/
+void ColumnarReader::toAreas(Areas &areas) const {
+    std::vector<Area> decoded;
+    decoded.reserve(areaCount());
+    for (uint32_t i = 0; i < areaCount(); i++) {
+        decoded.emplace_back(getString(ColumnAreaCode, i));
+        const std::string eng = getString(ColumnAreaNameEng, i);
+        const std::string cym = getString(ColumnAreaNameCym, i);
+        if (!eng.empty()) {
+            decoded.back().setName("eng", eng);
+        }
+        if (!cym.empty()) {
+            decoded.back().setName("cym", cym);
+        }
+    }
+
+    std::vector<Measure> dictionary;
+    dictionary.reserve(measureCount());
+    for (uint32_t i = 0; i < measureCount(); i++) {
+        dictionary.emplace_back(getString(ColumnMeasureCode, i), getString(ColumnMeasureLabel, i));
+    }
+
+    //the rows are grouped by area and measure, so each Measure is built up
+    //and only added to its Area when the next one starts
+    const uint32_t *areaColumn = this->areas();
+    const uint32_t *measureColumn = this->measures();
+    const uint32_t *yearColumn = this->years();
+    const double *valueColumn = this->values();
+
+    uint64_t row = 0;
+    while (row < rowCount) {
+        const uint32_t area = areaColumn[row];
+        const uint32_t measure = measureColumn[row];
+        if (area >= decoded.size() || measure >= dictionary.size()) {
+            throw std::runtime_error("Invalid columnar file: " + path);
+        }
+
+        Measure current = dictionary[measure];
+        for (; row < rowCount && areaColumn[row] == area && measureColumn[row] == measure; row++) {
+            current.setValue(yearColumn[row], valueColumn[row]);
+        }
+        decoded[area].setMeasure(current.getCodename(), current);
+    }
+
+    for (auto &area : decoded) {
+        const std::string code = area.getLocalAuthorityCode();
+        areas.setArea(code, std::move(area));
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef COLUMNAR_H_
+#define COLUMNAR_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declarations for the columnar file format, a compact
+  binary form of an Areas object that can be memory mapped and read without
+  parsing:
+
+    writeColumnar()  — writes an Areas object to a stream as a columnar file
+    ColumnarReader   — maps a columnar file and gives access to its columns,
+                       or converts it back into an Areas object
+
+  The file starts with a fixed header and a directory of columns:
+
+    char     magic[8]        "BETHYWC1"
+    uint32_t byteOrder       0x01020304 in the byte order of the writer
+    uint32_t columnCount
+    uint64_t rowCount        one row per area, measure and year
+    then columnCount entries of:
+      char     name[16]      e.g. "value", padded with zeros
+      uint32_t type          ColumnU32, ColumnF64 or ColumnStrings
+      uint32_t count         number of values (or strings) in the column
+      uint64_t offset        from the start of the file, a multiple of 8
+      uint64_t size          in bytes
+
+  The area and measure columns hold indexes into dictionaries of strings
+  (area codes and names, measure codenames and labels). A column of strings
+  is count + 1 uint32_t offsets into the character data that follows them.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  The types of column in a columnar file.
+*/
+enum ColumnarType {
+  ColumnU32 = 1,
+  ColumnF64 = 2,
+  ColumnStrings = 3
+};
+
+/*
+  The columns of a columnar file, in the order they appear in the directory.
+*/
+enum ColumnarColumn {
+  ColumnAreaCode,      // strings: authority code of each area
+  ColumnAreaNameEng,   // strings: English name of each area, or empty
+  ColumnAreaNameCym,   // strings: Welsh name of each area, or empty
+  ColumnMeasureCode,   // strings: codename of each measure
+  ColumnMeasureLabel,  // strings: label of each measure
+  ColumnArea,          // u32: index of the area of each row
+  ColumnMeasure,       // u32: index of the measure of each row
+  ColumnYear,          // u32: year of each row
+  ColumnValue,         // f64: value of each row
+  COLUMNAR_COLUMNS
+};
+
+void writeColumnar(std::ostream &os, const Areas &areas);
+
+/*
+  A ColumnarReader maps a columnar file into memory (or, where mmap is not
+  available, reads the whole file in) and checks its header and directory.
+  The row accessors do no further checking, so are as cheap as reading an
+  array; toAreas() checks every index as it goes.
+*/
+class ColumnarReader {
+public:
+  explicit ColumnarReader(const std::string &path);
+  ColumnarReader(const ColumnarReader &) = delete;
+  ColumnarReader &operator=(const ColumnarReader &) = delete;
+  ~ColumnarReader();
+
+  uint64_t rows() const;
+  uint32_t areaCount() const;
+  uint32_t measureCount() const;
+  std::string getString(ColumnarColumn column, uint32_t index) const;
+
+  const uint32_t *areas() const;
+  const uint32_t *measures() const;
+  const uint32_t *years() const;
+  const double *values() const;
+
+  void toAreas(Areas &areas) const;
+
+private:
+  struct Column {
+    uint32_t type;
+    uint32_t count;
+    const char *data;
+    uint64_t size;
+  };
+
+  void parse();
+
+  std::string path;
+  const char *data;
+  size_t length;
+  bool mapped;
+  std::vector<uint64_t> copy;
+  uint64_t rowCount;
+  Column columns[COLUMNAR_COLUMNS];
+};
+
+#endif // COLUMNAR_H_
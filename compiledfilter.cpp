@@ -0,0 +1,204 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the CompiledFilter class.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "compiledfilter.h"
+
+/*
+  Compile the three filters as they are given to the populate functions.
+
+  @param areasFilter
+    The areas (codes or names) to import, or nullptr or an empty set for all
+
+  @param measuresFilter
+    The measures (lowercase codenames or labels) to import, or nullptr or an
+    empty set for all
+
+  @param yearsFilter
+    The inclusive range of years to import, or nullptr or <0,0> for all
+
+  @example
+    auto areasFilter = BethYw::parseAreasArg(args);
+    auto measuresFilter = BethYw::parseMeasuresArg(args);
+    auto yearsFilter = BethYw::parseYearsArg(args);
+    CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+*/
+CompiledFilter::CompiledFilter(const StringFilterSet * const areasFilter,
+                               const StringFilterSet * const measuresFilter,
+                               const YearFilterTuple * const yearsFilter)
+    : everyYear(!yearsFilter
+                || (std::get<0>(*yearsFilter) == 0 && std::get<1>(*yearsFilter) == 0)) {
+    if (areasFilter) {
+        areas.assign(areasFilter->begin(), areasFilter->end());
+        std::sort(areas.begin(), areas.end());
+    }
+    if (measuresFilter) {
+        measures = *measuresFilter;
+    }
+    if (!everyYear && std::get<0>(*yearsFilter) <= std::get<1>(*yearsFilter)) {
+        years.resize(std::get<1>(*yearsFilter) + 1, false);
+        std::fill(years.begin() + std::get<0>(*yearsFilter), years.end(), true);
+    }
+}
+
+/*
+  Check whether the filter lets every area through.
+
+  @return
+    true if no areas filter was given
+*/
+bool CompiledFilter::allAreas() const {
+    return areas.empty();
+}
+
+/*
+  Check whether an area code or name, given as the bytes read from a row, is
+  in the areas filter. Comparing the bytes to the sorted entries means
+  nothing is allocated, whatever the answer.
+
+  @param begin
+    The first byte of the code or name
+
+  @param length
+    The number of bytes in the code or name
+
+  @return
+    true if the areas filter is empty or contains the code or name
+*/
+bool CompiledFilter::acceptsArea(const char *begin, size_t length) const {
+    if (areas.empty()) {
+        return true;
+    }
+
+    auto compare = [](const char *a, size_t aLength, const char *b, size_t bLength) {
+        const int result = std::memcmp(a, b, std::min(aLength, bLength));
+        return result != 0 ? result : (aLength < bLength ? -1 : (aLength > bLength ? 1 : 0));
+    };
+    size_t low = 0, high = areas.size();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const int result = compare(areas[middle].data(), areas[middle].size(), begin, length);
+        if (result == 0) {
+            return true;
+        } else if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+bool CompiledFilter::acceptsArea(const std::string &codeOrName) const {
+    return acceptsArea(codeOrName.data(), codeOrName.size());
+}
+
+/*
+  Check whether the filter lets every year through.
+
+  @return
+    true if no years filter was given
+*/
+bool CompiledFilter::allYears() const {
+    return everyYear;
+}
+
+/*
+  Check whether a year is within the years filter.
+
+  @param year
+    The year
+
+  @return
+    true if the years filter is <0,0> or includes the year
+*/
+bool CompiledFilter::acceptsYear(unsigned int year) const {
+    return everyYear || (year < years.size() && years[year]);
+}
+
+/*
+  Check whether the filter lets every measure through.
+
+  @return
+    true if no measures filter was given
+*/
+bool CompiledFilter::allMeasures() const {
+    return measures.empty();
+}
+
+/*
+  Check whether a measure is in the measures filter, by its codename or its
+  label.
+
+  @param codename
+    The measure's codename, in lowercase as it is stored
+
+  @param label
+    The measure's label
+
+  @return
+    true if the measures filter is empty or contains the codename or label
+*/
+bool CompiledFilter::acceptsMeasure(const std::string &codename,
+                                    const std::string &label) const {
+    return measures.empty()
+           || measures.find(codename) != measures.end()
+           || measures.find(label) != measures.end();
+}
+
+/*
+  Construct an empty table of measures for one import.
+
+  @param filter
+    The filter to check each new measure against, which must outlive the
+    table
+*/
+CompiledFilter::MeasureIds::MeasureIds(const CompiledFilter &filter) : filter(filter) {}
+
+/*
+  Find the ID of a measure, adding it (and checking it against the filter)
+  if it has not been met before.
+
+  @param rawCodename
+    The codename as it was read, before it is lowercased
+
+  @param label
+    The measure's label
+
+  @return
+    The ID of the measure
+*/
+size_t CompiledFilter::MeasureIds::find(const std::string &rawCodename, const std::string &label) {
+    for (size_t id = 0; id < entries.size(); id++) {
+        if (entries[id].rawCodename == rawCodename && entries[id].label == label) {
+            return id;
+        }
+    }
+
+    std::string codename = rawCodename;
+    std::transform(codename.begin(), codename.end(), codename.begin(), ::tolower);
+    const bool accepted = filter.acceptsMeasure(codename, label);
+    entries.push_back({rawCodename, std::move(codename), label, accepted});
+    return entries.size() - 1;
+}
+
+bool CompiledFilter::MeasureIds::accepted(size_t id) const {
+    return entries[id].accepted;
+}
+
+const std::string &CompiledFilter::MeasureIds::codename(size_t id) const {
+    return entries[id].codename;
+}
+
+const std::string &CompiledFilter::MeasureIds::label(size_t id) const {
+    return entries[id].label;
+}
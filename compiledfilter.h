@@ -0,0 +1,87 @@
+#ifndef COMPILEDFILTER_H_
+#define COMPILEDFILTER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the CompiledFilter class, the areas,
+  measures and years filters turned into a form the parsers can test each row
+  against straight from the bytes they have read.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A CompiledFilter is built once per import (in BethYw::loadDatasets(), after
+  the areas have been loaded) instead of the three filters being checked as
+  they were given on every row:
+
+  - the areas filter becomes a sorted table of its entries, which area codes
+    (and, for the JSON datasets, names) are looked up in by their bytes, so
+    nothing is copied out of a row to be rejected;
+  - the years filter becomes a bitmap indexed by year;
+  - the parsers give each measure they meet an ID along with whether the
+    measures filter accepts it, so the codename is lowercased and looked up
+    once per measure rather than once per row (see MeasureIds).
+
+  A row is accepted by exactly the same rules as before.
+*/
+class CompiledFilter {
+public:
+  CompiledFilter(const StringFilterSet * const areasFilter,
+                 const StringFilterSet * const measuresFilter,
+                 const YearFilterTuple * const yearsFilter);
+
+  bool allAreas() const;
+  bool acceptsArea(const char *begin, size_t length) const;
+  bool acceptsArea(const std::string &codeOrName) const;
+
+  bool allYears() const;
+  bool acceptsYear(unsigned int year) const;
+
+  bool allMeasures() const;
+  bool acceptsMeasure(const std::string &codename, const std::string &label) const;
+
+  /*
+    The measures a parser has met so far, each with an ID (its position) and
+    whether the filter accepts it. Datasets only hold a handful of measures,
+    so looking one up by its bytes is a short linear search, and the
+    codename is only lowercased the first time it is met.
+  */
+  class MeasureIds {
+  public:
+    explicit MeasureIds(const CompiledFilter &filter);
+
+    size_t find(const std::string &rawCodename, const std::string &label);
+    bool accepted(size_t id) const;
+    const std::string &codename(size_t id) const;
+    const std::string &label(size_t id) const;
+
+  private:
+    struct Entry {
+      std::string rawCodename;
+      std::string codename;
+      std::string label;
+      bool accepted;
+    };
+
+    const CompiledFilter &filter;
+    std::vector<Entry> entries;
+  };
+
+private:
+  std::vector<std::string> areas;
+  std::vector<bool> years;
+  bool everyYear;
+  StringFilterSet measures;
+};
+
+#endif // COMPILEDFILTER_H_
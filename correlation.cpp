@@ -0,0 +1,490 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the CorrelationMatrix class.
+
+  The values being compared are first copied into a columnar layout: one
+  contiguous column of doubles per measure (with a matching column of 1.0/0.0
+  presence flags), so that the inner loops only ever walk memory sequentially.
+  The pairwise sums are then accumulated in blocks of rows and columns that
+  fit comfortably in cache, using SSE2 where the compiler provides it.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BETHYW_SSE2 1
+#endif
+
+#include "lib_json.hpp"
+
+#include "correlation.h"
+
+/*
+  The number of observations (rows) and measures (columns) processed together
+  when accumulating the pairwise sums.
+*/
+const size_t CORRELATION_BLOCK_ROWS = 512;
+const size_t CORRELATION_BLOCK_COLS = 8;
+
+/*
+  The number of sums accumulated for each pair of measures: the count of
+  shared observations, the sum of each column, the sum of squares of each
+  column, and the sum of the products.
+*/
+const size_t CORRELATION_SUMS = 6;
+
+/*
+  Relative variance below which a column is treated as constant (i.e. what is
+  left is only rounding error), in which case no coefficient can be calculated
+  against it.
+*/
+const double CORRELATION_EPSILON = 1e-10;
+
+/*
+  Accumulate the pairwise sums for two columns x and y (and their presence
+  flags mx and my) over len rows. Missing values are stored as 0 so they drop
+  out of every product without a branch.
+
+  @param x
+    Values of the first column
+
+  @param mx
+    Presence flags of the first column
+
+  @param y
+    Values of the second column
+
+  @param my
+    Presence flags of the second column
+
+  @param len
+    Number of rows to accumulate
+
+  @param sums
+    The six running sums for this pair, added to in place
+*/
+static void accumulatePairSums(const double *x,
+                               const double *mx,
+                               const double *y,
+                               const double *my,
+                               size_t len,
+                               double *sums) {
+    size_t i = 0;
+#ifdef BETHYW_SSE2
+    __m128d n = _mm_setzero_pd();
+    __m128d sx = _mm_setzero_pd();
+    __m128d sy = _mm_setzero_pd();
+    __m128d sxx = _mm_setzero_pd();
+    __m128d syy = _mm_setzero_pd();
+    __m128d sxy = _mm_setzero_pd();
+    for (; i + 2 <= len; i += 2) {
+        __m128d vx = _mm_loadu_pd(x + i);
+        __m128d vmx = _mm_loadu_pd(mx + i);
+        __m128d vy = _mm_loadu_pd(y + i);
+        __m128d vmy = _mm_loadu_pd(my + i);
+        __m128d xmy = _mm_mul_pd(vx, vmy);
+        __m128d ymx = _mm_mul_pd(vy, vmx);
+        n = _mm_add_pd(n, _mm_mul_pd(vmx, vmy));
+        sx = _mm_add_pd(sx, xmy);
+        sy = _mm_add_pd(sy, ymx);
+        sxx = _mm_add_pd(sxx, _mm_mul_pd(xmy, vx));
+        syy = _mm_add_pd(syy, _mm_mul_pd(ymx, vy));
+        sxy = _mm_add_pd(sxy, _mm_mul_pd(vx, vy));
+    }
+    double lanes[2];
+    __m128d *vectors[CORRELATION_SUMS] = {&n, &sx, &sy, &sxx, &syy, &sxy};
+    for (size_t s = 0; s < CORRELATION_SUMS; s++) {
+        _mm_storeu_pd(lanes, *vectors[s]);
+        sums[s] += lanes[0] + lanes[1];
+    }
+#else
+    //four independent accumulators so the loop can still be pipelined
+    double acc[CORRELATION_SUMS][4] = {};
+    for (; i + 4 <= len; i += 4) {
+        for (size_t l = 0; l < 4; l++) {
+            double xmy = x[i + l] * my[i + l];
+            double ymx = y[i + l] * mx[i + l];
+            acc[0][l] += mx[i + l] * my[i + l];
+            acc[1][l] += xmy;
+            acc[2][l] += ymx;
+            acc[3][l] += xmy * x[i + l];
+            acc[4][l] += ymx * y[i + l];
+            acc[5][l] += x[i + l] * y[i + l];
+        }
+    }
+    for (size_t s = 0; s < CORRELATION_SUMS; s++) {
+        sums[s] += (acc[s][0] + acc[s][1]) + (acc[s][2] + acc[s][3]);
+    }
+#endif
+    for (; i < len; i++) {
+        double xmy = x[i] * my[i];
+        double ymx = y[i] * mx[i];
+        sums[0] += mx[i] * my[i];
+        sums[1] += xmy;
+        sums[2] += ymx;
+        sums[3] += xmy * x[i];
+        sums[4] += ymx * y[i];
+        sums[5] += x[i] * y[i];
+    }
+}
+
+/*
+  Build the correlation matrix between every measure across all the areas in
+  an Areas object for a single year. Each area is one observation.
+
+  @param areas
+    The Areas object holding the data
+
+  @param year
+    The year to compare measures in
+
+  @return
+    The computed CorrelationMatrix
+
+  @example
+    Areas data = Areas();
+    ...
+    auto matrix = CorrelationMatrix::acrossAreas(data, 2015);
+*/
+CorrelationMatrix CorrelationMatrix::acrossAreas(const Areas &areas, unsigned int year) {
+    std::set<std::string> codenameSet;
+    for (const auto &area : areas.getAreasContainer()) {
+        for (const auto &measure : area.second.getMeasures()) {
+            codenameSet.insert(measure.first);
+        }
+    }
+
+    std::vector<std::string> codenames(codenameSet.begin(), codenameSet.end());
+    const size_t rows = areas.getAreasContainer().size();
+    std::vector<double> columns(codenames.size() * rows, 0.0);
+    std::vector<double> present(codenames.size() * rows, 0.0);
+
+    for (size_t j = 0; j < codenames.size(); j++) {
+        size_t i = 0;
+        for (const auto &area : areas.getAreasContainer()) {
+            const auto &measures = area.second.getMeasures();
+            auto measure = measures.find(codenames[j]);
+            if (measure != measures.end()) {
+                auto value = measure->second.getValues().find(year);
+                if (value != measure->second.getValues().end()) {
+                    columns[j * rows + i] = value->second;
+                    present[j * rows + i] = 1.0;
+                }
+            }
+            i++;
+        }
+    }
+
+    return CorrelationMatrix("Correlation across areas in " + std::to_string(year),
+                             codenames, rows, columns, present);
+}
+
+/*
+  Build the correlation matrix between every measure of a single area across
+  all the years it has data for. Each year is one observation.
+
+  @param areas
+    The Areas object holding the data
+
+  @param localAuthorityCode
+    The local authority code of the area to compare measures in
+
+  @return
+    The computed CorrelationMatrix
+
+  @throws
+    std::invalid_argument if there is no area with the given code
+
+  @example
+    Areas data = Areas();
+    ...
+    auto matrix = CorrelationMatrix::acrossYears(data, "W06000011");
+*/
+CorrelationMatrix CorrelationMatrix::acrossYears(const Areas &areas,
+                                                 const std::string &localAuthorityCode) {
+    auto area = areas.getAreasContainer().find(localAuthorityCode);
+    if (area == areas.getAreasContainer().end()) {
+        throw std::invalid_argument("No area found matching " + localAuthorityCode);
+    }
+
+    std::vector<std::string> codenames;
+    std::set<unsigned int> yearSet;
+    for (const auto &measure : area->second.getMeasures()) {
+        codenames.push_back(measure.first);
+        for (const auto &value : measure.second.getValues()) {
+            yearSet.insert(value.first);
+        }
+    }
+
+    std::vector<unsigned int> years(yearSet.begin(), yearSet.end());
+    const size_t rows = years.size();
+    std::vector<double> columns(codenames.size() * rows, 0.0);
+    std::vector<double> present(codenames.size() * rows, 0.0);
+
+    size_t j = 0;
+    for (const auto &measure : area->second.getMeasures()) {
+        //values and years are both ordered, so walk them together
+        size_t i = 0;
+        for (const auto &value : measure.second.getValues()) {
+            while (years[i] != value.first) {
+                i++;
+            }
+            columns[j * rows + i] = value.second;
+            present[j * rows + i] = 1.0;
+        }
+        j++;
+    }
+
+    return CorrelationMatrix("Correlation across years in " + localAuthorityCode,
+                             codenames, rows, columns, present);
+}
+
+/*
+  Construct a CorrelationMatrix from columnar data and compute the
+  coefficients.
+
+  @param description
+    Human-readable description of what was compared
+
+  @param codenames
+    The codenames of the measures, one per column
+
+  @param observations
+    The number of rows in each column
+
+  @param columns
+    Column-major values, with 0 where a value is missing
+
+  @param present
+    Column-major flags, 1.0 where a value exists and 0.0 otherwise
+*/
+CorrelationMatrix::CorrelationMatrix(std::string description,
+                                     std::vector<std::string> codenames,
+                                     size_t observations,
+                                     std::vector<double> columns,
+                                     std::vector<double> present)
+    : description(std::move(description)),
+      codenames(std::move(codenames)),
+      observations(observations) {
+    compute(columns, present);
+}
+
+/*
+  Compute the coefficient for every pair of columns. Each column is centred
+  on its own mean first, which leaves the coefficients unchanged but avoids
+  losing precision when subtracting large sums (e.g. for population counts).
+
+  @param columns
+    Column-major values, with 0 where a value is missing
+
+  @param present
+    Column-major flags, 1.0 where a value exists and 0.0 otherwise
+*/
+void CorrelationMatrix::compute(const std::vector<double> &columns,
+                                const std::vector<double> &present) {
+    const size_t cols = codenames.size();
+    const size_t rows = observations;
+
+    std::vector<double> centred(columns);
+    for (size_t j = 0; j < cols; j++) {
+        double total = 0;
+        double count = 0;
+        for (size_t i = 0; i < rows; i++) {
+            total += centred[j * rows + i];
+            count += present[j * rows + i];
+        }
+        if (count > 0) {
+            const double mean = total / count;
+            for (size_t i = 0; i < rows; i++) {
+                centred[j * rows + i] -= mean * present[j * rows + i];
+            }
+        }
+    }
+
+    std::vector<double> sums(cols * cols * CORRELATION_SUMS, 0.0);
+    for (size_t rowStart = 0; rowStart < rows; rowStart += CORRELATION_BLOCK_ROWS) {
+        const size_t len = std::min(CORRELATION_BLOCK_ROWS, rows - rowStart);
+        for (size_t jb = 0; jb < cols; jb += CORRELATION_BLOCK_COLS) {
+            for (size_t kb = jb; kb < cols; kb += CORRELATION_BLOCK_COLS) {
+                const size_t jEnd = std::min(jb + CORRELATION_BLOCK_COLS, cols);
+                const size_t kEnd = std::min(kb + CORRELATION_BLOCK_COLS, cols);
+                for (size_t j = jb; j < jEnd; j++) {
+                    for (size_t k = std::max(kb, j); k < kEnd; k++) {
+                        accumulatePairSums(&centred[j * rows + rowStart],
+                                           &present[j * rows + rowStart],
+                                           &centred[k * rows + rowStart],
+                                           &present[k * rows + rowStart],
+                                           len,
+                                           &sums[(j * cols + k) * CORRELATION_SUMS]);
+                    }
+                }
+            }
+        }
+    }
+
+    coefficients.assign(cols * cols, std::numeric_limits<double>::quiet_NaN());
+    for (size_t j = 0; j < cols; j++) {
+        for (size_t k = j; k < cols; k++) {
+            const double *s = &sums[(j * cols + k) * CORRELATION_SUMS];
+            const double n = s[0];
+            const double varX = n * s[3] - s[1] * s[1];
+            const double varY = n * s[4] - s[2] * s[2];
+            double r = std::numeric_limits<double>::quiet_NaN();
+            if (n >= 2
+                && varX > n * s[3] * CORRELATION_EPSILON
+                && varY > n * s[4] * CORRELATION_EPSILON) {
+                r = (n * s[5] - s[1] * s[2]) / std::sqrt(varX * varY);
+                r = std::max(-1.0, std::min(1.0, r));
+            }
+            coefficients[j * cols + k] = r;
+            coefficients[k * cols + j] = r;
+        }
+    }
+}
+
+/*
+  Retrieve the description of what was compared, e.g.
+  "Correlation across areas in 2015".
+
+  @return
+    The description
+*/
+const std::string &CorrelationMatrix::getDescription() const {
+    return description;
+}
+
+/*
+  Retrieve the codenames of the measures, in the order of the rows and
+  columns of the matrix.
+
+  @return
+    The codenames
+*/
+const std::vector<std::string> &CorrelationMatrix::getCodenames() const {
+    return codenames;
+}
+
+/*
+  Retrieve the coefficient between two measures.
+
+  @param i
+    Index of the first measure in getCodenames()
+
+  @param j
+    Index of the second measure in getCodenames()
+
+  @return
+    The Pearson correlation coefficient, or NaN if it cannot be calculated
+
+  @throws
+    std::out_of_range if either index is not a valid measure
+*/
+double CorrelationMatrix::getCoefficient(size_t i, size_t j) const {
+    if (i >= codenames.size() || j >= codenames.size()) {
+        throw std::out_of_range("No coefficient for measures " + std::to_string(i)
+                                + " and " + std::to_string(j));
+    }
+    return coefficients[i * codenames.size() + j];
+}
+
+/*
+  Retrieve the number of measures in the matrix.
+
+  @return
+    The number of rows (and columns) of the matrix
+*/
+size_t CorrelationMatrix::size() const {
+    return codenames.size();
+}
+
+/*
+  Convert the matrix to JSON, formatted as:
+    {
+      "description": "<description>",
+      "observations": <number of observations>,
+      "measures": [ "<codename1>", … ],
+      "matrix": [ [ <coefficient>, … ], … ]
+    }
+  with null for any coefficient that cannot be calculated.
+
+  @return
+    std::string of JSON
+*/
+std::string CorrelationMatrix::toJSON() const {
+    nlohmann::json j;
+    j["description"] = description;
+    j["observations"] = observations;
+    j["measures"] = codenames;
+    j["matrix"] = nlohmann::json::array();
+    for (size_t r = 0; r < codenames.size(); r++) {
+        nlohmann::json row = nlohmann::json::array();
+        for (size_t c = 0; c < codenames.size(); c++) {
+            row.push_back(coefficients[r * codenames.size() + c]);
+        }
+        j["matrix"].push_back(row);
+    }
+    return j.dump();
+}
+
+/*
+  Overload the << operator to print the matrix as a table, with the
+  codenames as row and column headings.
+
+  @param os
+    The output stream to write to
+
+  @param matrix
+    The CorrelationMatrix to write to the output stream
+
+  @return
+    Reference to the output stream
+*/
+std::ostream &operator<<(std::ostream &os, const CorrelationMatrix &matrix) {
+    os << matrix.description << " (" << matrix.observations << " observations)" << std::endl;
+    if (matrix.codenames.empty()) {
+        return os << "<no measures>" << std::endl;
+    }
+
+    size_t labelWidth = 0;
+    int columnWidth = 9; // "-1.000000"
+    for (const auto &codename : matrix.codenames) {
+        labelWidth = std::max(labelWidth, codename.size());
+        columnWidth = std::max(columnWidth, (int) codename.size());
+    }
+
+    std::ostringstream table;
+    table << std::string(labelWidth, ' ') << ' ';
+    for (const auto &codename : matrix.codenames) {
+        table << std::right << std::setw(columnWidth) << codename << ' ';
+    }
+    table << '\n';
+
+    table << std::fixed << std::setprecision(6);
+    for (size_t r = 0; r < matrix.codenames.size(); r++) {
+        table << std::left << std::setw((int) labelWidth) << matrix.codenames[r] << ' ' << std::right;
+        for (size_t c = 0; c < matrix.codenames.size(); c++) {
+            const double coefficient = matrix.coefficients[r * matrix.codenames.size() + c];
+            if (std::isnan(coefficient)) {
+                table << std::setw(columnWidth) << "-" << ' ';
+            } else {
+                table << std::setw(columnWidth) << coefficient << ' ';
+            }
+        }
+        table << '\n';
+    }
+
+    return os << table.str();
+}
@@ -0,0 +1,58 @@
+#ifndef CORRELATION_H_
+#define CORRELATION_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the CorrelationMatrix class, which
+  computes the Pearson correlation coefficient between every pair of measures
+  held in an Areas object, either across all areas for a single year or across
+  all years for a single area.
+ */
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A CorrelationMatrix holds the codenames of the measures that were compared
+  and a symmetric matrix of coefficients between them. Observations where
+  either measure has no value are skipped for that pair (pairwise deletion),
+  and a coefficient that cannot be calculated is stored as NaN.
+*/
+class CorrelationMatrix {
+public:
+  static CorrelationMatrix acrossAreas(const Areas &areas, unsigned int year);
+  static CorrelationMatrix acrossYears(const Areas &areas,
+                                       const std::string &localAuthorityCode);
+
+  const std::string &getDescription() const;
+  const std::vector<std::string> &getCodenames() const;
+  double getCoefficient(size_t i, size_t j) const;
+  size_t size() const;
+  std::string toJSON() const;
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const CorrelationMatrix &matrix);
+
+private:
+  CorrelationMatrix(std::string description,
+                    std::vector<std::string> codenames,
+                    size_t observations,
+                    std::vector<double> columns,
+                    std::vector<double> present);
+  void compute(const std::vector<double> &columns,
+               const std::vector<double> &present);
+
+  std::string description;
+  std::vector<std::string> codenames;
+  size_t observations;
+  std::vector<double> coefficients;
+};
+
+#endif // CORRELATION_H_
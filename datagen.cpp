@@ -0,0 +1,153 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  A generator of synthetic data for Beth Yw?. It writes areas.csv and the
+  files of the datasets in datasets.h into a directory, under their usual
+  names and in the shapes their parsers read, with as many areas, measures
+  and years as asked for, so that bethyw --dir can be run on data of any
+  size (see DatasetGenerator in datasetgenerator.h).
+
+  Build with ./build.sh datagen, then e.g.:
+
+    bin/bethyw-datagen --dir /tmp/big/ --areas 2000000 --measures 4 --years 11 \
+      --missing 0.05 --order shuffled --seed 7
+    bin/bethyw --dir /tmp/big/ -d popden,complete-pop -a W06000001 -j
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "lib_cxxopts.hpp"
+
+#include "datasets.h"
+#include "datasetgenerator.h"
+
+int main(int argc, char *argv[]) {
+    cxxopts::Options cxxopts("bethyw-datagen",
+                             "Write synthetic areas.csv and dataset files for Beth Yw?, in the "
+                             "shapes of the files in the datasets directory.\n");
+    cxxopts.add_options()(
+        "dir",
+        "The directory to write the files to (created if need be)",
+        cxxopts::value<std::string>()->default_value("datasets-generated"))(
+
+        "d,datasets",
+        "The files to write, by dataset code (as for bethyw -d, and areas for "
+        "areas.csv), comma-separated; all of them by default",
+        cxxopts::value<std::vector<std::string>>())(
+
+        "areas",
+        "The number of areas",
+        cxxopts::value<unsigned int>()->default_value("22"))(
+
+        "measures",
+        "The number of measures in each StatsWales file with several",
+        cxxopts::value<unsigned int>()->default_value("3"))(
+
+        "years",
+        "The number of years (bethyw reads the complete-*.csv files only with "
+        "eleven)",
+        cxxopts::value<unsigned int>()->default_value("11"))(
+
+        "first-year",
+        "The first year",
+        cxxopts::value<unsigned int>()->default_value("2009"))(
+
+        "missing",
+        "The share of values, from 0 to 1, that are missing",
+        cxxopts::value<double>()->default_value("0"))(
+
+        "order",
+        "The order of the rows: sorted (by authority code), interleaved (by "
+        "measure and year, then code) or shuffled (interleaved, with the "
+        "areas in a random order)",
+        cxxopts::value<std::string>()->default_value("sorted"))(
+
+        "seed",
+        "The seed for the values, which missing values there are and the "
+        "shuffled order",
+        cxxopts::value<unsigned long long>()->default_value("1"))(
+
+        "h,help",
+        "Print usage.");
+
+    try {
+        auto args = cxxopts.parse(argc, argv);
+        if (args.count("help")) {
+            std::cerr << cxxopts.help() << std::endl;
+            return 0;
+        }
+
+        GeneratorSettings settings;
+        settings.areas = args["areas"].as<unsigned int>();
+        settings.measures = args["measures"].as<unsigned int>();
+        settings.years = args["years"].as<unsigned int>();
+        settings.firstYear = args["first-year"].as<unsigned int>();
+        settings.missing = args["missing"].as<double>();
+        settings.order = DatasetGenerator::parseOrder(args["order"].as<std::string>());
+        settings.seed = args["seed"].as<unsigned long long>();
+        const DatasetGenerator generator(settings);
+
+        std::vector<const BethYw::InputFileSource *> sources;
+        if (args.count("datasets")) {
+            for (const auto &code : args["datasets"].as<std::vector<std::string>>()) {
+                const BethYw::InputFileSource *found = nullptr;
+                if (code == BethYw::InputFiles::AREAS.CODE) {
+                    found = &BethYw::InputFiles::AREAS;
+                }
+                for (const auto &source : BethYw::InputFiles::DATASETS) {
+                    if (source.CODE == code) {
+                        found = &source;
+                    }
+                }
+                if (!found) {
+                    throw std::invalid_argument("No dataset matches key: " + code);
+                }
+                sources.push_back(found);
+            }
+        } else {
+            sources.push_back(&BethYw::InputFiles::AREAS);
+            for (const auto &source : BethYw::InputFiles::DATASETS) {
+                sources.push_back(&source);
+            }
+        }
+
+        std::string dir = args["dir"].as<std::string>();
+        if (dir.empty() || dir.back() != '/') {
+            dir += '/';
+        }
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Could not create " + dir + ": " + std::strerror(errno));
+        }
+
+        for (const BethYw::InputFileSource *source : sources) {
+            const std::string path = dir + source->FILE;
+            std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not open " + path);
+            }
+            const uint64_t rows = generator.write(file, *source);
+            const auto bytes = (uint64_t) file.tellp();
+            file.close();
+            if (!file) {
+                throw std::runtime_error("Could not write " + path);
+            }
+            std::cout << path << ": " << rows << " rows, " << bytes << " bytes" << std::endl;
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
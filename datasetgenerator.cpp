@@ -0,0 +1,347 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the DatasetGenerator class.
+*/
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "datasetgenerator.h"
+
+/*
+  Construct a generator for the given settings.
+
+  @param settings
+    The number of areas, measures and years, the share of values that are
+    missing (0 to 1), the order of the rows and the seed
+
+  @throws
+    std::invalid_argument if there are no areas, measures or years, or the
+    share of missing values is not between 0 and 1
+
+  @example
+    GeneratorSettings settings;
+    settings.areas = 100000;
+    DatasetGenerator generator(settings);
+    generator.write(file, BethYw::InputFiles::POPDEN);
+*/
+DatasetGenerator::DatasetGenerator(const GeneratorSettings &settings) : settings(settings) {
+    if (settings.areas == 0 || settings.measures == 0 || settings.years == 0) {
+        throw std::invalid_argument("There must be at least one area, measure and year");
+    }
+    if (!(settings.missing >= 0 && settings.missing <= 1)) {
+        throw std::invalid_argument("The share of missing values must be from 0 to 1");
+    }
+
+    if (settings.order == GeneratedOrder::Shuffled && settings.areas > 1) {
+        auto gcd = [](uint64_t a, uint64_t b) {
+            while (b != 0) {
+                const uint64_t r = a % b;
+                a = b;
+                b = r;
+            }
+            return a;
+        };
+        step = 1 + hash("", 0, 0, 0, 2) % (settings.areas - 1);
+        while (gcd(step, settings.areas) != 1) {
+            step++;
+        }
+        offset = hash("", 0, 0, 0, 3) % settings.areas;
+    }
+}
+
+/*
+  Parse the name of an order: sorted, interleaved or shuffled.
+
+  @param order
+    The name of the order
+
+  @return
+    The order
+
+  @throws
+    std::invalid_argument if the name is not one of them
+*/
+GeneratedOrder DatasetGenerator::parseOrder(const std::string &order) {
+    if (order == "sorted") {
+        return GeneratedOrder::Sorted;
+    } else if (order == "interleaved") {
+        return GeneratedOrder::Interleaved;
+    } else if (order == "shuffled") {
+        return GeneratedOrder::Shuffled;
+    }
+    throw std::invalid_argument("Invalid order: " + order
+                                + " (expected sorted, interleaved or shuffled)");
+}
+
+/*
+  Write the file of a dataset, or areas.csv, in the shape its parser reads.
+
+  @param os
+    The output stream to write to
+
+  @param source
+    The dataset (or areas.csv) whose file to write
+
+  @return
+    The number of rows written (not counting a CSV header)
+
+  @example
+    std::ofstream file(dir + BethYw::InputFiles::AREAS.FILE);
+    generator.write(file, BethYw::InputFiles::AREAS);
+*/
+uint64_t DatasetGenerator::write(std::ostream &os, const BethYw::InputFileSource &source) const {
+    switch (source.PARSER) {
+    case BethYw::AuthorityCodeCSV:
+        return writeAreas(os, source);
+    case BethYw::WelshStatsJSON:
+        return writeWelshStatsJSON(os, source);
+    case BethYw::AuthorityByYearCSV:
+        return writeAuthorityByYearCSV(os, source);
+    default:
+        throw std::invalid_argument("Unknown source type for " + source.CODE);
+    }
+}
+
+/*
+  The authority code of an area, e.g. W06000001 for the first.
+
+  @param area
+    The number of the area, from 0
+
+  @return
+    The authority code
+*/
+std::string DatasetGenerator::code(uint32_t area) const {
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "W%08llu", 6000001ULL + area);
+    return buffer;
+}
+
+/*
+  The number of measures in a dataset's file: one for a dataset with a single
+  measure, otherwise the number in the settings.
+
+  @param source
+    The dataset
+
+  @return
+    The number of measures
+*/
+uint32_t DatasetGenerator::measureCount(const BethYw::InputFileSource &source) const {
+    return source.COLS.count(BethYw::SINGLE_MEASURE_CODE) ? 1 : settings.measures;
+}
+
+/*
+  Whether the value of an area, measure and year of a dataset is missing.
+
+  @param source
+    The dataset
+
+  @param area
+    The number of the area, from 0
+
+  @param measure
+    The number of the measure, from 0
+
+  @param year
+    The number of the year, from 0 (for the first year in the settings)
+
+  @return
+    true if it is missing
+*/
+bool DatasetGenerator::isMissing(const BethYw::InputFileSource &source,
+                                 uint32_t area, uint32_t measure, uint32_t year) const {
+    return settings.missing > 0
+           && (double) (hash(source.CODE, area, measure, year, 1) >> 11) / (double) (1ULL << 53)
+              < settings.missing;
+}
+
+/*
+  The value of an area, measure and year of a dataset, a number from 0 to
+  1,000,000 with two decimal places (so it is written and read back
+  exactly).
+
+  @param source
+    The dataset
+
+  @param area
+    The number of the area, from 0
+
+  @param measure
+    The number of the measure, from 0
+
+  @param year
+    The number of the year, from 0 (for the first year in the settings)
+
+  @return
+    The value
+*/
+double DatasetGenerator::value(const BethYw::InputFileSource &source,
+                               uint32_t area, uint32_t measure, uint32_t year) const {
+    return (double) (hash(source.CODE, area, measure, year, 0) % 100000001) / 100.0;
+}
+
+/*
+  Write areas.csv, with a code, English name and Welsh name for each area.
+*/
+uint64_t DatasetGenerator::writeAreas(std::ostream &os,
+                                      const BethYw::InputFileSource &source) const {
+    os << source.COLS.at(BethYw::AUTH_CODE) << ','
+       << source.COLS.at(BethYw::AUTH_NAME_ENG) << ','
+       << source.COLS.at(BethYw::AUTH_NAME_CYM) << '\n';
+
+    char line[96];
+    for (uint32_t position = 0; position < settings.areas; position++) {
+        const uint32_t area = areaAt(position);
+        const int length = std::snprintf(line, sizeof(line), "%s,Area %u,Ardal %u\n",
+                                         code(area).c_str(), area + 1, area + 1);
+        os.write(line, length);
+    }
+    return settings.areas;
+}
+
+/*
+  Write a StatsWales file: the rows of its "value" array have the dataset's
+  columns for the area's code and English name, the measure's code and name
+  (unless it has a single measure), the year and the value.
+*/
+uint64_t DatasetGenerator::writeWelshStatsJSON(std::ostream &os,
+                                               const BethYw::InputFileSource &source) const {
+    const auto &cols = source.COLS;
+    const uint32_t measures = measureCount(source);
+    const bool single = cols.count(BethYw::SINGLE_MEASURE_CODE) > 0;
+
+    // Some datasets use one column for the measure's code and name
+    const std::string measureName =
+        single || cols.at(BethYw::MEASURE_NAME) == cols.at(BethYw::MEASURE_CODE)
+            ? "" : cols.at(BethYw::MEASURE_NAME);
+
+    // The fixed parts of a row, between which the values go
+    const std::string valueKey = "{\"" + cols.at(BethYw::VALUE) + "\":";
+    const std::string codeKey = ",\"" + cols.at(BethYw::AUTH_CODE) + "\":\"";
+    const std::string nameKey = "\",\"" + cols.at(BethYw::AUTH_NAME_ENG) + "\":\"Area ";
+    const std::string measureKey = single ? "" : "\",\"" + cols.at(BethYw::MEASURE_CODE) + "\":\"";
+    const std::string measureNameKey = measureName.empty() ? "" : "\",\"" + measureName + "\":\"";
+    const std::string yearKey = "\",\"" + cols.at(BethYw::YEAR) + "\":\"";
+
+    os << "{\"odata.metadata\":\"" << source.NAME << "\",\"value\":[\n";
+    uint64_t rows = 0;
+    std::string row;
+    char number[32];
+    auto writeRow = [&](uint32_t area, uint32_t measure, uint32_t year) {
+        row = rows++ ? ",\n" : "";
+        row += valueKey;
+        if (isMissing(source, area, measure, year)) {
+            row += "\"\"";
+        } else {
+            row.append(number, std::snprintf(number, sizeof(number), "%.2f",
+                                             value(source, area, measure, year)));
+        }
+        row += codeKey;
+        row += code(area);
+        row += nameKey;
+        row.append(number, std::snprintf(number, sizeof(number), "%u", area + 1));
+        if (!single) {
+            const int length = std::snprintf(number, sizeof(number), "%u", measure + 1);
+            row += measureKey;
+            row += "M";
+            row.append(number, length);
+            if (!measureName.empty()) {
+                row += measureNameKey;
+                row += "Measure ";
+                row.append(number, length);
+            }
+        }
+        row += yearKey;
+        row.append(number, std::snprintf(number, sizeof(number), "%u", settings.firstYear + year));
+        row += "\"}";
+        os.write(row.data(), row.size());
+    };
+
+    if (settings.order == GeneratedOrder::Sorted) {
+        for (uint32_t area = 0; area < settings.areas; area++) {
+            for (uint32_t measure = 0; measure < measures; measure++) {
+                for (uint32_t year = 0; year < settings.years; year++) {
+                    writeRow(area, measure, year);
+                }
+            }
+        }
+    } else {
+        for (uint32_t measure = 0; measure < measures; measure++) {
+            for (uint32_t year = 0; year < settings.years; year++) {
+                for (uint32_t position = 0; position < settings.areas; position++) {
+                    writeRow(areaAt(position), measure, year);
+                }
+            }
+        }
+    }
+    os << "\n]}\n";
+    return rows;
+}
+
+/*
+  Write a complete-*.csv file, with a column for each year of the dataset's
+  single measure.
+*/
+uint64_t DatasetGenerator::writeAuthorityByYearCSV(std::ostream &os,
+                                                   const BethYw::InputFileSource &source) const {
+    os << source.COLS.at(BethYw::AUTH_CODE);
+    for (uint32_t year = 0; year < settings.years; year++) {
+        os << ',' << settings.firstYear + year;
+    }
+    os << '\n';
+
+    std::string line;
+    char number[32];
+    for (uint32_t position = 0; position < settings.areas; position++) {
+        const uint32_t area = areaAt(position);
+        line = code(area);
+        for (uint32_t year = 0; year < settings.years; year++) {
+            line += ',';
+            if (!isMissing(source, area, 0, year)) {
+                line.append(number, std::snprintf(number, sizeof(number), "%.2f",
+                                                  value(source, area, 0, year)));
+            }
+        }
+        line += '\n';
+        os.write(line.data(), line.size());
+    }
+    return settings.areas;
+}
+
+/*
+  The area at a position in the order of the settings.
+*/
+uint32_t DatasetGenerator::areaAt(uint32_t position) const {
+    return (uint32_t) ((position * step + offset) % settings.areas);
+}
+
+/*
+  Mix the seed, a dataset code, an area, measure and year, and a salt (one
+  for each use) into a well-spread 64-bit number (FNV-1a for the code, then
+  SplitMix64).
+*/
+uint64_t DatasetGenerator::hash(const std::string &dataset,
+                                uint64_t area, uint64_t measure, uint64_t year,
+                                uint64_t salt) const {
+    uint64_t key = 0xCBF29CE484222325ULL;
+    for (char c : dataset) {
+        key = (key ^ (unsigned char) c) * 0x100000001B3ULL;
+    }
+
+    uint64_t x = settings.seed;
+    for (uint64_t part : {key, area, measure, year, salt}) {
+        x += 0x9E3779B97F4A7C15ULL + part;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+    }
+    return x;
+}
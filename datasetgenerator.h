@@ -0,0 +1,103 @@
+#ifndef DATASETGENERATOR_H_
+#define DATASETGENERATOR_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the DatasetGenerator class, which
+  writes synthetic files in the shapes of areas.csv and the datasets, of
+  any size, for bethyw-datagen and bethyw-bench.
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "datasets.h"
+
+/*
+  The order a DatasetGenerator writes the rows of a file in:
+
+  - Sorted: by authority code, then measure, then year, as --stream needs;
+  - Interleaved: by measure, then year, then authority code, so each
+    area's rows are spread across the file;
+  - Shuffled: interleaved, with the areas in a random order each time.
+
+  Files with one row per area (areas.csv and the complete-*.csv files) are
+  the same Sorted and Interleaved.
+*/
+enum class GeneratedOrder {
+  Sorted,
+  Interleaved,
+  Shuffled
+};
+
+/*
+  The size and contents of the files a DatasetGenerator writes.
+*/
+struct GeneratorSettings {
+  uint32_t areas = 22;
+  uint32_t measures = 3;
+  uint32_t years = 11;
+  uint32_t firstYear = 2009;
+  double missing = 0;
+  GeneratedOrder order = GeneratedOrder::Sorted;
+  uint64_t seed = 1;
+};
+
+/*
+  A DatasetGenerator writes the file of any dataset in datasets.h (or
+  areas.csv), with the columns its InputFileSource gives, for a number of
+  synthetic areas, measures and years:
+
+  - areas.csv (AuthorityCodeCSV) has a code, English name and Welsh name
+    for each area;
+  - a StatsWales file (WelshStatsJSON) has a row for every area, measure
+    and year, in a "value" array, with one measure if the dataset has a
+    single measure (e.g. trains);
+  - a complete-*.csv file (AuthorityByYearCSV) has a row for every area
+    with a column for every year, for the dataset's single measure.
+
+  Every value comes from a hash of the seed, dataset, area, measure and
+  year, as does whether it is missing (an empty field, or "" in JSON), so
+  the same settings always give the same files, byte for byte, and the
+  files written in different orders hold the same data. The files are written as they are
+  generated, so they can be far larger than memory.
+*/
+class DatasetGenerator {
+public:
+  explicit DatasetGenerator(const GeneratorSettings &settings);
+
+  static GeneratedOrder parseOrder(const std::string &order);
+
+  uint64_t write(std::ostream &os, const BethYw::InputFileSource &source) const;
+
+  std::string code(uint32_t area) const;
+  uint32_t measureCount(const BethYw::InputFileSource &source) const;
+  bool isMissing(const BethYw::InputFileSource &source,
+                 uint32_t area, uint32_t measure, uint32_t year) const;
+  double value(const BethYw::InputFileSource &source,
+               uint32_t area, uint32_t measure, uint32_t year) const;
+
+private:
+  uint64_t writeAreas(std::ostream &os, const BethYw::InputFileSource &source) const;
+  uint64_t writeWelshStatsJSON(std::ostream &os, const BethYw::InputFileSource &source) const;
+  uint64_t writeAuthorityByYearCSV(std::ostream &os,
+                                   const BethYw::InputFileSource &source) const;
+  uint32_t areaAt(uint32_t position) const;
+  uint64_t hash(const std::string &dataset,
+                uint64_t area, uint64_t measure, uint64_t year, uint64_t salt) const;
+
+  GeneratorSettings settings;
+
+  // The areas are shuffled as position * step + offset (mod areas), which
+  // visits every area once as step and areas have no common factor
+  uint64_t step = 1;
+  uint64_t offset = 0;
+};
+
+#endif // DATASETGENERATOR_H_
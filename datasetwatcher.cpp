@@ -0,0 +1,139 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the DatasetWatcher class.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "datasetwatcher.h"
+
+namespace {
+
+// How often the watcher checks whether it has been asked to stop
+const int STOP_CHECK_MILLISECONDS = 250;
+
+} // namespace
+
+#ifdef __linux__
+
+/*
+  Construct a DatasetWatcher and start watching.
+
+  @param dir
+    The directory to watch
+
+  @param handler
+    The function to call, on the watcher's thread, with the names of the
+    files that changed
+
+  @param settle
+    How long the directory must be quiet before the changes are passed on
+
+  @throws
+    std::runtime_error if the directory cannot be watched
+
+  @example
+    DatasetWatcher watcher("datasets", [](const std::set<std::string> &files) {
+      for (const auto &file : files) std::cerr << file << " changed" << std::endl;
+    });
+*/
+DatasetWatcher::DatasetWatcher(const std::string &dir,
+                               ChangeHandler handler,
+                               std::chrono::milliseconds settle)
+    : inotify(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      handler(std::move(handler)),
+      settle(settle),
+      stopping(false) {
+    if (inotify < 0
+        || ::inotify_add_watch(inotify, dir.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        const std::string reason = std::strerror(errno);
+        if (inotify >= 0) {
+            ::close(inotify);
+        }
+        throw std::runtime_error("Could not watch " + dir + ": " + reason);
+    }
+    thread = std::thread(&DatasetWatcher::run, this);
+}
+
+/*
+  Stop watching, waiting for the handler to return if it is running.
+*/
+DatasetWatcher::~DatasetWatcher() {
+    stopping = true;
+    thread.join();
+    ::close(inotify);
+}
+
+/*
+  Wait for changes and pass them on until asked to stop.
+*/
+void DatasetWatcher::run() {
+    std::set<std::string> changed;
+    while (!stopping) {
+        // Wait for longer while nothing has changed, and only for the settle
+        // time once something has
+        pollfd waiting = {inotify, POLLIN, 0};
+        const int timeout = changed.empty() ? STOP_CHECK_MILLISECONDS : (int) settle.count();
+        const int ready = ::poll(&waiting, 1, timeout);
+
+        if (ready > 0) {
+            readEvents(changed);
+        } else if (ready == 0 && !changed.empty()) {
+            handler(changed);
+            changed.clear();
+        }
+    }
+}
+
+/*
+  Read the waiting events, adding the names of the files they are about to
+  a set.
+*/
+void DatasetWatcher::readEvents(std::set<std::string> &changed) {
+    alignas(inotify_event) char buffer[16384];
+    while (true) {
+        const ssize_t length = ::read(inotify, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+        for (char *at = buffer; at < buffer + length;) {
+            const inotify_event *event = (const inotify_event *) at;
+            if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                changed.insert(event->name);
+            }
+            at += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+#else
+
+DatasetWatcher::DatasetWatcher(const std::string &,
+                               ChangeHandler handler,
+                               std::chrono::milliseconds settle)
+    : inotify(-1), handler(std::move(handler)), settle(settle), stopping(false) {
+    throw std::runtime_error("Watching for changes is only supported on Linux");
+}
+
+DatasetWatcher::~DatasetWatcher() {}
+
+void DatasetWatcher::run() {}
+
+void DatasetWatcher::readEvents(std::set<std::string> &) {}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef DATASETWATCHER_H_
+#define DATASETWATCHER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the DatasetWatcher class, which uses
+  inotify to notice as soon as files in the data directory change, so that
+  a server (--watch) can re-import just those datasets.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+
+/*
+  A DatasetWatcher watches a directory, on a thread of its own, for files
+  that are written and closed, or moved into it (which is how most tools
+  replace a file), and calls a function with the names of the files
+  that changed. Changes that arrive close together (e.g. several files
+  copied in at once) are passed on together once the directory has been
+  quiet for a short while.
+
+  inotify is only available on Linux; elsewhere the constructor throws.
+*/
+class DatasetWatcher {
+public:
+  using ChangeHandler = std::function<void(const std::set<std::string> &files)>;
+
+  DatasetWatcher(const std::string &dir,
+                 ChangeHandler handler,
+                 std::chrono::milliseconds settle = std::chrono::milliseconds(200));
+  DatasetWatcher(const DatasetWatcher &) = delete;
+  DatasetWatcher &operator=(const DatasetWatcher &) = delete;
+  ~DatasetWatcher();
+
+private:
+  void run();
+  void readEvents(std::set<std::string> &changed);
+
+  int inotify;
+  ChangeHandler handler;
+  std::chrono::milliseconds settle;
+  std::atomic<bool> stopping;
+  std::thread thread;
+};
+
+#endif // DATASETWATCHER_H_
@@ -0,0 +1,735 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the HttpServer class.
+
+  The event loop owns every connection. It only ever passes a copy of a
+  parsed request to the workers, identified by the connection's id, and the
+  workers pass back the complete response text; if the connection has been
+  closed in the meantime, the response is dropped. Only one request per
+  connection is with the workers at a time, which keeps pipelined responses
+  in order.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "httpserver.h"
+#include "renderpool.h"
+
+namespace {
+
+// The longest request line and headers accepted
+const size_t MAX_HEADER = 16 * 1024;
+
+// How long an idle keep-alive connection is kept open
+const std::chrono::seconds IDLE_TIMEOUT(30);
+
+// How often the event loop checks whether it has been asked to stop
+const int LOOP_TIMEOUT_MILLISECONDS = 250;
+
+volatile std::sig_atomic_t signalled = 0;
+
+/*
+  Build the complete text of a response.
+*/
+std::string serialise(const HttpResponse &response, bool keepAlive, bool head) {
+    std::string text = "HTTP/1.1 " + std::to_string(response.status) + " "
+                       + HttpServer::statusText(response.status) + "\r\n";
+    text += "Content-Type: " + response.contentType + "\r\n";
+    text += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+    text += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    if (!head) {
+        text += response.body;
+    }
+    return text;
+}
+
+HttpResponse plainResponse(int status, const std::string &message) {
+    return {status, "text/plain; charset=utf-8", message + "\n"};
+}
+
+#ifdef __linux__
+
+void handleStopSignal(int) {
+    signalled = 1;
+}
+
+struct Connection {
+  int fd;
+  std::string input;
+  std::string output;
+  size_t written;
+  bool busy;
+  bool closing;
+  bool writing;
+  std::chrono::steady_clock::time_point lastActive;
+};
+
+struct Job {
+  uint64_t id;
+  bool keepAlive;
+  bool head;
+  HttpRequest request;
+};
+
+struct Completion {
+  uint64_t id;
+  bool keepAlive;
+  std::string text;
+};
+
+// The epoll ids of the listening socket and the wakeup eventfd; connections
+// are numbered from FIRST_CONNECTION
+const uint64_t LISTENER_ID = 0;
+const uint64_t WAKEUP_ID = 1;
+const uint64_t FIRST_CONNECTION = 2;
+
+/*
+  The state of the event loop and the worker pool while serving.
+*/
+class EventLoop {
+public:
+  EventLoop(int listener, int wakeup, const HttpHandler &handler)
+      : listener(listener), wakeup(wakeup), handler(handler),
+        epoll(::epoll_create1(EPOLL_CLOEXEC)), nextId(FIRST_CONNECTION), finished(false) {
+      if (epoll < 0) {
+          throw std::runtime_error("Could not create the event loop");
+      }
+      watch(listener, LISTENER_ID, EPOLLIN, EPOLL_CTL_ADD);
+      watch(wakeup, WAKEUP_ID, EPOLLIN, EPOLL_CTL_ADD);
+  }
+
+  ~EventLoop() {
+      {
+          std::lock_guard<std::mutex> lock(mutex);
+          finished = true;
+      }
+      ready.notify_all();
+      for (auto &worker : pool) {
+          worker.join();
+      }
+      for (auto &entry : connections) {
+          ::close(entry.second.fd);
+      }
+      ::close(epoll);
+  }
+
+  void start(unsigned int workers) {
+      for (unsigned int i = 0; i < workers; i++) {
+          pool.emplace_back(&EventLoop::work, this);
+      }
+  }
+
+  void run(const std::atomic<bool> &stopping) {
+      epoll_event events[64];
+      while (!stopping && !signalled) {
+          const int count = ::epoll_wait(epoll, events, 64, LOOP_TIMEOUT_MILLISECONDS);
+          for (int i = 0; i < count; i++) {
+              const uint64_t id = events[i].data.u64;
+              if (id == LISTENER_ID) {
+                  acceptAll();
+              } else if (id == WAKEUP_ID) {
+                  completeAll();
+              } else {
+                  handle(id, events[i].events);
+              }
+          }
+          closeIdle();
+      }
+  }
+
+private:
+  void watch(int fd, uint64_t id, uint32_t events, int operation) {
+      epoll_event event;
+      std::memset(&event, 0, sizeof(event));
+      event.events = events;
+      event.data.u64 = id;
+      ::epoll_ctl(epoll, operation, fd, &event);
+  }
+
+  void acceptAll() {
+      while (true) {
+          const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+          if (fd < 0) {
+              return;
+          }
+          const int on = 1;
+          ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+          const uint64_t id = nextId++;
+          connections[id] = {fd, "", "", 0, false, false, false,
+                             std::chrono::steady_clock::now()};
+          watch(fd, id, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+      }
+  }
+
+  void handle(uint64_t id, uint32_t events) {
+      auto found = connections.find(id);
+      if (found == connections.end()) {
+          return;
+      }
+      Connection &connection = found->second;
+      connection.lastActive = std::chrono::steady_clock::now();
+
+      if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+          char chunk[16384];
+          while (true) {
+              const ssize_t received = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+              if (received > 0) {
+                  connection.input.append(chunk, (size_t) received);
+                  continue;
+              }
+              if (received < 0 && errno == EINTR) {
+                  continue;
+              }
+              if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                  break;
+              }
+              if (received < 0) {
+                  close(id);
+                  return;
+              }
+
+              // The client has finished sending: answer what it has sent,
+              // then close
+              if (!process(id)) {
+                  return;
+              }
+              connection.closing = true;
+              if (!connection.busy && connection.written == connection.output.size()) {
+                  close(id);
+              } else {
+                  watch(connection.fd, id, connection.writing ? (uint32_t) EPOLLOUT : 0u, EPOLL_CTL_MOD);
+              }
+              return;
+          }
+          if (!process(id)) {
+              return;
+          }
+      }
+
+      if (events & EPOLLOUT) {
+          flush(id);
+      }
+  }
+
+  /*
+    Parse and dispatch the next request on a connection, if it has a
+    complete one and is not waiting for the workers. Returns false if the
+    connection was closed.
+  */
+  bool process(uint64_t id) {
+      Connection &connection = connections.at(id);
+      while (!connection.busy && !connection.closing) {
+          const size_t end = connection.input.find("\r\n\r\n");
+          if (end == std::string::npos) {
+              if (connection.input.size() > MAX_HEADER) {
+                  return respond(id, plainResponse(431, "Request header too large"), false, false);
+              }
+              return true;
+          }
+          if (end > MAX_HEADER) {
+              return respond(id, plainResponse(431, "Request header too large"), false, false);
+          }
+
+          const std::string header = connection.input.substr(0, end);
+          connection.input.erase(0, end + 4);
+
+          Job job;
+          job.id = id;
+          int error = parse(header, job);
+          if (error != 0) {
+              const std::string message = error == 505 ? "Only HTTP/1.x is supported"
+                                        : error == 405 ? "Only GET and HEAD are supported"
+                                        : "Bad request";
+              if (!respond(id, plainResponse(error, message), job.keepAlive && error == 405,
+                           job.head)) {
+                  return false;
+              }
+              continue;
+          }
+
+          connection.busy = true;
+          {
+              std::lock_guard<std::mutex> lock(mutex);
+              jobs.push_back(std::move(job));
+          }
+          ready.notify_one();
+      }
+      return true;
+  }
+
+  /*
+    Parse a request line and headers into a job, returning 0 or the status
+    code of the error.
+  */
+  static int parse(const std::string &header, Job &job) {
+      job.keepAlive = false;
+      job.head = false;
+
+      size_t lineEnd = header.find("\r\n");
+      const std::string line = header.substr(0, lineEnd);
+      const size_t firstSpace = line.find(' ');
+      const size_t secondSpace = line.find(' ', firstSpace + 1);
+      if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+          return 400;
+      }
+      const std::string method = line.substr(0, firstSpace);
+      const std::string target = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+      const std::string version = line.substr(secondSpace + 1);
+      if (version.compare(0, 7, "HTTP/1.") != 0) {
+          return 505;
+      }
+
+      std::string connectionHeader;
+      bool body = false;
+      while (lineEnd != std::string::npos) {
+          const size_t start = lineEnd + 2;
+          lineEnd = header.find("\r\n", start);
+          const std::string field = header.substr(start, lineEnd == std::string::npos
+                                                         ? std::string::npos
+                                                         : lineEnd - start);
+          const size_t colon = field.find(':');
+          if (colon == std::string::npos) {
+              return 400;
+          }
+          std::string name = field.substr(0, colon);
+          std::string value = field.substr(colon + 1);
+          std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+          std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+          value.erase(0, value.find_first_not_of(" \t"));
+          value.erase(value.find_last_not_of(" \t") + 1);
+
+          if (name == "connection") {
+              connectionHeader = value;
+          } else if ((name == "content-length" && value != "0") || name == "transfer-encoding") {
+              body = true;
+          }
+      }
+
+      job.keepAlive = version == "HTTP/1.1" ? connectionHeader != "close"
+                                            : connectionHeader == "keep-alive";
+      job.head = method == "HEAD";
+      if (body) {
+          // The body would have to be skipped to find the next request
+          job.keepAlive = false;
+          return 400;
+      }
+      if (method != "GET" && method != "HEAD") {
+          return 405;
+      }
+      if (!HttpServer::parseTarget(target, job.request)) {
+          return 400;
+      }
+      job.request.method = method;
+      return 0;
+  }
+
+  /*
+    Queue a response that is ready without the workers. Returns false if the
+    connection was closed.
+  */
+  bool respond(uint64_t id, const HttpResponse &response, bool keepAlive, bool head) {
+      Connection &connection = connections.at(id);
+      connection.output += serialise(response, keepAlive, head);
+      if (!keepAlive) {
+          connection.closing = true;
+      }
+      return flush(id);
+  }
+
+  void work() {
+      while (true) {
+          Job job;
+          {
+              std::unique_lock<std::mutex> lock(mutex);
+              ready.wait(lock, [this]() { return finished || !jobs.empty(); });
+              if (finished) {
+                  return;
+              }
+              job = std::move(jobs.front());
+              jobs.pop_front();
+          }
+
+          HttpResponse response;
+          try {
+              response = handler(job.request);
+          } catch (const std::exception &e) {
+              response = plainResponse(500, e.what());
+          }
+
+          Completion completion = {job.id, job.keepAlive,
+                                   serialise(response, job.keepAlive, job.head)};
+          {
+              std::lock_guard<std::mutex> lock(mutex);
+              done.push_back(std::move(completion));
+          }
+          const uint64_t one = 1;
+          if (::write(wakeup, &one, sizeof(one)) < 0) {
+              // The event loop is woken at least every LOOP_TIMEOUT_MILLISECONDS
+          }
+      }
+  }
+
+  void completeAll() {
+      uint64_t count;
+      if (::read(wakeup, &count, sizeof(count)) < 0) {
+          // Nothing to read; the completions are checked anyway
+      }
+
+      std::vector<Completion> completed;
+      {
+          std::lock_guard<std::mutex> lock(mutex);
+          completed.swap(done);
+      }
+
+      for (auto &completion : completed) {
+          auto found = connections.find(completion.id);
+          if (found == connections.end()) {
+              continue;
+          }
+          Connection &connection = found->second;
+          connection.busy = false;
+          connection.lastActive = std::chrono::steady_clock::now();
+          connection.output += completion.text;
+          if (!completion.keepAlive) {
+              connection.closing = true;
+          }
+          if (flush(completion.id)) {
+              process(completion.id);
+          }
+      }
+  }
+
+  /*
+    Send as much of a connection's output as it will take. Returns false if
+    the connection was closed.
+  */
+  bool flush(uint64_t id) {
+      Connection &connection = connections.at(id);
+      while (connection.written < connection.output.size()) {
+          const ssize_t sent = ::send(connection.fd,
+                                      connection.output.data() + connection.written,
+                                      connection.output.size() - connection.written,
+                                      MSG_NOSIGNAL);
+          if (sent < 0 && errno == EINTR) {
+              continue;
+          }
+          if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+              if (!connection.writing) {
+                  connection.writing = true;
+                  watch(connection.fd, id, EPOLLIN | EPOLLRDHUP | EPOLLOUT, EPOLL_CTL_MOD);
+              }
+              return true;
+          }
+          if (sent <= 0) {
+              close(id);
+              return false;
+          }
+          connection.written += (size_t) sent;
+      }
+
+      connection.output.clear();
+      connection.written = 0;
+      if (connection.writing) {
+          connection.writing = false;
+          watch(connection.fd, id, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+      }
+      if (connection.closing && !connection.busy) {
+          close(id);
+          return false;
+      }
+      return true;
+  }
+
+  void closeIdle() {
+      const auto now = std::chrono::steady_clock::now();
+      std::vector<uint64_t> idle;
+      for (const auto &entry : connections) {
+          const Connection &connection = entry.second;
+          if (!connection.busy && connection.output.empty()
+              && now - connection.lastActive > IDLE_TIMEOUT) {
+              idle.push_back(entry.first);
+          }
+      }
+      for (uint64_t id : idle) {
+          close(id);
+      }
+  }
+
+  void close(uint64_t id) {
+      auto found = connections.find(id);
+      ::epoll_ctl(epoll, EPOLL_CTL_DEL, found->second.fd, nullptr);
+      ::close(found->second.fd);
+      connections.erase(found);
+  }
+
+  int listener;
+  int wakeup;
+  const HttpHandler &handler;
+  int epoll;
+  uint64_t nextId;
+  std::unordered_map<uint64_t, Connection> connections;
+  std::vector<std::thread> pool;
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<Job> jobs;
+  std::vector<Completion> done;
+  bool finished;
+};
+
+#endif
+
+} // namespace
+
+#ifdef __linux__
+
+/*
+  Construct an HttpServer listening on a port of the loopback interface
+  (127.0.0.1), so only local processes can connect.
+
+  @param port
+    The port to listen on, or 0 to let the system choose one (see getPort())
+
+  @param workers
+    The number of worker threads to answer requests on, or 0 for one per
+    processor core
+
+  @throws
+    std::runtime_error if the port cannot be listened on
+
+  @example
+    HttpServer server(8080, 0);
+    server.serve(handler);
+*/
+HttpServer::HttpServer(uint16_t port, unsigned int workers)
+    : listener(-1), wakeup(-1), port(port), workers(renderThreads(workers)), stopping(false) {
+    listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int on = 1;
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+
+    if (listener < 0
+        || ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+        || ::bind(listener, (const sockaddr *) &address, sizeof(address)) != 0
+        || ::listen(listener, SOMAXCONN) != 0
+        || ::getsockname(listener, (sockaddr *) &address, &length) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        throw std::runtime_error("Could not listen on port " + std::to_string(port) + ": "
+                                 + reason);
+    }
+    this->port = ntohs(address.sin_port);
+
+    wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup < 0) {
+        ::close(listener);
+        throw std::runtime_error("Could not create the event loop");
+    }
+}
+
+/*
+  Stop listening.
+*/
+HttpServer::~HttpServer() {
+    ::close(listener);
+    ::close(wakeup);
+}
+
+/*
+  Answer requests until stop() is called or the process receives SIGINT or
+  SIGTERM. Open connections are closed when serving stops.
+
+  @param handler
+    The function that answers each request
+*/
+void HttpServer::serve(const HttpHandler &handler) {
+    struct sigaction stopAction, oldInterrupt, oldTerminate;
+    std::memset(&stopAction, 0, sizeof(stopAction));
+    stopAction.sa_handler = handleStopSignal;
+    sigemptyset(&stopAction.sa_mask);
+    ::sigaction(SIGINT, &stopAction, &oldInterrupt);
+    ::sigaction(SIGTERM, &stopAction, &oldTerminate);
+    signalled = 0;
+
+    {
+        EventLoop loop(listener, wakeup, handler);
+        loop.start(workers);
+        loop.run(stopping);
+    }
+
+    ::sigaction(SIGINT, &oldInterrupt, nullptr);
+    ::sigaction(SIGTERM, &oldTerminate, nullptr);
+}
+
+#else
+
+HttpServer::HttpServer(uint16_t port, unsigned int workers)
+    : listener(-1), wakeup(-1), port(port), workers(workers), stopping(false) {
+    throw std::runtime_error("The HTTP server is only supported on Linux");
+}
+
+HttpServer::~HttpServer() {}
+
+void HttpServer::serve(const HttpHandler &) {}
+
+#endif
+
+/*
+  Retrieve the port the server is listening on.
+
+  @return
+    The port
+*/
+uint16_t HttpServer::getPort() const {
+    return port;
+}
+
+/*
+  Ask the server to stop. This is safe to call from any thread, and the
+  server stops within a fraction of a second.
+*/
+void HttpServer::stop() {
+    stopping = true;
+}
+
+/*
+  Split a request target into its path and query parameters, URL-decoding
+  each.
+
+  @param target
+    The request target, e.g. "/areas/W06000011?measures=pop&years=2010-2019"
+
+  @param request
+    The request to fill in the path and query parameters of
+
+  @return
+    false if the target is not a valid origin-form target
+
+  @example
+    HttpRequest request;
+    HttpServer::parseTarget("/areas?years=2015", request);
+    // request.path == "/areas", request.query["years"] == "2015"
+*/
+bool HttpServer::parseTarget(const std::string &target, HttpRequest &request) {
+    if (target.empty() || target[0] != '/') {
+        return false;
+    }
+
+    const size_t mark = target.find('?');
+    try {
+        request.path = urlDecode(target.substr(0, mark));
+        request.query.clear();
+        if (mark == std::string::npos) {
+            return true;
+        }
+
+        const std::string query = target.substr(mark + 1);
+        size_t start = 0;
+        while (start <= query.size()) {
+            size_t end = query.find('&', start);
+            if (end == std::string::npos) {
+                end = query.size();
+            }
+            const std::string parameter = query.substr(start, end - start);
+            if (!parameter.empty()) {
+                const size_t equals = parameter.find('=');
+                std::string name = parameter.substr(0, equals);
+                std::string value = equals == std::string::npos ? "" : parameter.substr(equals + 1);
+                std::replace(name.begin(), name.end(), '+', ' ');
+                std::replace(value.begin(), value.end(), '+', ' ');
+                request.query[urlDecode(name)] = urlDecode(value);
+            }
+            start = end + 1;
+        }
+    } catch (const std::invalid_argument &) {
+        return false;
+    }
+    return true;
+}
+
+/*
+  Decode %XX escapes in part of a URL.
+
+  @param text
+    The encoded text
+
+  @return
+    The decoded text
+
+  @throws
+    std::invalid_argument if an escape is incomplete or not hexadecimal
+*/
+std::string HttpServer::urlDecode(const std::string &text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '%') {
+            decoded += text[i];
+            continue;
+        }
+        if (i + 2 >= text.size() || !::isxdigit((unsigned char) text[i + 1])
+            || !::isxdigit((unsigned char) text[i + 2])) {
+            throw std::invalid_argument("Invalid escape in URL");
+        }
+        decoded += (char) std::stoi(text.substr(i + 1, 2), nullptr, 16);
+        i += 2;
+    }
+    return decoded;
+}
+
+/*
+  Retrieve the reason phrase for a status code.
+
+  @param status
+    The status code
+
+  @return
+    The reason phrase, e.g. "Not Found"
+*/
+std::string HttpServer::statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 505: return "HTTP Version Not Supported";
+        default:  return "Unknown";
+    }
+}
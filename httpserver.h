@@ -0,0 +1,80 @@
+#ifndef HTTPSERVER_H_
+#define HTTPSERVER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the HttpServer class, a small
+  HTTP/1.1 server for answering queries over data held in memory (see --http
+  in bethyw.cpp).
+
+  One thread runs an epoll event loop that accepts connections and reads and
+  writes them without blocking; each complete request is handed to a pool of
+  worker threads, and the response is passed back to the event loop to send.
+  Connections are kept alive between requests (unless the client asks
+  otherwise), and pipelined requests are answered in order.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+/*
+  A parsed request. The path and the query parameters are URL-decoded.
+*/
+struct HttpRequest {
+  std::string method;
+  std::string path;
+  std::map<std::string, std::string> query;
+};
+
+/*
+  A response to send, with the length and connection headers filled in by
+  the server.
+*/
+struct HttpResponse {
+  int status;
+  std::string contentType;
+  std::string body;
+};
+
+/*
+  A function that answers a request. It is called from the worker threads,
+  several at once, so must only read shared data.
+*/
+using HttpHandler = std::function<HttpResponse(const HttpRequest &request)>;
+
+/*
+  An HttpServer listens on a loopback TCP port from when it is constructed
+  until it is destroyed.
+*/
+class HttpServer {
+public:
+  HttpServer(uint16_t port, unsigned int workers);
+  HttpServer(const HttpServer &) = delete;
+  HttpServer &operator=(const HttpServer &) = delete;
+  ~HttpServer();
+
+  uint16_t getPort() const;
+  void serve(const HttpHandler &handler);
+  void stop();
+
+  static bool parseTarget(const std::string &target, HttpRequest &request);
+  static std::string urlDecode(const std::string &text);
+  static std::string statusText(int status);
+
+private:
+  int listener;
+  int wakeup;
+  uint16_t port;
+  unsigned int workers;
+  std::atomic<bool> stopping;
+};
+
+#endif // HTTPSERVER_H_
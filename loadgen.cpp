@@ -0,0 +1,265 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  A load generator for the HTTP server (bethyw --http). It opens a number of
+  keep-alive connections to the server, each on its own thread, sends GET
+  requests for the given paths in turn until the requested total has been
+  sent, and prints the throughput and the latency percentiles.
+
+  Build with ./build.sh loadgen, then e.g.:
+
+    bin/bethyw --http 8080 &
+    bin/bethyw-loadgen --port 8080 --connections 16 --requests 20000 \
+      --path '/areas/W06000011?measures=pop' --path '/areas?format=csv'
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "lib_cxxopts.hpp"
+
+namespace {
+
+/*
+  The results of one connection's requests.
+*/
+struct ConnectionResult {
+  std::vector<double> latencies;
+  size_t errors = 0;
+  size_t bytes = 0;
+};
+
+int connectTo(const std::string &host, uint16_t port) {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid host: " + host);
+    }
+
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, (const sockaddr *) &address, sizeof(address)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+/*
+  Read one response from a connection, returning its status code, or 0 if
+  the connection failed. Any bytes read past the end of the response are left
+  in buffer.
+*/
+int readResponse(int fd, std::string &buffer, size_t &bytes) {
+    char chunk[65536];
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return 0;
+        }
+        buffer.append(chunk, (size_t) received);
+    }
+
+    int status = 0;
+    if (buffer.compare(0, 9, "HTTP/1.1 ") == 0 || buffer.compare(0, 9, "HTTP/1.0 ") == 0) {
+        status = std::atoi(buffer.c_str() + 9);
+    }
+
+    size_t length = 0;
+    std::string header = buffer.substr(0, headerEnd);
+    std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+    const size_t field = header.find("\r\ncontent-length:");
+    if (field != std::string::npos) {
+        length = std::strtoul(header.c_str() + field + 17, nullptr, 10);
+    }
+
+    const size_t total = headerEnd + 4 + length;
+    while (buffer.size() < total) {
+        const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return 0;
+        }
+        buffer.append(chunk, (size_t) received);
+    }
+    buffer.erase(0, total);
+    bytes += total;
+    return status;
+}
+
+void runConnection(const std::string &host,
+                   uint16_t port,
+                   const std::vector<std::string> &paths,
+                   std::atomic<size_t> &remaining,
+                   ConnectionResult &result) {
+    int fd = -1;
+    std::string buffer;
+    size_t sent = 0;
+
+    while (true) {
+        // Claim the next request, if there are any left
+        size_t left = remaining.load();
+        do {
+            if (left == 0) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                return;
+            }
+        } while (!remaining.compare_exchange_weak(left, left - 1));
+
+        if (fd < 0) {
+            fd = connectTo(host, port);
+            buffer.clear();
+            if (fd < 0) {
+                result.errors++;
+                continue;
+            }
+        }
+
+        const std::string &path = paths[sent++ % paths.size()];
+        const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host
+                                    + "\r\nConnection: keep-alive\r\n\r\n";
+
+        const auto start = std::chrono::steady_clock::now();
+        int status = 0;
+        if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t) request.size()) {
+            status = readResponse(fd, buffer, result.bytes);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        if (status == 0) {
+            // The connection failed; open a new one for the next request
+            ::close(fd);
+            fd = -1;
+            result.errors++;
+        } else if (status != 200) {
+            result.errors++;
+        } else {
+            result.latencies.push_back(
+                std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const size_t index = (size_t) (p / 100 * (double) (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cxxopts::Options cxxopts("bethyw-loadgen",
+                             "Send GET requests to a Beth Yw? HTTP server (bethyw --http) "
+                             "and report the throughput and latency.\n");
+    cxxopts.add_options()(
+        "host",
+        "The IPv4 address of the server",
+        cxxopts::value<std::string>()->default_value("127.0.0.1"))(
+
+        "p,port",
+        "The port of the server",
+        cxxopts::value<unsigned int>())(
+
+        "c,connections",
+        "The number of keep-alive connections to send requests on at once",
+        cxxopts::value<unsigned int>()->default_value("8"))(
+
+        "n,requests",
+        "The total number of requests to send",
+        cxxopts::value<size_t>()->default_value("10000"))(
+
+        "path",
+        "A path to request (may be given several times; they are requested "
+        "in turn)",
+        cxxopts::value<std::vector<std::string>>())(
+
+        "h,help",
+        "Print usage.");
+
+    try {
+        auto args = cxxopts.parse(argc, argv);
+        if (args.count("help") || !args.count("port")) {
+            std::cerr << cxxopts.help() << std::endl;
+            return args.count("help") ? 0 : 1;
+        }
+
+        const std::string host = args["host"].as<std::string>();
+        const unsigned int port = args["port"].as<unsigned int>();
+        const unsigned int connections = args["connections"].as<unsigned int>();
+        const size_t requests = args["requests"].as<size_t>();
+        std::vector<std::string> paths = {"/areas"};
+        if (args.count("path")) {
+            paths = args["path"].as<std::vector<std::string>>();
+        }
+        if (port == 0 || port > 65535 || connections == 0) {
+            throw std::invalid_argument("The port and connections must be positive");
+        }
+
+        std::atomic<size_t> remaining(requests);
+        std::vector<ConnectionResult> results(connections);
+        std::vector<std::thread> threads;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < connections; i++) {
+            threads.emplace_back(runConnection, std::cref(host), (uint16_t) port,
+                                 std::cref(paths), std::ref(remaining), std::ref(results[i]));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::vector<double> latencies;
+        size_t errors = 0, bytes = 0;
+        for (const auto &result : results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            errors += result.errors;
+            bytes += result.bytes;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "Requests:    " << latencies.size() << " ok, " << errors << " failed\n"
+                  << "Duration:    " << seconds << " s\n"
+                  << "Throughput:  " << (double) latencies.size() / seconds << " requests/s, "
+                  << (double) bytes / seconds / (1024 * 1024) << " MB/s\n"
+                  << "Latency:     p50 " << percentile(latencies, 50)
+                  << " ms, p90 " << percentile(latencies, 90)
+                  << " ms, p99 " << percentile(latencies, 99)
+                  << " ms, max " << percentile(latencies, 100) << " ms" << std::endl;
+
+        return errors == 0 ? 0 : 2;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -18,13 +18,14 @@
   must implement has a TODO block comment. 
 */
 
+#include <cmath>
 #include <stdexcept>
 #include <string>
 #include <algorithm>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
 #include <utility>
+#include <vector>
 
 #include "measure.h"
 
@@ -53,6 +54,51 @@ Measure::Measure(std::string codename, std::string label) {
     this->label = std::move(label);
 }
 
+/*
+  Copy or move a Measure. The copy is not held by any Areas until it is
+  stored in one (see Area::setMeasure()), so it does not count towards the
+  changes of the Areas the original is held by. Assigning to a Measure
+  counts as a change to it.
+
+  @param other
+    The Measure to copy or move
+*/
+Measure::Measure(const Measure &other)
+    : label(other.label), codename(other.codename), values(other.values) {}
+
+Measure::Measure(Measure &&other) noexcept
+    : label(std::move(other.label)), codename(std::move(other.codename)),
+      values(std::move(other.values)) {
+    other.changed();
+}
+
+Measure &Measure::operator=(const Measure &other) {
+    this->label = other.label;
+    this->codename = other.codename;
+    this->values = other.values;
+    changed();
+    return *this;
+}
+
+Measure &Measure::operator=(Measure &&other) noexcept {
+    this->label = std::move(other.label);
+    this->codename = std::move(other.codename);
+    this->values = std::move(other.values);
+    other.changed();
+    changed();
+    return *this;
+}
+
+/*
+  Count a change to the Measure towards the Areas holding it, so indexes the
+  Areas built over its values are rebuilt (see Areas::buildIndexes()).
+*/
+void Measure::changed() {
+    if (this->changes != nullptr) {
+        (*this->changes)++;
+    }
+}
+
 
 /*
   TODO: Measure::getCodename()
@@ -74,6 +120,11 @@ Measure::Measure(std::string codename, std::string label) {
     auto codename2 = measure.getCodename();
 */
 std::string & Measure::getCodename() {
+    changed(); // the caller may change it
+    return this->codename;
+}
+
+const std::string & Measure::getCodename() const {
     return this->codename;
 }
 
@@ -100,6 +151,11 @@ std::string & Measure::getCodename() {
     auto label = measure.getLabel();
 */
 std::string & Measure::getLabel() {
+    changed(); // the caller may change it
+    return this->label;
+}
+
+const std::string & Measure::getLabel() const {
     return this->label;
 }
 
@@ -120,6 +176,7 @@ std::string & Measure::getLabel() {
     measure.setLabel("New Population");
 */
 void Measure::setLabel(std::string label) {
+    changed();
     this->label = std::move(label);
 }
 
@@ -182,6 +239,7 @@ double Measure::getValue(const unsigned int key) {
     measure.setValue(1999, 12345678.9);
 */
 void Measure::setValue(const unsigned int key, const double value) {
+    changed();
     if (this->values.find(key) != this->values.end()) {
         //exists
         this->values.at(key) = value;
@@ -210,7 +268,7 @@ void Measure::setValue(const unsigned int key, const double value) {
     measure.setValue(1999, 12345678.9);
     auto size = measure.size(); // returns 1
 */
-unsigned int Measure::size() {
+size_t Measure::size() const {
     return this->values.size();
 }
 
@@ -232,7 +290,10 @@ unsigned int Measure::size() {
     measure.setValue(2001, 12345679.9);
     auto diff = measure.getDifference(); // returns 1.0
 */
-double Measure::getDifference() {
+double Measure::getDifference() const {
+    if (this->values.empty()) {
+        return 0.0;
+    }
     return getValues().rbegin()->second - getValues().begin()->second;
 }
 
@@ -254,7 +315,10 @@ double Measure::getDifference() {
     measure.setValue(2010, 12345679.9);
     auto diff = measure.getDifferenceAsPercentage();
 */
-double Measure::getDifferenceAsPercentage() {
+double Measure::getDifferenceAsPercentage() const {
+    if (this->values.empty()) {
+        return 0.0;
+    }
     double maxVal = getValues().rbegin()->second;
     double minVal = getValues().begin()->second;
     return (maxVal-minVal)/minVal*100;
@@ -278,7 +342,7 @@ double Measure::getDifferenceAsPercentage() {
     auto diff = measure.getAverage(); // returns 12345678.4
 */
 
-double Measure::getAverage() {
+double Measure::getAverage() const {
     double total = 0;
     for (auto & value : getValues())
     {
@@ -292,6 +356,72 @@ double Measure::getAverage() {
 
 
 
+/*
+  Measure::fillGaps(mode)
+
+  Materialise a value for every year between the first and last year of the
+  Measure that does not already have one, e.g. the complete-popu1009 tables
+  jump from 1991 to 2001 to 2011. Existing values are never changed.
+
+  The series is copied into flat arrays and the whole year grid is computed
+  in one pass, each gap being a tight loop over consecutive years that the
+  compiler can vectorise, before the new values are appended back in order.
+
+  @param mode
+    How to fill the gaps (see GapFillMode)
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1991, 100);
+    measure.setValue(2001, 200);
+    measure.fillGaps(GapFillLinear);
+    auto value = measure.getValue(1996); // returns 150
+*/
+void Measure::fillGaps(GapFillMode mode) {
+    if (mode == GapFillNone || this->values.size() < 2) {
+        return;
+    }
+
+    const unsigned int first = this->values.begin()->first;
+    const unsigned int last = this->values.rbegin()->first;
+    if (last - first + 1 == this->values.size()) {
+        return; // already contiguous
+    }
+
+    std::vector<unsigned int> years;
+    std::vector<double> known;
+    years.reserve(this->values.size());
+    known.reserve(this->values.size());
+    for (const auto &value : this->values) {
+        years.push_back(value.first);
+        known.push_back(value.second);
+    }
+
+    std::vector<double> grid(last - first + 1);
+    for (size_t i = 0; i + 1 < years.size(); i++) {
+        const size_t from = years[i] - first;
+        const size_t to = years[i + 1] - first;
+        const double start = known[i];
+        const double step = mode == GapFillLinear
+                ? (known[i + 1] - known[i]) / (double) (to - from)
+                : 0.0;
+        double *out = grid.data();
+        for (size_t y = from; y < to; y++) {
+            out[y] = start + step * (double) (y - from);
+        }
+    }
+
+    changed();
+    //years are visited in order, so each insert goes straight to the end
+    auto hint = this->values.begin();
+    for (size_t i = 0; i + 1 < years.size(); i++) {
+        for (unsigned int year = years[i] + 1; year < years[i + 1]; year++) {
+            hint = this->values.emplace_hint(std::next(hint), year, grid[year - first]);
+        }
+        hint = this->values.find(years[i + 1]);
+    }
+}
+
 /*
   TODO: operator<<(os, measure)
 
@@ -329,57 +459,214 @@ double Measure::getAverage() {
     std::cout << measure << std::end;
 */
 
-std::ostream &operator<<(std::ostream &os, Measure &measure) {
-    //label and codename
-    os << measure.getLabel() << " (" << measure.getCodename() << ")" << std::endl;
-
-    //get max length of a measure value
-    //This ensures that if the number of decimal places for the values changes at a
-    //later date the column headers will still align
-    int maxLength = std::to_string(measure.getValues().begin()->second).size();
-    for (auto elem : measure.getValues()) {
-        int curLength = std::to_string(elem.second).size();
-        if (curLength > maxLength) {
-            maxLength = curLength;
-        }
+std::ostream &operator<<(std::ostream &os, const Measure &measure) {
+    OutputBuffer out(os);
+    measure.toTable(out);
+    return os;
+}
+
+/*
+  Measure::toTable(out)
+
+  Write the Measure to an OutputBuffer as a table, in the format described
+  for operator<< above: the label and codename, then a row of years (and the
+  Average, Diff. and % Diff. column headings), then a row of values, and
+  finally a blank line.
+
+  Each heading is right-aligned to the width of the value beneath it. The
+  values are formatted once, into a scratch buffer, in the same pass that
+  calculates the average and differences, and the widths are taken from
+  there, so no value is ever formatted twice.
+
+  @param out
+    The OutputBuffer to write to
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+
+    OutputBuffer out(std::cout);
+    measure.toTable(out);
+*/
+void Measure::toTable(OutputBuffer &out) const {
+    out.append(this->label);
+    out.append(" (", 2);
+    out.append(this->codename);
+    out.append(") \n", 3);
+
+    if (this->values.empty()) {
+        out.append("<no data>\n\n", 11);
+        return;
     }
 
-    //column names
-    for (auto code : measure.getValues()) {
-        os << measure.alignValue(code.first, maxLength);
+    //each value (and the three summary columns) followed by a space; only
+    //the width of each column is kept, since the row is written as a whole
+    OutputBuffer row;
+    std::vector<size_t> widths;
+    widths.reserve(this->values.size() + 3);
+
+    double total = 0;
+    for (const auto &value : this->values) {
+        total += value.second;
+        widths.push_back(row.appendFixed6(value.second));
+        row.append(' ');
     }
-    os << measure.alignValue("Average", maxLength)
-    << measure.alignValue("Diff.", maxLength)
-    << measure.alignValue("% Diff.", maxLength) << std::endl;
 
-    //values
-    if (measure.getValues().empty()) {
-        return os << "<no data>" << std::endl;
+    //the same arithmetic as getAverage(), getDifference() and
+    //getDifferenceAsPercentage(), so the output is identical
+    const double first = this->values.begin()->second;
+    const double last = this->values.rbegin()->second;
+    const double average = total != 0 ? total / this->values.size() : 0.0;
+    const double summary[3] = {average, last - first, (last - first) / first * 100};
+    for (double value : summary) {
+        widths.push_back(row.appendFixed6(value));
+        row.append(' ');
     }
-    for (auto value : measure.getValues()) {
-        os << std::fixed << std::setprecision(6)<< value.second << ' ';
+
+    size_t column = 0;
+    char year[10];
+    for (const auto &value : this->values) {
+        size_t length = 0;
+        for (unsigned int y = value.first; length == 0 || y != 0; y /= 10) {
+            year[sizeof(year) - ++length] = (char) ('0' + y % 10);
+        }
+        if (widths[column] > length) {
+            out.appendPadding(widths[column] - length);
+        }
+        out.append(year + sizeof(year) - length, length);
+        out.append(' ');
+        column++;
     }
-    return os << measure.getAverage() << ' '
-    << measure.getDifference() << ' '
-    << measure.getDifferenceAsPercentage() << std::endl;
 
+    static const std::string HEADINGS[3] = {"Average", "Diff.", "% Diff."};
+    for (const auto &heading : HEADINGS) {
+        if (widths[column] > heading.size()) {
+            out.appendPadding(widths[column] - heading.size());
+        }
+        out.append(heading);
+        out.append(' ');
+        column++;
+    }
+    out.append('\n');
+
+    out.append(row.str());
+    out.append("\n\n", 2);
 }
 
-/**
- * This will return a padded and aligned value for the ostream.
- *
- * @param t - the value to align & pad
- * @param width - The maximum length of a column
- * @return - std::string aligned right and padded
- */
-template<typename T>
-std::string Measure::alignValue(T t, const int &width) {
-    std::stringstream stream;
-    stream << std::right << std::setw(width) << std::setfill(' ') << t;
-    return stream.str();
+/*
+  Measure::toJSON(out)
+
+  Write the Measure's values to an OutputBuffer as a JSON object of years
+  (as strings) to values, e.g. {"1991":711.6801,"1992":711.6801}. The years
+  are written in the same (string) order that nlohmann::json would use.
+
+  @param out
+    The OutputBuffer to write to
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+
+    OutputBuffer out(std::cout);
+    measure.toJSON(out);
+*/
+void Measure::toJSON(OutputBuffer &out) const {
+    out.append('{');
+
+    bool first = true;
+    auto writeValue = [&out, &first](unsigned int year, double value) {
+        if (!first) {
+            out.append(',');
+        }
+        first = false;
+        out.append('"');
+        out.appendUnsigned(year);
+        out.append("\":", 2);
+        out.appendJSONNumber(value);
+    };
+
+    //years with the same number of digits sort the same as numbers or strings
+    if (this->values.empty()
+        || std::to_string(this->values.begin()->first).size()
+           == std::to_string(this->values.rbegin()->first).size()) {
+        for (const auto &value : this->values) {
+            writeValue(value.first, value.second);
+        }
+    } else {
+        std::map<std::string, std::pair<unsigned int, double>> byString;
+        for (const auto &value : this->values) {
+            byString.emplace(std::to_string(value.first), value);
+        }
+        for (const auto &value : byString) {
+            writeValue(value.second.first, value.second.second);
+        }
+    }
+
+    out.append('}');
 }
 
+/*
+  Measure::toDelimited(out, prefix, delimiter, stats)
+
+  Write the Measure to an OutputBuffer as delimited (CSV or TSV) rows, one
+  per year: the prefix (the columns of the Area it belongs to), the codename,
+  label, year and value, and optionally the average, difference and
+  percentage difference of the Measure, repeated on every row. Values that
+  cannot be calculated (e.g. a percentage difference from 0) are left empty.
+
+  @param out
+    The OutputBuffer to write to
 
+  @param prefix
+    Text to start every row with, including its trailing delimiter
+
+  @param delimiter
+    The character that separates fields
+
+  @param stats
+    Whether to include the average and difference columns
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+
+    OutputBuffer out(std::cout);
+    measure.toDelimited(out, "W06000023,Powys,Powys,", ',', true);
+*/
+void Measure::toDelimited(OutputBuffer &out,
+                          const std::string &prefix,
+                          char delimiter,
+                          bool stats) const {
+    auto appendNumber = [&out](double value) {
+        if (std::isfinite(value)) {
+            out.appendJSONNumber(value);
+        }
+    };
+
+    //everything up to the year is the same on every row
+    OutputBuffer start;
+    start.append(prefix);
+    start.appendDelimitedField(this->codename, delimiter);
+    start.append(delimiter);
+    start.appendDelimitedField(this->label, delimiter);
+    start.append(delimiter);
+
+    const double summary[3] = {getAverage(), getDifference(), getDifferenceAsPercentage()};
+
+    for (const auto &value : this->values) {
+        out.append(start.str());
+        out.appendUnsigned(value.first);
+        out.append(delimiter);
+        appendNumber(value.second);
+        if (stats) {
+            for (double statistic : summary) {
+                out.append(delimiter);
+                appendNumber(statistic);
+            }
+        }
+        out.append('\n');
+    }
+}
 
 /*
   TODO: operator==(lhs, rhs)
@@ -410,7 +697,7 @@ bool operator==(const Measure& lhs, const Measure& rhs) {
  * @return
  *  A std::map object containing all the values with their corresponding year
  */
-std::map<unsigned int, double> Measure::getValues() {
+const std::map<unsigned int, double> & Measure::getValues() const {
     return this->values;
 }
 
@@ -14,9 +14,26 @@
   functions and member variables you need to declare in this class.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <map>
 
+#include "outputbuffer.h"
+
+/*
+  The ways in which the missing years between the first and last year of a
+  Measure can be filled in:
+    GapFillNone   — leave the gaps as they are
+    GapFillLinear — interpolate linearly between the surrounding years
+    GapFillStep   — carry the value of the previous year forward
+*/
+enum GapFillMode {
+  GapFillNone,
+  GapFillLinear,
+  GapFillStep
+};
+
 /*
   The Measure class contains a measure code, label, and a container for readings
   from across a number of years.
@@ -28,26 +45,41 @@
 class Measure {
 public:
   Measure(std::string code, std::string label);
+  Measure(const Measure &other);
+  Measure(Measure &&other) noexcept;
+  Measure &operator=(const Measure &other);
+  Measure &operator=(Measure &&other) noexcept;
 
 
   std::string& getCodename();
+  const std::string& getCodename() const;
   std::string& getLabel();
+  const std::string& getLabel() const;
   void setLabel(std::string label);
   double getValue(unsigned int key);
   void setValue(unsigned int key, double value);
-  unsigned int size();
-  double getDifference();
-  double getDifferenceAsPercentage();
-  double getAverage();
-  std::map<unsigned int, double> getValues();
-  template<typename T> std::string alignValue(T t, const int& width);
+  size_t size() const;
+  double getDifference() const;
+  double getDifferenceAsPercentage() const;
+  double getAverage() const;
+  void fillGaps(GapFillMode mode);
+  const std::map<unsigned int, double>& getValues() const;
+  void toJSON(OutputBuffer &out) const;
+  void toTable(OutputBuffer &out) const;
+  void toDelimited(OutputBuffer &out, const std::string &prefix, char delimiter, bool stats) const;
   friend bool operator==(const Measure& lhs, const Measure& rhs);
-  friend std::ostream &operator<<(std::ostream &os, Measure& measure);
+  friend std::ostream &operator<<(std::ostream &os, const Measure& measure);
 
 private:
     std::string label;
     std::string codename;
     std::map<unsigned int, double> values;
+
+    // The change counter of the Areas holding this Measure, if any
+    uint64_t *changes = nullptr;
+    void changed();
+
+    friend class Area;
 };
 
 #endif // MEASURE_H_
\ No newline at end of file
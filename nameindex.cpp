@@ -0,0 +1,352 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the NameIndex class.
+*/
+
+#include <algorithm>
+#include <cctype>
+
+#include "nameindex.h"
+
+namespace {
+
+/*
+  The unaccented lowercase letter for each code point from U+00C0 to U+017F,
+  or ? to leave the character as it is.
+*/
+const char LATIN1_FOLDS[] =
+    "aaaaaa?ceeeeiiii?nooooo??uuuuy??aaaaaa?ceeeeiiii?nooooo??uuuuy?y";
+const char LATIN_EXTENDED_A_FOLDS[] =
+    "aaaaaaccccccccdd??eeeeeeeeeegggggggghh??iiiiiiiii???jjkk?llllll????"
+    "nnnnnn???oooooo??rrrrrrsssssssstttt??uuuuuuuuuuuuwwyyyzzzzzz?";
+static_assert(sizeof(LATIN1_FOLDS) == 0x40 + 1, "one fold per code point");
+static_assert(sizeof(LATIN_EXTENDED_A_FOLDS) == 0x80 + 1, "one fold per code point");
+
+/*
+  Fold a UTF-8 encoded code point starting at text[i], appending the folded
+  letter to out and moving i past it, if it is an accented Latin letter.
+*/
+bool foldAccent(const std::string &text, size_t &i, std::string &out) {
+    const unsigned char lead = (unsigned char) text[i];
+    if ((lead & 0xE0) == 0xC0 && i + 1 < text.size()) {
+        const unsigned int point = ((lead & 0x1Fu) << 6) | ((unsigned char) text[i + 1] & 0x3Fu);
+        char folded = '?';
+        if (point >= 0xC0 && point < 0x100) {
+            folded = LATIN1_FOLDS[point - 0xC0];
+        } else if (point >= 0x100 && point < 0x180) {
+            folded = LATIN_EXTENDED_A_FOLDS[point - 0x100];
+        }
+        if (folded != '?') {
+            out += folded;
+            i += 2;
+            return true;
+        }
+    } else if (lead == 0xE1 && i + 2 < text.size()) {
+        // The Welsh ẁ, ẃ, ẅ and ỳ (and their capitals)
+        const unsigned int point = ((lead & 0x0Fu) << 12)
+                                   | (((unsigned char) text[i + 1] & 0x3Fu) << 6)
+                                   | ((unsigned char) text[i + 2] & 0x3Fu);
+        if (point >= 0x1E80 && point <= 0x1E85) {
+            out += 'w';
+            i += 3;
+            return true;
+        } else if (point == 0x1EF2 || point == 0x1EF3) {
+            out += 'y';
+            i += 3;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  The edit (Levenshtein) distance between the folded name being looked up
+  and each prefix in the trie is worked out a row at a time, one row per
+  character, as the trie is walked.
+*/
+using DistanceRow = std::vector<unsigned int>;
+
+} // namespace
+
+/*
+  Construct a NameIndex over the codes and names of some areas.
+
+  @param areas
+    The areas, e.g. those imported from areas.csv
+
+  @example
+    Areas areas = Areas();
+    BethYw::loadAreas(areas, dir, noFilter);
+    NameIndex names(areas);
+    names.withPrefix("vale of"); // {"W06000014"}
+*/
+NameIndex::NameIndex(const Areas &areas) : nodes(1) {
+    for (const auto &entry : areas.getAreasContainer()) {
+        const uint32_t area = (uint32_t) codes.size();
+        codes.push_back(entry.first);
+        exact.insert(entry.first);
+        insert(entry.first, area, false);
+        for (const auto &name : entry.second.getNames()) {
+            exact.insert(name.second);
+            insert(name.second, area, true);
+        }
+    }
+}
+
+/*
+  Fold a code or name for comparison: lowercase ASCII letters, remove the
+  accents from Latin letters, and trim and collapse spaces.
+
+  @param text
+    The UTF-8 encoded code or name
+
+  @return
+    The folded text
+
+  @example
+    NameIndex::fold("Ynys  Môn"); // "ynys mon"
+*/
+std::string NameIndex::fold(const std::string &text) {
+    std::string folded;
+    folded.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        const unsigned char c = (unsigned char) text[i];
+        if (std::isspace(c)) {
+            if (!folded.empty() && folded.back() != ' ') {
+                folded += ' ';
+            }
+            i++;
+        } else if (c < 0x80) {
+            folded += (char) std::tolower(c);
+            i++;
+        } else if (!foldAccent(text, i, folded)) {
+            folded += text[i];
+            i++;
+        }
+    }
+    if (!folded.empty() && folded.back() == ' ') {
+        folded.pop_back();
+    }
+    return folded;
+}
+
+/*
+  Add a code or name to the trie.
+*/
+void NameIndex::insert(const std::string &text, uint32_t area, bool isName) {
+    uint32_t node = 0;
+    for (char c : fold(text)) {
+        auto &children = nodes[node].children;
+        auto child = std::lower_bound(children.begin(), children.end(), std::make_pair(c, (uint32_t) 0));
+        if (child == children.end() || child->first != c) {
+            const uint32_t added = (uint32_t) nodes.size();
+            children.insert(child, std::make_pair(c, added));
+            nodes.emplace_back();
+            node = added;
+        } else {
+            node = child->second;
+        }
+    }
+    auto &found = isName ? nodes[node].byName : nodes[node].byCode;
+    if (std::find(found.begin(), found.end(), area) == found.end()) {
+        found.push_back(area);
+    }
+}
+
+/*
+  Find the node for some folded text, or -1 if no code or name starts with
+  it.
+*/
+int NameIndex::find(const std::string &folded) const {
+    uint32_t node = 0;
+    for (char c : folded) {
+        const auto &children = nodes[node].children;
+        auto child = std::lower_bound(children.begin(), children.end(), std::make_pair(c, (uint32_t) 0));
+        if (child == children.end() || child->first != c) {
+            return -1;
+        }
+        node = child->second;
+    }
+    return (int) node;
+}
+
+/*
+  Add every area with a code or name at or below a node.
+*/
+void NameIndex::collect(uint32_t node, std::vector<uint32_t> &found) const {
+    found.insert(found.end(), nodes[node].byCode.begin(), nodes[node].byCode.end());
+    found.insert(found.end(), nodes[node].byName.begin(), nodes[node].byName.end());
+    for (const auto &child : nodes[node].children) {
+        collect(child.second, found);
+    }
+}
+
+/*
+  The codes of some areas, sorted and without repeats.
+*/
+std::vector<std::string> NameIndex::codesOf(std::vector<uint32_t> found) const {
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    std::vector<std::string> result;
+    for (uint32_t area : found) {
+        result.push_back(codes[area]);
+    }
+    return result;
+}
+
+/*
+  Find the areas with a code or name equal to some text once both are
+  folded.
+
+  @param name
+    The code or name
+
+  @return
+    The codes of the areas, in order
+
+  @example
+    names.lookup("ynys mon"); // {"W06000001"}
+*/
+std::vector<std::string> NameIndex::lookup(const std::string &name) const {
+    const int node = find(fold(name));
+    if (node < 0) {
+        return {};
+    }
+    std::vector<uint32_t> found = nodes[node].byCode;
+    found.insert(found.end(), nodes[node].byName.begin(), nodes[node].byName.end());
+    return codesOf(found);
+}
+
+/*
+  Find the areas with a code or name that starts with some text once both
+  are folded.
+
+  @param prefix
+    The start of the code or name
+
+  @return
+    The codes of the areas, in order
+
+  @example
+    names.withPrefix("Vale of"); // {"W06000014"}
+*/
+std::vector<std::string> NameIndex::withPrefix(const std::string &prefix) const {
+    const int node = find(fold(prefix));
+    if (node < 0) {
+        return {};
+    }
+    std::vector<uint32_t> found;
+    collect((uint32_t) node, found);
+    return codesOf(found);
+}
+
+/*
+  Find the areas with the names closest to some text, once both are folded,
+  by edit distance. Codes are not considered.
+
+  @param name
+    The name, e.g. with a typing mistake
+
+  @param maxDistance
+    The most edits (insertions, deletions or substitutions) a name may be
+    from the text
+
+  @return
+    The codes of the areas with a name the fewest edits away, up to
+    maxDistance, in order
+
+  @example
+    names.closest("Cardif", 1); // {"W06000015"}
+*/
+std::vector<std::string> NameIndex::closest(const std::string &name,
+                                            unsigned int maxDistance) const {
+    const std::string folded = fold(name);
+    unsigned int best = maxDistance + 1;
+    std::vector<uint32_t> found;
+
+    // Walk the trie depth first, pruning any branch where every prefix of
+    // the text is already too far away
+    DistanceRow first(folded.size() + 1);
+    for (size_t i = 0; i <= folded.size(); i++) {
+        first[i] = (unsigned int) i;
+    }
+    std::vector<std::pair<uint32_t, DistanceRow>> stack = {{0, first}};
+    while (!stack.empty()) {
+        const uint32_t node = stack.back().first;
+        const DistanceRow row = std::move(stack.back().second);
+        stack.pop_back();
+
+        const unsigned int distance = row.back();
+        if (!nodes[node].byName.empty() && distance <= best) {
+            if (distance < best) {
+                best = distance;
+                found.clear();
+            }
+            found.insert(found.end(), nodes[node].byName.begin(), nodes[node].byName.end());
+        }
+
+        for (const auto &child : nodes[node].children) {
+            DistanceRow next(row.size());
+            next[0] = row[0] + 1;
+            unsigned int lowest = next[0];
+            for (size_t i = 1; i < row.size(); i++) {
+                const unsigned int substitute = row[i - 1] + (folded[i - 1] == child.first ? 0 : 1);
+                next[i] = std::min({row[i] + 1, next[i - 1] + 1, substitute});
+                lowest = std::min(lowest, next[i]);
+            }
+            if (lowest <= best && lowest <= maxDistance) {
+                stack.emplace_back(child.second, std::move(next));
+            }
+        }
+    }
+    return codesOf(found);
+}
+
+/*
+  Replace the entries of an areas filter that are prefixes (ending in *),
+  or names with different case, accents or spacing, or with small mistakes,
+  with the codes of the areas they match (see the class comment). Entries
+  that are exactly a code or name are kept along with the codes they match,
+  and entries that match nothing are kept as they are.
+
+  @param areasFilter
+    The areas filter, as given by BethYw::parseAreasArg()
+
+  @example
+    auto areasFilter = BethYw::parseAreasArg(args); // {"Vale of*", "Swansea"}
+    names.resolve(areasFilter);    // {"W06000014", "W06000011", "Swansea"}
+*/
+void NameIndex::resolve(StringFilterSet &areasFilter) const {
+    StringFilterSet resolved;
+    for (const auto &entry : areasFilter) {
+        std::vector<std::string> matched;
+        if (!entry.empty() && entry.back() == '*') {
+            matched = withPrefix(entry.substr(0, entry.size() - 1));
+        } else if (exact.find(entry) != exact.end()) {
+            // Keep an exact name alongside its codes, as the CSV datasets
+            // only match codes
+            matched = lookup(entry);
+            matched.push_back(entry);
+        } else {
+            matched = lookup(entry);
+            const size_t length = fold(entry).size();
+            if (matched.empty() && length >= 4
+                && entry.find_first_of("0123456789") == std::string::npos) {
+                matched = closest(entry, length <= 7 ? 1 : 2);
+            }
+        }
+
+        if (matched.empty()) {
+            resolved.insert(entry);
+        } else {
+            resolved.insert(matched.begin(), matched.end());
+        }
+    }
+    areasFilter = std::move(resolved);
+}
@@ -0,0 +1,74 @@
+#ifndef NAMEINDEX_H_
+#define NAMEINDEX_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the NameIndex class, which resolves
+  the areas argument (e.g. -a "Vale of*" or -a "Ynys Mon") to authority
+  codes before any dataset is parsed.
+ */
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A NameIndex is a trie over the authority codes and the names (in every
+  language) of a set of areas, e.g. those imported from areas.csv. Both are
+  folded first: ASCII letters are lowercased, accented Latin letters (such
+  as the â and ŵ of Welsh names) lose their accents, and runs of spaces
+  become one, so "ynys mon" finds "Ynys Môn".
+
+  An entry of the areas filter is resolved by resolve() as follows:
+
+  - an entry ending in * matches every area with a code or name that starts
+    with the rest, folded;
+  - an entry that is exactly a code or name is kept, along with the codes
+    of the areas it names, so a name selects the same values as its code
+    in every dataset (the CSV datasets only match codes);
+  - otherwise an entry matches the areas with a code or name equal to it
+    once folded, or failing that (if it has at least four characters and no
+    digits, so is not meant as a code) the areas whose names are closest to
+    it within a small edit distance (one edit for up to seven characters,
+    two for longer).
+
+  An entry that matches nothing is left as it is.
+*/
+class NameIndex {
+public:
+  explicit NameIndex(const Areas &areas);
+
+  static std::string fold(const std::string &text);
+
+  std::vector<std::string> lookup(const std::string &name) const;
+  std::vector<std::string> withPrefix(const std::string &prefix) const;
+  std::vector<std::string> closest(const std::string &name, unsigned int maxDistance) const;
+
+  void resolve(StringFilterSet &areasFilter) const;
+
+private:
+  struct Node {
+    std::vector<std::pair<char, uint32_t>> children;
+    std::vector<uint32_t> byCode;
+    std::vector<uint32_t> byName;
+  };
+
+  void insert(const std::string &text, uint32_t area, bool isName);
+  int find(const std::string &folded) const;
+  void collect(uint32_t node, std::vector<uint32_t> &found) const;
+  std::vector<std::string> codesOf(std::vector<uint32_t> found) const;
+
+  std::vector<Node> nodes;
+  std::vector<std::string> codes;
+  StringFilterSet exact;
+};
+
+#endif // NAMEINDEX_H_
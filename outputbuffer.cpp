@@ -0,0 +1,343 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the OutputBuffer class.
+
+  The JSON helpers produce exactly the same text as nlohmann::json::dump()
+  (which is what Areas::toJSON() originally used), so that output written
+  directly to a stream is byte-for-byte identical to the old output.
+*/
+
+#include <cmath>
+#include <cstdio>
+
+#include "lib_json.hpp"
+
+#include "outputbuffer.h"
+
+/*
+  Construct an OutputBuffer that accumulates everything appended to it, to
+  be retrieved with str().
+
+  @example
+    OutputBuffer out;
+    out.append("text");
+    std::string text = out.str();
+*/
+OutputBuffer::OutputBuffer() : os(nullptr), capacity(0) {}
+
+/*
+  Construct an OutputBuffer that writes to a stream in chunks.
+
+  @param os
+    The output stream to write to
+
+  @param capacity
+    How many characters to collect before writing them to the stream
+
+  @example
+    OutputBuffer out(std::cout);
+    out.append("text");
+*/
+OutputBuffer::OutputBuffer(std::ostream &os, size_t capacity)
+    : os(&os), capacity(capacity) {
+    buffer.reserve(capacity + 256);
+}
+
+/*
+  Write anything left in the buffer to the stream, if there is one.
+*/
+OutputBuffer::~OutputBuffer() {
+    if (os) {
+        spill();
+    }
+}
+
+/*
+  Append a single character.
+
+  @param c
+    The character to append
+*/
+void OutputBuffer::append(char c) {
+    buffer.push_back(c);
+    if (os && buffer.size() >= capacity) {
+        spill();
+    }
+}
+
+/*
+  Append a run of characters.
+
+  @param text
+    Pointer to the first character
+
+  @param length
+    The number of characters
+*/
+void OutputBuffer::append(const char *text, size_t length) {
+    buffer.append(text, length);
+    if (os && buffer.size() >= capacity) {
+        spill();
+    }
+}
+
+/*
+  Append a std::string.
+
+  @param text
+    The text to append
+*/
+void OutputBuffer::append(const std::string &text) {
+    append(text.data(), text.size());
+}
+
+/*
+  Append an unsigned integer in decimal.
+
+  @param value
+    The value to append
+*/
+void OutputBuffer::appendUnsigned(uint64_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+        digits[length++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    char text[20];
+    for (size_t i = 0; i < length; i++) {
+        text[i] = digits[length - 1 - i];
+    }
+    append(text, length);
+}
+
+/*
+  Append a double with exactly six decimal places, producing the same text
+  as printf("%.6f") (or std::fixed with std::setprecision(6)) would.
+
+  The value is scaled by a million and rounded as an integer, which is exact
+  unless the scaled value lies within rounding error of a half (or is too
+  large to scale exactly, or not finite), in which case this falls back on
+  snprintf() to get the correctly rounded digits.
+
+  @param value
+    The value to append
+
+  @return
+    The number of characters appended
+*/
+size_t OutputBuffer::appendFixed6(double value) {
+    const double MAX_FAST = 1e9; // keeps value * 1e6 well below 2^53
+
+    double magnitude = std::fabs(value);
+    if (std::isfinite(value) && magnitude < MAX_FAST) {
+        const double scaled = magnitude * 1e6;
+        const double whole = std::floor(scaled);
+        const double fraction = scaled - whole;
+
+        //the multiplication is out by at most half an ulp of scaled
+        const double ulp = std::nextafter(scaled, MAX_FAST * 1e6) - scaled;
+        if (std::fabs(fraction - 0.5) > ulp) {
+            uint64_t rounded = (uint64_t) whole + (fraction > 0.5 ? 1 : 0);
+
+            //written backwards from the end: six decimals, the point, then
+            //the integer part and sign
+            char text[32];
+            char *start = text + sizeof(text);
+            for (int i = 0; i < 6; i++) {
+                *--start = (char) ('0' + rounded % 10);
+                rounded /= 10;
+            }
+            *--start = '.';
+            do {
+                *--start = (char) ('0' + rounded % 10);
+                rounded /= 10;
+            } while (rounded != 0);
+            if (std::signbit(value)) {
+                *--start = '-';
+            }
+
+            const size_t length = (size_t) (text + sizeof(text) - start);
+            append(start, length);
+            return length;
+        }
+    }
+
+    char text[512];
+    const int length = std::snprintf(text, sizeof(text), "%.6f", value);
+    append(text, (size_t) length);
+    return (size_t) length;
+}
+
+/*
+  Append a number of spaces, e.g. to right-align a column.
+
+  @param count
+    The number of spaces
+*/
+void OutputBuffer::appendPadding(size_t count) {
+    buffer.append(count, ' ');
+    if (os && buffer.size() >= capacity) {
+        spill();
+    }
+}
+
+/*
+  Append a string as a quoted JSON string. Quotation marks, backslashes and
+  control characters are escaped, and everything else (including UTF-8 such
+  as Welsh names) is written as is.
+
+  @param text
+    The string to append
+*/
+void OutputBuffer::appendJSONString(const std::string &text) {
+    static const char HEX[] = "0123456789abcdef";
+
+    buffer.push_back('"');
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        const unsigned char c = (unsigned char) text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        buffer.append(text, start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"':  buffer.append("\\\"", 2); break;
+            case '\\': buffer.append("\\\\", 2); break;
+            case '\b': buffer.append("\\b", 2); break;
+            case '\t': buffer.append("\\t", 2); break;
+            case '\n': buffer.append("\\n", 2); break;
+            case '\f': buffer.append("\\f", 2); break;
+            case '\r': buffer.append("\\r", 2); break;
+            default: {
+                const char escaped[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                buffer.append(escaped, 6);
+            }
+        }
+    }
+    buffer.append(text, start, text.size() - start);
+    append('"');
+}
+
+/*
+  Append a double as a JSON number, using the shortest representation that
+  reads back as the same double (e.g. 711.6801 or 68592.0). Values that are
+  not finite are written as null.
+
+  @param value
+    The value to append
+*/
+void OutputBuffer::appendJSONNumber(double value) {
+    if (!std::isfinite(value)) {
+        append("null", 4);
+        return;
+    }
+
+    char number[64];
+    char *end = nlohmann::detail::to_chars(number, number + sizeof(number), value);
+    append(number, (size_t) (end - number));
+}
+
+/*
+  Append a text field of a delimited (CSV or TSV) row.
+
+  With a comma delimiter, a field containing a comma, quotation mark or line
+  break is quoted, with any quotation marks doubled, as in RFC 4180. Any
+  other delimiter (e.g. a tab) cannot be quoted, so delimiters and line
+  breaks in the text are replaced with spaces instead.
+
+  @param text
+    The field to append
+
+  @param delimiter
+    The character that separates fields in the row
+*/
+void OutputBuffer::appendDelimitedField(const std::string &text, char delimiter) {
+    const bool special = text.find_first_of(delimiter == ',' ? ",\"\r\n" : "\r\n") != std::string::npos
+                         || text.find(delimiter) != std::string::npos;
+    if (!special) {
+        append(text);
+        return;
+    }
+
+    if (delimiter == ',') {
+        buffer.push_back('"');
+        for (char c : text) {
+            if (c == '"') {
+                buffer.push_back('"');
+            }
+            buffer.push_back(c);
+        }
+        append('"');
+    } else {
+        for (char c : text) {
+            buffer.push_back(c == delimiter || c == '\r' || c == '\n' ? ' ' : c);
+        }
+        if (os && buffer.size() >= capacity) {
+            spill();
+        }
+    }
+}
+
+/*
+  Write everything in the buffer to the stream and flush the stream. This
+  does nothing if there is no stream.
+*/
+void OutputBuffer::flush() {
+    if (os) {
+        spill();
+        os->flush();
+    }
+}
+
+/*
+  Retrieve everything appended so far that has not yet been written to a
+  stream.
+
+  @return
+    The buffered text
+*/
+const std::string &OutputBuffer::str() const {
+    return buffer;
+}
+
+/*
+  Take everything appended so far that has not yet been written to a stream,
+  leaving the buffer empty.
+
+  @return
+    The buffered text
+*/
+std::string OutputBuffer::release() {
+    std::string text;
+    text.swap(buffer);
+    return text;
+}
+
+/*
+  Retrieve the number of characters currently buffered.
+
+  @return
+    The number of characters
+*/
+size_t OutputBuffer::size() const {
+    return buffer.size();
+}
+
+/*
+  Write the buffered characters to the stream and empty the buffer.
+*/
+void OutputBuffer::spill() {
+    if (!buffer.empty()) {
+        os->write(buffer.data(), (std::streamsize) buffer.size());
+        buffer.clear();
+    }
+}
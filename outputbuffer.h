@@ -0,0 +1,59 @@
+#ifndef OUTPUTBUFFER_H_
+#define OUTPUTBUFFER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the OutputBuffer class, a simple
+  character buffer that the output functions of Areas, Area and Measure write
+  their text into, which is then handed to a std::ostream in large chunks
+  rather than a few characters at a time.
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+  An OutputBuffer either writes through to a std::ostream whenever it grows
+  past its capacity (and when it is flushed or destroyed), or, if it is
+  constructed without a stream, simply accumulates everything so it can be
+  retrieved with str().
+
+  None of the append functions depend on the locale or any stream state.
+*/
+class OutputBuffer {
+public:
+  OutputBuffer();
+  explicit OutputBuffer(std::ostream &os, size_t capacity = 64 * 1024);
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+  ~OutputBuffer();
+
+  void append(char c);
+  void append(const char *text, size_t length);
+  void append(const std::string &text);
+  void appendUnsigned(uint64_t value);
+  size_t appendFixed6(double value);
+  void appendPadding(size_t count);
+  void appendJSONString(const std::string &text);
+  void appendJSONNumber(double value);
+  void appendDelimitedField(const std::string &text, char delimiter);
+  void flush();
+  const std::string &str() const;
+  std::string release();
+  size_t size() const;
+
+private:
+  void spill();
+
+  std::ostream *os;
+  size_t capacity;
+  std::string buffer;
+};
+
+#endif // OUTPUTBUFFER_H_
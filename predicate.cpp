@@ -0,0 +1,357 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the ValuePredicate class.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "predicate.h"
+
+namespace {
+
+/*
+  Remove the spaces from the start and end of some text.
+*/
+std::string trim(const std::string &text) {
+    const size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return "";
+    }
+    const size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+/*
+  Check whether an area in a dataset is in the areas filter, by the same
+  rules as Areas::mergeFiltered(): by its code or any of its names.
+*/
+bool inAreasFilter(const StringFilterSet &areasFilter, const AreaSeries &series) {
+    if (areasFilter.empty() || areasFilter.find(*series.code) != areasFilter.end()) {
+        return true;
+    }
+    for (const auto &name : series.area->getNames()) {
+        if (areasFilter.find(name.second) != areasFilter.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/*
+  Construct a ValuePredicate.
+
+  @param measure
+    The codename of the measure to compare, which is lowercased
+
+  @param comparison
+    How each value is compared with the threshold
+
+  @param threshold
+    The value to compare with
+
+  @param year
+    The year whose value is compared, or 0 to pass an area if a value in any
+    year passes
+
+  @example
+    ValuePredicate predicate("pop", ValuePredicate::GREATER, 100000, 2019);
+*/
+ValuePredicate::ValuePredicate(std::string measure,
+                               Comparison comparison,
+                               double threshold,
+                               unsigned int year)
+    : measure(std::move(measure)), comparison(comparison), threshold(threshold), year(year) {
+    std::transform(this->measure.begin(), this->measure.end(), this->measure.begin(), ::tolower);
+}
+
+/*
+  Parse a predicate as it is given with the where argument: a measure
+  codename, one of <, <=, =, !=, >= or >, a number, and optionally "in" and a
+  four digit year. Spaces around each part are ignored.
+
+  @param text
+    The predicate, e.g. "pop>100000 in 2019" or "rb <= 50"
+
+  @return
+    The ValuePredicate
+
+  @throws
+    std::invalid_argument if the text is not a predicate, with the message:
+    Invalid input for where argument: <text>
+
+  @example
+    auto predicate = ValuePredicate::parse("pop>100000 in 2019");
+    predicate.test(120000); // true
+*/
+ValuePredicate ValuePredicate::parse(const std::string &text) {
+    const std::invalid_argument invalid("Invalid input for where argument: " + text);
+
+    const size_t position = text.find_first_of("<>=!");
+    const std::string measure = trim(text.substr(0, std::min(position, text.size())));
+    if (position == std::string::npos || measure.empty()) {
+        throw invalid;
+    }
+
+    Comparison comparison;
+    size_t length = 1;
+    const bool equals = position + 1 < text.size() && text[position + 1] == '=';
+    switch (text[position]) {
+        case '<':
+            comparison = equals ? LESS_EQUAL : LESS;
+            length += equals;
+            break;
+        case '>':
+            comparison = equals ? GREATER_EQUAL : GREATER;
+            length += equals;
+            break;
+        case '!':
+            if (!equals) {
+                throw invalid;
+            }
+            comparison = NOT_EQUAL;
+            length++;
+            break;
+        default:
+            comparison = EQUAL;
+            length += equals; // == is the same as =
+    }
+
+    const std::string rest = trim(text.substr(position + length));
+    const char *begin = rest.c_str();
+    char *end = nullptr;
+    const double threshold = std::strtod(begin, &end);
+    if (end == begin || !(threshold == threshold)) {
+        throw invalid;
+    }
+
+    unsigned int year = 0;
+    const std::string suffix = trim(std::string(end));
+    if (!suffix.empty()) {
+        if (suffix.size() < 3 || std::tolower(suffix[0]) != 'i' || std::tolower(suffix[1]) != 'n'
+            || (suffix[2] != ' ' && suffix[2] != '\t')) {
+            throw invalid;
+        }
+        const std::string digits = trim(suffix.substr(2));
+        if (digits.size() != 4 || digits.find_first_not_of("0123456789") != std::string::npos) {
+            throw invalid;
+        }
+        year = (unsigned int) std::stoi(digits);
+    }
+
+    return ValuePredicate(measure, comparison, threshold, year);
+}
+
+const std::string &ValuePredicate::getMeasure() const {
+    return measure;
+}
+
+ValuePredicate::Comparison ValuePredicate::getComparison() const {
+    return comparison;
+}
+
+double ValuePredicate::getThreshold() const {
+    return threshold;
+}
+
+unsigned int ValuePredicate::getYear() const {
+    return year;
+}
+
+/*
+  Write the predicate out the way parse() reads it, with every part spelt
+  the same way whichever way it was given, e.g. to use in a cache key.
+
+  @return
+    The predicate as text
+
+  @example
+    ValuePredicate::parse("POP >1e5 IN 2019").toString(); // "pop > 100000 in 2019"
+*/
+std::string ValuePredicate::toString() const {
+    static const char * const SYMBOLS[] = {"<", "<=", "=", "!=", ">=", ">"};
+    std::ostringstream text;
+    text << measure << ' ' << SYMBOLS[comparison] << ' '
+         << std::setprecision(17) << threshold;
+    if (year != 0) {
+        text << " in " << year;
+    }
+    return text.str();
+}
+
+/*
+  Compare a value with the threshold.
+
+  @param value
+    The value
+
+  @return
+    true if the value passes
+
+  @example
+    ValuePredicate::parse("pop>100000").test(120000); // true
+*/
+bool ValuePredicate::test(double value) const {
+    switch (comparison) {
+        case LESS:
+            return value < threshold;
+        case LESS_EQUAL:
+            return value <= threshold;
+        case EQUAL:
+            return value == threshold;
+        case NOT_EQUAL:
+            return value != threshold;
+        case GREATER_EQUAL:
+            return value >= threshold;
+        default:
+            return value > threshold;
+    }
+}
+
+/*
+  Work out from the smallest and largest of some values (an entry in a zone
+  map) whether none, some or all of them pass the comparison, without looking
+  at the values themselves. SOME means they have to be looked at.
+
+  @param range
+    The smallest and largest value
+
+  @return
+    NONE if no value can pass, ALL if every value must pass, otherwise SOME
+
+  @example
+    ValuePredicate::parse("pop>100000").test(ValueRange{20000, 90000}); // NONE
+*/
+ValuePredicate::Verdict ValuePredicate::test(const ValueRange &range) const {
+    switch (comparison) {
+        case LESS:
+        case LESS_EQUAL:
+            return !test(range.min) ? NONE : (test(range.max) ? ALL : SOME);
+        case GREATER:
+        case GREATER_EQUAL:
+            return !test(range.max) ? NONE : (test(range.min) ? ALL : SOME);
+        case EQUAL:
+            if (threshold < range.min || threshold > range.max) {
+                return NONE;
+            }
+            return range.min == range.max ? ALL : SOME;
+        default:
+            if (threshold < range.min || threshold > range.max) {
+                return ALL;
+            }
+            return range.min == range.max ? NONE : SOME;
+    }
+}
+
+/*
+  Find the areas that pass this predicate in any of some datasets.
+*/
+std::set<std::string> ValuePredicate::screen(const std::vector<const Areas *> &sources,
+                                             const StringFilterSet &areasFilter) const {
+    std::set<std::string> passed;
+    for (const Areas *source : sources) {
+        const ZoneMap &zones = source->getZoneMap();
+        const auto zone = zones.find(measure);
+        if (zone == zones.end()) {
+            continue;
+        }
+
+        // Rule the whole measure (or year) in or out if its zone allows
+        Verdict whole;
+        if (year == 0) {
+            whole = test(zone->second.all);
+        } else {
+            const auto inYear = zone->second.byYear.find(year);
+            if (inYear == zone->second.byYear.end()) {
+                continue;
+            }
+            whole = test(inYear->second);
+        }
+        if (whole == NONE) {
+            continue;
+        }
+
+        for (const AreaSeries &series : source->getMeasureIndex().at(measure)) {
+            const auto &values = series.measure->getValues();
+            if (values.empty() || passed.find(*series.code) != passed.end()
+                || !inAreasFilter(areasFilter, series)) {
+                continue;
+            }
+
+            bool passes;
+            if (year != 0) {
+                const auto value = values.find(year);
+                passes = value != values.end() && (whole == ALL || test(value->second));
+            } else {
+                const Verdict verdict = whole == ALL ? ALL : test(series.range);
+                passes = verdict == ALL
+                         || (verdict == SOME
+                             && std::any_of(values.begin(), values.end(),
+                                            [this](const std::pair<const unsigned int, double> &value) {
+                                                return test(value.second);
+                                            }));
+            }
+            if (passes) {
+                passed.insert(*series.code);
+            }
+        }
+    }
+    return passed;
+}
+
+/*
+  Find the areas that pass every one of some predicates, each in any of some
+  datasets, using the datasets' zone maps to avoid comparing values that
+  cannot change the answer.
+
+  @param predicates
+    The predicates, as given by BethYw::parseWhereArg()
+
+  @param sources
+    The datasets to look for values in
+
+  @param areasFilter
+    The areas to consider (codes or names, as for Areas::mergeFiltered()),
+    or an empty set for every area
+
+  @return
+    The codes of the areas that pass, which is empty if none do
+
+  @example
+    auto predicates = BethYw::parseWhereArg(args);
+    std::set<std::string> codes = ValuePredicate::screen(predicates, {&popden}, {});
+*/
+std::set<std::string> ValuePredicate::screen(const std::vector<ValuePredicate> &predicates,
+                                             const std::vector<const Areas *> &sources,
+                                             const StringFilterSet &areasFilter) {
+    std::set<std::string> passed;
+    for (size_t i = 0; i < predicates.size(); i++) {
+        std::set<std::string> passing = predicates[i].screen(sources, areasFilter);
+        if (i == 0) {
+            passed = std::move(passing);
+        } else {
+            std::set<std::string> both;
+            std::set_intersection(passed.begin(), passed.end(),
+                                  passing.begin(), passing.end(),
+                                  std::inserter(both, both.end()));
+            passed = std::move(both);
+        }
+        if (passed.empty()) {
+            break;
+        }
+    }
+    return passed;
+}
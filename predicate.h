@@ -0,0 +1,71 @@
+#ifndef PREDICATE_H_
+#define PREDICATE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the ValuePredicate class, a
+  comparison given with the where argument (e.g. --where "pop>100000 in
+  2019") that selects the areas with a value that passes it.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A ValuePredicate compares the values of one measure (by its codename, in
+  lowercase) with a threshold, either in one year or, if no year is given,
+  in any year. An area passes if it has a value that passes the comparison.
+
+  The areas that pass are found by screen(), which uses the zone maps of
+  the datasets (see Areas::getZoneMap()) to skip whole measures, years and
+  series whose range of values cannot pass, or must pass, without comparing
+  each value.
+*/
+class ValuePredicate {
+public:
+  enum Comparison { LESS, LESS_EQUAL, EQUAL, NOT_EQUAL, GREATER_EQUAL, GREATER };
+
+  /*
+    Whether none, some or all of a range of values pass a comparison.
+  */
+  enum Verdict { NONE, SOME, ALL };
+
+  ValuePredicate(std::string measure,
+                 Comparison comparison,
+                 double threshold,
+                 unsigned int year = 0);
+
+  static ValuePredicate parse(const std::string &text);
+
+  const std::string &getMeasure() const;
+  Comparison getComparison() const;
+  double getThreshold() const;
+  unsigned int getYear() const;
+  std::string toString() const;
+
+  bool test(double value) const;
+  Verdict test(const ValueRange &range) const;
+
+  static std::set<std::string> screen(const std::vector<ValuePredicate> &predicates,
+                                      const std::vector<const Areas *> &sources,
+                                      const StringFilterSet &areasFilter);
+
+private:
+  std::set<std::string> screen(const std::vector<const Areas *> &sources,
+                               const StringFilterSet &areasFilter) const;
+
+  std::string measure;
+  Comparison comparison;
+  double threshold;
+  unsigned int year;
+};
+
+#endif // PREDICATE_H_
@@ -0,0 +1,241 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the QuantileSketch class.
+
+  Values are appended to the bottom compactor. When the sketch holds more
+  values than the sum of its compactor capacities, the lowest compactor that
+  is over capacity is sorted and every other value (starting at a random
+  offset) is promoted to the level above, where each value counts twice as
+  much. Higher levels get larger capacities, shrinking by 2/3 per level down.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "quantiles.h"
+
+/*
+  Construct an empty QuantileSketch.
+
+  @param codename
+    The codename of the measure the values belong to, converted to lowercase
+
+  @param label
+    Human-readable label for the measure
+
+  @param k
+    Capacity of the top compactor, which controls the accuracy (and memory)
+    of the sketch
+
+  @example
+    QuantileSketch sketch("pop", "Population");
+    sketch.update(69123);
+*/
+QuantileSketch::QuantileSketch(std::string codename, std::string label, unsigned int k)
+    : label(std::move(label)),
+      k(std::max(k, 8u)),
+      n(0),
+      minValue(std::numeric_limits<double>::infinity()),
+      maxValue(-std::numeric_limits<double>::infinity()),
+      seed(0x9E3779B97F4A7C15ULL),
+      maxSize(0) {
+    std::transform(codename.begin(), codename.end(), codename.begin(), ::tolower);
+    this->codename = std::move(codename);
+    grow();
+}
+
+/*
+  Retrieve the codename of the measure.
+
+  @return
+    The codename
+*/
+const std::string &QuantileSketch::getCodename() const {
+    return this->codename;
+}
+
+/*
+  Retrieve the label of the measure.
+
+  @return
+    The label
+*/
+const std::string &QuantileSketch::getLabel() const {
+    return this->label;
+}
+
+/*
+  The capacity of a given compactor level. The top level holds k values and
+  each level below holds 2/3 as many, but never fewer than 2.
+
+  @param level
+    The compactor level (0 is the bottom)
+
+  @return
+    The number of values the level can hold before it is compacted
+*/
+unsigned int QuantileSketch::capacity(size_t level) const {
+    const size_t depth = compactors.size() - level - 1;
+    const double scaled = std::ceil(std::pow(2.0 / 3.0, (double) depth) * k);
+    return std::max(2u, (unsigned int) scaled);
+}
+
+/*
+  Add another compactor level at the top of the hierarchy, which changes the
+  capacity of every level below it.
+*/
+void QuantileSketch::grow() {
+    compactors.emplace_back();
+    maxSize = 0;
+    for (size_t level = 0; level < compactors.size(); level++) {
+        maxSize += capacity(level);
+    }
+}
+
+/*
+  Compact the lowest level that is over capacity, promoting half of its
+  values to the level above.
+*/
+void QuantileSketch::compress() {
+    for (size_t level = 0; level < compactors.size(); level++) {
+        if (compactors[level].size() >= capacity(level)) {
+            if (level + 1 >= compactors.size()) {
+                grow();
+            }
+
+            auto &current = compactors[level];
+            std::sort(current.begin(), current.end());
+
+            //xorshift for the offset, so the output is the same on every run
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            const size_t offset = seed & 1;
+
+            //an odd value out stays behind at this level
+            double leftover = 0;
+            const bool odd = current.size() % 2 == 1;
+            if (odd) {
+                leftover = current.back();
+                current.pop_back();
+            }
+
+            auto &above = compactors[level + 1];
+            for (size_t i = offset; i < current.size(); i += 2) {
+                above.push_back(current[i]);
+            }
+            current.clear();
+            if (odd) {
+                current.push_back(leftover);
+            }
+            return;
+        }
+    }
+}
+
+/*
+  Add a value to the sketch.
+
+  @param value
+    The value to add
+
+  @example
+    QuantileSketch sketch("pop", "Population");
+    sketch.update(69123);
+*/
+void QuantileSketch::update(double value) {
+    if (std::isnan(value)) {
+        return;
+    }
+
+    n++;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    compactors[0].push_back(value);
+
+    if (retained() >= maxSize) {
+        compress();
+    }
+}
+
+/*
+  Approximate the value at a given fraction of the way through all the values
+  seen, e.g. 0.5 for the median. The minimum and maximum are exact.
+
+  @param fraction
+    A value between 0 and 1 inclusive
+
+  @return
+    The approximate quantile, or NaN if the sketch is empty
+
+  @throws
+    std::out_of_range if fraction is not between 0 and 1
+*/
+double QuantileSketch::getQuantile(double fraction) const {
+    if (!(fraction >= 0 && fraction <= 1)) {
+        throw std::out_of_range("Quantile must be between 0 and 1");
+    }
+    if (n == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (fraction == 0) {
+        return minValue;
+    }
+    if (fraction == 1) {
+        return maxValue;
+    }
+
+    //each value at level h stands in for 2^h of the original values
+    std::vector<std::pair<double, uint64_t>> weighted;
+    weighted.reserve(retained());
+    uint64_t total = 0;
+    for (size_t level = 0; level < compactors.size(); level++) {
+        for (double value : compactors[level]) {
+            weighted.emplace_back(value, (uint64_t) 1 << level);
+            total += (uint64_t) 1 << level;
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    const double target = fraction * (double) total;
+    uint64_t cumulative = 0;
+    for (const auto &item : weighted) {
+        cumulative += item.second;
+        if ((double) cumulative >= target) {
+            return std::max(minValue, std::min(maxValue, item.first));
+        }
+    }
+    return maxValue;
+}
+
+/*
+  Retrieve the number of values added to the sketch.
+
+  @return
+    The number of values
+*/
+uint64_t QuantileSketch::count() const {
+    return n;
+}
+
+/*
+  Retrieve the number of samples the sketch is currently holding in memory.
+
+  @return
+    The number of retained samples
+*/
+size_t QuantileSketch::retained() const {
+    size_t total = 0;
+    for (const auto &compactor : compactors) {
+        total += compactor.size();
+    }
+    return total;
+}
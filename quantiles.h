@@ -0,0 +1,65 @@
+#ifndef QUANTILES_H_
+#define QUANTILES_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the QuantileSketch class, a KLL
+  (Karnin, Lang and Liberty) streaming quantile sketch. It summarises every
+  value of a measure seen as the areas are merged one at a time (--stream and
+  --memory-limit), so that percentiles can be answered afterwards without
+  holding on to the values themselves.
+ */
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+  A QuantileSketch has a codename and label like a Measure, but instead of a
+  container of values by year it keeps a fixed number of samples per level
+  of a hierarchy of compactors. Memory grows only with the logarithm of the
+  number of values seen, and a percentile is approximated to within roughly
+  1.7/k of the true rank (about 1% for the default k of 200). A sketch whose
+  k is larger than the number of values it is given never compacts them, so
+  its percentiles are exact.
+*/
+class QuantileSketch {
+public:
+  QuantileSketch(std::string codename, std::string label, unsigned int k = 200);
+
+  const std::string& getCodename() const;
+  const std::string& getLabel() const;
+  void update(double value);
+  double getQuantile(double fraction) const;
+  uint64_t count() const;
+  size_t retained() const;
+
+private:
+  unsigned int capacity(size_t level) const;
+  void grow();
+  void compress();
+
+  std::string codename;
+  std::string label;
+  unsigned int k;
+  uint64_t n;
+  double minValue;
+  double maxValue;
+  uint64_t seed;
+  size_t maxSize;
+  std::vector<std::vector<double>> compactors;
+};
+
+/*
+  The quantile sketches of several measures, keyed by codename.
+*/
+using QuantileSketches = std::map<std::string, QuantileSketch>;
+
+#endif // QUANTILES_H_
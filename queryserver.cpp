@@ -0,0 +1,422 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the QueryServer class.
+*/
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "queryserver.h"
+#include "renderpool.h"
+
+namespace {
+
+// The most a client may send, to stop a faulty client using up memory
+const size_t MAX_REQUEST = 1024 * 1024;
+
+// How long to wait for a client to send its query or take the reply
+const int CLIENT_TIMEOUT_SECONDS = 10;
+
+// How often the server checks whether it has been asked to stop
+const int STOP_CHECK_MILLISECONDS = 250;
+
+// Set by stop() from any thread, or by SIGINT or SIGTERM (it is lock-free,
+// so it can be set from a signal handler)
+std::atomic<bool> stopRequested(false);
+
+#ifndef _WIN32
+
+void handleStopSignal(int) {
+    stopRequested = true;
+}
+
+/*
+  Fill in the address of a Unix domain socket.
+*/
+sockaddr_un socketAddress(const std::string &path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Invalid socket path: " + path);
+    }
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+/*
+  Write all of a buffer to a socket, giving up if the other end has gone.
+*/
+bool sendAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= (size_t) sent;
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
+#ifndef _WIN32
+
+/*
+  Construct a QueryServer listening on a Unix domain socket. A socket file
+  left behind by a server that is no longer running is replaced.
+
+  @param path
+    The path of the socket file
+
+  @param workers
+    The number of worker threads to answer queries on, or 0 for one per
+    processor core
+
+  @throws
+    std::invalid_argument if the path is too long for a socket
+    std::runtime_error if the socket cannot be created, or another server is
+    already listening on it
+
+  @example
+    QueryServer server("/tmp/bethyw.sock");
+    server.serve(handler);
+*/
+QueryServer::QueryServer(std::string path, unsigned int workers)
+    : path(std::move(path)), listener(-1), workers(renderThreads(workers)) {
+    const sockaddr_un address = socketAddress(this->path);
+
+    struct stat info;
+    if (::lstat(this->path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            throw std::runtime_error("Not a socket: " + this->path);
+        }
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool running = probe >= 0
+            && ::connect(probe, (const sockaddr *) &address, sizeof(address)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (running) {
+            throw std::runtime_error("A server is already listening on " + this->path);
+        }
+        ::unlink(this->path.c_str());
+    }
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0
+        || ::bind(listener, (const sockaddr *) &address, sizeof(address)) != 0
+        || ::listen(listener, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        throw std::runtime_error("Could not listen on " + this->path + ": " + reason);
+    }
+
+    stopRequested = false;
+}
+
+/*
+  Stop listening and remove the socket file.
+*/
+QueryServer::~QueryServer() {
+    ::close(listener);
+    ::unlink(path.c_str());
+}
+
+/*
+  Answer queries until stop() is called or the process receives SIGINT or
+  SIGTERM. The handler is called on the worker threads, several at a time.
+  Once stopping, the queries being answered are finished and those still
+  waiting for a worker are closed unanswered.
+
+  @param handler
+    The function that answers each query
+*/
+void QueryServer::serve(const QueryHandler &handler) {
+    struct sigaction stopAction, oldInterrupt, oldTerminate, oldPipe;
+    std::memset(&stopAction, 0, sizeof(stopAction));
+    stopAction.sa_handler = handleStopSignal;
+    sigemptyset(&stopAction.sa_mask);
+    ::sigaction(SIGINT, &stopAction, &oldInterrupt);
+    ::sigaction(SIGTERM, &stopAction, &oldTerminate);
+
+    //a client that disconnects early must not kill the server
+    struct sigaction ignoreAction = stopAction;
+    ignoreAction.sa_handler = SIG_IGN;
+    ::sigaction(SIGPIPE, &ignoreAction, &oldPipe);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> pending;
+    bool finished = false;
+
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < workers; i++) {
+        pool.emplace_back([&]() {
+            while (true) {
+                int connection;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&]() { return finished || !pending.empty(); });
+                    if (finished) {
+                        return;
+                    }
+                    connection = pending.front();
+                    pending.pop_front();
+                }
+                answer(connection, handler);
+                ::close(connection);
+            }
+        });
+    }
+
+    while (!stopRequested) {
+        pollfd waiting = {listener, POLLIN, 0};
+        if (::poll(&waiting, 1, STOP_CHECK_MILLISECONDS) <= 0) {
+            continue;
+        }
+
+        const int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(connection);
+        }
+        ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    ready.notify_all();
+    for (auto &worker : pool) {
+        worker.join();
+    }
+    for (int connection : pending) {
+        ::close(connection);
+    }
+
+    ::sigaction(SIGINT, &oldInterrupt, nullptr);
+    ::sigaction(SIGTERM, &oldTerminate, nullptr);
+    ::sigaction(SIGPIPE, &oldPipe, nullptr);
+}
+
+/*
+  Read one query from a connection, answer it and send the reply.
+
+  @param connection
+    The client's connection
+
+  @param handler
+    The function that answers the query
+*/
+void QueryServer::answer(int connection, const QueryHandler &handler) const {
+    timeval timeout = {CLIENT_TIMEOUT_SECONDS, 0};
+    ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char chunk[4096];
+    while (request.size() <= MAX_REQUEST) {
+        const ssize_t received = ::recv(connection, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0) {
+            return;
+        }
+        if (received == 0) {
+            break;
+        }
+        request.append(chunk, (size_t) received);
+    }
+
+    std::ostringstream out, err;
+    int code;
+    if (request.size() > MAX_REQUEST || (!request.empty() && request.back() != '\0')) {
+        err << "Invalid query" << std::endl;
+        code = 1;
+    } else {
+        std::vector<std::string> arguments;
+        size_t start = 0;
+        for (size_t end = request.find('\0'); end != std::string::npos;
+             end = request.find('\0', start)) {
+            arguments.push_back(request.substr(start, end - start));
+            start = end + 1;
+        }
+
+        try {
+            code = handler(arguments, out, err);
+        } catch (const std::exception &e) {
+            err << e.what() << std::endl;
+            code = 1;
+        }
+    }
+
+    const std::string status = std::to_string(code) + "\n";
+    const std::string payload = code == 0 ? out.str() : err.str();
+    if (sendAll(connection, status.data(), status.size())) {
+        sendAll(connection, payload.data(), payload.size());
+    }
+}
+
+/*
+  Ask the server to stop answering queries. This is safe to call from any
+  thread, and the server stops within a fraction of a second.
+*/
+void QueryServer::stop() {
+    stopRequested = true;
+}
+
+/*
+  Send a query to a server and copy the reply to the given streams.
+
+  @param path
+    The path of the server's socket file
+
+  @param arguments
+    The command line arguments to send
+
+  @param out
+    The stream to write the output to
+
+  @param err
+    The stream to write the error message to, if the query fails
+
+  @return
+    The exit code sent by the server
+
+  @throws
+    std::runtime_error if the server cannot be reached or does not reply
+
+  @example
+    int code = QueryServer::query("/tmp/bethyw.sock", {"-d", "popden", "-j"},
+                                  std::cout, std::cerr);
+*/
+int QueryServer::query(const std::string &path,
+                       const std::vector<std::string> &arguments,
+                       std::ostream &out,
+                       std::ostream &err) {
+    const sockaddr_un address = socketAddress(path);
+
+    const int connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0
+        || ::connect(connection, (const sockaddr *) &address, sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (connection >= 0) {
+            ::close(connection);
+        }
+        throw std::runtime_error("Could not connect to " + path + ": " + reason);
+    }
+
+    std::string request;
+    for (const auto &argument : arguments) {
+        request += argument;
+        request += '\0';
+    }
+    if (!sendAll(connection, request.data(), request.size())) {
+        ::close(connection);
+        throw std::runtime_error("Could not send the query to " + path);
+    }
+    ::shutdown(connection, SHUT_WR);
+
+    std::string status;
+    bool haveStatus = false;
+    int code = 0;
+    char chunk[1 << 16];
+    while (true) {
+        const ssize_t received = ::recv(connection, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+
+        const char *data = chunk;
+        size_t size = (size_t) received;
+        if (!haveStatus) {
+            const char *newline = (const char *) std::memchr(data, '\n', size);
+            if (!newline) {
+                status.append(data, size);
+                continue;
+            }
+            status.append(data, (size_t) (newline - data));
+            size -= (size_t) (newline - data) + 1;
+            data = newline + 1;
+            try {
+                code = std::stoi(status);
+            } catch (const std::exception &) {
+                break;
+            }
+            haveStatus = true;
+        }
+        (code == 0 ? out : err).write(data, (std::streamsize) size);
+    }
+    ::close(connection);
+
+    if (!haveStatus) {
+        throw std::runtime_error("No reply from " + path);
+    }
+    out.flush();
+    return code;
+}
+
+#else
+
+QueryServer::QueryServer(std::string path, unsigned int workers)
+    : path(std::move(path)), listener(-1), workers(workers) {
+    throw std::runtime_error("Unix domain sockets are not supported on this platform");
+}
+
+QueryServer::~QueryServer() {}
+
+void QueryServer::serve(const QueryHandler &) {}
+
+void QueryServer::answer(int, const QueryHandler &) const {}
+
+void QueryServer::stop() {
+    stopRequested = true;
+}
+
+int QueryServer::query(const std::string &,
+                       const std::vector<std::string> &,
+                       std::ostream &,
+                       std::ostream &) {
+    throw std::runtime_error("Unix domain sockets are not supported on this platform");
+}
+
+#endif
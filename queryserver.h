@@ -0,0 +1,65 @@
+#ifndef QUERYSERVER_H_
+#define QUERYSERVER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the QueryServer class, which answers
+  queries from other Beth Yw? processes over a Unix domain socket (see
+  --serve and --client in bethyw.cpp).
+
+  A client connects, writes its command line arguments, each followed by a
+  NUL byte, and shuts down its side of the connection. The server replies
+  with the exit code on a line of its own, followed by the output (or, if the
+  exit code is not 0, the error message), and closes the connection.
+ */
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+  A function that answers one query: given the client's arguments, it writes
+  the output and any error message to the two streams and returns the exit
+  code.
+*/
+using QueryHandler = std::function<int(const std::vector<std::string> &arguments,
+                                       std::ostream &out,
+                                       std::ostream &err)>;
+
+/*
+  A QueryServer listens on a Unix domain socket from when it is constructed
+  until it is destroyed, when the socket file is removed. One thread accepts
+  the connections and hands them to a pool of worker threads, each of which
+  reads a query, answers it and sends the reply, so a slow or stalled client
+  only holds up its own worker.
+*/
+class QueryServer {
+public:
+  explicit QueryServer(std::string path, unsigned int workers = 0);
+  QueryServer(const QueryServer &) = delete;
+  QueryServer &operator=(const QueryServer &) = delete;
+  ~QueryServer();
+
+  void serve(const QueryHandler &handler);
+
+  static void stop();
+  static int query(const std::string &path,
+                   const std::vector<std::string> &arguments,
+                   std::ostream &out,
+                   std::ostream &err);
+
+private:
+  void answer(int connection, const QueryHandler &handler) const;
+
+  std::string path;
+  int listener;
+  unsigned int workers;
+};
+
+#endif // QUERYSERVER_H_
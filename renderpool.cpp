@@ -0,0 +1,181 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of renderInOrder().
+
+  The items are split into batches. Workers take the next batch, render it
+  into a buffer of their own and hand the text back, while the calling
+  thread writes the batches to the output as soon as each one in order is
+  ready. Workers never get more than a few batches ahead of the output, so
+  only a small window of rendered text is held in memory at any time.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "renderpool.h"
+
+/*
+  Work out how many threads to render with.
+
+  @param requested
+    The number of threads asked for, or 0 to use one per hardware thread
+
+  @return
+    The number of threads, at least 1
+*/
+unsigned int renderThreads(unsigned int requested) {
+    if (requested == 0) {
+        requested = std::thread::hardware_concurrency();
+    }
+    return std::max(1u, requested);
+}
+
+/*
+  Render count items, in order, into an OutputBuffer. With one thread (or
+  too few items to be worth sharing out) the items are rendered directly
+  into the output on the calling thread.
+
+  If rendering any item throws an exception, the workers stop and the
+  exception is rethrown here once they have finished.
+
+  @param out
+    The OutputBuffer to write to
+
+  @param count
+    The number of items
+
+  @param threads
+    The number of worker threads to render with
+
+  @param render
+    Renders the item at an index into the buffer it is given
+
+  @param flush
+    Whether to flush the output as soon as each item (or, with several
+    threads, each batch of items) is written, so a reader at the other end
+    of a pipe can start on it straight away
+
+  @example
+    std::vector<Area> areas = ...;
+    OutputBuffer out(std::cout);
+    renderInOrder(out, areas.size(), 4, [&areas](OutputBuffer &buffer, size_t i) {
+      areas[i].toTable(buffer);
+    });
+*/
+void renderInOrder(OutputBuffer &out,
+                   size_t count,
+                   unsigned int threads,
+                   const RenderItem &render,
+                   bool flush) {
+    const size_t BATCH_SIZE = 16;
+    const size_t batches = (count + BATCH_SIZE - 1) / BATCH_SIZE;
+
+    if (threads <= 1 || batches <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            render(out, i);
+            if (flush) {
+                out.flush();
+            }
+        }
+        return;
+    }
+
+    threads = (unsigned int) std::min<size_t>(threads, batches);
+    const size_t window = 4 * (size_t) threads;
+
+    std::mutex mutex;
+    std::condition_variable readyChanged;
+    std::condition_variable writtenChanged;
+    std::vector<std::string> rendered(batches);
+    std::vector<bool> ready(batches, false);
+    size_t next = 0;
+    size_t written = 0;
+    std::exception_ptr error;
+
+    auto work = [&]() {
+        while (true) {
+            size_t batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                writtenChanged.wait(lock, [&]() {
+                    return error || next >= batches || next < written + window;
+                });
+                if (error || next >= batches) {
+                    return;
+                }
+                batch = next++;
+            }
+
+            OutputBuffer buffer;
+            try {
+                const size_t last = std::min(count, (batch + 1) * BATCH_SIZE);
+                for (size_t i = batch * BATCH_SIZE; i < last; i++) {
+                    render(buffer, i);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                readyChanged.notify_all();
+                writtenChanged.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            rendered[batch] = buffer.release();
+            ready[batch] = true;
+            readyChanged.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+
+    try {
+        for (size_t batch = 0; batch < batches; batch++) {
+            std::string text;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                readyChanged.wait(lock, [&]() { return error || ready[batch]; });
+                if (error) {
+                    break;
+                }
+                text.swap(rendered[batch]);
+                written = batch + 1;
+                writtenChanged.notify_all();
+            }
+            out.append(text);
+            if (flush) {
+                out.flush();
+            }
+        }
+    } catch (...) {
+        //the workers must still be stopped and joined before leaving
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+        writtenChanged.notify_all();
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef RENDERPOOL_H_
+#define RENDERPOOL_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of renderInOrder(), which renders a
+  sequence of items (e.g. each Area in an Areas object) into text on a pool
+  of worker threads, and writes the text out in the original order.
+ */
+
+#include <cstddef>
+#include <functional>
+
+#include "outputbuffer.h"
+
+/*
+  A function that renders the item at a given index into an OutputBuffer. It
+  is called from several threads at once, so must only read shared data.
+*/
+using RenderItem = std::function<void(OutputBuffer &out, size_t index)>;
+
+unsigned int renderThreads(unsigned int requested);
+
+void renderInOrder(OutputBuffer &out,
+                   size_t count,
+                   unsigned int threads,
+                   const RenderItem &render,
+                   bool flush = false);
+
+#endif // RENDERPOOL_H_
@@ -0,0 +1,465 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the ResidentData class.
+*/
+
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#include <sys/stat.h>
+
+#include "bethyw.h"
+#include "resident.h"
+
+/*
+  Construct a ResidentData object, importing areas.csv and every given
+  dataset from a directory without any filters.
+
+  @param dir
+    The directory where the datasets are, ending in a directory separator
+
+  @param datasets
+    The datasets to keep in memory
+
+  @param cache
+    A SnapshotCache to load the datasets from, or nullptr to parse the files
+
+  @throws
+    std::runtime_error if a file cannot be opened or parsed
+
+  @example
+    ResidentData resident("datasets/",
+                          {BethYw::InputFiles::POPDEN, BethYw::InputFiles::BIZ});
+*/
+ResidentData::ResidentData(std::string dir,
+                           const std::vector<BethYw::InputFileSource> &datasets,
+                           SnapshotCache *cache)
+    : dir(std::move(dir)), loadedStamp(), areas(), names(), sources(), datasets() {
+    // Taken before importing, so a change made while importing is noticed
+    loadedStamp = stamp(this->dir, datasets);
+
+    areas = importAreas(this->dir);
+    names = std::make_shared<const NameIndex>(*areas);
+    for (const auto &source : datasets) {
+        if (hasDataset(source.CODE)) {
+            continue;
+        }
+        this->datasets.emplace(source.CODE, importDataset(this->dir, source, cache));
+        sources.push_back(source);
+    }
+}
+
+/*
+  Make a copy of this ResidentData with areas.csv and any of the datasets
+  whose files have changed imported again. The datasets that have not
+  changed are shared with this object rather than copied.
+
+  @param changedFiles
+    The names of the files that have changed, within the directory (e.g.
+    "econ0080.json"); names of files that are not held are ignored
+
+  @param cache
+    A SnapshotCache to load the datasets from, or nullptr to parse the files
+
+  @return
+    The new ResidentData
+
+  @throws
+    std::runtime_error if a changed file cannot be opened or parsed
+
+  @example
+    auto next = resident.reloaded({"popu1009.json"});
+*/
+std::unique_ptr<ResidentData> ResidentData::reloaded(const std::set<std::string> &changedFiles,
+                                                     SnapshotCache *cache) const {
+    std::unique_ptr<ResidentData> next(new ResidentData(*this));
+    next->loadedStamp = stamp(dir, sources);
+
+    if (changedFiles.count("areas.csv")) {
+        next->areas = importAreas(dir);
+        next->names = std::make_shared<const NameIndex>(*next->areas);
+    }
+    for (const auto &source : sources) {
+        if (changedFiles.count(source.FILE)) {
+            next->datasets[source.CODE] = importDataset(dir, source, cache);
+        }
+    }
+    return next;
+}
+
+/*
+  Import areas.csv without filters, and build its indexes so queries can
+  use them straight away.
+*/
+std::shared_ptr<const Areas> ResidentData::importAreas(std::string dir) {
+    std::unordered_set<std::string> noFilter;
+    std::shared_ptr<Areas> imported(new Areas());
+    BethYw::loadAreas(*imported, dir, noFilter);
+    imported->buildIndexes();
+    return imported;
+}
+
+/*
+  Import one dataset without filters, and build its indexes.
+*/
+std::shared_ptr<const Areas> ResidentData::importDataset(std::string dir,
+                                                         const BethYw::InputFileSource &source,
+                                                         SnapshotCache *cache) {
+    std::unordered_set<std::string> noFilter;
+    std::tuple<unsigned int, unsigned int> allYears(0, 0);
+    std::shared_ptr<Areas> imported(new Areas());
+    BethYw::loadDatasets(*imported, dir, {source}, noFilter, noFilter, allYears, cache);
+    imported->buildIndexes();
+    return imported;
+}
+
+/*
+  Describe the current version of areas.csv and the dataset files by their
+  sizes and modification times, so that a change to any of them (e.g. for
+  BackgroundReloader) can be noticed without reading them.
+
+  @param dir
+    The directory where the datasets are, ending in a directory separator
+
+  @param datasets
+    The datasets
+
+  @return
+    A string that changes whenever one of the files does
+*/
+std::string ResidentData::stamp(const std::string &dir,
+                                const std::vector<BethYw::InputFileSource> &datasets) {
+    std::string text;
+    std::vector<std::string> files = {"areas.csv"};
+    for (const auto &source : datasets) {
+        files.push_back(source.FILE);
+    }
+
+    for (const auto &file : files) {
+        struct stat info;
+        if (::stat((dir + file).c_str(), &info) != 0) {
+            text += file + ":missing;";
+            continue;
+        }
+#ifdef __linux__
+        const long long nanoseconds = (long long) info.st_mtim.tv_nsec;
+#else
+        const long long nanoseconds = 0;
+#endif
+        text += file + ":" + std::to_string((unsigned long long) info.st_size) + ":"
+                + std::to_string((long long) info.st_mtime) + "." + std::to_string(nanoseconds) + ";";
+    }
+    return text;
+}
+
+/*
+  Retrieve the stamp (see stamp()) of the files as they were when they were
+  imported.
+
+  @return
+    The stamp
+*/
+const std::string &ResidentData::getStamp() const {
+    return loadedStamp;
+}
+
+/*
+  Retrieve the directory the data was imported from.
+
+  @return
+    The directory, ending in a directory separator
+*/
+const std::string &ResidentData::getDir() const {
+    return dir;
+}
+
+/*
+  Retrieve the datasets that were imported, in the order they were given.
+
+  @return
+    The datasets
+*/
+const std::vector<BethYw::InputFileSource> &ResidentData::getDatasets() const {
+    return sources;
+}
+
+/*
+  Check whether a dataset was imported.
+
+  @param code
+    The dataset's code, e.g. "popden"
+
+  @return
+    true if the dataset is held in memory
+*/
+bool ResidentData::hasDataset(const std::string &code) const {
+    return datasets.find(code) != datasets.end();
+}
+
+/*
+  Retrieve the number of datasets held in memory.
+
+  @return
+    The number of datasets
+*/
+size_t ResidentData::datasetCount() const {
+    return datasets.size();
+}
+
+/*
+  Retrieve the index of the names in areas.csv, which queries resolve their
+  areas filters with.
+
+  @return
+    The NameIndex
+*/
+const NameIndex &ResidentData::getNameIndex() const {
+    return *names;
+}
+
+/*
+  Fill an Areas object with what a normal run would import from the files
+  with the same datasets and filters.
+
+  @param areas
+    The (empty) Areas object to fill, which may have quantile tracking
+    enabled
+
+  @param datasetsToImport
+    The datasets to include
+
+  @param areasFilter
+    The areas to include, or an empty set for all of them, resolved with
+    NameIndex::resolve() as a normal run does
+
+  @param measuresFilter
+    The measures to include, or an empty set for all of them
+
+  @param yearsFilter
+    The range of years to include, or <0,0> for all of them
+
+  @param predicates
+    The value predicates (--where) an area must pass to be included, or an
+    empty vector to include areas whatever their values. They are checked
+    against the values a normal run would end up with: a single dataset is
+    screened with the zone maps built when it was imported, and several are
+    merged first (just the compared measures) so that a value overwritten by
+    a later dataset cannot pass
+
+  @throws
+    std::invalid_argument if one of the datasets is not held in memory
+
+  @example
+    Areas data = Areas();
+    resident.query(data, {BethYw::InputFiles::POPDEN}, {"W06000011"}, {}, {0, 0});
+*/
+void ResidentData::query(Areas &areas,
+                         const std::vector<BethYw::InputFileSource> &datasetsToImport,
+                         const StringFilterSet &areasFilter,
+                         const StringFilterSet &measuresFilter,
+                         const YearFilterTuple &yearsFilter,
+                         const std::vector<ValuePredicate> &predicates) const {
+    StringFilterSet resolved = areasFilter;
+    if (!resolve(datasetsToImport, resolved, predicates)) {
+        return;
+    }
+
+    mergeFrom(areas, *this->areas, &resolved, nullptr, nullptr);
+    for (const auto &source : datasetsToImport) {
+        mergeFrom(areas, *datasets.at(source.CODE), &resolved, &measuresFilter, &yearsFilter);
+    }
+}
+
+/*
+  Fill an Areas object for each of several queries of the same datasets,
+  as query() would fill it for each query on its own, but walking
+  areas.csv and each dataset only once between them.
+
+  The union of the queries' selections (every area, measure and year any of
+  them asks for) is merged out of areas.csv and each dataset once, and each
+  query's own selection is then merged out of that much smaller union. A
+  value is in a query's selection only if it is in the union, and the union
+  keeps the names and labels of each area and measure it keeps, so the
+  result is the same as merging straight from the datasets.
+
+  @param areas
+    The (empty) Areas object to fill for each selection, in the same order,
+    each of which may have quantile tracking enabled
+
+  @param datasetsToImport
+    The datasets every query includes
+
+  @param selections
+    What each query selects from the datasets, as given to query()
+
+  @throws
+    std::invalid_argument if one of the datasets is not held in memory, or
+    there is not an Areas object for each selection
+
+  @example
+    Areas cardiff = Areas(), pop = Areas();
+    resident.query({&cardiff, &pop}, {BethYw::InputFiles::POPDEN},
+                   {{{"W06000015"}, {}, {0, 0}, {}}, {{}, {"pop"}, {2015, 2015}, {}}});
+*/
+void ResidentData::query(const std::vector<Areas *> &areas,
+                         const std::vector<BethYw::InputFileSource> &datasetsToImport,
+                         const std::vector<Selection> &selections) const {
+    if (areas.size() != selections.size()) {
+        throw std::invalid_argument("ResidentData::query: one Areas object is needed per selection");
+    }
+
+    // Resolve (and screen) each query's areas, and widen the union to take
+    // in its selection; an empty filter in the union means everything
+    std::vector<StringFilterSet> resolved(selections.size());
+    std::vector<bool> selected(selections.size(), false);
+    StringFilterSet unionAreas, unionMeasures;
+    YearFilterTuple unionYears(0, 0);
+    bool anyArea = false, anyMeasure = false, anyYear = false, first = true;
+    for (size_t i = 0; i < selections.size(); i++) {
+        const Selection &selection = selections[i];
+        resolved[i] = selection.areasFilter;
+        if (!resolve(datasetsToImport, resolved[i], selection.predicates)) {
+            continue;
+        }
+        selected[i] = true;
+
+        anyArea = anyArea || resolved[i].empty();
+        unionAreas.insert(resolved[i].begin(), resolved[i].end());
+        anyMeasure = anyMeasure || selection.measuresFilter.empty();
+        unionMeasures.insert(selection.measuresFilter.begin(), selection.measuresFilter.end());
+
+        const unsigned int from = std::get<0>(selection.yearsFilter);
+        const unsigned int to = std::get<1>(selection.yearsFilter);
+        anyYear = anyYear || (from == 0 && to == 0);
+        if (first || from < std::get<0>(unionYears)) {
+            std::get<0>(unionYears) = from;
+        }
+        if (first || to > std::get<1>(unionYears)) {
+            std::get<1>(unionYears) = to;
+        }
+        first = false;
+    }
+    if (first) {
+        return;
+    }
+    if (anyArea) {
+        unionAreas.clear();
+    }
+    if (anyMeasure) {
+        unionMeasures.clear();
+    }
+    if (anyYear) {
+        unionYears = YearFilterTuple(0, 0);
+    }
+
+    Areas sharedAreas = Areas();
+    mergeFrom(sharedAreas, *this->areas, &unionAreas, nullptr, nullptr);
+    std::vector<Areas> shared(datasetsToImport.size());
+    for (size_t d = 0; d < datasetsToImport.size(); d++) {
+        mergeFrom(shared[d], *datasets.at(datasetsToImport[d].CODE),
+                  &unionAreas, &unionMeasures, &unionYears);
+    }
+
+    for (size_t i = 0; i < selections.size(); i++) {
+        if (!selected[i]) {
+            continue;
+        }
+        areas[i]->mergeFiltered(sharedAreas, &resolved[i], nullptr, nullptr);
+        for (const auto &dataset : shared) {
+            areas[i]->mergeFiltered(dataset, &resolved[i], &selections[i].measuresFilter,
+                                    &selections[i].yearsFilter);
+        }
+    }
+}
+
+/*
+  Check that the datasets are all held, resolve an areas filter with
+  NameIndex::resolve() as a normal run does, and narrow it down to the
+  areas that pass the value predicates, if any.
+
+  A value that a later dataset overwrites must not pass, so with more than
+  one dataset the compared measures are merged first, in every year, as a
+  normal run imports them; a single dataset is screened with the zone maps
+  built when it was imported.
+
+  @param datasetsToImport
+    The datasets to include
+
+  @param areasFilter
+    The areas filter to resolve, in place
+
+  @param predicates
+    The value predicates (--where), or an empty vector
+
+  @return
+    false if no area passes the predicates, so nothing is to be merged
+
+  @throws
+    std::invalid_argument if one of the datasets is not held in memory
+*/
+bool ResidentData::resolve(const std::vector<BethYw::InputFileSource> &datasetsToImport,
+                           StringFilterSet &areasFilter,
+                           const std::vector<ValuePredicate> &predicates) const {
+    for (const auto &source : datasetsToImport) {
+        if (!hasDataset(source.CODE)) {
+            throw std::invalid_argument("Dataset not loaded by the server: " + source.CODE);
+        }
+    }
+
+    names->resolve(areasFilter);
+
+    if (!predicates.empty()) {
+        Areas screening = Areas();
+        const Areas *source = &screening;
+        if (datasetsToImport.size() == 1) {
+            source = datasets.at(datasetsToImport.front().CODE).get();
+        } else {
+            StringFilterSet compared;
+            for (const auto &predicate : predicates) {
+                compared.insert(predicate.getMeasure());
+            }
+            const YearFilterTuple everyYear(0, 0);
+            for (const auto &dataset : datasetsToImport) {
+                mergeFrom(screening, *datasets.at(dataset.CODE), &areasFilter, &compared,
+                          &everyYear);
+            }
+        }
+        const std::set<std::string> passed = ValuePredicate::screen(predicates, {source},
+                                                                    areasFilter);
+        if (passed.empty()) {
+            return false;
+        }
+        areasFilter = StringFilterSet(passed.begin(), passed.end());
+    }
+    return true;
+}
+
+/*
+  Merge from areas.csv or a held dataset with Areas::mergeFiltered(),
+  counting the traversal (see getTraversals()).
+*/
+void ResidentData::mergeFrom(Areas &areas, const Areas &source,
+                             const StringFilterSet *areasFilter,
+                             const StringFilterSet *measuresFilter,
+                             const YearFilterTuple *yearsFilter) const {
+    traversals.count++;
+    areas.mergeFiltered(source, areasFilter, measuresFilter, yearsFilter);
+}
+
+/*
+  Retrieve the number of times areas.csv or one of the datasets held has
+  been merged from by the queries so far.
+
+  @return
+    The number of traversals of the data held
+*/
+uint64_t ResidentData::getTraversals() const {
+    return traversals.count;
+}
@@ -0,0 +1,113 @@
+#ifndef RESIDENT_H_
+#define RESIDENT_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the ResidentData class, which holds
+  the areas and datasets, unfiltered, in memory so that many queries can be
+  answered without loading any files (see --serve in bethyw.cpp).
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "datasets.h"
+#include "areas.h"
+#include "nameindex.h"
+#include "predicate.h"
+#include "snapshotcache.h"
+
+/*
+  ResidentData imports areas.csv and each dataset once, without filters, and
+  keeps them apart from one another. A query then builds the Areas object a
+  normal run would have imported, with Areas::mergeFiltered(), which applies
+  the filters by the same rules as the populate functions.
+
+  A ResidentData object is never modified after it is constructed, so any
+  number of threads may query it at once. Each dataset (and the areas) is
+  held through a shared pointer, so that reloaded() can make a new
+  ResidentData that re-imports only the files that changed and shares the
+  rest with the old one: a dataset's contribution is exactly its own Areas
+  object, so replacing it cannot disturb the others.
+*/
+class ResidentData {
+public:
+  /*
+    What one query selects from the datasets it asks for (see query()).
+  */
+  struct Selection {
+    StringFilterSet areasFilter;
+    StringFilterSet measuresFilter;
+    YearFilterTuple yearsFilter;
+    std::vector<ValuePredicate> predicates;
+  };
+
+  ResidentData(std::string dir,
+               const std::vector<BethYw::InputFileSource> &datasets,
+               SnapshotCache *cache = nullptr);
+
+  std::unique_ptr<ResidentData> reloaded(const std::set<std::string> &changedFiles,
+                                         SnapshotCache *cache = nullptr) const;
+
+  static std::string stamp(const std::string &dir,
+                           const std::vector<BethYw::InputFileSource> &datasets);
+
+  const std::string &getDir() const;
+  const std::string &getStamp() const;
+  const std::vector<BethYw::InputFileSource> &getDatasets() const;
+  bool hasDataset(const std::string &code) const;
+  size_t datasetCount() const;
+  const NameIndex &getNameIndex() const;
+
+  void query(Areas &areas,
+             const std::vector<BethYw::InputFileSource> &datasetsToImport,
+             const StringFilterSet &areasFilter,
+             const StringFilterSet &measuresFilter,
+             const YearFilterTuple &yearsFilter,
+             const std::vector<ValuePredicate> &predicates = {}) const;
+  void query(const std::vector<Areas *> &areas,
+             const std::vector<BethYw::InputFileSource> &datasetsToImport,
+             const std::vector<Selection> &selections) const;
+  uint64_t getTraversals() const;
+
+private:
+  static std::shared_ptr<const Areas> importAreas(std::string dir);
+  static std::shared_ptr<const Areas> importDataset(std::string dir,
+                                                    const BethYw::InputFileSource &source,
+                                                    SnapshotCache *cache);
+  bool resolve(const std::vector<BethYw::InputFileSource> &datasetsToImport,
+               StringFilterSet &areasFilter,
+               const std::vector<ValuePredicate> &predicates) const;
+  void mergeFrom(Areas &areas, const Areas &source,
+                 const StringFilterSet *areasFilter,
+                 const StringFilterSet *measuresFilter,
+                 const YearFilterTuple *yearsFilter) const;
+
+  std::string dir;
+  std::string loadedStamp;
+  std::shared_ptr<const Areas> areas;
+  std::shared_ptr<const NameIndex> names;
+  std::vector<BethYw::InputFileSource> sources;
+  std::map<std::string, std::shared_ptr<const Areas>> datasets;
+
+  // The number of times areas.csv or a dataset has been merged from, which
+  // a copy made by reloaded() starts again from zero
+  struct Counter {
+    Counter() = default;
+    Counter(const Counter &) {}
+    std::atomic<uint64_t> count{0};
+  };
+  mutable Counter traversals;
+};
+
+#endif // RESIDENT_H_
@@ -0,0 +1,381 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the ResultCache and
+  ResultRecording classes.
+
+  Each entry is a file named <hash of key>.result, which starts with the
+  line "bethyw-result <length of key>", then the key, then the output
+  exactly as it was written.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#else
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <sys/utime.h>
+#endif
+
+#include "resultcache.h"
+
+namespace {
+
+const std::string RESULT_EXTENSION = ".result";
+
+/*
+  Hash a string with 64-bit FNV-1a.
+*/
+uint64_t hashString(const std::string &text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+/*
+  Construct a ResultRecording that writes to a stream and to a temporary
+  file, which becomes a cache entry when it is committed.
+
+  @param os
+    The stream the output is really for
+
+  @param path
+    The path of the cache entry
+
+  @param temporary
+    The path to write the entry to until it is committed
+*/
+ResultRecording::ResultRecording(std::ostream &os, std::string path, std::string temporary)
+    : path(std::move(path)),
+      temporary(std::move(temporary)),
+      file(this->temporary, std::ios::binary | std::ios::trunc),
+      tee(os.rdbuf(), file.rdbuf()),
+      out(&tee),
+      committed(false) {}
+
+/*
+  Remove the temporary file if the recording was never committed.
+*/
+ResultRecording::~ResultRecording() {
+    if (!committed) {
+        file.close();
+        std::remove(temporary.c_str());
+    }
+}
+
+/*
+  Retrieve the stream to write the output to.
+
+  @return
+    A stream that writes to both the original stream and the cache entry
+*/
+std::ostream &ResultRecording::stream() {
+    return out;
+}
+
+/*
+  Flush everything and move the temporary file into place.
+
+  @return
+    true if the cache entry was written
+*/
+bool ResultRecording::finish() {
+    out.flush();
+    file.close();
+    if (!out || !file) {
+        return false;
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    committed = true;
+    return true;
+}
+
+ResultRecording::TeeBuffer::TeeBuffer(std::streambuf *first, std::streambuf *second)
+    : first(first), second(second) {}
+
+int ResultRecording::TeeBuffer::overflow(int c) {
+    if (c == traits_type::eof()) {
+        return traits_type::not_eof(c);
+    }
+    const bool written = first->sputc((char) c) != traits_type::eof();
+    if (second->sputc((char) c) == traits_type::eof() || !written) {
+        return traits_type::eof();
+    }
+    return c;
+}
+
+std::streamsize ResultRecording::TeeBuffer::xsputn(const char *s, std::streamsize n) {
+    const std::streamsize written = first->sputn(s, n);
+    return std::min(written, second->sputn(s, n));
+}
+
+int ResultRecording::TeeBuffer::sync() {
+    const int firstResult = first->pubsync();
+    const int secondResult = second->pubsync();
+    return firstResult == 0 && secondResult == 0 ? 0 : -1;
+}
+
+/*
+  Construct a ResultCache that keeps its entries in a directory, which is
+  created when the first entry is written if it does not already exist.
+
+  @param dir
+    The directory to keep the entries in
+
+  @param maxBytes
+    The most the entries may add up to before the least recently used are
+    removed
+
+  @example
+    ResultCache cache("/tmp/bethyw-results", 256 * 1024 * 1024);
+*/
+ResultCache::ResultCache(std::string dir, uint64_t maxBytes)
+    : dir(std::move(dir)), maxBytes(maxBytes) {
+    if (!this->dir.empty() && this->dir.back() != '/' && this->dir.back() != '\\') {
+        this->dir += '/';
+    }
+}
+
+/*
+  Describe the current version of a file by its size, modification time and
+  inode, for use in a key. Only the file's metadata is read, so that a hit
+  does not read the datasets at all: a file that is rewritten or replaced
+  gets a new modification time (or, if it is renamed into place, a new
+  inode).
+
+  @param path
+    The path of the file
+
+  @return
+    The fingerprint of the file
+
+  @throws
+    std::runtime_error if the file cannot be read
+*/
+std::string ResultCache::fingerprint(const std::string &path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+#ifdef __linux__
+    //a file rewritten within the same second is told apart by nanoseconds
+    const long long modified = (long long) info.st_mtim.tv_sec * 1000000000LL
+                               + info.st_mtim.tv_nsec;
+#else
+    const long long modified = (long long) info.st_mtime;
+#endif
+    char text[80];
+    std::snprintf(text, sizeof(text), "%llu-%lld-%llu",
+                  (unsigned long long) info.st_size,
+                  modified,
+                  (unsigned long long) info.st_ino);
+    return text;
+}
+
+/*
+  The path of the cache entry for a key.
+*/
+std::string ResultCache::entryPath(const std::string &key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hashString(key));
+    return dir + name + RESULT_EXTENSION;
+}
+
+/*
+  The start of the cache entry for a key.
+*/
+std::string ResultCache::header(const std::string &key) {
+    return "bethyw-result " + std::to_string(key.size()) + "\n" + key;
+}
+
+/*
+  Copy the output cached for a key, if there is one, to a stream, and mark
+  the entry as recently used.
+
+  @param key
+    The key, which should describe everything the output depends on
+
+  @param os
+    The stream to write the output to
+
+  @return
+    true if there was an entry for the key, which has been written to os
+*/
+bool ResultCache::replay(const std::string &key, std::ostream &os) const {
+    const std::string path = entryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const std::string expected = header(key);
+    std::string found(expected.size(), '\0');
+    file.read(&found[0], (std::streamsize) found.size());
+    if (!file || found != expected) {
+        return false;
+    }
+
+    std::vector<char> chunk(1 << 16);
+    while (file) {
+        file.read(chunk.data(), (std::streamsize) chunk.size());
+        os.write(chunk.data(), file.gcount());
+    }
+    os.flush();
+
+    ::utime(path.c_str(), nullptr);
+    return true;
+}
+
+/*
+  Start recording the output for a key.
+
+  @param key
+    The key, which should describe everything the output depends on
+
+  @param os
+    The stream the output is really for
+
+  @return
+    The recording to write the output to, or nullptr if the cache directory
+    cannot be written to
+
+  @example
+    ResultCache cache("/tmp/bethyw-results", 256 * 1024 * 1024);
+    if (!cache.replay(key, std::cout)) {
+      auto recording = cache.record(key, std::cout);
+      recording->stream() << ...;
+      cache.commit(*recording);
+    }
+*/
+std::unique_ptr<ResultRecording> ResultCache::record(const std::string &key,
+                                                     std::ostream &os) const {
+#ifndef _WIN32
+    ::mkdir(dir.c_str(), 0777);
+    const std::string suffix = ".tmp" + std::to_string(::getpid());
+#else
+    ::_mkdir(dir.c_str());
+    const std::string suffix = ".tmp" + std::to_string(::_getpid());
+#endif
+
+    const std::string path = entryPath(key);
+    std::unique_ptr<ResultRecording> recording(new ResultRecording(os, path, path + suffix));
+    if (!recording->file.is_open()) {
+        return nullptr;
+    }
+
+    const std::string start = header(key);
+    recording->file.write(start.data(), (std::streamsize) start.size());
+    return recording;
+}
+
+/*
+  Add a finished recording to the cache, then remove the least recently used
+  entries if the cache has grown past its size limit.
+
+  @param recording
+    The recording, with all the output written to it
+
+  @return
+    true if the recording was added to the cache
+*/
+bool ResultCache::commit(ResultRecording &recording) const {
+    const bool committed = recording.finish();
+    if (committed) {
+        evict();
+    }
+    return committed;
+}
+
+/*
+  Remove the least recently used entries until they add up to no more than
+  the size limit.
+*/
+void ResultCache::evict() const {
+    struct Entry {
+        std::string path;
+        uint64_t size;
+        long long used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+#ifndef _WIN32
+    DIR *directory = ::opendir(dir.c_str());
+    if (!directory) {
+        return;
+    }
+    while (struct dirent *entry = ::readdir(directory)) {
+        const std::string name = entry->d_name;
+        if (name.size() <= RESULT_EXTENSION.size()
+            || name.compare(name.size() - RESULT_EXTENSION.size(),
+                            RESULT_EXTENSION.size(), RESULT_EXTENSION) != 0) {
+            continue;
+        }
+        struct stat info;
+        if (::stat((dir + name).c_str(), &info) == 0) {
+#ifdef __linux__
+            //entries written within the same second are told apart by nanoseconds
+            const long long used = (long long) info.st_mtim.tv_sec * 1000000000LL
+                                   + info.st_mtim.tv_nsec;
+#else
+            const long long used = (long long) info.st_mtime;
+#endif
+            entries.push_back({dir + name, (uint64_t) info.st_size, used});
+            total += (uint64_t) info.st_size;
+        }
+    }
+    ::closedir(directory);
+#else
+    //the modification times are only to the second here
+    struct __finddata64_t found;
+    const intptr_t handle = ::_findfirst64((dir + "*" + RESULT_EXTENSION).c_str(), &found);
+    if (handle == -1) {
+        return;
+    }
+    do {
+        if (!(found.attrib & _A_SUBDIR)) {
+            entries.push_back({dir + found.name, (uint64_t) found.size, (long long) found.time_write});
+            total += (uint64_t) found.size;
+        }
+    } while (::_findnext64(handle, &found) == 0);
+    ::_findclose(handle);
+#endif
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.used < b.used;
+    });
+    for (const auto &entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        if (std::remove(entry.path.c_str()) == 0) {
+            total -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the ResultCache class, an on-disk
+  cache of the complete output of previous runs, so that a run with the same
+  datasets, filters and output options can copy its output from the cache
+  without loading anything.
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+class ResultCache;
+
+/*
+  A ResultRecording is a stream that writes to another stream (e.g. the
+  standard output) and to a new cache entry at the same time. The entry is
+  only added to the cache by ResultCache::commit(), so a run that fails part
+  way through leaves nothing behind.
+*/
+class ResultRecording {
+public:
+  ResultRecording(std::ostream &os, std::string path, std::string temporary);
+  ResultRecording(const ResultRecording &) = delete;
+  ResultRecording &operator=(const ResultRecording &) = delete;
+  ~ResultRecording();
+
+  std::ostream &stream();
+
+private:
+  friend class ResultCache;
+
+  /*
+    A stream buffer that passes everything on to two others.
+  */
+  class TeeBuffer : public std::streambuf {
+  public:
+    TeeBuffer(std::streambuf *first, std::streambuf *second);
+
+  protected:
+    int overflow(int c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+  private:
+    std::streambuf *first;
+    std::streambuf *second;
+  };
+
+  bool finish();
+
+  std::string path;
+  std::string temporary;
+  std::ofstream file;
+  TeeBuffer tee;
+  std::ostream out;
+  bool committed;
+};
+
+/*
+  A ResultCache keeps each output in a file named after a hash of its key,
+  starting with the key itself so that a hash collision is never mistaken
+  for a hit. When the files add up to more than the size limit, the least
+  recently used (by modification time, which is updated on every hit) are
+  removed.
+*/
+class ResultCache {
+public:
+  ResultCache(std::string dir, uint64_t maxBytes);
+
+  static std::string fingerprint(const std::string &path);
+
+  bool replay(const std::string &key, std::ostream &os) const;
+  std::unique_ptr<ResultRecording> record(const std::string &key, std::ostream &os) const;
+  bool commit(ResultRecording &recording) const;
+  void evict() const;
+
+private:
+  std::string entryPath(const std::string &key) const;
+  static std::string header(const std::string &key);
+
+  std::string dir;
+  uint64_t maxBytes;
+};
+
+#endif // RESULTCACHE_H_
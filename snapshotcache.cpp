@@ -0,0 +1,238 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the SnapshotCache class.
+
+  Snapshots are written to a temporary file and renamed into place, so a
+  run never sees a half-written snapshot, even if several runs share the
+  cache directory.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#else
+#include <direct.h>
+#include <process.h>
+#endif
+
+#include "columnar.h"
+#include "snapshotcache.h"
+
+namespace {
+
+// Change this whenever the parsers or the columnar format change, so that
+// snapshots written by an older build are not used
+const std::string SNAPSHOT_VERSION = "v1";
+const std::string SNAPSHOT_EXTENSION = ".columnar";
+
+} // namespace
+
+/*
+  Construct a SnapshotCache that keeps its snapshots in a directory. The
+  directory is created when the first snapshot is written, if it does not
+  already exist.
+
+  @param dir
+    The directory to keep the snapshots in
+
+  @example
+    SnapshotCache cache("/tmp/bethyw-cache");
+*/
+SnapshotCache::SnapshotCache(std::string dir) : dir(std::move(dir)) {
+    if (!this->dir.empty() && this->dir.back() != '/' && this->dir.back() != '\\') {
+        this->dir += '/';
+    }
+}
+
+/*
+  Hash the contents of a file with 64-bit FNV-1a.
+
+  @param path
+    The path of the file
+
+  @return
+    The hash
+
+  @throws
+    std::runtime_error if the file cannot be read
+*/
+uint64_t SnapshotCache::hashFile(const std::string &path) {
+    const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    std::vector<char> chunk(1 << 16);
+    while (file) {
+        file.read(chunk.data(), (std::streamsize) chunk.size());
+        const std::streamsize read = file.gcount();
+        for (std::streamsize i = 0; i < read; i++) {
+            hash ^= (unsigned char) chunk[i];
+            hash *= FNV_PRIME;
+        }
+    }
+    if (file.bad()) {
+        throw std::runtime_error("Could not read file: " + path);
+    }
+    return hash;
+}
+
+/*
+  Work out where the snapshot of a dataset file would be, from the dataset
+  code and the size, modification time and hash of the file as it is now.
+
+  @param source
+    The dataset
+
+  @param path
+    The path of the dataset file
+
+  @return
+    The path of the snapshot, which may or may not exist
+
+  @throws
+    std::runtime_error if the dataset file cannot be read
+
+  @example
+    SnapshotCache cache("/tmp/bethyw-cache");
+    auto snapshot = cache.snapshotPath(BethYw::InputFiles::POPDEN,
+                                       "datasets/popu1009.json");
+*/
+std::string SnapshotCache::snapshotPath(const BethYw::InputFileSource &source,
+                                        const std::string &path) const {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    char key[64];
+    std::snprintf(key, sizeof(key), "%llu-%lld-%016llx",
+                  (unsigned long long) info.st_size,
+                  (long long) info.st_mtime,
+                  (unsigned long long) hashFile(path));
+
+    return dir + source.CODE + "-" + SNAPSHOT_VERSION + "-" + key + SNAPSHOT_EXTENSION;
+}
+
+/*
+  Load a snapshot, if there is one, into an Areas object.
+
+  @param snapshotPath
+    The path of the snapshot, from snapshotPath()
+
+  @param snapshot
+    The (empty) Areas object to load the snapshot into
+
+  @return
+    true if the snapshot was loaded; false if there is no snapshot, or it
+    could not be read (in which case it is removed)
+*/
+bool SnapshotCache::load(const std::string &snapshotPath, Areas &snapshot) const {
+    struct stat info;
+    if (::stat(snapshotPath.c_str(), &info) != 0) {
+        return false;
+    }
+
+    try {
+        ColumnarReader reader(snapshotPath);
+        reader.toAreas(snapshot);
+        return true;
+    } catch (const std::exception &) {
+        std::remove(snapshotPath.c_str());
+        snapshot = Areas();
+        return false;
+    }
+}
+
+/*
+  Write a snapshot of a dataset, replacing any snapshots of older versions
+  of the same dataset file.
+
+  @param snapshotPath
+    The path of the snapshot, from snapshotPath()
+
+  @param source
+    The dataset the snapshot is of
+
+  @param snapshot
+    The unfiltered data imported from the dataset
+
+  @return
+    true if the snapshot was written; false if it could not be
+*/
+bool SnapshotCache::store(const std::string &snapshotPath,
+                          const BethYw::InputFileSource &source,
+                          const Areas &snapshot) const {
+#ifndef _WIN32
+    ::mkdir(dir.c_str(), 0777);
+    const std::string temporary = snapshotPath + ".tmp" + std::to_string(::getpid());
+#else
+    ::_mkdir(dir.c_str());
+    const std::string temporary = snapshotPath + ".tmp" + std::to_string(::_getpid());
+#endif
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        try {
+            writeColumnar(file, snapshot);
+        } catch (const std::exception &) {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+        file.close();
+        if (!file) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(snapshotPath.c_str());
+#endif
+    if (std::rename(temporary.c_str(), snapshotPath.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+#ifndef _WIN32
+    //remove snapshots of older versions of the same dataset
+    const std::string prefix = source.CODE + "-" + SNAPSHOT_VERSION + "-";
+    const std::string current = snapshotPath.substr(dir.size());
+    DIR *directory = ::opendir(dir.c_str());
+    if (directory) {
+        while (struct dirent *entry = ::readdir(directory)) {
+            const std::string name = entry->d_name;
+            if (name != current
+                && name.compare(0, prefix.size(), prefix) == 0
+                && name.size() > SNAPSHOT_EXTENSION.size()
+                && name.compare(name.size() - SNAPSHOT_EXTENSION.size(),
+                                SNAPSHOT_EXTENSION.size(), SNAPSHOT_EXTENSION) == 0) {
+                std::remove((dir + name).c_str());
+            }
+        }
+        ::closedir(directory);
+    }
+#endif
+
+    return true;
+}
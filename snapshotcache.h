@@ -0,0 +1,51 @@
+#ifndef SNAPSHOTCACHE_H_
+#define SNAPSHOTCACHE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the SnapshotCache class, an on-disk
+  cache of parsed datasets. Each dataset is stored unfiltered as a columnar
+  file (see columnar.h), so that later runs can map it in instead of parsing
+  the original file again, whatever filters they use.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "datasets.h"
+#include "areas.h"
+
+/*
+  A SnapshotCache keeps one snapshot per dataset in a directory. A snapshot
+  is named after the dataset's code and a key made from the size,
+  modification time and FNV-1a hash of the contents of the dataset file, so
+  a snapshot is only used while the file it came from is unchanged.
+  Snapshots for older versions of a file are removed when a new one is
+  written.
+
+  The cache is only ever an optimisation: a snapshot that cannot be read is
+  ignored (and removed), and one that cannot be written is skipped.
+*/
+class SnapshotCache {
+public:
+  explicit SnapshotCache(std::string dir);
+
+  std::string snapshotPath(const BethYw::InputFileSource &source,
+                           const std::string &path) const;
+  bool load(const std::string &snapshotPath, Areas &snapshot) const;
+  bool store(const std::string &snapshotPath,
+             const BethYw::InputFileSource &source,
+             const Areas &snapshot) const;
+
+  static uint64_t hashFile(const std::string &path);
+
+private:
+  std::string dir;
+};
+
+#endif // SNAPSHOTCACHE_H_
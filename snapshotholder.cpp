@@ -0,0 +1,225 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the SnapshotHolder and
+  BackgroundReloader classes.
+
+  All the atomic operations in SnapshotHolder are sequentially consistent:
+  the argument that a publisher never deletes data a reader can still see
+  relies on a reader's increment and epoch check, and the publisher's swap
+  and epoch change, being seen in one order by every thread.
+*/
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "snapshotholder.h"
+
+/*
+  Construct a SnapshotHolder holding some data.
+
+  @param initial
+    The data for readers to see until the first publish()
+
+  @throws
+    std::invalid_argument if there is no data
+*/
+SnapshotHolder::SnapshotHolder(std::unique_ptr<ResidentData> initial)
+    : readers(), epoch(0), current(initial.get()), generation(0), publishing() {
+    if (!initial) {
+        throw std::invalid_argument("A SnapshotHolder needs some data");
+    }
+    readers[0] = 0;
+    readers[1] = 0;
+    initial.release();
+}
+
+/*
+  Delete the current data. There must be no readers left.
+*/
+SnapshotHolder::~SnapshotHolder() {
+    delete current.load();
+}
+
+/*
+  Start reading the current data, without waiting for anything.
+
+  @return
+    A Reader, through which the data stays valid until it is destroyed
+
+  @example
+    auto snapshot = holder.read();
+    snapshot->query(data, datasets, areasFilter, measuresFilter, yearsFilter);
+*/
+SnapshotHolder::Reader SnapshotHolder::read() const {
+    while (true) {
+        const uint64_t seen = epoch.load();
+        std::atomic<long> &counter = readers[seen & 1];
+        counter.fetch_add(1);
+        if (epoch.load() == seen) {
+            return Reader(&counter, current.load());
+        }
+        // A publisher moved on to the next epoch while this reader was
+        // counting itself, and may not be waiting for this counter any more
+        counter.fetch_sub(1);
+    }
+}
+
+/*
+  Replace the data that readers see. The old data is deleted once every
+  reader that could have seen it has finished; this function waits until
+  then, so call it from a thread that can afford to wait (e.g. a
+  BackgroundReloader's).
+
+  @param next
+    The new data
+
+  @throws
+    std::invalid_argument if there is no data
+*/
+void SnapshotHolder::publish(std::unique_ptr<ResidentData> next) {
+    if (!next) {
+        throw std::invalid_argument("A SnapshotHolder needs some data");
+    }
+
+    std::lock_guard<std::mutex> lock(publishing);
+    const ResidentData *old = current.exchange(next.release());
+
+    // Readers that start from now on count themselves in the other counter,
+    // and see the new data
+    const uint64_t previous = epoch.fetch_add(1);
+    std::atomic<long> &counter = readers[previous & 1];
+    while (counter.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    delete old;
+    generation.fetch_add(1);
+}
+
+/*
+  Retrieve the number of times the data has been replaced.
+
+  @return
+    The number of publish() calls that have completed
+*/
+uint64_t SnapshotHolder::getGeneration() const {
+    return generation.load();
+}
+
+SnapshotHolder::Reader::Reader(std::atomic<long> *counter, const ResidentData *data)
+    : counter(counter), data(data) {}
+
+SnapshotHolder::Reader::Reader(Reader &&other) noexcept
+    : counter(other.counter), data(other.data) {
+    other.counter = nullptr;
+    other.data = nullptr;
+}
+
+/*
+  Stop reading, so the data can be deleted once it has been replaced.
+*/
+SnapshotHolder::Reader::~Reader() {
+    if (counter) {
+        counter->fetch_sub(1);
+    }
+}
+
+const ResidentData &SnapshotHolder::Reader::operator*() const {
+    return *data;
+}
+
+const ResidentData *SnapshotHolder::Reader::operator->() const {
+    return data;
+}
+
+/*
+  Construct a BackgroundReloader and start its thread.
+
+  @param holder
+    The SnapshotHolder to publish new data to
+
+  @param load
+    A function that imports the data
+
+  @param stamp
+    A function that returns a string that changes whenever the files do
+
+  @param loadedStamp
+    The stamp of the files when the data in the holder was imported (taken
+    before it was imported, so no change is missed)
+
+  @param interval
+    How often to check the stamp
+
+  @example
+    BackgroundReloader reloader(holder, load, stamp, initialStamp,
+                                std::chrono::seconds(5));
+*/
+BackgroundReloader::BackgroundReloader(SnapshotHolder &holder,
+                                       Loader load,
+                                       Stamp stamp,
+                                       std::string loadedStamp,
+                                       std::chrono::milliseconds interval)
+    : holder(holder),
+      load(std::move(load)),
+      stamp(std::move(stamp)),
+      interval(interval),
+      lastStamp(std::move(loadedStamp)),
+      stopping(false) {
+    thread = std::thread(&BackgroundReloader::run, this);
+}
+
+/*
+  Stop the thread, waiting for any import in progress to finish.
+*/
+BackgroundReloader::~BackgroundReloader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+/*
+  Import the data again and publish it if the files have changed since it
+  was last imported.
+
+  @return
+    true if new data was published
+*/
+bool BackgroundReloader::reloadIfChanged() {
+    std::lock_guard<std::mutex> lock(reloading);
+
+    const std::string now = stamp();
+    if (now == lastStamp) {
+        return false;
+    }
+    lastStamp = now;
+
+    std::unique_ptr<ResidentData> next;
+    try {
+        next = load();
+    } catch (const std::exception &e) {
+        std::cerr << "Could not reload the datasets, keeping the previous data:" << std::endl
+                  << e.what() << std::endl;
+        return false;
+    }
+    holder.publish(std::move(next));
+    return true;
+}
+
+void BackgroundReloader::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+        lock.unlock();
+        reloadIfChanged();
+        lock.lock();
+    }
+}
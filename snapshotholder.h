@@ -0,0 +1,122 @@
+#ifndef SNAPSHOTHOLDER_H_
+#define SNAPSHOTHOLDER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declarations of the SnapshotHolder class, which
+  lets the servers (--serve and --http) swap in newly imported data while
+  they are answering queries, and the BackgroundReloader class, which
+  imports the data again whenever the files change.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "resident.h"
+
+/*
+  A SnapshotHolder holds the current ResidentData. Any number of threads can
+  read it without locking while another publishes a replacement.
+
+  It uses epochs with two reader counters. A reader counts itself in the
+  counter for the current epoch (checking the epoch did not change as it
+  did so), loads the current pointer and uncounts itself when it is done.
+  A publisher swaps the pointer, moves on to the next epoch, and waits for
+  the counter of the previous epoch to reach zero: every reader that could
+  have loaded the old pointer has then left, so it is deleted. Readers never
+  wait, and the writer only waits for readers that were already reading.
+*/
+class SnapshotHolder {
+public:
+  /*
+    A reader's hold on a snapshot, which stays valid (and unchanged) until
+    the Reader is destroyed.
+  */
+  class Reader {
+  public:
+    Reader(Reader &&other) noexcept;
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+    Reader &operator=(Reader &&) = delete;
+    ~Reader();
+
+    const ResidentData &operator*() const;
+    const ResidentData *operator->() const;
+
+  private:
+    friend class SnapshotHolder;
+    Reader(std::atomic<long> *counter, const ResidentData *data);
+
+    std::atomic<long> *counter;
+    const ResidentData *data;
+  };
+
+  explicit SnapshotHolder(std::unique_ptr<ResidentData> initial);
+  SnapshotHolder(const SnapshotHolder &) = delete;
+  SnapshotHolder &operator=(const SnapshotHolder &) = delete;
+  ~SnapshotHolder();
+
+  Reader read() const;
+  void publish(std::unique_ptr<ResidentData> next);
+  uint64_t getGeneration() const;
+
+private:
+  mutable std::atomic<long> readers[2];
+  std::atomic<uint64_t> epoch;
+  std::atomic<const ResidentData *> current;
+  std::atomic<uint64_t> generation;
+  std::mutex publishing;
+};
+
+/*
+  A BackgroundReloader checks, on a thread of its own, whether the files
+  have changed (by comparing a stamp such as ResidentData::stamp()) at a
+  fixed interval, and if they have, imports them again and publishes the
+  result. If the import fails, the old data is kept and the import is tried
+  again at the next change.
+*/
+class BackgroundReloader {
+public:
+  using Loader = std::function<std::unique_ptr<ResidentData>()>;
+  using Stamp = std::function<std::string()>;
+
+  BackgroundReloader(SnapshotHolder &holder,
+                     Loader load,
+                     Stamp stamp,
+                     std::string loadedStamp,
+                     std::chrono::milliseconds interval);
+  BackgroundReloader(const BackgroundReloader &) = delete;
+  BackgroundReloader &operator=(const BackgroundReloader &) = delete;
+  ~BackgroundReloader();
+
+  bool reloadIfChanged();
+
+private:
+  void run();
+
+  SnapshotHolder &holder;
+  Loader load;
+  Stamp stamp;
+  std::chrono::milliseconds interval;
+  std::string lastStamp;
+  std::mutex reloading;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping;
+  std::thread thread;
+};
+
+#endif // SNAPSHOTHOLDER_H_
@@ -0,0 +1,349 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the SpilledAreas class.
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "spilledareas.h"
+
+const size_t SpilledAreas::MAX_MERGE_RUNS;
+
+/*
+  Reads the records of a run back a block at a time.
+*/
+class SpilledAreas::RunReader {
+public:
+  RunReader(const Run &run, size_t blockRecords)
+      : run(run), remaining(run.records), block(blockRecords) {
+      std::rewind(run.file);
+      fill();
+  }
+
+  bool done() const {
+      return position == filled;
+  }
+
+  const Record &current() const {
+      return block[position];
+  }
+
+  void advance() {
+      if (++position == filled) {
+          fill();
+      }
+  }
+
+private:
+  void fill() {
+      const size_t count = (size_t) std::min<uint64_t>(block.size(), remaining);
+      if (count != 0 && std::fread(block.data(), sizeof(Record), count, run.file) != count) {
+          throw std::runtime_error("Could not read a temporary file for --memory-limit");
+      }
+      remaining -= count;
+      filled = count;
+      position = 0;
+  }
+
+  Run run;
+  uint64_t remaining;
+  std::vector<Record> block;
+  size_t filled = 0;
+  size_t position = 0;
+};
+
+/*
+  Construct an empty SpilledAreas.
+
+  @param memoryLimit
+    The most memory, in bytes, to hold records in before spilling them
+
+  @example
+    SpilledAreas spilled(256 * 1024 * 1024);
+*/
+SpilledAreas::SpilledAreas(uint64_t memoryLimit) : memoryLimit(memoryLimit) {
+    buffer.reserve((size_t) std::max<uint64_t>(memoryLimit / 2 / sizeof(Record), 1));
+}
+
+SpilledAreas::~SpilledAreas() {
+    for (const Run &run : runs) {
+        std::fclose(run.file);
+    }
+}
+
+/*
+  Add the areas imported from some rows, which come after those added
+  before: their names are recorded, and their values are added as records,
+  spilling a run if the records fill half the memory limit.
+
+  @param chunk
+    The areas imported from the next rows of a file
+
+  @throws
+    std::runtime_error if a run cannot be written
+
+  @example
+    Areas chunk = Areas();
+    stream.nextRows(chunk, filter, 1024 * 1024);
+    spilled.add(chunk);
+*/
+void SpilledAreas::add(const Areas &chunk) {
+    const uint32_t number = chunks++;
+    for (const auto &area : chunk.getAreasContainer()) {
+        auto entry = areas.find(area.first);
+        if (entry == areas.end()) {
+            entry = areas.emplace(area.first, AreaEntry{(uint32_t) codes.size(), {}}).first;
+            codes.push_back(&entry->first);
+        }
+        for (const auto &name : area.second.getNames()) {
+            entry->second.names[name.first] = name.second;
+        }
+
+        for (const auto &measure : area.second.getMeasures()) {
+            const auto key = std::make_pair(measure.second.getCodename(), measure.second.getLabel());
+            auto id = measureIds.find(key);
+            if (id == measureIds.end()) {
+                id = measureIds.emplace(key, (uint32_t) measures.size()).first;
+                measures.push_back(key);
+            }
+            for (const auto &value : measure.second.getValues()) {
+                buffer.push_back({entry->second.id, number, id->second, value.first, value.second});
+                values++;
+                if (buffer.size() >= buffer.capacity()) {
+                    spill();
+                }
+            }
+        }
+    }
+}
+
+/*
+  Order records by area code, chunk, measure and year.
+*/
+bool SpilledAreas::before(const Record &a, const Record &b) const {
+    if (a.area != b.area) {
+        return *codes[a.area] < *codes[b.area];
+    }
+    if (a.chunk != b.chunk) {
+        return a.chunk < b.chunk;
+    }
+    if (a.measure != b.measure) {
+        return a.measure < b.measure;
+    }
+    return a.year < b.year;
+}
+
+/*
+  Create a temporary file for a run, which is deleted when it is closed.
+*/
+SpilledAreas::Run SpilledAreas::createRun() {
+    std::FILE *file = std::tmpfile();
+    if (!file) {
+        throw std::runtime_error("Could not create a temporary file for --memory-limit");
+    }
+    return Run{file, 0};
+}
+
+/*
+  Sort the records held in memory and write them out as a run.
+*/
+void SpilledAreas::spill() {
+    std::sort(buffer.begin(), buffer.end(), [this](const Record &a, const Record &b) {
+        return before(a, b);
+    });
+
+    Run run = createRun();
+    runs.push_back(run);
+    if (std::fwrite(buffer.data(), sizeof(Record), buffer.size(), run.file) != buffer.size()
+        || std::fflush(run.file) != 0) {
+        throw std::runtime_error("Could not write a temporary file for --memory-limit");
+    }
+    runs.back().records = buffer.size();
+    buffer.clear();
+}
+
+/*
+  Merge some of the runs into one, closing (and so deleting) them.
+*/
+SpilledAreas::Run SpilledAreas::mergeRuns(std::vector<Run> &runs, size_t first, size_t count) {
+    const size_t blockRecords = (size_t) std::max<uint64_t>(
+        256, memoryLimit / 4 / (count + 1) / sizeof(Record));
+
+    std::vector<RunReader> readers;
+    for (size_t i = first; i < first + count; i++) {
+        readers.emplace_back(runs[i], blockRecords);
+    }
+    auto after = [this, &readers](size_t a, size_t b) {
+        return before(readers[b].current(), readers[a].current());
+    };
+    std::vector<size_t> heap;
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (!readers[i].done()) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), after);
+
+    Run merged = createRun();
+    std::vector<Record> block;
+    block.reserve(blockRecords);
+    auto write = [&merged, &block]() {
+        if (std::fwrite(block.data(), sizeof(Record), block.size(), merged.file) != block.size()) {
+            std::fclose(merged.file);
+            throw std::runtime_error("Could not write a temporary file for --memory-limit");
+        }
+        merged.records += block.size();
+        block.clear();
+    };
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        RunReader &reader = readers[heap.back()];
+        block.push_back(reader.current());
+        if (block.size() == blockRecords) {
+            write();
+        }
+        reader.advance();
+        if (reader.done()) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+    }
+    write();
+    std::fflush(merged.file);
+
+    for (size_t i = first; i < first + count; i++) {
+        std::fclose(runs[i].file);
+    }
+    return merged;
+}
+
+/*
+  Rebuild every area, one at a time in authority code order, and pass each
+  to a function in an Areas object of its own, exactly as it would be in an
+  Areas object that all the chunks had been imported into in turn. This can
+  only be done once, as the runs are used up.
+
+  @param visit
+    The function to pass each area to, e.g. to fill its gaps and write it
+
+  @throws
+    std::runtime_error if a run cannot be read or written
+
+  @example
+    spilled.forEachArea([&writer](Areas &area) {
+      writer.write(area);
+    });
+*/
+void SpilledAreas::forEachArea(const std::function<void(Areas &)> &visit) {
+    if (!runs.empty()) {
+        if (!buffer.empty()) {
+            spill();
+        }
+        std::vector<Record>().swap(buffer);
+
+        // Merge runs until there are few enough to read side by side
+        while (runs.size() > MAX_MERGE_RUNS) {
+            const Run merged = mergeRuns(runs, 0, MAX_MERGE_RUNS);
+            runs.erase(runs.begin(), runs.begin() + MAX_MERGE_RUNS);
+            runs.push_back(merged);
+        }
+    } else {
+        std::sort(buffer.begin(), buffer.end(), [this](const Record &a, const Record &b) {
+            return before(a, b);
+        });
+    }
+
+    // The records in order, from the runs or from memory if nothing spilled
+    const size_t blockRecords = (size_t) std::max<uint64_t>(
+        256, memoryLimit / 4 / (runs.size() + 1) / sizeof(Record));
+    std::vector<RunReader> readers;
+    for (const Run &run : runs) {
+        readers.emplace_back(run, blockRecords);
+    }
+    auto after = [this, &readers](size_t a, size_t b) {
+        return before(readers[b].current(), readers[a].current());
+    };
+    std::vector<size_t> heap;
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (!readers[i].done()) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), after);
+    size_t position = 0;
+
+    auto peek = [&]() -> const Record * {
+        if (readers.empty()) {
+            return position < buffer.size() ? &buffer[position] : nullptr;
+        }
+        return heap.empty() ? nullptr : &readers[heap.front()].current();
+    };
+    auto pop = [&]() {
+        if (readers.empty()) {
+            position++;
+            return;
+        }
+        std::pop_heap(heap.begin(), heap.end(), after);
+        RunReader &reader = readers[heap.back()];
+        reader.advance();
+        if (reader.done()) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+    };
+
+    for (const auto &entry : areas) {
+        const uint32_t id = entry.second.id;
+        Area area(entry.first);
+        for (const auto &name : entry.second.names) {
+            area.setName(name.first, name.second);
+        }
+
+        // Replay the area's values a chunk and measure at a time
+        const Record *record;
+        while ((record = peek()) && record->area == id) {
+            const uint32_t chunk = record->chunk;
+            const uint32_t measureId = record->measure;
+            Measure measure(measures[measureId].first, measures[measureId].second);
+            while ((record = peek()) && record->area == id && record->chunk == chunk
+                   && record->measure == measureId) {
+                measure.setValue(record->year, record->value);
+                pop();
+            }
+            area.setMeasure(measures[measureId].first, measure);
+        }
+
+        Areas one = Areas();
+        one.setArea(entry.first, std::move(area));
+        visit(one);
+    }
+}
+
+/*
+  The number of areas added.
+*/
+size_t SpilledAreas::areaCount() const {
+    return areas.size();
+}
+
+/*
+  The number of values added, which may be far more than fit in memory.
+*/
+uint64_t SpilledAreas::valueCount() const {
+    return values;
+}
+
+/*
+  The number of runs spilled to temporary files so far.
+*/
+size_t SpilledAreas::runCount() const {
+    return runs.size();
+}
@@ -0,0 +1,109 @@
+#ifndef SPILLEDAREAS_H_
+#define SPILLEDAREAS_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declaration of the SpilledAreas class, which holds
+  imported data within a memory limit (--memory-limit) by spilling sorted
+  runs of values to temporary files and merging them as it is written out.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A SpilledAreas is filled with Areas objects holding a few rows each, in
+  the order they were imported (see AreaStream::nextRows()), and gives back
+  the same areas as importing everything into one Areas object would, one
+  area at a time in authority code order (see forEachArea()).
+
+  Each value is kept as a small fixed-size record: the area, the measure
+  (codename and label), the year, the value, and the number of the chunk it
+  came from. Records are collected in memory until they take up half of the
+  memory limit, then sorted by area code, chunk, measure and year, and
+  written to a temporary file as a run. forEachArea() merges the runs (in
+  passes of up to MAX_MERGE_RUNS, if there are more) and rebuilds each area
+  by replaying its values in the order of their chunks, so a value
+  imported later replaces an earlier one for the same measure and year just
+  as it does in Areas::setArea().
+
+  The names of each area, and the codename and label of each measure, are
+  few however many values there are, so they are kept in memory.
+*/
+class SpilledAreas {
+public:
+  explicit SpilledAreas(uint64_t memoryLimit);
+  ~SpilledAreas();
+
+  SpilledAreas(const SpilledAreas &) = delete;
+  SpilledAreas &operator=(const SpilledAreas &) = delete;
+
+  static const size_t MAX_MERGE_RUNS = 64;
+
+  void add(const Areas &chunk);
+  void forEachArea(const std::function<void(Areas &)> &visit);
+
+  size_t areaCount() const;
+  uint64_t valueCount() const;
+  size_t runCount() const;
+
+private:
+  struct Record {
+    uint32_t area;
+    uint32_t chunk;
+    uint32_t measure;
+    uint32_t year;
+    double value;
+  };
+
+  /*
+    A run of records sorted by area code, chunk, measure and year, in a
+    temporary file that is deleted when it is closed.
+  */
+  struct Run {
+    std::FILE *file;
+    uint64_t records;
+  };
+
+  class RunReader;
+
+  bool before(const Record &a, const Record &b) const;
+  void spill();
+  Run mergeRuns(std::vector<Run> &runs, size_t first, size_t count);
+  static Run createRun();
+
+  uint64_t memoryLimit;
+  uint32_t chunks = 0;
+  uint64_t values = 0;
+
+  // The names of each area (by code), and each area's position in codes
+  struct AreaEntry {
+    uint32_t id;
+    std::map<std::string, std::string> names;
+  };
+  std::map<std::string, AreaEntry> areas;
+  std::vector<const std::string *> codes;
+
+  // The codename and label of each measure
+  std::map<std::pair<std::string, std::string>, uint32_t> measureIds;
+  std::vector<std::pair<std::string, std::string>> measures;
+
+  std::vector<Record> buffer;
+  std::vector<Run> runs;
+};
+
+#endif // SPILLEDAREAS_H_
@@ -0,0 +1,346 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the implementation of the StageProfiler and
+  CountingStreambuf classes, and the replacement operator new and delete
+  that count allocations for them.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+
+#include <sys/stat.h>
+
+#include "lib_json.hpp"
+
+#include "stageprofiler.h"
+
+namespace {
+
+// The number of profilers, and the allocations counted while there are any
+std::atomic<int> profilers(0);
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> allocatedBytes(0);
+
+void *allocate(std::size_t size) {
+    if (profilers.load(std::memory_order_relaxed) != 0) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocateOrThrow(std::size_t size) {
+    while (true) {
+        void *memory = allocate(size);
+        if (memory) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    return allocateOrThrow(size);
+}
+
+void *operator new[](std::size_t size) {
+    return allocateOrThrow(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+/*
+  Construct a profiler whose first stage starts now.
+
+  @example
+    StageProfiler profiler;
+    profiler.stage("parse", bytes, rows);
+    profiler.toTable(std::cerr);
+*/
+StageProfiler::StageProfiler() : StageProfiler(now()) {}
+
+/*
+  Construct a profiler whose first stage started at an earlier moment, e.g.
+  before the arguments were parsed (allocations before then are not counted,
+  as no profiler existed yet).
+
+  @param start
+    The moment the first stage started, from now()
+
+  @example
+    const StageProfiler::Sample started = StageProfiler::now();
+    auto args = cxxopts.parse(argc, argv);
+    StageProfiler profiler(started);
+    profiler.stage("args");
+*/
+StageProfiler::StageProfiler(const Sample &start) : mark(start) {
+    profilers.fetch_add(1);
+}
+
+StageProfiler::~StageProfiler() {
+    profilers.fetch_sub(1);
+}
+
+/*
+  Read the clocks and allocation counters.
+
+  @return
+    The current wall clock, process CPU time and allocation counts
+*/
+StageProfiler::Sample StageProfiler::now() {
+    return Sample{std::chrono::steady_clock::now(),
+                  (double) std::clock() / CLOCKS_PER_SEC,
+                  allocations.load(std::memory_order_relaxed),
+                  allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+/*
+  The size of a file, for the bytes a stage reads.
+
+  @param path
+    The path of the file
+
+  @return
+    The size in bytes, or 0 if the file cannot be found
+*/
+uint64_t StageProfiler::fileSize(const std::string &path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return 0;
+    }
+    return (uint64_t) info.st_size;
+}
+
+/*
+  Record the stage that has just finished, as everything since the previous
+  stage finished, and start the next.
+
+  @param name
+    The name of the stage
+
+  @param bytes
+    The bytes the stage read or wrote
+
+  @param rows
+    The rows (areas, or values) the stage handled
+
+  @example
+    profiler.stage("popden: parse", 121157, 726);
+*/
+void StageProfiler::stage(const std::string &name, uint64_t bytes, uint64_t rows) {
+    const Sample finished = now();
+    stages.push_back({name,
+                      std::chrono::duration<double>(finished.wall - mark.wall).count(),
+                      finished.cpu - mark.cpu,
+                      bytes,
+                      rows,
+                      finished.allocations - mark.allocations,
+                      finished.allocatedBytes - mark.allocatedBytes});
+    mark = finished;
+}
+
+/*
+  Retrieve the recorded stages, in the order they ran.
+
+  @return
+    The stages
+*/
+const std::vector<StageProfiler::Stage> &StageProfiler::getStages() const {
+    return stages;
+}
+
+/*
+  Add up the recorded stages.
+
+  @return
+    A stage named "total" with the sums of all of them
+*/
+StageProfiler::Stage StageProfiler::total() const {
+    Stage sum = {"total", 0, 0, 0, 0, 0, 0};
+    for (const Stage &stage : stages) {
+        sum.wallSeconds += stage.wallSeconds;
+        sum.cpuSeconds += stage.cpuSeconds;
+        sum.bytes += stage.bytes;
+        sum.rows += stage.rows;
+        sum.allocations += stage.allocations;
+        sum.allocatedBytes += stage.allocatedBytes;
+    }
+    return sum;
+}
+
+/*
+  Write the stages as a table, with the throughput of each stage that
+  handled any bytes or rows, and their total:
+
+    Stage                 Wall ms   CPU ms      Bytes     MB/s    Rows   Rows/s  Allocs  Alloc KB
+    args                    0.412    0.398          0        -       0        -     312      21.4
+    popden: parse          21.093   21.071     560218    25.33    1584    75097   41090    2211.9
+
+  @param os
+    The stream to write to
+*/
+void StageProfiler::toTable(std::ostream &os) const {
+    const auto flags = os.flags();
+    const auto precision = os.precision();
+
+    size_t width = 5;
+    for (const Stage &stage : stages) {
+        width = std::max(width, stage.name.size());
+    }
+    os << std::left << std::setw((int) width) << "Stage" << std::right
+       << std::setw(11) << "Wall ms" << std::setw(11) << "CPU ms"
+       << std::setw(13) << "Bytes" << std::setw(10) << "MB/s"
+       << std::setw(11) << "Rows" << std::setw(12) << "Rows/s"
+       << std::setw(10) << "Allocs" << std::setw(11) << "Alloc KB" << '\n';
+
+    auto write = [&](const Stage &stage) {
+        os << std::left << std::setw((int) width) << stage.name << std::right << std::fixed
+           << std::setprecision(3) << std::setw(11) << stage.wallSeconds * 1000
+           << std::setw(11) << stage.cpuSeconds * 1000
+           << std::setw(13) << stage.bytes;
+        if (stage.bytes != 0 && stage.wallSeconds > 0) {
+            os << std::setprecision(2) << std::setw(10)
+               << (double) stage.bytes / stage.wallSeconds / (1024 * 1024);
+        } else {
+            os << std::setw(10) << "-";
+        }
+        os << std::setw(11) << stage.rows;
+        if (stage.rows != 0 && stage.wallSeconds > 0) {
+            os << std::setprecision(0) << std::setw(12) << (double) stage.rows / stage.wallSeconds;
+        } else {
+            os << std::setw(12) << "-";
+        }
+        os << std::setw(10) << stage.allocations
+           << std::setprecision(1) << std::setw(11) << (double) stage.allocatedBytes / 1024
+           << '\n';
+    };
+    for (const Stage &stage : stages) {
+        write(stage);
+    }
+    write(total());
+    os.flush();
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+/*
+  Write the stages as JSON:
+
+    { "stages": [ { "name": "args", "wall_seconds": 0.000412,
+                    "cpu_seconds": 0.000398, "bytes": 0, "rows": 0,
+                    "allocations": 312, "allocated_bytes": 21904 }, … ],
+      "total": { … } }
+
+  @param os
+    The stream to write to
+*/
+void StageProfiler::toJSON(std::ostream &os) const {
+    auto stageJSON = [](const Stage &stage) {
+        return nlohmann::json{{"name", stage.name},
+                              {"wall_seconds", stage.wallSeconds},
+                              {"cpu_seconds", stage.cpuSeconds},
+                              {"bytes", stage.bytes},
+                              {"rows", stage.rows},
+                              {"allocations", stage.allocations},
+                              {"allocated_bytes", stage.allocatedBytes}};
+    };
+
+    nlohmann::json j = {{"stages", nlohmann::json::array()}};
+    for (const Stage &stage : stages) {
+        j["stages"].push_back(stageJSON(stage));
+    }
+    j["total"] = stageJSON(total());
+    os << j.dump() << std::endl;
+}
+
+/*
+  Construct a stream buffer that passes what is written to it on to another.
+
+  @param target
+    The stream buffer to write to, e.g. std::cout.rdbuf()
+
+  @example
+    CountingStreambuf counter(std::cout.rdbuf());
+    std::ostream counted(&counter);
+    counted << "text";
+    counter.count(); // 4
+*/
+CountingStreambuf::CountingStreambuf(std::streambuf *target) : target(target) {}
+
+/*
+  The number of bytes written so far.
+
+  @return
+    The number of bytes
+*/
+uint64_t CountingStreambuf::count() const {
+    return written;
+}
+
+CountingStreambuf::int_type CountingStreambuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    if (traits_type::eq_int_type(target->sputc(traits_type::to_char_type(c)),
+                                 traits_type::eof())) {
+        return traits_type::eof();
+    }
+    written++;
+    return c;
+}
+
+std::streamsize CountingStreambuf::xsputn(const char *s, std::streamsize n) {
+    const std::streamsize put = target->sputn(s, n);
+    written += (uint64_t) put;
+    return put;
+}
+
+int CountingStreambuf::sync() {
+    return target->pubsync();
+}
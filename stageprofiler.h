@@ -0,0 +1,111 @@
+#ifndef STAGEPROFILER_H_
+#define STAGEPROFILER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  This file contains the declarations of the StageProfiler and
+  CountingStreambuf classes, which --profile-stages uses to report the time,
+  bytes, rows and allocations of each stage of a run.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/*
+  A StageProfiler divides a run into consecutive stages. A run marks the end
+  of each stage with stage(), giving its name and the bytes and rows it
+  handled, and the stage is recorded as everything since the end of the one
+  before (or since the profiler's start), so the stages add up to the whole
+  run:
+
+    StageProfiler profiler;
+    loadAreas(...);
+    profiler.stage("loadAreas", fileSize, areas.size());
+
+  Each stage has its wall time, the CPU time of the process (all of its
+  threads), and the number and total size of the allocations made with
+  operator new, which this file replaces to count them while any profiler
+  exists (and otherwise only checks a flag). bethyw.cpp uses the profiler,
+  so the replacement is in every program built with it: bethyw, the tests
+  and the benchmarks.
+
+  The report is a table or JSON (toTable() and toJSON()).
+*/
+class StageProfiler {
+public:
+  /*
+    The clocks and allocation counters at one moment.
+  */
+  struct Sample {
+    std::chrono::steady_clock::time_point wall;
+    double cpu;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+  };
+
+  /*
+    One recorded stage.
+  */
+  struct Stage {
+    std::string name;
+    double wallSeconds;
+    double cpuSeconds;
+    uint64_t bytes;
+    uint64_t rows;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+  };
+
+  StageProfiler();
+  explicit StageProfiler(const Sample &start);
+  ~StageProfiler();
+
+  StageProfiler(const StageProfiler &) = delete;
+  StageProfiler &operator=(const StageProfiler &) = delete;
+
+  static Sample now();
+  static uint64_t fileSize(const std::string &path);
+
+  void stage(const std::string &name, uint64_t bytes = 0, uint64_t rows = 0);
+  const std::vector<Stage> &getStages() const;
+  Stage total() const;
+
+  void toTable(std::ostream &os) const;
+  void toJSON(std::ostream &os) const;
+
+private:
+  Sample mark;
+  std::vector<Stage> stages;
+};
+
+/*
+  A CountingStreambuf passes everything written to it on to another stream
+  buffer, counting the bytes, so that the bytes a stage writes can be
+  reported whatever the output stream is (std::cout has no position).
+*/
+class CountingStreambuf : public std::streambuf {
+public:
+  explicit CountingStreambuf(std::streambuf *target);
+
+  uint64_t count() const;
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+  int sync() override;
+
+private:
+  std::streambuf *target;
+  uint64_t written = 0;
+};
+
+#endif // STAGEPROFILER_H_
@@ -0,0 +1,104 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "../areas.h"
+#include "../correlation.h"
+
+SCENARIO( "a CorrelationMatrix can be computed between measures", "[CorrelationMatrix]" ) {
+
+  GIVEN( "an Areas instance with three measures in three areas" ) {
+
+    Areas areas = Areas();
+
+    // pop rises with dens, area falls as they rise, and rail is missing once
+    const double pops[]  = {100, 200, 300};
+    const double dens[]  = {10, 20, 30};
+    const double sizes[] = {9, 6, 1};
+    const std::string codes[] = {"W06000001", "W06000002", "W06000003"};
+
+    for (int i = 0; i < 3; i++) {
+      Area area(codes[i]);
+      Measure pop("pop", "Population");
+      pop.setValue(2015, pops[i]);
+      pop.setValue(2016, pops[i] * 2);
+      Measure den("dens", "Population density");
+      den.setValue(2015, dens[i]);
+      den.setValue(2016, dens[i] + 1);
+      Measure size("area", "Land area");
+      size.setValue(2015, sizes[i]);
+      area.setMeasure("pop", pop);
+      area.setMeasure("dens", den);
+      area.setMeasure("area", size);
+      areas.setArea(codes[i], area);
+    }
+
+    WHEN( "the measures are compared across areas for a year" ) {
+
+      auto matrix = CorrelationMatrix::acrossAreas(areas, 2015);
+
+      THEN( "every measure is included in codename order" ) {
+
+        REQUIRE( matrix.size() == 3 );
+        REQUIRE( matrix.getCodenames()[0] == "area" );
+        REQUIRE( matrix.getCodenames()[1] == "dens" );
+        REQUIRE( matrix.getCodenames()[2] == "pop" );
+
+      } // THEN
+
+      THEN( "the coefficients are correct and symmetric" ) {
+
+        REQUIRE( matrix.getCoefficient(2, 2) == Approx(1.0) );
+        REQUIRE( matrix.getCoefficient(1, 2) == Approx(1.0) );
+        REQUIRE( matrix.getCoefficient(0, 2) == Approx(-0.9897433186) );
+        REQUIRE( matrix.getCoefficient(2, 0) == matrix.getCoefficient(0, 2) );
+
+      } // THEN
+
+      THEN( "an invalid index throws an exception" ) {
+
+        REQUIRE_THROWS_AS( matrix.getCoefficient(0, 3), std::out_of_range );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the measures are compared across years for an area" ) {
+
+      auto matrix = CorrelationMatrix::acrossYears(areas, "W06000002");
+
+      THEN( "measures with too few shared years have no coefficient" ) {
+
+        REQUIRE( std::isnan(matrix.getCoefficient(0, 1)) );
+        REQUIRE( matrix.getCoefficient(1, 2) == Approx(1.0) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the measures are compared across years for an unknown area" ) {
+
+      THEN( "an exception is thrown" ) {
+
+        REQUIRE_THROWS_AS( CorrelationMatrix::acrossYears(areas, "W06000999"), std::invalid_argument );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,229 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../quantiles.h"
+
+SCENARIO( "a QuantileSketch approximates percentiles of a stream", "[QuantileSketch]" ) {
+
+  GIVEN( "a newly constructed QuantileSketch" ) {
+
+    QuantileSketch sketch("Pop", "Population");
+
+    THEN( "the codename is lowercase and it is empty" ) {
+
+      REQUIRE( sketch.getCodename() == "pop" );
+      REQUIRE( sketch.count() == 0 );
+      REQUIRE( std::isnan(sketch.getQuantile(0.5)) );
+
+    } // THEN
+
+    WHEN( "100000 values are added out of order" ) {
+
+      const unsigned int total = 100000;
+      for (unsigned int i = 0; i < total; i++) {
+        sketch.update((double) ((i * 7919) % total));
+      }
+
+      THEN( "every value is counted but only a fraction are retained" ) {
+
+        REQUIRE( sketch.count() == total );
+        REQUIRE( sketch.retained() < 2000 );
+
+      } // THEN
+
+      THEN( "the extremes are exact and the percentiles are within 2%" ) {
+
+        REQUIRE( sketch.getQuantile(0) == 0 );
+        REQUIRE( sketch.getQuantile(1) == total - 1 );
+        REQUIRE( std::fabs(sketch.getQuantile(0.5) - 50000) < 0.02 * total );
+        REQUIRE( std::fabs(sketch.getQuantile(0.9) - 90000) < 0.02 * total );
+
+      } // THEN
+
+      THEN( "an invalid fraction throws an exception" ) {
+
+        REQUIRE_THROWS_AS( sketch.getQuantile(1.5), std::out_of_range );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "quantile sketches count each value that is kept once", "[Areas][QuantileSketch]" ) {
+
+  GIVEN( "an Areas instance with quantile tracking enabled" ) {
+
+    Areas areas = Areas();
+    areas.setQuantileTracking(true);
+
+    AND_GIVEN( "two datasets with the same measure for the same areas and years" ) {
+
+      std::unordered_set<std::string> areasFilter;
+      std::unordered_set<std::string> measuresFilter;
+      std::tuple<unsigned int, unsigned int> yearsFilter(0, 0);
+
+      for (const auto &source : {BethYw::InputFiles::POPDEN, BethYw::InputFiles::COMPLETE_POP}) {
+        std::ifstream stream("datasets/" + source.FILE);
+        REQUIRE( stream.is_open() );
+        auto cols = source.COLS;
+        areas.populate(stream, source.PARSER, cols, &areasFilter, &measuresFilter, &yearsFilter);
+      }
+
+      THEN( "a value replaced by the second dataset is not counted twice" ) {
+
+        std::vector<double> values;
+        for (const auto &area : areas.getAreasContainer()) {
+          for (const auto &value : area.second.getMeasures().at("pop").getValues()) {
+            values.push_back(value.second);
+          }
+        }
+        std::sort(values.begin(), values.end());
+
+        const QuantileSketch &sketch = areas.getQuantileSketches().at("pop");
+        REQUIRE( sketch.count() == values.size() );
+
+        // The values are all held, so the median is exact
+        REQUIRE( sketch.getQuantile(0.5) == values[(values.size() + 1) / 2 - 1] );
+
+      } // THEN
+
+      THEN( "the sketches are rebuilt when the areas change" ) {
+
+        const size_t before = areas.getQuantileSketches().at("pop").count();
+        areas.getArea("W06000011").getMeasure("pop").setValue(1900, 1);
+        REQUIRE( areas.getQuantileSketches().at("pop").count() == before + 1 );
+
+      } // THEN
+
+    } // AND_GIVEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "percentiles can be worked out within a memory limit without holding the values", "[Areas][QuantileSketch]" ) {
+
+  GIVEN( "the popden dataset and a memory limit" ) {
+
+    std::string dir = "datasets/";
+    std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::POPDEN};
+    std::unordered_set<std::string> areasFilter;
+    std::unordered_set<std::string> measuresFilter;
+    std::tuple<unsigned int, unsigned int> yearsFilter(0, 0);
+
+    Argv argvObj({"bethyw", "-d", "popden", "-p", "50", "--memory-limit", "1"});
+    auto argc = argvObj.argc();
+    auto** argv = argvObj.argv();
+    auto options = BethYw::cxxoptsSetup();
+    auto args = options.parse(argc, argv);
+
+    WHEN( "the areas are merged into sketches one at a time" ) {
+
+      QuantileSketches sketches;
+      std::ostringstream out;
+      BethYw::spillDatasets(args, dir, datasets, areasFilter, measuresFilter, yearsFilter,
+                            1024 * 1024, out, &sketches);
+
+      Areas areas = Areas();
+      BethYw::loadDatasets(areas, dir, datasets, areasFilter, measuresFilter, yearsFilter);
+
+      THEN( "nothing is written" ) {
+
+        REQUIRE( out.str().empty() );
+
+      } // THEN
+
+      THEN( "every value is counted once, but only a fraction are retained" ) {
+
+        REQUIRE( sketches.size() == 3 );
+        for (const auto &entry : sketches) {
+          std::vector<double> values;
+          for (const auto &area : areas.getAreasContainer()) {
+            for (const auto &value : area.second.getMeasures().at(entry.first).getValues()) {
+              values.push_back(value.second);
+            }
+          }
+          std::sort(values.begin(), values.end());
+
+          const QuantileSketch &sketch = entry.second;
+          REQUIRE( sketch.count() == values.size() );
+          REQUIRE( sketch.retained() < values.size() );
+          REQUIRE( sketch.getQuantile(0) == values.front() );
+          REQUIRE( sketch.getQuantile(1) == values.back() );
+
+          // Within the sketch's rank error of the exact median
+          const double median = sketch.getQuantile(0.5);
+          const auto rank = std::lower_bound(values.begin(), values.end(), median) - values.begin();
+          REQUIRE( std::abs((double) rank - values.size() / 2.0) <= values.size() * 0.02 );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "bethyw is run with the memory limit" ) {
+
+      std::ostringstream limited, held, err;
+      REQUIRE( BethYw::runQuery(args, limited, err) == 0 );
+
+      Argv heldArgvObj({"bethyw", "-d", "popden", "-p", "50"});
+      auto heldArgc = heldArgvObj.argc();
+      auto** heldArgv = heldArgvObj.argv();
+      auto heldOptions = BethYw::cxxoptsSetup();
+      auto heldArgs = heldOptions.parse(heldArgc, heldArgv);
+      REQUIRE( BethYw::runQuery(heldArgs, held, err) == 0 );
+
+      THEN( "the percentiles of the same measures and counts are printed" ) {
+
+        REQUIRE( !limited.str().empty() );
+        std::istringstream limitedLines(limited.str()), heldLines(held.str());
+        std::string limitedLine, heldLine;
+        size_t line = 0;
+        while (std::getline(heldLines, heldLine)) {
+          REQUIRE( std::getline(limitedLines, limitedLine) );
+          // The headings and the counts, but not the values, are the same
+          if (line % 4 != 2) {
+            REQUIRE( limitedLine == heldLine );
+          } else {
+            REQUIRE( limitedLine.substr(limitedLine.rfind(' ', limitedLine.size() - 2))
+                     == heldLine.substr(heldLine.rfind(' ', heldLine.size() - 2)) );
+          }
+          line++;
+        }
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
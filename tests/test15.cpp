@@ -0,0 +1,79 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <string>
+
+#include "../measure.h"
+
+SCENARIO( "the gaps in a Measure's years can be filled", "[Measure][fillGaps]" ) {
+
+  GIVEN( "a Measure with values for 1991, 2001 and 2003" ) {
+
+    Measure measure("pop", "Population");
+    measure.setValue(1991, 100);
+    measure.setValue(2001, 200);
+    measure.setValue(2003, 100);
+
+    WHEN( "the gaps are not filled" ) {
+
+      measure.fillGaps(GapFillNone);
+
+      THEN( "the Measure is unchanged" ) {
+
+        REQUIRE( measure.size() == 3 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the gaps are filled linearly" ) {
+
+      measure.fillGaps(GapFillLinear);
+
+      THEN( "every year between the first and last has a value" ) {
+
+        REQUIRE( measure.size() == 13 );
+
+      } // THEN
+
+      THEN( "the values are interpolated and the existing values kept" ) {
+
+        REQUIRE( measure.getValue(1991) == 100 );
+        REQUIRE( measure.getValue(1996) == Approx(150) );
+        REQUIRE( measure.getValue(2000) == Approx(190) );
+        REQUIRE( measure.getValue(2001) == 200 );
+        REQUIRE( measure.getValue(2002) == Approx(150) );
+        REQUIRE( measure.getValue(2003) == 100 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the gaps are filled with steps" ) {
+
+      measure.fillGaps(GapFillStep);
+
+      THEN( "each gap carries the previous value forward" ) {
+
+        REQUIRE( measure.size() == 13 );
+        REQUIRE( measure.getValue(1992) == 100 );
+        REQUIRE( measure.getValue(2000) == 100 );
+        REQUIRE( measure.getValue(2002) == 200 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,99 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+#include "../lib_json.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+
+SCENARIO( "Areas can be written directly to a stream as JSON", "[Areas][toJSON]" ) {
+
+  GIVEN( "an empty Areas instance" ) {
+
+    Areas areas = Areas();
+
+    THEN( "the JSON is an empty object" ) {
+
+      REQUIRE( areas.toJSON() == "{}" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an Areas instance with names, escaped characters and an empty measure" ) {
+
+    Areas areas = Areas();
+    Area area("W06000001");
+    area.setName("eng", "Isle of \"Anglesey\"\t\\");
+    area.setName("cym", "Ynys Môn");
+    area.setMeasure("none", Measure("none", "No values"));
+    Measure measure("pop", "Population");
+    measure.setValue(999, 1.5);
+    measure.setValue(2010, 68592);
+    area.setMeasure("pop", measure);
+    areas.setArea("W06000001", area);
+    areas.setArea("W06000002", Area("W06000002"));
+
+    THEN( "the JSON is identical to that produced by nlohmann::json" ) {
+
+      nlohmann::json j;
+      j["W06000001"]["names"]["eng"] = "Isle of \"Anglesey\"\t\\";
+      j["W06000001"]["names"]["cym"] = "Ynys Môn";
+      j["W06000001"]["measures"]["pop"]["999"] = 1.5;
+      j["W06000001"]["measures"]["pop"]["2010"] = 68592.0;
+
+      REQUIRE( areas.toJSON() == j.dump() );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an Areas instance populated from popu1009.json" ) {
+
+    Areas areas = Areas();
+    std::ifstream stream("datasets/popu1009.json");
+    REQUIRE( stream.is_open() );
+    std::unordered_set<std::string> areasFilter;
+    std::unordered_set<std::string> measuresFilter;
+    std::tuple<unsigned int, unsigned int> yearsFilter(0, 0);
+    areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS,
+                                     &areasFilter, &measuresFilter, &yearsFilter);
+
+    THEN( "the JSON written to a stream is identical to that produced by nlohmann::json" ) {
+
+      nlohmann::json j;
+      for (const auto &area : areas.getAreasContainer()) {
+        for (const auto &measure : area.second.getMeasures()) {
+          for (const auto &value : measure.second.getValues()) {
+            j[area.first]["measures"][measure.first][std::to_string(value.first)] = value.second;
+          }
+        }
+        for (const auto &name : area.second.getNames()) {
+          j[area.first]["names"][name.first] = name.second;
+        }
+      }
+
+      std::ostringstream os;
+      areas.toJSON(os);
+      REQUIRE( os.str() == j.dump() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
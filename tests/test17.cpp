@@ -0,0 +1,162 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "../outputbuffer.h"
+#include "../measure.h"
+#include "../area.h"
+#include "../areas.h"
+
+std::string test17Printf(double value) {
+  char text[512];
+  int length = std::snprintf(text, sizeof(text), "%.6f", value);
+  return std::string(text, (size_t) length);
+}
+
+SCENARIO( "Doubles are formatted with six decimal places like printf", "[OutputBuffer][appendFixed6]" ) {
+
+  GIVEN( "awkward values, including halves and values that are not finite" ) {
+
+    const double values[] = {
+        0, -0.0, 1, -1, 0.5, 0.0000005, 0.0000015, 0.0000025, -0.0000005,
+        711.6801, 97.126504, 69424.666666666667, 0.938905, 1e-7, -1e-7,
+        999999999.9999995, 1e9, 1e15, -1e20, 123456789012345678.0,
+        std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN()};
+
+    THEN( "each is formatted exactly as printf would" ) {
+
+      for (double value : values) {
+        OutputBuffer out;
+        size_t length = out.appendFixed6(value);
+        REQUIRE( out.str() == test17Printf(value) );
+        REQUIRE( length == out.str().size() );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "many random values of different magnitudes" ) {
+
+    std::mt19937_64 random(956213);
+    std::uniform_real_distribution<double> mantissa(-1, 1);
+    std::uniform_int_distribution<int> exponent(-8, 12);
+
+    THEN( "each is formatted exactly as printf would" ) {
+
+      for (int i = 0; i < 100000; i++) {
+        double value = mantissa(random) * std::pow(10.0, exponent(random));
+        if (i % 4 == 0) {
+          //values that are exactly halfway between two six decimal values
+          value = (std::round(value * 1e6) + 0.5) / 1e6;
+        }
+
+        OutputBuffer out;
+        out.appendFixed6(value);
+        REQUIRE( out.str() == test17Printf(value) );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "Measures and Areas can be written as a table", "[Area][Measure][toTable]" ) {
+
+  GIVEN( "a Measure with values of different widths" ) {
+
+    Measure measure("pop", "Population");
+    measure.setValue(1991, 69123);
+    measure.setValue(1992, 5.5);
+
+    THEN( "the years and headings are right-aligned to the values beneath them" ) {
+
+      std::stringstream stream;
+      stream << measure;
+
+      REQUIRE( stream.str() ==
+               "Population (pop) \n"
+               "        1991     1992      Average         Diff.    % Diff. \n"
+               "69123.000000 5.500000 34564.250000 -69117.500000 -99.992043 \n"
+               "\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a Measure with no values" ) {
+
+    Measure measure("pop", "Population");
+
+    THEN( "<no data> is written in place of the table" ) {
+
+      std::stringstream stream;
+      stream << measure;
+
+      REQUIRE( stream.str() == "Population (pop) \n<no data>\n\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "Areas with no names, one name and two names" ) {
+
+    Areas areas = Areas();
+
+    Area unnamed("W06000001");
+    areas.setArea("W06000001", unnamed);
+
+    Area named("W06000002");
+    named.setName("eng", "Gwynedd");
+    Measure measure("area", "Land area");
+    measure.setValue(2000, 2548.4);
+    named.setMeasure("area", measure);
+    areas.setArea("W06000002", named);
+
+    Area bilingual("W06000003");
+    bilingual.setName("eng", "Conwy");
+    bilingual.setName("cym", "Conwy");
+    areas.setArea("W06000003", bilingual);
+
+    THEN( "each Area is written with its names followed by its measures" ) {
+
+      std::stringstream stream;
+      stream << areas;
+
+      REQUIRE( stream.str() ==
+               "Unnamed (W06000001)\n"
+               "<no measures>\n"
+               "\n"
+               "Gwynedd (W06000002)\n"
+               "Land area (area) \n"
+               "       2000     Average    Diff.  % Diff. \n"
+               "2548.400000 2548.400000 0.000000 0.000000 \n"
+               "\n"
+               "Conwy / Conwy (W06000003)\n"
+               "<no measures>\n"
+               "\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,94 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../renderpool.h"
+#include "../areas.h"
+
+SCENARIO( "Areas can be rendered on several threads", "[Areas][renderInOrder]" ) {
+
+  GIVEN( "an Areas instance with many areas" ) {
+
+    Areas areas = Areas();
+    for (unsigned int i = 0; i < 1000; i++) {
+      std::string code = "W" + std::to_string(10000000 + i);
+      Area area(code);
+      if (i % 3 != 0) {
+        area.setName("eng", "Area " + std::to_string(i));
+        area.setName("cym", "Ardal " + std::to_string(i));
+      }
+      if (i % 5 != 0) {
+        Measure measure("pop", "Population");
+        for (unsigned int year = 2000; year < 2000 + i % 20; year++) {
+          measure.setValue(year, i * 1.5 + year);
+        }
+        area.setMeasure("pop", measure);
+      }
+      areas.setArea(code, area);
+    }
+
+    THEN( "the tables are the same whatever the number of threads" ) {
+
+      std::stringstream single;
+      areas.toTable(single, 1);
+
+      for (unsigned int threads : {2u, 3u, 8u}) {
+        std::stringstream parallel;
+        areas.toTable(parallel, threads);
+        REQUIRE( parallel.str() == single.str() );
+      }
+
+      std::stringstream stream;
+      stream << areas;
+      REQUIRE( stream.str() == single.str() );
+
+    } // THEN
+
+    THEN( "the JSON is the same whatever the number of threads" ) {
+
+      std::stringstream single;
+      areas.toJSON(single, 1);
+      REQUIRE( single.str() == areas.toJSON() );
+
+      for (unsigned int threads : {2u, 3u, 8u}) {
+        std::stringstream parallel;
+        areas.toJSON(parallel, threads);
+        REQUIRE( parallel.str() == single.str() );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an item that cannot be rendered" ) {
+
+    auto render = [](OutputBuffer &out, size_t i) {
+      if (i == 500) {
+        throw std::runtime_error("Cannot render");
+      }
+      out.appendUnsigned(i);
+    };
+
+    THEN( "the exception is rethrown on the calling thread" ) {
+
+      OutputBuffer out;
+      REQUIRE_THROWS_AS( renderInOrder(out, 1000, 4, render), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
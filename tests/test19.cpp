@@ -0,0 +1,72 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "../areas.h"
+
+SCENARIO( "Areas can be written as CSV or TSV rows", "[Areas][toDelimited]" ) {
+
+  GIVEN( "Areas with awkward names, a missing name and a value of 0" ) {
+
+    Areas areas = Areas();
+
+    Area quoted("W06000001");
+    quoted.setName("eng", "Anglesey, \"Ynys\"");
+    quoted.setName("cym", "Ynys\tMôn");
+    Measure measure("pop", "Population");
+    measure.setValue(2000, 0);
+    measure.setValue(2001, 12.5);
+    quoted.setMeasure("pop", measure);
+    areas.setArea("W06000001", quoted);
+
+    Area unnamed("W06000002");
+    Measure area("area", "Land area");
+    area.setValue(1999, 711.6801);
+    unnamed.setMeasure("area", area);
+    areas.setArea("W06000002", unnamed);
+
+    Area empty("W06000003");
+    empty.setName("eng", "Conwy");
+    areas.setArea("W06000003", empty);
+
+    THEN( "CSV fields are quoted where needed and areas without values have no rows" ) {
+
+      std::stringstream stream;
+      areas.toDelimited(stream, ',', false);
+
+      REQUIRE( stream.str() ==
+               "auth_code,name_eng,name_cym,measure_code,measure_label,year,value\n"
+               "W06000001,\"Anglesey, \"\"Ynys\"\"\",Ynys\tMôn,pop,Population,2000,0.0\n"
+               "W06000001,\"Anglesey, \"\"Ynys\"\"\",Ynys\tMôn,pop,Population,2001,12.5\n"
+               "W06000002,,,area,Land area,1999,711.6801\n" );
+
+    } // THEN
+
+    THEN( "TSV fields have tabs replaced and statistics that cannot be calculated are empty" ) {
+
+      std::stringstream stream;
+      areas.toDelimited(stream, '\t', true, 4);
+
+      REQUIRE( stream.str() ==
+               "auth_code\tname_eng\tname_cym\tmeasure_code\tmeasure_label\tyear\tvalue\taverage\tdiff\tdiff_pct\n"
+               "W06000001\tAnglesey, \"Ynys\"\tYnys Môn\tpop\tPopulation\t2000\t0.0\t6.25\t12.5\t\n"
+               "W06000001\tAnglesey, \"Ynys\"\tYnys Môn\tpop\tPopulation\t2001\t12.5\t6.25\t12.5\t\n"
+               "W06000002\t\t\tarea\tLand area\t1999\t711.6801\t711.6801\t0.0\t0.0\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
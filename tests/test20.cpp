@@ -0,0 +1,119 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "../columnar.h"
+#include "../datasets.h"
+#include "../input.h"
+
+SCENARIO( "Areas can be written to and read from a columnar file", "[Areas][columnar]" ) {
+
+  const std::string path = "test20-columnar.bin";
+
+  GIVEN( "a newly constructed Areas instance populated from popu1009.json" ) {
+
+    Areas areas = Areas();
+
+    InputFile input("datasets/" + BethYw::InputFiles::DATASETS[2].FILE);
+    StringFilterSet noFilter;
+    YearFilterTuple allYears(0, 0);
+    areas.populateFromWelshStatsJSON(input.open(),
+                                     BethYw::InputFiles::DATASETS[2].COLS,
+                                     &noFilter,
+                                     &noFilter,
+                                     &allYears);
+
+    Area named("W06000999");
+    named.setName("eng", "Nowhere");
+    named.setName("cym", "Unman");
+    areas.setArea("W06000999", named);
+
+    {
+      std::ofstream file(path, std::ios::binary);
+      writeColumnar(file, areas);
+    }
+
+    THEN( "the file has every value, and reads back into the same Areas" ) {
+
+      ColumnarReader reader(path);
+
+      unsigned int values = 0;
+      for (const auto &area : areas.getAreasContainer()) {
+        for (const auto &measure : area.second.getMeasures()) {
+          values += measure.second.getValues().size();
+        }
+      }
+      REQUIRE( reader.rows() == values );
+      REQUIRE( reader.areaCount() == areas.size() );
+
+      uint32_t nowhere = 0;
+      while (nowhere < reader.areaCount()
+             && reader.getString(ColumnAreaCode, nowhere) != "W06000999") {
+        nowhere++;
+      }
+      REQUIRE( nowhere < reader.areaCount() );
+      REQUIRE( reader.getString(ColumnAreaNameCym, nowhere) == "Unman" );
+      REQUIRE_THROWS_AS( reader.getString(ColumnValue, 0), std::out_of_range );
+
+      Areas decoded = Areas();
+      reader.toAreas(decoded);
+      REQUIRE( decoded.toJSON() == areas.toJSON() );
+      REQUIRE( decoded.getArea("W06000999").getNames().size() == 2 );
+
+    } // THEN
+
+    THEN( "a file with a row that refers to a missing area cannot be read" ) {
+
+      //find the area column from the directory and corrupt its first row
+      std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekg(24 + 40 * ColumnArea + 24);
+      uint64_t offset = 0;
+      file.read((char *) &offset, sizeof(offset));
+      uint32_t badArea = 1000;
+      file.seekp((std::streamoff) offset);
+      file.write((const char *) &badArea, sizeof(badArea));
+      file.close();
+
+      ColumnarReader reader(path);
+      Areas decoded = Areas();
+      REQUIRE_THROWS_AS( reader.toAreas(decoded), std::runtime_error );
+
+    } // THEN
+
+    std::remove(path.c_str());
+
+  } // GIVEN
+
+  GIVEN( "a file that is not a columnar file" ) {
+
+    {
+      std::ofstream file(path, std::ios::binary);
+      file << "{\"W06000001\":{}}";
+    }
+
+    THEN( "it cannot be opened" ) {
+
+      REQUIRE_THROWS_AS( ColumnarReader(path), std::runtime_error );
+      REQUIRE_THROWS_AS( ColumnarReader("does-not-exist.bin"), std::runtime_error );
+
+    } // THEN
+
+    std::remove(path.c_str());
+
+  } // GIVEN
+
+} // SCENARIO
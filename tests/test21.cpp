@@ -0,0 +1,70 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "../lib_json.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../input.h"
+
+SCENARIO( "Areas can be written as newline-delimited JSON", "[Areas][toNDJSON]" ) {
+
+  GIVEN( "an Areas instance populated from popu1009.json and an Area with no data" ) {
+
+    Areas areas = Areas();
+
+    InputFile input("datasets/" + BethYw::InputFiles::POPDEN.FILE);
+    StringFilterSet noFilter;
+    YearFilterTuple allYears(0, 0);
+    areas.populateFromWelshStatsJSON(input.open(),
+                                     BethYw::InputFiles::POPDEN.COLS,
+                                     &noFilter,
+                                     &noFilter,
+                                     &allYears);
+    areas.setArea("W06000999", Area("W06000999"));
+
+    std::stringstream stream;
+    areas.toNDJSON(stream);
+
+    THEN( "each line is one Area, and together they make the same JSON as toJSON()" ) {
+
+      nlohmann::json merged = nlohmann::json::object();
+      std::string line;
+      unsigned int lines = 0;
+      while (std::getline(stream, line)) {
+        auto object = nlohmann::json::parse(line);
+        REQUIRE( object.size() == 1 );
+        REQUIRE( line == object.dump() );
+        merged.update(object);
+        lines++;
+      }
+
+      REQUIRE( lines == areas.size() - 1 );
+      REQUIRE( merged.dump() == areas.toJSON() );
+
+    } // THEN
+
+    THEN( "the output is the same whatever the number of threads" ) {
+
+      std::stringstream parallel;
+      areas.toNDJSON(parallel, 4);
+      REQUIRE( parallel.str() == stream.str() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,195 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../input.h"
+#include "../snapshotcache.h"
+
+Areas test22Populate(const BethYw::InputFileSource &source,
+                     const StringFilterSet &areasFilter,
+                     const StringFilterSet &measuresFilter,
+                     const YearFilterTuple &yearsFilter) {
+  Areas areas = Areas();
+  InputFile input("datasets/" + source.FILE);
+  areas.populate(input.open(), source.PARSER, source.COLS,
+                 &areasFilter, &measuresFilter, &yearsFilter);
+  return areas;
+}
+
+SCENARIO( "Unfiltered Areas can be filtered as if they were being imported", "[Areas][mergeFiltered]" ) {
+
+  const StringFilterSet noFilter;
+  const YearFilterTuple allYears(0, 0);
+
+  struct Filters {
+    StringFilterSet areas;
+    StringFilterSet measures;
+    YearFilterTuple years;
+  };
+  const std::vector<Filters> filters = {
+      {{}, {}, YearFilterTuple(0, 0)},
+      {{"W06000011", "Cardiff"}, {}, YearFilterTuple(0, 0)},
+      {{}, {"pop", "population density"}, YearFilterTuple(0, 0)},
+      {{"Caerdydd", "W06000002"}, {"dens"}, YearFilterTuple(1995, 2005)},
+      {{}, {}, YearFilterTuple(2015, 2015)}};
+
+  for (const auto &source : {BethYw::InputFiles::POPDEN, BethYw::InputFiles::COMPLETE_POP}) {
+
+    GIVEN( "the unfiltered " + source.CODE + " dataset" ) {
+
+      Areas unfiltered = test22Populate(source, noFilter, noFilter, allYears);
+
+      THEN( "merging it with filters gives the same Areas as importing with them" ) {
+
+        for (const auto &filter : filters) {
+          Areas expected = test22Populate(source, filter.areas, filter.measures, filter.years);
+
+          Areas merged = Areas();
+          merged.mergeFiltered(unfiltered, &filter.areas, &filter.measures, &filter.years);
+
+          REQUIRE( merged.toJSON() == expected.toJSON() );
+          REQUIRE( merged.size() == expected.size() );
+        }
+
+      } // THEN
+
+    } // GIVEN
+
+  }
+
+} // SCENARIO
+
+SCENARIO( "Parsed datasets can be kept in a snapshot cache", "[SnapshotCache]" ) {
+
+  GIVEN( "an empty cache directory" ) {
+
+    const std::string dir = "test22-cache";
+    SnapshotCache cache(dir);
+    const auto &source = BethYw::InputFiles::POPDEN;
+    const std::string path = "datasets/" + source.FILE;
+
+    StringFilterSet noFilter;
+    YearFilterTuple allYears(0, 0);
+    Areas parsed = test22Populate(source, noFilter, noFilter, allYears);
+
+    const std::string snapshotPath = cache.snapshotPath(source, path);
+
+    THEN( "the snapshot is named after the dataset, and only found once it is stored" ) {
+
+      REQUIRE( snapshotPath.find(dir + "/" + source.CODE + "-") == 0 );
+      REQUIRE( snapshotPath == cache.snapshotPath(source, path) );
+
+      Areas snapshot = Areas();
+      REQUIRE_FALSE( cache.load(snapshotPath, snapshot) );
+
+      REQUIRE( cache.store(snapshotPath, source, parsed) );
+      REQUIRE( cache.load(snapshotPath, snapshot) );
+      REQUIRE( snapshot.toJSON() == parsed.toJSON() );
+
+      std::remove(snapshotPath.c_str());
+
+    } // THEN
+
+    THEN( "a snapshot that cannot be read is ignored and removed" ) {
+
+      {
+        REQUIRE( cache.store(snapshotPath, source, parsed) );
+        std::FILE *file = std::fopen(snapshotPath.c_str(), "wb");
+        std::fputs("not a snapshot", file);
+        std::fclose(file);
+      }
+
+      Areas snapshot = Areas();
+      REQUIRE_FALSE( cache.load(snapshotPath, snapshot) );
+      REQUIRE( snapshot.size() == 0 );
+      REQUIRE( std::fopen(snapshotPath.c_str(), "rb") == nullptr );
+
+    } // THEN
+
+    std::remove(dir.c_str());
+
+  } // GIVEN
+
+  GIVEN( "two files with different contents" ) {
+
+    THEN( "they hash differently" ) {
+
+      REQUIRE( SnapshotCache::hashFile("datasets/popu1009.json")
+               != SnapshotCache::hashFile("datasets/areas.csv") );
+      REQUIRE_THROWS_AS( SnapshotCache::hashFile("datasets/missing.json"), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "The measure codes of the complete-*.csv datasets match -m in any case", "[Areas][populate]" ) {
+
+  const StringFilterSet noFilter;
+  const YearFilterTuple allYears(0, 0);
+
+  GIVEN( "the complete-pop dataset, whose measure code is Pop" ) {
+
+    REQUIRE( BethYw::InputFiles::COMPLETE_POP.COLS.at(BethYw::SINGLE_MEASURE_CODE) == "Pop" );
+
+    THEN( "the lowercased filter pop selects it, as the snapshot cache does" ) {
+
+      const StringFilterSet areas = {"W06000011"};
+      const StringFilterSet measures = {"pop"};
+      Areas imported = test22Populate(BethYw::InputFiles::COMPLETE_POP, areas, measures, allYears);
+      REQUIRE( imported.size() == 1 );
+      REQUIRE( imported.getArea("W06000011").getMeasure("pop").getValue(2011) == 183961 );
+
+      Areas merged = Areas();
+      merged.mergeFiltered(test22Populate(BethYw::InputFiles::COMPLETE_POP, noFilter, noFilter, allYears),
+                           &areas, &measures, &allYears);
+      REQUIRE( merged.toJSON() == imported.toJSON() );
+
+    } // THEN
+
+    THEN( "a filter for another measure does not" ) {
+
+      const StringFilterSet measures = {"dens"};
+      Areas imported = test22Populate(BethYw::InputFiles::COMPLETE_POP, noFilter, measures, allYears);
+      REQUIRE( imported.size() == 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "popden and complete-pop, which both have pop" ) {
+
+    THEN( "with -m pop, complete-pop's value replaces popden's for the same area and year" ) {
+
+      const StringFilterSet areas = {"W06000011"};
+      const StringFilterSet measures = {"pop"};
+      const YearFilterTuple year(2011, 2011);
+      Areas imported = test22Populate(BethYw::InputFiles::POPDEN, areas, measures, year);
+      REQUIRE( imported.getArea("W06000011").getMeasure("pop").getValue(2011) == 238691 );
+
+      InputFile input("datasets/" + BethYw::InputFiles::COMPLETE_POP.FILE);
+      imported.populate(input.open(), BethYw::InputFiles::COMPLETE_POP.PARSER,
+                        BethYw::InputFiles::COMPLETE_POP.COLS, &areas, &measures, &year);
+      REQUIRE( imported.getArea("W06000011").getMeasure("pop").getValue(2011) == 183961 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,153 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "../resultcache.h"
+
+SCENARIO( "The output of a run can be recorded and replayed from the result cache", "[ResultCache]" ) {
+
+  const std::string dir = "test23-results";
+  const std::string output(5000, 'x');
+
+  GIVEN( "an empty result cache" ) {
+
+    ResultCache cache(dir, 1024 * 1024);
+
+    THEN( "nothing is replayed for a key that was never recorded" ) {
+
+      std::stringstream replayed;
+      REQUIRE_FALSE( cache.replay("never recorded", replayed) );
+      REQUIRE( replayed.str().empty() );
+
+    } // THEN
+
+    WHEN( "the output for a key is recorded and committed" ) {
+
+      std::stringstream original;
+      auto recording = cache.record("key one", original);
+      REQUIRE( recording != nullptr );
+      recording->stream() << output << 42 << '\n';
+      REQUIRE( cache.commit(*recording) );
+
+      THEN( "the output still reaches the original stream" ) {
+
+        REQUIRE( original.str() == output + "42\n" );
+
+      } // THEN
+
+      THEN( "the same output is replayed for the same key" ) {
+
+        std::stringstream replayed;
+        REQUIRE( cache.replay("key one", replayed) );
+        REQUIRE( replayed.str() == output + "42\n" );
+
+      } // THEN
+
+      THEN( "nothing is replayed for a different key" ) {
+
+        std::stringstream replayed;
+        REQUIRE_FALSE( cache.replay("key two", replayed) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a recording is abandoned without being committed" ) {
+
+      {
+        std::stringstream original;
+        auto recording = cache.record("abandoned", original);
+        REQUIRE( recording != nullptr );
+        recording->stream() << output;
+      }
+
+      THEN( "nothing is replayed for its key" ) {
+
+        std::stringstream replayed;
+        REQUIRE_FALSE( cache.replay("abandoned", replayed) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a result cache with room for two outputs" ) {
+
+    ResultCache cache(dir, 2 * output.size() + 200);
+
+    WHEN( "three outputs are committed" ) {
+
+      for (const std::string key : {"first", "second", "third"}) {
+        std::stringstream original;
+        auto recording = cache.record(key, original);
+        REQUIRE( recording != nullptr );
+        recording->stream() << output;
+        REQUIRE( cache.commit(*recording) );
+      }
+
+      THEN( "the least recently used output is removed to stay within the size limit" ) {
+
+        int kept = 0;
+        for (const std::string key : {"first", "second", "third"}) {
+          std::stringstream ignored;
+          kept += cache.replay(key, ignored) ? 1 : 0;
+        }
+        REQUIRE( kept == 2 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a dataset file" ) {
+
+    const std::string path = "test23-dataset.csv";
+    std::ofstream(path) << "W06000011,1";
+    const std::string before = ResultCache::fingerprint(path);
+
+    THEN( "its fingerprint stays the same while it is unchanged" ) {
+
+      REQUIRE( ResultCache::fingerprint(path) == before );
+
+    } // THEN
+
+    WHEN( "it is rewritten with the same size" ) {
+
+      ::usleep(20000);
+      std::ofstream(path) << "W06000011,2";
+
+      THEN( "its fingerprint changes" ) {
+
+        REQUIRE( ResultCache::fingerprint(path) != before );
+
+      } // THEN
+
+    } // WHEN
+
+    std::remove(path.c_str());
+
+  } // GIVEN
+
+  // clear the cache for the next run
+  ResultCache(dir, 0).evict();
+  ::rmdir(dir.c_str());
+
+} // SCENARIO
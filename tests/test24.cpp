@@ -0,0 +1,231 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../predicate.h"
+#include "../queryserver.h"
+#include "../resident.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SCENARIO( "Data held in memory can be queried as if it were imported with filters", "[ResidentData]" ) {
+
+  std::string dir = "datasets/";
+  const std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::POPDEN,
+                                                         BethYw::InputFiles::BIZ};
+
+  GIVEN( "the areas and two datasets held in memory" ) {
+
+    const ResidentData resident(dir, datasets);
+
+    REQUIRE( resident.datasetCount() == 2 );
+    REQUIRE( resident.hasDataset("popden") );
+    REQUIRE_FALSE( resident.hasDataset("aqi") );
+
+    THEN( "each query gives the same Areas as importing the files with its filters" ) {
+
+      struct Filters {
+        std::unordered_set<std::string> areas;
+        std::unordered_set<std::string> measures;
+        std::tuple<unsigned int, unsigned int> years;
+      };
+      std::vector<Filters> filters = {
+          {{}, {}, std::make_tuple(0u, 0u)},
+          {{"W06000011", "Caerdydd"}, {}, std::make_tuple(0u, 0u)},
+          {{}, {"pop", "rb"}, std::make_tuple(2010u, 2015u)},
+          {{"doesnotexist"}, {}, std::make_tuple(0u, 0u)}};
+
+      for (auto &filter : filters) {
+        // A normal run resolves the names in the areas filter to codes first
+        std::unordered_set<std::string> resolved = filter.areas;
+        resident.getNameIndex().resolve(resolved);
+
+        Areas expected = Areas();
+        BethYw::loadAreas(expected, dir, resolved);
+        BethYw::loadDatasets(expected, dir, datasets, resolved, filter.measures, filter.years);
+
+        Areas queried = Areas();
+        resident.query(queried, datasets, filter.areas, filter.measures, filter.years);
+
+        REQUIRE( queried.toJSON() == expected.toJSON() );
+      }
+
+    } // THEN
+
+    THEN( "overlapping queries walk each dataset once between them" ) {
+
+      const std::vector<ResidentData::Selection> selections = {
+          {{"W06000011", "Caerdydd"}, {"pop"}, std::make_tuple(2010u, 2015u), {}},
+          {{"W06000011"}, {"pop", "rb"}, std::make_tuple(2012u, 2018u),
+           {ValuePredicate::parse("pop>0")}}};
+
+      std::vector<Areas> separate(selections.size());
+      uint64_t before = resident.getTraversals();
+      for (size_t i = 0; i < selections.size(); i++) {
+        const auto &selection = selections[i];
+        resident.query(separate[i], datasets, selection.areasFilter, selection.measuresFilter,
+                       selection.yearsFilter, selection.predicates);
+      }
+      // areas.csv and both datasets for each query (and both datasets
+      // again to screen the second one's predicate)
+      REQUIRE( resident.getTraversals() - before == 8 );
+
+      std::vector<Areas> shared(selections.size());
+      before = resident.getTraversals();
+      resident.query({&shared[0], &shared[1]}, datasets, selections);
+      REQUIRE( resident.getTraversals() - before == 5 );
+
+      for (size_t i = 0; i < selections.size(); i++) {
+        REQUIRE( shared[i].size() > 0 );
+        REQUIRE( shared[i].toJSON() == separate[i].toJSON() );
+      }
+
+    } // THEN
+
+    THEN( "a query for a dataset that is not held in memory is rejected" ) {
+
+      Areas queried = Areas();
+      REQUIRE_THROWS_AS(
+        resident.query(queried, {BethYw::InputFiles::AQI}, {}, {}, std::make_tuple(0u, 0u)),
+        std::invalid_argument);
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "A query can be sent to a server over a Unix domain socket", "[QueryServer]" ) {
+
+  const std::string path = "test24.sock";
+
+  GIVEN( "a server that echoes its arguments, or fails if there are none" ) {
+
+    QueryServer server(path);
+    std::thread serving([&server]() {
+      server.serve([](const std::vector<std::string> &arguments,
+                      std::ostream &out,
+                      std::ostream &err) {
+        if (arguments.empty()) {
+          err << "No arguments" << std::endl;
+          return 1;
+        }
+        for (const auto &argument : arguments) {
+          out << '[' << argument << ']';
+        }
+        return 0;
+      });
+    });
+
+    WHEN( "a client sends a query" ) {
+
+      std::ostringstream out, err;
+      const int code = QueryServer::query(path, {"-a", "W06000011,Cardiff", "", "-j"}, out, err);
+
+      THEN( "the server's output and exit code are returned" ) {
+
+        REQUIRE( code == 0 );
+        REQUIRE( out.str() == "[-a][W06000011,Cardiff][][-j]" );
+        REQUIRE( err.str().empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a client sends a query that fails" ) {
+
+      std::ostringstream out, err;
+      const int code = QueryServer::query(path, {}, out, err);
+
+      THEN( "the error message and exit code are returned" ) {
+
+        REQUIRE( code == 1 );
+        REQUIRE( out.str().empty() );
+        REQUIRE( err.str() == "No arguments\n" );
+
+      } // THEN
+
+    } // WHEN
+
+    QueryServer::stop();
+    serving.join();
+
+  } // GIVEN
+
+  THEN( "the socket is removed when the server stops, and clients cannot connect" ) {
+
+    std::ostringstream out, err;
+    REQUIRE_THROWS_AS( QueryServer::query(path, {"-j"}, out, err), std::runtime_error );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "A stalled client does not hold up the other queries", "[QueryServer]" ) {
+
+  const std::string path = "test24-stalled.sock";
+
+  GIVEN( "a server with two workers" ) {
+
+    QueryServer server(path, 2);
+    std::thread serving([&server]() {
+      server.serve([](const std::vector<std::string> &arguments,
+                      std::ostream &out,
+                      std::ostream &) {
+        out << arguments.size();
+        return 0;
+      });
+    });
+
+    WHEN( "one client connects and sends nothing" ) {
+
+      const int stalled = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un address;
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, path.data(), path.size());
+      REQUIRE( ::connect(stalled, (const sockaddr *) &address, sizeof(address)) == 0 );
+
+      THEN( "another client's query is answered straight away" ) {
+
+        const auto start = std::chrono::steady_clock::now();
+        std::ostringstream out, err;
+        REQUIRE( QueryServer::query(path, {"-d", "popden"}, out, err) == 0 );
+        REQUIRE( out.str() == "2" );
+        REQUIRE( std::chrono::steady_clock::now() - start < std::chrono::seconds(5) );
+
+      } // THEN
+
+      ::close(stalled);
+
+    } // WHEN
+
+    QueryServer::stop();
+    serving.join();
+
+  } // GIVEN
+
+} // SCENARIO
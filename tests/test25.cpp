@@ -0,0 +1,223 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../datasets.h"
+#include "../bethyw.h"
+#include "../httpserver.h"
+#include "../resident.h"
+
+std::string test25Exchange(uint16_t port, const std::string &requests, size_t responses) {
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  REQUIRE( ::connect(fd, (const sockaddr *) &address, sizeof(address)) == 0 );
+  REQUIRE( ::send(fd, requests.data(), requests.size(), 0) == (ssize_t) requests.size() );
+
+  // Read until the expected number of responses (or the end of the
+  // connection); every response in these tests has "END" as its last line
+  std::string received;
+  char chunk[4096];
+  size_t found = 0;
+  while (found < responses) {
+    const ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (count <= 0) {
+      break;
+    }
+    received.append(chunk, (size_t) count);
+    found = 0;
+    for (size_t at = received.find("END\n"); at != std::string::npos;
+         at = received.find("END\n", at + 1)) {
+      found++;
+    }
+  }
+  ::close(fd);
+  return received;
+}
+
+SCENARIO( "A request target can be split into a URL-decoded path and query", "[HttpServer][parseTarget]" ) {
+
+  HttpRequest request;
+
+  THEN( "the path and each parameter are decoded" ) {
+
+    REQUIRE( HttpServer::parseTarget("/areas/Cardiff%2CSwansea?measures=pop&years=2010-2019&stats&a+b=c%20d",
+                                     request) );
+    REQUIRE( request.path == "/areas/Cardiff,Swansea" );
+    REQUIRE( request.query.size() == 4 );
+    REQUIRE( request.query["measures"] == "pop" );
+    REQUIRE( request.query["years"] == "2010-2019" );
+    REQUIRE( request.query["stats"] == "" );
+    REQUIRE( request.query["a b"] == "c d" );
+
+  } // THEN
+
+  THEN( "invalid targets are rejected" ) {
+
+    REQUIRE_FALSE( HttpServer::parseTarget("areas", request) );
+    REQUIRE_FALSE( HttpServer::parseTarget("/areas%2", request) );
+    REQUIRE_FALSE( HttpServer::parseTarget("/areas?years=%zz", request) );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "An HTTP server answers requests on keep-alive connections", "[HttpServer]" ) {
+
+  GIVEN( "a server that echoes the path of each request" ) {
+
+    HttpServer server(0, 2);
+    REQUIRE( server.getPort() != 0 );
+
+    std::thread serving([&server]() {
+      server.serve([](const HttpRequest &request) {
+        return HttpResponse{200, "text/plain", request.method + " " + request.path + " END\n"};
+      });
+    });
+
+    WHEN( "two requests are pipelined on one connection" ) {
+
+      const std::string received = test25Exchange(
+          server.getPort(),
+          "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+          "GET /second HTTP/1.1\r\nHost: localhost\r\n\r\n",
+          2);
+
+      THEN( "both are answered, in order, and the connection is kept alive" ) {
+
+        const size_t first = received.find("GET /first END\n");
+        const size_t second = received.find("GET /second END\n");
+        REQUIRE( first != std::string::npos );
+        REQUIRE( second != std::string::npos );
+        REQUIRE( first < second );
+        REQUIRE( received.find("Content-Length: 15\r\n") != std::string::npos );
+        REQUIRE( received.find("Connection: keep-alive\r\n") != std::string::npos );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a request asks for the connection to be closed" ) {
+
+      const std::string received = test25Exchange(
+          server.getPort(),
+          "HEAD /only HTTP/1.1\r\nConnection: close\r\n\r\n",
+          1);
+
+      THEN( "the headers are sent without the body, and the connection is closed" ) {
+
+        REQUIRE( received.compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0 );
+        REQUIRE( received.find("Connection: close\r\n") != std::string::npos );
+        REQUIRE( received.find("END") == std::string::npos );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a request uses another method" ) {
+
+      const std::string received = test25Exchange(
+          server.getPort(),
+          "DELETE /areas HTTP/1.1\r\nConnection: close\r\n\r\n",
+          1);
+
+      THEN( "it is refused" ) {
+
+        REQUIRE( received.compare(0, 33, "HTTP/1.1 405 Method Not Allowed\r\n") == 0 );
+
+      } // THEN
+
+    } // WHEN
+
+    server.stop();
+    serving.join();
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "HTTP requests are answered from data held in memory", "[answerHttp]" ) {
+
+  GIVEN( "the popden dataset held in memory" ) {
+
+    const ResidentData resident("datasets/", {BethYw::InputFiles::POPDEN});
+
+    THEN( "a request for an area gives the same output as the command line" ) {
+
+      HttpRequest request;
+      REQUIRE( HttpServer::parseTarget("/areas/W06000011?measures=pop&years=2010-2015&format=csv",
+                                       request) );
+      const HttpResponse response = BethYw::answerHttp(resident, request);
+
+      std::ostringstream out, err;
+      REQUIRE( BethYw::runArguments({"-a", "W06000011", "-m", "pop", "-y", "2010-2015",
+                                     "--format", "csv"},
+                                    out, err, &resident) == 0 );
+
+      REQUIRE( response.status == 200 );
+      REQUIRE( response.contentType == "text/csv; charset=utf-8" );
+      REQUIRE( response.body == out.str() );
+
+    } // THEN
+
+    THEN( "the format is matched in any case, as --format is" ) {
+
+      HttpRequest lower, upper;
+      REQUIRE( HttpServer::parseTarget("/areas/W06000011?measures=pop&format=csv", lower) );
+      REQUIRE( HttpServer::parseTarget("/areas/W06000011?measures=pop&format=CSV", upper) );
+      const HttpResponse expected = BethYw::answerHttp(resident, lower);
+      const HttpResponse response = BethYw::answerHttp(resident, upper);
+
+      REQUIRE( response.status == 200 );
+      REQUIRE( response.contentType == expected.contentType );
+      REQUIRE( response.body == expected.body );
+
+    } // THEN
+
+    THEN( "invalid parameters, paths and datasets are reported" ) {
+
+      HttpRequest request;
+      REQUIRE( HttpServer::parseTarget("/areas?years=20x", request) );
+      REQUIRE( BethYw::answerHttp(resident, request).status == 400 );
+
+      REQUIRE( HttpServer::parseTarget("/areas?colour=red", request) );
+      REQUIRE( BethYw::answerHttp(resident, request).status == 400 );
+
+      REQUIRE( HttpServer::parseTarget("/areas?datasets=aqi", request) );
+      REQUIRE( BethYw::answerHttp(resident, request).status == 400 );
+
+      REQUIRE( HttpServer::parseTarget("/areas?datasets=nope", request) );
+      REQUIRE( BethYw::answerHttp(resident, request).status == 400 );
+
+      REQUIRE( HttpServer::parseTarget("/areasx", request) );
+      REQUIRE( BethYw::answerHttp(resident, request).status == 404 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
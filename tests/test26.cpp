@@ -0,0 +1,107 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../bethyw.h"
+
+std::string test26Read(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+SCENARIO( "A line of a batch file can be split into arguments", "[splitCommandLine]" ) {
+
+  THEN( "arguments are split at whitespace, except inside quotes or after a backslash" ) {
+
+    REQUIRE( BethYw::splitCommandLine("") == std::vector<std::string>{} );
+    REQUIRE( BethYw::splitCommandLine("  -d   popden\t-j ")
+             == std::vector<std::string>({"-d", "popden", "-j"}) );
+    REQUIRE( BethYw::splitCommandLine("-a 'Vale of Glamorgan',W06000011 -o out\\ file.txt")
+             == std::vector<std::string>({"-a", "Vale of Glamorgan,W06000011", "-o", "out file.txt"}) );
+    REQUIRE( BethYw::splitCommandLine("-a \"Bro \\\"Morgannwg\\\"\" ''")
+             == std::vector<std::string>({"-a", "Bro \"Morgannwg\"", ""}) );
+
+  } // THEN
+
+  THEN( "unclosed quotes and trailing backslashes are rejected" ) {
+
+    REQUIRE_THROWS_AS( BethYw::splitCommandLine("-a 'Cardiff"), std::invalid_argument );
+    REQUIRE_THROWS_AS( BethYw::splitCommandLine("-a \"Cardiff"), std::invalid_argument );
+    REQUIRE_THROWS_AS( BethYw::splitCommandLine("-a Cardiff\\"), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "A batch of queries gives the same output as running each query", "[runBatch]" ) {
+
+  GIVEN( "a batch file with queries that share, overlap and differ in their filters" ) {
+
+    const std::vector<std::vector<std::string>> queries = {
+        {"-d", "popden", "-a", "W06000011"},
+        {"-d", "popden", "-a", "W06000011", "--format", "csv", "--stats"},
+        {"-d", "popden,biz", "-m", "pop,rb", "-y", "2010-2015", "-j"},
+        {"-d", "biz,popden", "-m", "rb,pop", "-y", "2010-2015", "--format", "ndjson"},
+        {"-d", "complete-pop", "--fill", "linear", "-j"},
+        {"-d", "popden", "-a", "W06000011,Cardiff", "-y", "2012-2014", "-w", "pop>0", "-j"},
+        {"-d", "popden", "-m", "pop", "-p", "50"}};
+
+    std::ofstream batch("test26-batch.txt");
+    batch << "# a comment, then a blank line" << std::endl << std::endl;
+    for (size_t i = 0; i < queries.size(); i++) {
+      batch << "bethyw";
+      for (const auto &argument : queries[i]) {
+        batch << " '" << argument << "'";
+      }
+      batch << " -o test26-output" << i << std::endl;
+    }
+    batch << "-d popden -y 20x -o test26-invalid" << std::endl;
+    batch.close();
+
+    WHEN( "the batch is run" ) {
+
+      Argv argvObj({"bethyw", "--batch", "test26-batch.txt"});
+      const int code = BethYw::run(argvObj.argc(), argvObj.argv());
+
+      THEN( "the invalid query is reported and the others are written" ) {
+
+        REQUIRE( code == 1 );
+        REQUIRE( test26Read("test26-invalid").empty() );
+
+        for (size_t i = 0; i < queries.size(); i++) {
+          std::ostringstream expected, err;
+          REQUIRE( BethYw::runArguments(queries[i], expected, err) == 0 );
+          REQUIRE( test26Read("test26-output" + std::to_string(i)) == expected.str() );
+          std::remove(("test26-output" + std::to_string(i)).c_str());
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    std::remove("test26-batch.txt");
+    std::remove("test26-invalid");
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,144 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../datasets.h"
+#include "../resident.h"
+#include "../snapshotholder.h"
+
+std::unique_ptr<ResidentData> test27Load() {
+  return std::unique_ptr<ResidentData>(new ResidentData("datasets/", {}));
+}
+
+SCENARIO( "Readers see a whole snapshot while new ones are published", "[SnapshotHolder]" ) {
+
+  GIVEN( "a SnapshotHolder holding the areas" ) {
+
+    SnapshotHolder holder(test27Load());
+    REQUIRE( holder.getGeneration() == 0 );
+
+    WHEN( "a reader holds the current snapshot while another is published" ) {
+
+      std::unique_ptr<SnapshotHolder::Reader> reader(
+          new SnapshotHolder::Reader(holder.read()));
+      const ResidentData *held = &**reader;
+
+      std::thread publisher([&holder]() { holder.publish(test27Load()); });
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      THEN( "the publisher waits for the reader, and new readers see the new snapshot" ) {
+
+        REQUIRE( holder.getGeneration() == 0 );
+        REQUIRE( holder.read().operator->() != held );
+        REQUIRE( (*reader)->getDir() == "datasets/" );
+
+        reader.reset();
+        publisher.join();
+        REQUIRE( holder.getGeneration() == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "many readers read while snapshots are published" ) {
+
+      std::atomic<bool> done(false);
+      std::atomic<long> reads(0);
+      std::atomic<long> bad(0);
+      std::vector<std::thread> readers;
+      for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+          while (!done) {
+            const auto snapshot = holder.read();
+            Areas areas = Areas();
+            snapshot->query(areas, {}, {"W06000011"}, {}, std::make_tuple(0u, 0u));
+            if (areas.size() != 1 || snapshot->getDir() != "datasets/") {
+              bad++;
+            }
+            reads++;
+          }
+        });
+      }
+
+      for (int i = 0; i < 5; i++) {
+        // Make sure the readers are reading each snapshot
+        const long before = reads;
+        while (reads < before + 10) {
+          std::this_thread::yield();
+        }
+        holder.publish(test27Load());
+      }
+      done = true;
+      for (auto &reader : readers) {
+        reader.join();
+      }
+
+      THEN( "every read saw a complete snapshot" ) {
+
+        REQUIRE( holder.getGeneration() == 5 );
+        REQUIRE( reads > 0 );
+        REQUIRE( bad == 0 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "A BackgroundReloader publishes new data only when the stamp changes", "[BackgroundReloader]" ) {
+
+  GIVEN( "a reloader with a stamp that the test controls" ) {
+
+    SnapshotHolder holder(test27Load());
+    std::atomic<int> version(1);
+    std::atomic<int> loads(0);
+
+    BackgroundReloader reloader(
+        holder,
+        [&loads]() {
+          loads++;
+          return test27Load();
+        },
+        [&version]() { return std::to_string(version.load()); },
+        "1",
+        std::chrono::hours(1));
+
+    THEN( "nothing is reloaded while the stamp is unchanged" ) {
+
+      REQUIRE_FALSE( reloader.reloadIfChanged() );
+      REQUIRE( loads == 0 );
+      REQUIRE( holder.getGeneration() == 0 );
+
+    } // THEN
+
+    THEN( "the data is reloaded and published once after the stamp changes" ) {
+
+      version = 2;
+      REQUIRE( reloader.reloadIfChanged() );
+      REQUIRE_FALSE( reloader.reloadIfChanged() );
+      REQUIRE( loads == 1 );
+      REQUIRE( holder.getGeneration() == 1 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
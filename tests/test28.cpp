@@ -0,0 +1,154 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../areas.h"
+#include "../datasets.h"
+#include "../datasetwatcher.h"
+#include "../resident.h"
+
+std::string test28Copy(const std::string &from, const std::string &to) {
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary | std::ios::trunc);
+  out << in.rdbuf();
+  return to;
+}
+
+double test28Value(const ResidentData &resident,
+                   const std::vector<BethYw::InputFileSource> &datasets,
+                   const std::string &measure) {
+  Areas areas = Areas();
+  resident.query(areas, datasets, {"W06000001"}, {measure}, std::make_tuple(0u, 0u));
+  return areas.getArea("W06000001").getMeasure(measure).getValue(1991);
+}
+
+SCENARIO( "Data held in memory can re-import just the files that changed", "[ResidentData]" ) {
+
+  char dirTemplate[] = "/tmp/bethyw-test28-XXXXXX";
+  REQUIRE( ::mkdtemp(dirTemplate) != nullptr );
+  const std::string dir = std::string(dirTemplate) + "/";
+
+  const std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::COMPLETE_POP,
+                                                         BethYw::InputFiles::COMPLETE_AREA};
+  std::vector<std::string> files = {test28Copy("datasets/areas.csv", dir + "areas.csv")};
+  for (const auto &source : datasets) {
+    files.push_back(test28Copy("datasets/" + source.FILE, dir + source.FILE));
+  }
+
+  GIVEN( "two datasets held in memory, one of which is then edited" ) {
+
+    const ResidentData resident(dir, datasets);
+    REQUIRE( test28Value(resident, datasets, "pop") == 69123 );
+    REQUIRE( test28Value(resident, datasets, "area") == Approx(711.6801) );
+
+    {
+      std::ifstream in(dir + BethYw::InputFiles::COMPLETE_POP.FILE);
+      std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      text.replace(text.find("69123"), 5, "12345");
+      std::ofstream out(dir + BethYw::InputFiles::COMPLETE_POP.FILE, std::ios::trunc);
+      out << text;
+    }
+
+    WHEN( "the edited file is re-imported" ) {
+
+      const auto next = resident.reloaded({BethYw::InputFiles::COMPLETE_POP.FILE});
+
+      THEN( "the new data has the edit, and the old data and other dataset are unchanged" ) {
+
+        REQUIRE( test28Value(*next, datasets, "pop") == 12345 );
+        REQUIRE( test28Value(*next, datasets, "area") == Approx(711.6801) );
+        REQUIRE( test28Value(resident, datasets, "pop") == 69123 );
+        REQUIRE( next->getStamp() != resident.getStamp() );
+        REQUIRE( next->getStamp() == ResidentData::stamp(dir, datasets) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file that was not edited is re-imported" ) {
+
+      const auto next = resident.reloaded({BethYw::InputFiles::COMPLETE_AREA.FILE});
+
+      THEN( "the edit is not seen" ) {
+
+        REQUIRE( test28Value(*next, datasets, "pop") == 69123 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  for (const auto &file : files) {
+    std::remove(file.c_str());
+  }
+  ::rmdir(dirTemplate);
+
+} // SCENARIO
+
+SCENARIO( "A DatasetWatcher reports the files written in a directory", "[DatasetWatcher]" ) {
+
+  char dirTemplate[] = "/tmp/bethyw-test28-XXXXXX";
+  REQUIRE( ::mkdtemp(dirTemplate) != nullptr );
+  const std::string dir = std::string(dirTemplate) + "/";
+
+  GIVEN( "a watcher on an empty directory" ) {
+
+    std::atomic<int> calls(0);
+    std::set<std::string> seen;
+    DatasetWatcher watcher(
+        dir,
+        [&](const std::set<std::string> &files) {
+          seen = files;
+          calls++;
+        },
+        std::chrono::milliseconds(50));
+
+    WHEN( "two files are written close together" ) {
+
+      test28Copy("datasets/areas.csv", dir + "areas.csv");
+      test28Copy("datasets/popu1009.json", dir + "popu1009.json");
+
+      for (int i = 0; i < 100 && calls == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+
+      THEN( "the handler is called once with both names" ) {
+
+        REQUIRE( calls == 1 );
+        REQUIRE( seen == std::set<std::string>({"areas.csv", "popu1009.json"}) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  std::remove((dir + "areas.csv").c_str());
+  std::remove((dir + "popu1009.json").c_str());
+  ::rmdir(dirTemplate);
+
+} // SCENARIO
@@ -0,0 +1,180 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../compiledfilter.h"
+
+SCENARIO( "Filters are compiled into a form rows can be tested against by their bytes", "[CompiledFilter]" ) {
+
+  GIVEN( "an areas, a measures and a years filter" ) {
+
+    StringFilterSet areasFilter = {"W06000011", "Caerdydd"};
+    StringFilterSet measuresFilter = {"pop", "land area"};
+    YearFilterTuple yearsFilter(2010, 2015);
+
+    const CompiledFilter filter(&areasFilter, &measuresFilter, &yearsFilter);
+
+    THEN( "area codes and names are matched exactly, by their bytes" ) {
+
+      const char *row = "W06000011,69123";
+      REQUIRE( filter.acceptsArea(row, 9) );
+      REQUIRE_FALSE( filter.acceptsArea(row, 8) );
+      REQUIRE_FALSE( filter.acceptsArea(row, 10) );
+      REQUIRE( filter.acceptsArea(std::string("Caerdydd")) );
+      REQUIRE_FALSE( filter.acceptsArea(std::string("W06000015")) );
+      REQUIRE_FALSE( filter.allAreas() );
+
+    } // THEN
+
+    THEN( "years are checked against the range" ) {
+
+      REQUIRE_FALSE( filter.acceptsYear(2009) );
+      REQUIRE( filter.acceptsYear(2010) );
+      REQUIRE( filter.acceptsYear(2015) );
+      REQUIRE_FALSE( filter.acceptsYear(2016) );
+      REQUIRE_FALSE( filter.acceptsYear(100000) );
+
+    } // THEN
+
+    THEN( "measures are given IDs, matched by their lowercase codename or label" ) {
+
+      CompiledFilter::MeasureIds ids(filter);
+      const size_t pop = ids.find("POP", "Population");
+      const size_t area = ids.find("Area", "land area");
+      const size_t dens = ids.find("Dens", "Population density");
+
+      REQUIRE( ids.find("POP", "Population") == pop );
+      REQUIRE( ids.codename(pop) == "pop" );
+      REQUIRE( ids.accepted(pop) );
+      REQUIRE( ids.accepted(area) );
+      REQUIRE_FALSE( ids.accepted(dens) );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "no filters" ) {
+
+    StringFilterSet none;
+    YearFilterTuple allYears(0, 0);
+    const CompiledFilter filter(&none, &none, &allYears);
+
+    THEN( "everything is accepted" ) {
+
+      REQUIRE( filter.allAreas() );
+      REQUIRE( filter.allYears() );
+      REQUIRE( filter.allMeasures() );
+      REQUIRE( filter.acceptsArea("anything", 8) );
+      REQUIRE( filter.acceptsYear(1) );
+      REQUIRE( filter.acceptsMeasure("pop", "Population") );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "The parsers skip rows the filters reject and values that are missing", "[Areas][CompiledFilter]" ) {
+
+  GIVEN( "a CSV dataset with an empty field" ) {
+
+    std::stringstream csv(
+        "AuthorityCode,1991,2001,2011,2012,2013,2014,2015,2016,2017,2018,2019\r\n"
+        "W06000001,1,2,3,4,5,,7,8,9,10,11\r\n"
+        "W06000002,12,13,14,15,16,17,18,19,20,21,22\r\n");
+
+    WHEN( "it is imported for one area and some of the years" ) {
+
+      StringFilterSet areasFilter = {"W06000001"};
+      YearFilterTuple yearsFilter(2013, 2015);
+      Areas areas = Areas();
+      areas.populateFromAuthorityByYearCSV(csv,
+                                           BethYw::InputFiles::COMPLETE_POP.COLS,
+                                           &areasFilter,
+                                           &yearsFilter);
+
+      THEN( "only that area is imported, without the missing value" ) {
+
+        REQUIRE( areas.size() == 1 );
+        auto &measure = areas.getArea("W06000001").getMeasure("pop");
+        REQUIRE( measure.size() == 2 );
+        REQUIRE( measure.getValue(2013) == 5 );
+        REQUIRE( measure.getValue(2015) == 7 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a StatsWales JSON dataset with other keys, nested values and a number value" ) {
+
+    std::stringstream json(
+        "{\"odata.metadata\":\"x\",\"extra\":{\"value\":[1,2]},\"value\":["
+        "{\"Data\":\"1.5\",\"Area_Code\":\"W06000001\",\"Area_ItemName_ENG\":\"Isle of Anglesey\","
+        "\"Pollutant_ItemName_ENG\":\"NO2\",\"Year_Code\":\"2010\",\"Notes\":{\"Data\":\"9\"}},"
+        "{\"Data\":2.5,\"Area_Code\":\"W06000002\",\"Area_ItemName_ENG\":\"Gwynedd\","
+        "\"Pollutant_ItemName_ENG\":\"NO2\",\"Year_Code\":\"2011\"},"
+        "{\"Data\":\"\",\"Area_Code\":\"W06000002\",\"Area_ItemName_ENG\":\"Gwynedd\","
+        "\"Pollutant_ItemName_ENG\":\"NO2\",\"Year_Code\":\"2012\"}"
+        "],\"odata.nextLink\":\"y\"}");
+
+    WHEN( "it is imported for an area given by name" ) {
+
+      StringFilterSet areasFilter = {"Gwynedd"};
+      Areas areas = Areas();
+      areas.populateFromWelshStatsJSON(json,
+                                       BethYw::InputFiles::AQI.COLS,
+                                       &areasFilter,
+                                       nullptr,
+                                       nullptr);
+
+      THEN( "only the rows for that area with values are imported" ) {
+
+        REQUIRE( areas.size() == 1 );
+        auto &measure = areas.getArea("W06000002").getMeasure("no2");
+        REQUIRE( measure.getLabel() == "NO2" );
+        REQUIRE( measure.size() == 1 );
+        REQUIRE( measure.getValue(2011) == 2.5 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a JSON dataset that is cut short" ) {
+
+    std::stringstream json("{\"value\":[{\"Data\":\"1.5\",");
+
+    THEN( "importing it throws std::runtime_error" ) {
+
+      Areas areas = Areas();
+      REQUIRE_THROWS_AS( areas.populateFromWelshStatsJSON(json,
+                                                          BethYw::InputFiles::AQI.COLS,
+                                                          nullptr,
+                                                          nullptr,
+                                                          nullptr),
+                         std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,138 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+
+SCENARIO( "Areas can be indexed by measure and by year", "[Areas][indexes]" ) {
+
+  GIVEN( "the areas and two datasets imported without filters" ) {
+
+    std::string dir = "datasets/";
+    const std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::POPDEN,
+                                                           BethYw::InputFiles::BIZ};
+    std::unordered_set<std::string> noFilter;
+    std::tuple<unsigned int, unsigned int> allYears(0, 0);
+
+    Areas unfiltered = Areas();
+    BethYw::loadAreas(unfiltered, dir, noFilter);
+    BethYw::loadDatasets(unfiltered, dir, datasets, noFilter, noFilter, allYears);
+
+    REQUIRE_FALSE( unfiltered.hasIndexes() );
+
+    THEN( "the indexes are built when first asked for and list every value" ) {
+
+      const auto &byMeasure = unfiltered.getMeasureIndex();
+      REQUIRE( unfiltered.hasIndexes() );
+      const auto &pop = byMeasure.at("pop");
+      REQUIRE_FALSE( pop.empty() );
+      for (size_t i = 1; i < pop.size(); i++) {
+        REQUIRE( *pop[i - 1].code < *pop[i].code );
+      }
+
+      const auto &byYear = unfiltered.getYearIndex();
+      double value = 0;
+      for (const auto &entry : byYear.at(2015)) {
+        if (*entry.code == "W06000011" && entry.measure->getCodename() == "pop") {
+          value = entry.value;
+        }
+      }
+      REQUIRE( value == unfiltered.getArea("W06000011").getMeasure("pop").getValue(2015) );
+
+    } // THEN
+
+    THEN( "changing the areas drops the indexes, and copies do not share them" ) {
+
+      unfiltered.buildIndexes();
+      Areas copy = unfiltered;
+      REQUIRE_FALSE( copy.hasIndexes() );
+
+      unfiltered.setArea("W06000099", Area("W06000099"));
+      REQUIRE_FALSE( unfiltered.hasIndexes() );
+
+    } // THEN
+
+    THEN( "a change made through a kept reference to an area is seen by the indexes" ) {
+
+      Area &area = unfiltered.getArea("W06000011");
+      Measure &pop = area.getMeasure("pop");
+      unfiltered.buildIndexes();
+      REQUIRE( unfiltered.hasIndexes() );
+
+      // reading the area leaves the indexes be
+      REQUIRE( pop.getValue(2015) > 0 );
+      REQUIRE( unfiltered.hasIndexes() );
+
+      const double highest = unfiltered.getZoneMap().at("pop").byYear.at(2015).max;
+      pop.setValue(2015, highest + 1);
+      REQUIRE_FALSE( unfiltered.hasIndexes() );
+      REQUIRE( unfiltered.getZoneMap().at("pop").byYear.at(2015).max == highest + 1 );
+
+      double indexed = 0;
+      for (const auto &entry : unfiltered.getYearIndex().at(2015)) {
+        if (*entry.code == "W06000011" && entry.measure->getCodename() == "pop") {
+          indexed = entry.value;
+        }
+      }
+      REQUIRE( indexed == highest + 1 );
+
+      area.setName("eng", "Renamed");
+      REQUIRE_FALSE( unfiltered.hasIndexes() );
+
+    } // THEN
+
+    THEN( "merging with filters gives the same result from the indexes as without" ) {
+
+      struct Filters {
+        std::unordered_set<std::string> areas;
+        std::unordered_set<std::string> measures;
+        std::tuple<unsigned int, unsigned int> years;
+      };
+      std::vector<Filters> filters = {
+          {{}, {"pop"}, std::make_tuple(2015u, 2015u)},
+          {{}, {}, std::make_tuple(2010u, 2012u)},
+          {{"Caerdydd", "W06000001"}, {"population density", "rb"}, std::make_tuple(0u, 0u)},
+          {{}, {"doesnotexist"}, std::make_tuple(0u, 0u)},
+          {{}, {}, std::make_tuple(1900u, 1900u)}};
+
+      Areas indexed = unfiltered;
+      indexed.buildIndexes();
+
+      for (auto &filter : filters) {
+        Areas walked = Areas();
+        walked.setQuantileTracking(true);
+        walked.mergeFiltered(unfiltered, &filter.areas, &filter.measures, &filter.years);
+
+        Areas looked = Areas();
+        looked.setQuantileTracking(true);
+        looked.mergeFiltered(indexed, &filter.areas, &filter.measures, &filter.years);
+
+        REQUIRE( looked.toJSON() == walked.toJSON() );
+        REQUIRE( looked.getQuantileSketches().size() == walked.getQuantileSketches().size() );
+        for (const auto &sketch : walked.getQuantileSketches()) {
+          REQUIRE( looked.getQuantileSketches().at(sketch.first).getQuantile(0.5)
+                   == sketch.second.getQuantile(0.5) );
+        }
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,142 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../lib_json.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../nameindex.h"
+#include "../resident.h"
+
+SCENARIO( "Names are folded for case, accents and spacing", "[NameIndex]" ) {
+
+  REQUIRE( NameIndex::fold("Ynys Môn") == "ynys mon" );
+  REQUIRE( NameIndex::fold("  Vale   of GLAMORGAN ") == "vale of glamorgan" );
+  REQUIRE( NameIndex::fold("Ŵ ŷ ẁ Ỳ é") == "w y w y e" );
+  REQUIRE( NameIndex::fold("Pen-y-bont ar Ogwr") == "pen-y-bont ar ogwr" );
+
+} // SCENARIO
+
+SCENARIO( "Areas can be found by prefix, folded name or a near miss", "[NameIndex]" ) {
+
+  GIVEN( "a NameIndex over areas.csv" ) {
+
+    std::string dir = "datasets/";
+    std::unordered_set<std::string> noFilter;
+    Areas areas = Areas();
+    BethYw::loadAreas(areas, dir, noFilter);
+    const NameIndex names(areas);
+
+    THEN( "names and codes are found however they are written" ) {
+
+      REQUIRE( names.lookup("ynys mon") == std::vector<std::string>({"W06000001"}) );
+      REQUIRE( names.lookup("CAERDYDD") == std::vector<std::string>({"W06000015"}) );
+      REQUIRE( names.lookup("w06000011") == std::vector<std::string>({"W06000011"}) );
+      REQUIRE( names.lookup("Cardif").empty() );
+
+    } // THEN
+
+    THEN( "prefixes find every area starting with them" ) {
+
+      REQUIRE( names.withPrefix("Vale of") == std::vector<std::string>({"W06000014"}) );
+      REQUIRE( names.withPrefix("sir ") == std::vector<std::string>({"W06000004",
+                                                                     "W06000005",
+                                                                     "W06000009",
+                                                                     "W06000010",
+                                                                     "W06000021"}) );
+      REQUIRE( names.withPrefix("W0600002").size() == 5 );
+      REQUIRE( names.withPrefix("").size() == 22 );
+      REQUIRE( names.withPrefix("xyz").empty() );
+
+    } // THEN
+
+    THEN( "near misses find the closest names" ) {
+
+      REQUIRE( names.closest("Cardif", 1) == std::vector<std::string>({"W06000015"}) );
+      REQUIRE( names.closest("Merthyr Tydfill", 2) == std::vector<std::string>({"W06000024"}) );
+      REQUIRE( names.closest("Swansee", 1) == std::vector<std::string>({"W06000011"}) );
+      REQUIRE( names.closest("doesnotexist", 2).empty() );
+
+    } // THEN
+
+    THEN( "an areas filter is resolved, keeping exact entries with their codes and ones that match nothing" ) {
+
+      StringFilterSet filter = {"Vale of*", "Cardif", "ynys mon", "Swansea", "W06000099",
+                                "doesnotexist"};
+      names.resolve(filter);
+      REQUIRE( filter == StringFilterSet({"W06000014", "W06000015", "W06000001", "Swansea",
+                                          "W06000011", "W06000099", "doesnotexist"}) );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "data held in memory" ) {
+
+    std::string dir = "datasets/";
+    const std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::COMPLETE_POP};
+    const ResidentData resident(dir, datasets);
+
+    THEN( "queries resolve their areas filters in the same way" ) {
+
+      std::unordered_set<std::string> patterns = {"Vale of*", "caerdydd"};
+      std::unordered_set<std::string> codes = {"W06000014", "W06000015"};
+      std::unordered_set<std::string> noFilter;
+      std::tuple<unsigned int, unsigned int> allYears(0, 0);
+
+      Areas byPattern = Areas();
+      resident.query(byPattern, datasets, patterns, noFilter, allYears);
+      Areas byCode = Areas();
+      resident.query(byCode, datasets, codes, noFilter, allYears);
+
+      REQUIRE( byPattern.size() == 2 );
+      REQUIRE( byPattern.toJSON() == byCode.toJSON() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "An area's exact name selects the same values as its code", "[NameIndex]" ) {
+
+  for (const std::string area : {"Swansea", "swansea", "Swanse", "Swan*"}) {
+    GIVEN( "bethyw -a " + area + " on datasets that match names and ones that only match codes" ) {
+
+      const auto run = [](const std::string &areas) {
+        std::ostringstream out, err;
+        REQUIRE( BethYw::runArguments({"-a", areas, "-m", "pop", "-y", "2011", "-j"},
+                                      out, err) == 0 );
+        return out.str();
+      };
+
+      const std::string byCode = run("W06000011");
+
+      THEN( "the output is the same as with the code" ) {
+
+        REQUIRE( run(area) == byCode );
+        REQUIRE( nlohmann::json::parse(byCode)["W06000011"]["measures"]["pop"]["2011"]
+                 == 183961 );
+
+      } // THEN
+
+    } // GIVEN
+  }
+
+} // SCENARIO
@@ -0,0 +1,215 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../predicate.h"
+#include "../resident.h"
+
+SCENARIO( "Value predicates are parsed and compare values and ranges", "[ValuePredicate]" ) {
+
+  THEN( "predicates are read with or without spaces and a year" ) {
+
+    REQUIRE( ValuePredicate::parse("pop>100000 in 2019").toString() == "pop > 100000 in 2019" );
+    REQUIRE( ValuePredicate::parse(" POP >= 1e5 IN 2019 ").toString() == "pop >= 100000 in 2019" );
+    REQUIRE( ValuePredicate::parse("rb<=50").toString() == "rb <= 50" );
+    REQUIRE( ValuePredicate::parse("no2 != 2.5").getComparison() == ValuePredicate::NOT_EQUAL );
+    REQUIRE( ValuePredicate::parse("no2==2.5").getComparison() == ValuePredicate::EQUAL );
+    REQUIRE( ValuePredicate::parse("no2 < -1").getThreshold() == -1 );
+
+    for (const std::string text : {"pop", ">5", "pop>", "pop=>5", "pop!5", "pop>5 in 20",
+                                   "pop>5 2019", "pop>five", "pop>5 in 2019x"}) {
+      REQUIRE_THROWS_AS( ValuePredicate::parse(text), std::invalid_argument );
+    }
+
+  } // THEN
+
+  THEN( "values and ranges are compared with the threshold" ) {
+
+    const ValuePredicate above = ValuePredicate::parse("pop>100");
+    REQUIRE( above.test(101) );
+    REQUIRE_FALSE( above.test(100) );
+    REQUIRE( above.test(ValueRange{10, 100}) == ValuePredicate::NONE );
+    REQUIRE( above.test(ValueRange{10, 200}) == ValuePredicate::SOME );
+    REQUIRE( above.test(ValueRange{101, 200}) == ValuePredicate::ALL );
+
+    const ValuePredicate below = ValuePredicate::parse("pop<=100");
+    REQUIRE( below.test(ValueRange{101, 200}) == ValuePredicate::NONE );
+    REQUIRE( below.test(ValueRange{100, 200}) == ValuePredicate::SOME );
+    REQUIRE( below.test(ValueRange{10, 100}) == ValuePredicate::ALL );
+
+    const ValuePredicate equal = ValuePredicate::parse("pop=100");
+    REQUIRE( equal.test(ValueRange{101, 200}) == ValuePredicate::NONE );
+    REQUIRE( equal.test(ValueRange{10, 200}) == ValuePredicate::SOME );
+    REQUIRE( equal.test(ValueRange{100, 100}) == ValuePredicate::ALL );
+
+    const ValuePredicate notEqual = ValuePredicate::parse("pop!=100");
+    REQUIRE( notEqual.test(ValueRange{100, 100}) == ValuePredicate::NONE );
+    REQUIRE( notEqual.test(ValueRange{10, 200}) == ValuePredicate::SOME );
+    REQUIRE( notEqual.test(ValueRange{101, 200}) == ValuePredicate::ALL );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "Areas keep a zone map of each measure", "[Areas][ValuePredicate]" ) {
+
+  GIVEN( "the population density dataset" ) {
+
+    std::string dir = "datasets/";
+    std::unordered_set<std::string> noFilter;
+    std::tuple<unsigned int, unsigned int> allYears(0, 0);
+    Areas areas = Areas();
+    BethYw::loadDatasets(areas, dir, {BethYw::InputFiles::POPDEN}, noFilter, noFilter, allYears);
+
+    THEN( "each zone is the range of the values it covers" ) {
+
+      const MeasureZones &zones = areas.getZoneMap().at("pop");
+      double min = 1e300, max = -1e300;
+      double min2019 = 1e300, max2019 = -1e300;
+      for (const AreaSeries &series : areas.getMeasureIndex().at("pop")) {
+        double seriesMin = 1e300, seriesMax = -1e300;
+        for (const auto &value : series.measure->getValues()) {
+          seriesMin = std::min(seriesMin, value.second);
+          seriesMax = std::max(seriesMax, value.second);
+          if (value.first == 2019) {
+            min2019 = std::min(min2019, value.second);
+            max2019 = std::max(max2019, value.second);
+          }
+        }
+        REQUIRE( series.range.min == seriesMin );
+        REQUIRE( series.range.max == seriesMax );
+        min = std::min(min, seriesMin);
+        max = std::max(max, seriesMax);
+      }
+
+      REQUIRE( zones.all.min == min );
+      REQUIRE( zones.all.max == max );
+      REQUIRE( zones.byYear.at(2019).min == min2019 );
+      REQUIRE( zones.byYear.at(2019).max == max2019 );
+
+    } // THEN
+
+    THEN( "screening finds exactly the areas with a passing value" ) {
+
+      const auto predicates = std::vector<ValuePredicate>{ValuePredicate::parse("pop>150000 in 2019")};
+      std::set<std::string> expected;
+      for (const AreaSeries &series : areas.getMeasureIndex().at("pop")) {
+        const auto &values = series.measure->getValues();
+        if (values.count(2019) && values.at(2019) > 150000) {
+          expected.insert(*series.code);
+        }
+      }
+
+      REQUIRE( !expected.empty() );
+      REQUIRE( ValuePredicate::screen(predicates, {&areas}, {}) == expected );
+      REQUIRE( ValuePredicate::screen(predicates, {&areas}, {"W06000011"})
+               == std::set<std::string>({"W06000011"}) );
+      REQUIRE( ValuePredicate::screen({ValuePredicate::parse("pop>1e12")}, {&areas}, {}).empty() );
+      REQUIRE( ValuePredicate::screen({ValuePredicate::parse("nothing>0")}, {&areas}, {}).empty() );
+
+      auto both = predicates;
+      both.push_back(ValuePredicate::parse("pop<200000 in 2019"));
+      for (const std::string &code : ValuePredicate::screen(both, {&areas}, {})) {
+        REQUIRE( expected.count(code) == 1 );
+        REQUIRE( areas.getArea(code).getMeasure("pop").getValue(2019) < 200000 );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "The where argument gives the same output from files and from memory", "[args][where]" ) {
+
+  GIVEN( "data held in memory" ) {
+
+    std::string dir = "datasets/";
+    const ResidentData resident(dir, {BethYw::InputFiles::POPDEN, BethYw::InputFiles::AQI,
+                                      BethYw::InputFiles::COMPLETE_POP});
+
+    // complete-pop overwrites some of popden's populations (e.g. Swansea's
+    // 238691 in 2011 with 183961), so only the values that are kept may pass
+    const std::vector<std::vector<std::string>> queries = {
+      {"-d", "popden", "-w", "pop>100000 in 2019", "--format", "csv"},
+      {"-d", "popden,aqi", "-w", "pop>200000,pop<300000", "-m", "pop,no2", "-y", "2015"},
+      {"-d", "popden", "-a", "Swansea,Gwynedd", "-w", "dens>=100", "-j"},
+      {"-d", "aqi", "-w", "pop>0"},
+      {"-d", "popden,complete-pop", "-a", "W06000011", "-m", "pop", "-y", "2011",
+       "-w", "pop>200000 in 2011", "-j"},
+      {"-d", "complete-pop,popden", "-a", "W06000011", "-m", "pop", "-y", "2011",
+       "-w", "pop>200000 in 2011", "-j"},
+      {"-d", "popden,complete-pop", "-w", "pop>200000 in 2011", "-m", "pop", "-y", "2011"},
+    };
+
+    THEN( "each query gives the same output either way" ) {
+
+      for (const auto &query : queries) {
+        std::ostringstream fromFiles, fromMemory, err;
+        REQUIRE( BethYw::runArguments(query, fromFiles, err) == 0 );
+        REQUIRE( BethYw::runArguments(query, fromMemory, err, &resident) == 0 );
+        REQUIRE( fromFiles.str() == fromMemory.str() );
+      }
+
+    } // THEN
+
+    THEN( "a value overwritten by a later dataset does not pass" ) {
+
+      Argv argvObj({"bethyw", "-d", "popden,complete-pop", "-a", "W06000011", "-m", "pop",
+                    "-y", "2011", "-w", "pop>200000 in 2011", "-j"});
+      auto argc = argvObj.argc();
+      auto** argv = argvObj.argv();
+      auto options = BethYw::cxxoptsSetup();
+      auto args = options.parse(argc, argv);
+
+      std::ostringstream fromMemory, err;
+      REQUIRE( BethYw::runQuery(args, fromMemory, err, &resident) == 0 );
+      REQUIRE( fromMemory.str() == "{}\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an invalid predicate" ) {
+
+    Argv argv({"test", "--where", "pop>>5"});
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+    auto options = BethYw::cxxoptsSetup();
+    auto args = options.parse(argc, actual_argv);
+
+    THEN( "it is rejected before anything is imported" ) {
+
+      std::ostringstream out, err;
+      REQUIRE( BethYw::runQuery(args, out, err) == 1 );
+      REQUIRE( err.str() == "Invalid input for where argument: pop>>5\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,168 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../areastream.h"
+#include "../bethyw.h"
+#include "../compiledfilter.h"
+
+namespace {
+
+/*
+  Write a small StatsWales-style file for the population density dataset,
+  with its rows in the given order of authority codes.
+*/
+void test33Write(const std::string &path, const std::vector<std::string> &codes) {
+  std::ofstream file(path);
+  file << "{\"odata.metadata\":\"test\",\"value\":[";
+  for (size_t i = 0; i < codes.size(); i++) {
+    file << (i ? "," : "")
+         << "{\"Localauthority_Code\":\"" << codes[i] << "\","
+         << "\"Localauthority_ItemName_ENG\":\"Area \\\"" << codes[i] << "\\\"\","
+         << "\"Measure_Code\":\"Pop\",\"Measure_ItemName_ENG\":\"Population\","
+         << "\"Year_Code\":\"" << 2000 + i << "\",\"Data\":" << 10 * i + 1 << "}";
+  }
+  file << "],\"odata.nextLink\":{\"value\":[]}}";
+}
+
+/*
+  Run a query and return its output.
+*/
+std::string test33Run(const std::vector<std::string> &arguments) {
+  std::ostringstream out, err;
+  REQUIRE( BethYw::runArguments(arguments, out, err) == 0 );
+  return out.str();
+}
+
+} // namespace
+
+SCENARIO( "A sorted file is read one area at a time", "[AreaStream]" ) {
+
+  const BethYw::InputFileSource &popden = BethYw::InputFiles::POPDEN;
+  const BethYw::InputFileSource source = {popden.CODE, popden.NAME, "test33-popden.json",
+                                          popden.PARSER, popden.COLS};
+
+  GIVEN( "a StatsWales file sorted by authority code" ) {
+
+    test33Write("test33-popden.json", {"W06000001", "W06000001", "W06000002", "W06000011"});
+
+    THEN( "it is found to be sorted and its groups import what the whole file does" ) {
+
+      REQUIRE( AreaStream::sorted("test33-popden.json", source) );
+
+      std::unordered_set<std::string> noFilter;
+      std::tuple<unsigned int, unsigned int> allYears(0, 0);
+      const CompiledFilter filter(&noFilter, &noFilter, &allYears);
+
+      Areas whole = Areas();
+      std::ifstream file("test33-popden.json");
+      auto cols = source.COLS;
+      whole.populate(file, source.PARSER, cols, filter);
+
+      AreaStream stream("test33-popden.json", source);
+      Areas grouped = Areas();
+      std::vector<std::string> codes;
+      while (!stream.done()) {
+        codes.push_back(stream.code());
+        Areas area = Areas();
+        stream.next(area, filter);
+        REQUIRE( area.size() == 1 );
+        grouped.mergeFiltered(area, nullptr, nullptr, nullptr);
+      }
+
+      REQUIRE( codes == std::vector<std::string>({"W06000001", "W06000002", "W06000011"}) );
+      REQUIRE( grouped.toJSON() == whole.toJSON() );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a StatsWales file that is not sorted" ) {
+
+    test33Write("test33-popden.json", {"W06000002", "W06000001"});
+
+    THEN( "it is found not to be" ) {
+
+      REQUIRE_FALSE( AreaStream::sorted("test33-popden.json", source) );
+
+    } // THEN
+
+  } // GIVEN
+
+  std::remove("test33-popden.json");
+
+  THEN( "the shipped CSV files are sorted and the JSON files are not" ) {
+
+    REQUIRE( AreaStream::sorted("datasets/areas.csv", BethYw::InputFiles::AREAS) );
+    REQUIRE( AreaStream::sorted("datasets/complete-popu1009-pop.csv",
+                                BethYw::InputFiles::COMPLETE_POP) );
+    REQUIRE_FALSE( AreaStream::sorted("datasets/popu1009.json", popden) );
+    REQUIRE_FALSE( AreaStream::sorted("datasets/missing.json", popden) );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "The stream argument gives the same output as a normal run", "[args][stream]" ) {
+
+  const std::vector<std::vector<std::string>> queries = {
+    {"-d", "complete-pop,complete-popden,complete-area"},
+    {"-d", "complete-pop", "-j"},
+    {"-d", "complete-pop,complete-area", "--format", "ndjson"},
+    {"-d", "complete-popden", "--format", "csv", "--stats"},
+    {"-d", "complete-pop", "-a", "Swansea,W06000001", "-y", "2012-2014", "--format", "tsv"},
+    {"-d", "complete-pop", "--fill", "linear", "-y", "2010-2015", "-j"},
+    {"-d", "complete-pop", "-a", "doesnotexist", "-j"},
+    {"-d", "popden,complete-pop", "-j"},
+    {"-d", "complete-pop", "-p", "50"},
+  };
+
+  for (const auto &query : queries) {
+    std::vector<std::string> streamed = query;
+    streamed.push_back("--stream");
+    REQUIRE( test33Run(streamed) == test33Run(query) );
+  }
+
+  GIVEN( "sorted and unsorted datasets" ) {
+
+    std::string dir = "datasets/";
+    std::unordered_set<std::string> noFilter;
+    std::tuple<unsigned int, unsigned int> allYears(0, 0);
+    auto args = BethYw::parseArguments({"-j"});
+
+    THEN( "only the sorted ones are merged, and nothing is written otherwise" ) {
+
+      std::ostringstream sorted, unsorted;
+      REQUIRE( BethYw::streamDatasets(args, dir, {BethYw::InputFiles::COMPLETE_POP},
+                                      noFilter, noFilter, allYears, sorted) );
+      REQUIRE( !sorted.str().empty() );
+      REQUIRE_FALSE( BethYw::streamDatasets(args, dir, {BethYw::InputFiles::POPDEN},
+                                            noFilter, noFilter, allYears, unsorted) );
+      REQUIRE( unsorted.str().empty() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
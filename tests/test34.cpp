@@ -0,0 +1,146 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+
+#include "../datasets.h"
+#include "../area.h"
+#include "../areas.h"
+#include "../areastream.h"
+#include "../bethyw.h"
+#include "../compiledfilter.h"
+#include "../measure.h"
+#include "../spilledareas.h"
+
+namespace {
+
+/*
+  Run a query and return its output.
+*/
+std::string test34Run(const std::vector<std::string> &arguments) {
+  std::ostringstream out, err;
+  REQUIRE( BethYw::runArguments(arguments, out, err) == 0 );
+  return out.str();
+}
+
+} // namespace
+
+SCENARIO( "Counts are not limited to unsigned int", "[SpilledAreas]" ) {
+
+  REQUIRE( std::is_same<decltype(Areas().size()), size_t>::value );
+  REQUIRE( std::is_same<decltype(Area("W06000011").size()), size_t>::value );
+  REQUIRE( std::is_same<decltype(Measure("pop", "Population").size()), size_t>::value );
+
+} // SCENARIO
+
+SCENARIO( "Spilled areas are rebuilt as importing everything at once would", "[SpilledAreas]" ) {
+
+  GIVEN( "unsorted datasets read a few rows at a time" ) {
+
+    const std::vector<BethYw::InputFileSource> sources = {
+      BethYw::InputFiles::AREAS,
+      BethYw::InputFiles::POPDEN,
+      BethYw::InputFiles::BIZ,
+      BethYw::InputFiles::COMPLETE_POP,
+    };
+    std::unordered_set<std::string> noFilter;
+    std::tuple<unsigned int, unsigned int> allYears(0, 0);
+    const CompiledFilter filter(&noFilter, &noFilter, &allYears);
+
+    Areas whole = Areas();
+    for (const auto &source : sources) {
+      std::ifstream file("datasets/" + source.FILE);
+      auto cols = source.COLS;
+      whole.populate(file, source.PARSER, cols, filter);
+    }
+
+    // Small enough to spill well over MAX_MERGE_RUNS runs
+    SpilledAreas spilled(1024);
+    for (const auto &source : sources) {
+      AreaStream stream("datasets/" + source.FILE, source);
+      while (!stream.done()) {
+        Areas chunk = Areas();
+        stream.nextRows(chunk, filter, 8192);
+        spilled.add(chunk);
+      }
+    }
+
+    THEN( "every value is spilled to a run" ) {
+
+      REQUIRE( spilled.runCount() > SpilledAreas::MAX_MERGE_RUNS );
+      REQUIRE( spilled.areaCount() == whole.size() );
+
+    } // THEN
+
+    THEN( "the areas come back in code order with the same names and values" ) {
+
+      Areas rebuilt = Areas();
+      std::string previous;
+      spilled.forEachArea([&rebuilt, &previous](Areas &area) {
+        REQUIRE( area.size() == 1 );
+        REQUIRE( area.getAreasContainer().begin()->first > previous );
+        previous = area.getAreasContainer().begin()->first;
+        rebuilt.mergeFiltered(area, nullptr, nullptr, nullptr);
+      });
+
+      REQUIRE( rebuilt.size() == whole.size() );
+      REQUIRE( rebuilt.toJSON() == whole.toJSON() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "The memory-limit argument gives the same output as a normal run", "[args][memory-limit]" ) {
+
+  const std::vector<std::vector<std::string>> queries = {
+    {"-d", "popden,biz,complete-pop"},
+    {"-d", "popden,trains", "-j"},
+    {"-d", "aqi,complete-area", "--format", "ndjson"},
+    {"-d", "popden", "--format", "csv", "--stats"},
+    {"-d", "biz", "-a", "Swansea,W06000001", "-y", "2012-2014", "--format", "tsv"},
+    {"-d", "popden", "--fill", "linear", "-y", "2010-2015", "-j"},
+    {"-d", "popden", "-a", "doesnotexist", "-j"},
+    {"-d", "complete-pop", "--stream", "-j"},
+    {"-d", "popden", "-p", "50"},
+  };
+
+  for (const auto &query : queries) {
+    std::vector<std::string> limited = query;
+    limited.push_back("--memory-limit");
+    limited.push_back("1");
+    REQUIRE( test34Run(limited) == test34Run(query) );
+  }
+
+  THEN( "an invalid limit is rejected" ) {
+
+    for (const std::string limit : {"0", "-1", "abc", "2000000"}) {
+      auto args = BethYw::parseArguments({"--memory-limit", limit});
+
+      REQUIRE_THROWS_AS( BethYw::parseMemoryLimitArg(args), std::invalid_argument );
+      REQUIRE_THROWS_WITH( BethYw::parseMemoryLimitArg(args),
+                           "Invalid input for memory-limit argument" );
+    }
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,181 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../areastream.h"
+#include "../datasetgenerator.h"
+
+namespace {
+
+/*
+  Import a generated file with no filters.
+*/
+Areas test35Import(const std::string &text, const BethYw::InputFileSource &source) {
+  std::unordered_set<std::string> noFilter;
+  std::tuple<unsigned int, unsigned int> allYears(0, 0);
+  std::istringstream is(text);
+  auto cols = source.COLS;
+  Areas areas = Areas();
+  areas.populate(is, source.PARSER, cols, &noFilter, &noFilter, &allYears);
+  return areas;
+}
+
+std::string test35Write(const DatasetGenerator &generator, const BethYw::InputFileSource &source) {
+  std::ostringstream os;
+  generator.write(os, source);
+  return os.str();
+}
+
+} // namespace
+
+SCENARIO( "Generated files have the shapes their parsers read", "[DatasetGenerator]" ) {
+
+  GeneratorSettings settings;
+  settings.areas = 37;
+  settings.measures = 4;
+  settings.years = 11;
+  settings.missing = 0.2;
+  settings.order = GeneratedOrder::Shuffled;
+  settings.seed = 42;
+  const DatasetGenerator generator(settings);
+
+  GIVEN( "areas.csv" ) {
+
+    const Areas areas = test35Import(test35Write(generator, BethYw::InputFiles::AREAS),
+                                     BethYw::InputFiles::AREAS);
+
+    THEN( "every area is imported with its names" ) {
+
+      REQUIRE( areas.size() == 37 );
+      const Area &first = areas.getAreasContainer().at(generator.code(0));
+      REQUIRE( first.getNames().at("eng") == "Area 1" );
+      REQUIRE( first.getNames().at("cym") == "Ardal 1" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "every dataset" ) {
+
+    for (const auto &source : BethYw::InputFiles::DATASETS) {
+      const Areas areas = test35Import(test35Write(generator, source), source);
+
+      THEN( "every value that is not missing is imported: " + source.CODE ) {
+
+        const uint32_t measures = generator.measureCount(source);
+        size_t expected = 0, imported = 0;
+        for (uint32_t area = 0; area < settings.areas; area++) {
+          for (uint32_t measure = 0; measure < measures; measure++) {
+            for (uint32_t year = 0; year < settings.years; year++) {
+              expected += !generator.isMissing(source, area, measure, year);
+            }
+          }
+        }
+        for (const auto &area : areas.getAreasContainer()) {
+          for (const auto &measure : area.second.getMeasures()) {
+            imported += measure.second.size();
+          }
+        }
+        REQUIRE( expected > 0 );
+        REQUIRE( imported == expected );
+
+        // Spot check the values of the first area's first measure
+        const Area &first = areas.getAreasContainer().at(generator.code(0));
+        const Measure &measure = first.getMeasures().begin()->second;
+        for (uint32_t year = 0; year < settings.years; year++) {
+          const auto value = measure.getValues().find(settings.firstYear + year);
+          if (generator.isMissing(source, 0, 0, year)) {
+            REQUIRE( value == measure.getValues().end() );
+          } else {
+            REQUIRE( value->second == generator.value(source, 0, 0, year) );
+          }
+        }
+
+      } // THEN
+    }
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "Generated files are deterministic and hold the same data in any order", "[DatasetGenerator]" ) {
+
+  const BethYw::InputFileSource &popden = BethYw::InputFiles::POPDEN;
+  const BethYw::InputFileSource source = {popden.CODE, popden.NAME, "test35-popden.json",
+                                          popden.PARSER, popden.COLS};
+
+  GeneratorSettings settings;
+  settings.areas = 25;
+  settings.missing = 0.1;
+
+  std::vector<std::string> texts;
+  for (auto order : {GeneratedOrder::Sorted, GeneratedOrder::Interleaved,
+                     GeneratedOrder::Shuffled}) {
+    settings.order = order;
+    texts.push_back(test35Write(DatasetGenerator(settings), source));
+  }
+
+  THEN( "the same settings give the same bytes, and another seed does not" ) {
+
+    settings.order = GeneratedOrder::Shuffled;
+    REQUIRE( test35Write(DatasetGenerator(settings), source) == texts[2] );
+    settings.seed = 2;
+    REQUIRE( test35Write(DatasetGenerator(settings), source) != texts[2] );
+
+  } // THEN
+
+  THEN( "every order imports the same data" ) {
+
+    REQUIRE( texts[0] != texts[1] );
+    REQUIRE( texts[1] != texts[2] );
+    const std::string sorted = test35Import(texts[0], source).toJSON();
+    REQUIRE( test35Import(texts[1], source).toJSON() == sorted );
+    REQUIRE( test35Import(texts[2], source).toJSON() == sorted );
+
+  } // THEN
+
+  THEN( "only the sorted order is sorted by authority code" ) {
+
+    for (size_t i = 0; i < texts.size(); i++) {
+      {
+        std::ofstream file("test35-popden.json");
+        file << texts[i];
+      }
+      REQUIRE( AreaStream::sorted("test35-popden.json", source) == (i == 0) );
+    }
+    std::remove("test35-popden.json");
+
+  } // THEN
+
+  THEN( "invalid settings are rejected" ) {
+
+    REQUIRE_THROWS_AS( DatasetGenerator::parseOrder("random"), std::invalid_argument );
+    settings.missing = 1.5;
+    REQUIRE_THROWS_AS( DatasetGenerator(settings), std::invalid_argument );
+    settings.missing = 0;
+    settings.areas = 0;
+    REQUIRE_THROWS_AS( DatasetGenerator(settings), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,179 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: 956213
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_json.hpp"
+
+#include "../bethyw.h"
+#include "../stageprofiler.h"
+
+namespace {
+
+/*
+  Run a query, with a profiler if one is given, and return its output.
+*/
+std::string test36Run(const std::vector<std::string> &arguments, StageProfiler *profiler) {
+  std::ostringstream out, err;
+  REQUIRE( BethYw::runArguments(arguments, out, err, nullptr, profiler) == 0 );
+  return out.str();
+}
+
+} // namespace
+
+SCENARIO( "A StageProfiler records consecutive stages", "[StageProfiler]" ) {
+
+  GIVEN( "a profiler with three stages" ) {
+
+    StageProfiler profiler;
+    profiler.stage("first", 100, 10);
+    std::vector<std::unique_ptr<int>> allocated;
+    for (int i = 0; i < 50; i++) {
+      allocated.emplace_back(new int(i));
+    }
+    profiler.stage("allocate", 0, 50);
+    profiler.stage("last");
+
+    THEN( "the stages are kept in order with their bytes and rows" ) {
+
+      const auto &stages = profiler.getStages();
+      REQUIRE( stages.size() == 3 );
+      REQUIRE( stages[0].name == "first" );
+      REQUIRE( stages[0].bytes == 100 );
+      REQUIRE( stages[0].rows == 10 );
+      REQUIRE( stages[1].name == "allocate" );
+      REQUIRE( stages[2].name == "last" );
+      for (const auto &stage : stages) {
+        REQUIRE( stage.wallSeconds >= 0 );
+      }
+
+    } // THEN
+
+    THEN( "the allocations of a stage are counted" ) {
+
+      const auto &stages = profiler.getStages();
+      REQUIRE( stages[1].allocations >= 50 );
+      REQUIRE( stages[1].allocatedBytes >= 50 * sizeof(int) );
+
+    } // THEN
+
+    THEN( "the total adds up the stages" ) {
+
+      const auto total = profiler.total();
+      REQUIRE( total.name == "total" );
+      REQUIRE( total.bytes == 100 );
+      REQUIRE( total.rows == 60 );
+      REQUIRE( total.allocations
+               == profiler.getStages()[0].allocations
+                  + profiler.getStages()[1].allocations
+                  + profiler.getStages()[2].allocations );
+
+    } // THEN
+
+    THEN( "the JSON report has every stage and the total" ) {
+
+      std::ostringstream os;
+      profiler.toJSON(os);
+      const auto j = nlohmann::json::parse(os.str());
+      REQUIRE( j["stages"].size() == 3 );
+      REQUIRE( j["stages"][1]["name"] == "allocate" );
+      REQUIRE( j["stages"][1]["rows"] == 50 );
+      REQUIRE( j["total"]["bytes"] == 100 );
+      for (const auto &key : {"wall_seconds", "cpu_seconds", "allocations", "allocated_bytes"}) {
+        REQUIRE( j["total"].count(key) == 1 );
+      }
+
+    } // THEN
+
+    THEN( "the table report has a line for every stage and the total" ) {
+
+      std::ostringstream os;
+      profiler.toTable(os);
+      std::istringstream lines(os.str());
+      std::vector<std::string> names;
+      std::string line;
+      while (std::getline(lines, line)) {
+        names.push_back(line.substr(0, line.find(' ')));
+      }
+      REQUIRE( names == std::vector<std::string>({"Stage", "first", "allocate", "last", "total"}) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "A CountingStreambuf counts the bytes passed through it", "[StageProfiler]" ) {
+
+  std::ostringstream target;
+  CountingStreambuf counter(target.rdbuf());
+  std::ostream counted(&counter);
+
+  counted << "Beth Yw?" << ' ' << 2021 << std::endl;
+  counted.write("abc", 3);
+
+  REQUIRE( target.str() == "Beth Yw? 2021\nabc" );
+  REQUIRE( counter.count() == target.str().size() );
+
+} // SCENARIO
+
+SCENARIO( "Profiling a run leaves its output unchanged", "[StageProfiler]" ) {
+
+  const std::vector<std::vector<std::string>> queries = {
+    {"-d", "popden,complete-pop"},
+    {"-d", "popden", "-a", "swan,W06000011", "-j"},
+    {"-d", "popden", "--percentiles", "50"},
+    {"-d", "popden", "--memory-limit", "1", "--format", "csv"},
+  };
+
+  for (const auto &query : queries) {
+    GIVEN( "bethyw with " + query[1] + (query.size() > 2 ? " " + query[2] : "") ) {
+
+      const std::string plain = test36Run(query, nullptr);
+      StageProfiler profiler;
+      const std::string profiled = test36Run(query, &profiler);
+
+      THEN( "the output is the same" ) {
+
+        REQUIRE( profiled == plain );
+
+      } // THEN
+
+      THEN( "the stages of the run are recorded" ) {
+
+        std::set<std::string> names;
+        for (const auto &stage : profiler.getStages()) {
+          names.insert(stage.name);
+        }
+        REQUIRE( names.count("args") == 1 );
+        if (query.size() == 2) {
+          REQUIRE( names.count("loadAreas") == 1 );
+          REQUIRE( names.count("popden: open") == 1 );
+          REQUIRE( names.count("popden: parse") == 1 );
+          REQUIRE( names.count("popden: merge") == 0 );
+          REQUIRE( names.count("complete-pop: parse") == 1 );
+          REQUIRE( names.count("fill") == 1 );
+          REQUIRE( names.count("render") == 1 );
+          REQUIRE( profiler.getStages().back().bytes == plain.size() );
+        }
+
+      } // THEN
+
+    } // GIVEN
+  }
+
+} // SCENARIO